@@ -1,16 +1,19 @@
 // By Wouter Jansen & Jan Steckel, Cosys-Lab, University of Antwerp. See the LICENSE file for details. 
 
 #include "SonoTrace.h"
+#include "SonoTraceCPU.h"
 #include "GlobalShader.h"
 #include "RHIDefinitions.h"
 #include "Modules/ModuleManager.h"
+#include "Misc/ScopeLock.h"
 #include "../Private/ScenePrivate.h"
 #include "../Private/Nanite/NaniteRayTracing.h"
-#if RHI_RAYTRACING
-#define NUM_THREADS_PER_GROUP_DIMENSION 8
 
 DEFINE_LOG_CATEGORY(SonoTraceUE);
 
+#if RHI_RAYTRACING
+#define NUM_THREADS_PER_GROUP_DIMENSION 8
+
 class FSonoTraceRGS : public FGlobalShader
 {
 	DECLARE_GLOBAL_SHADER(FSonoTraceRGS)
@@ -115,14 +118,130 @@ public:
 };
 IMPLEMENT_GLOBAL_SHADER(FSonoTraceMS, "/Plugin/SonoTraceUE/private/SonoTrace.usf", "SonoTraceMS", SF_RayMiss);
 
+#endif // RHI_RAYTRACING
+
 FSonoTrace::FSonoTrace()
 {
 }
 
+FSonoTraceGPUReadback::FSonoTraceGPUReadback(const FName& RequestName):
+	Readback(MakeUnique<FRHIGPUBufferReadback>(RequestName))
+{
+}
+
+bool FSonoTraceGPUReadback::IsReady()
+{
+	return Readback->IsReady();
+}
+
+uint32 FSonoTraceGPUReadback::GetSizeBytes()
+{
+	return Readback->GetGPUSizeBytes();
+}
+
+bool FSonoTraceGPUReadback::CopyTo(void* Destination, const uint32 NumBytes)
+{
+	const void* Data = Readback->Lock(NumBytes);
+	if (Data)
+		FMemory::Memcpy(Destination, Data, NumBytes);
+	Readback->Unlock();
+	return Data != nullptr;
+}
+
+FSonoTraceCPUReadback::~FSonoTraceCPUReadback()
+{
+	// The trace task writes into the buffer
+	if (Task.IsValid())
+		Task.Wait();
+}
+
+bool FSonoTraceCPUReadback::CopyTo(void* Destination, const uint32 NumBytes)
+{
+	if (NumBytes > GetSizeBytes())
+		return false;
+	FMemory::Memcpy(Destination, Buffer.GetData(), NumBytes);
+	return true;
+}
+
+FSonoTraceReadbackRing::FSonoTraceReadbackRing(TArray<TUniquePtr<ISonoTraceReadback>>&& Readbacks)
+{
+	Slots.SetNum(Readbacks.Num());
+	for (int32 SlotIndex = 0; SlotIndex < Readbacks.Num(); SlotIndex++)
+	{
+		Slots[SlotIndex].Readback = MoveTemp(Readbacks[SlotIndex]);
+	}
+}
+
+int32 FSonoTraceReadbackRing::NumInFlight() const
+{
+	FScopeLock Lock(&CriticalSection);
+	return InFlightCount;
+}
+
+bool FSonoTraceReadbackRing::HasFreeSlot() const
+{
+	FScopeLock Lock(&CriticalSection);
+	return InFlightCount < Slots.Num();
+}
+
+bool FSonoTraceReadbackRing::IsOldestReady() const
+{
+	FScopeLock Lock(&CriticalSection);
+	return InFlightCount > 0 && Slots[OldestSlotIndex].Readback->IsReady();
+}
+
+ISonoTraceReadback* FSonoTraceReadbackRing::BeginTrace(const FSonoTraceFrameInfo& FrameInfo)
+{
+	FScopeLock Lock(&CriticalSection);
+	if (InFlightCount >= Slots.Num())
+		return nullptr;
+	FSlot& Slot = Slots[(OldestSlotIndex + InFlightCount) % Slots.Num()];
+	Slot.FrameInfo = FrameInfo;
+	InFlightCount++;
+	return Slot.Readback.Get();
+}
+
+bool FSonoTraceReadbackRing::PopReady(TArray<FStructuredOutputBufferElem>& OutBuffer, FSonoTraceFrameInfo& OutFrameInfo)
+{
+	FScopeLock Lock(&CriticalSection);
+	if (InFlightCount == 0)
+		return false;
+	FSlot& Slot = Slots[OldestSlotIndex];
+	if (!Slot.Readback->IsReady())
+		return false;
+
+	const uint32 NumBytes = Slot.Readback->GetSizeBytes();
+	OutBuffer.SetNumUninitialized(NumBytes / sizeof(FStructuredOutputBufferElem), EAllowShrinking::No);
+	const bool Success = Slot.Readback->CopyTo(OutBuffer.GetData(), OutBuffer.Num() * sizeof(FStructuredOutputBufferElem));
+	OutFrameInfo = MoveTemp(Slot.FrameInfo);
+	OldestSlotIndex = (OldestSlotIndex + 1) % Slots.Num();
+	InFlightCount--;
+	return Success;
+}
+
+FSonoTrace::FSonoTrace(const float SimulationRate, const bool RunOnTriggerOnly, const bool UseCPUBackend, const int32 NumberOfInFlightTraces):
+	RunRate(SimulationRate),
+	RunOnTriggerOnly(RunOnTriggerOnly)
+{
+	if (UseCPUBackend)
+		CPUBackend = MakeShared<FSonoTraceCPU>();
+
+	TArray<TUniquePtr<ISonoTraceReadback>> Readbacks;
+	for (int32 SlotIndex = 0; SlotIndex < FMath::Max(1, NumberOfInFlightTraces); SlotIndex++)
+	{
+		if (UseCPUBackend)
+			Readbacks.Add(MakeUnique<FSonoTraceCPUReadback>());
+		else
+			Readbacks.Add(MakeUnique<FSonoTraceGPUReadback>(FName(*FString::Printf(TEXT("SonoTraceReadback%d"), SlotIndex))));
+	}
+	ReadbackRing = MakeShared<FSonoTraceReadbackRing, ESPMode::ThreadSafe>(MoveTemp(Readbacks));
+}
+
 void FSonoTrace::BeginRendering()
 {
 	// If the handle is already initialized and valid, no need to do anything
-	if (SonoTraceRenderDelegate.IsValid())
+	// The CPU backend is executed from the game thread and does not need the render delegate
+	if (SonoTraceRenderDelegate.IsValid() || CPUBackend.IsValid())
 		return;
 
 	// Get the Renderer Module
@@ -163,6 +282,57 @@ void FSonoTrace::UpdateParameters(const FSonoTraceParameters& InputParameters)
 	bCachedParamsAreValid = true;
 }
 
+bool FSonoTrace::ShouldExecute()
+{
+	// If using a fixed rate, calculate it here
+	const double CurrentTime = FPlatformTime::Seconds();
+
+	if (!RunOnTriggerOnly)
+	{
+		if (CurrentTime - LastExecutionTime < 1 / RunRate)
+		{
+			return false;
+		}
+		RunState = 1;
+	}else if (RunState != 1)
+	{
+		return false;
+	}
+
+	LastExecutionTime = CurrentTime;
+	ExecutionCounter += 1;
+	CurrentTimestamp = FDateTime::Now().ToUnixTimestamp();
+	return true;
+}
+
+bool FSonoTrace::Execute_GameThread(const TMap<int32, int32>& PersistentPrimitiveIndexToScenePrimitiveIndex)
+{
+	if (!CPUBackend.IsValid() || !bCachedParamsAreValid || !ReadbackRing.IsValid() || !ReadbackRing->HasFreeSlot())
+		return false;
+
+	check(IsInGameThread());
+
+	if (!ShouldExecute())
+		return false;
+
+	FSonoTraceFrameInfo FrameInfo = CachedParams.FrameInfo;
+	FrameInfo.ExecutionCounter = ExecutionCounter;
+	FrameInfo.Timestamp = CurrentTimestamp;
+	ISonoTraceReadback* Readback = ReadbackRing->BeginTrace(FrameInfo);
+	// The instance transforms are snapshotted here, the rays are traced in a task like the GPU trace runs on the GPU.
+	// The slot becomes ready once the task completes, the readback waits for it before it is destroyed.
+	const FSonoTraceCPUScenePtr Scene = CPUBackend->CreateScene(PersistentPrimitiveIndexToScenePrimitiveIndex);
+	Readback->SetCPUTask(UE::Tasks::Launch(UE_SOURCE_LOCATION,
+		[Scene, Parameters = CachedParams, Buffer = Readback->GetCPUBuffer()]()
+		{
+			Scene->Trace(Parameters, *Buffer);
+		}));
+
+	RunState = 2;
+	return true;
+}
+
+#if RHI_RAYTRACING
 void FSonoTrace::BindSonoTraceCHSBindings(FRHICommandList& RHICmdList, const FViewInfo& View, FRHIRayTracingScene* RHIScene, FRHIUniformBuffer* SceneUniformBuffer, FRayTracingPipelineState* PipelineState)
 {
 	FSceneRenderingBulkObjectAllocator Allocator;
@@ -265,24 +435,12 @@ void FSonoTrace::Execute_RenderThread(FPostOpaqueRenderParameters& Parameters)
 	//Render Thread Assertion
 	check(IsInRenderingThread());
 
-	// If using a fixed rate, calculate it here
-	const double CurrentTime = FPlatformTime::Seconds();
-
-	if (!RunOnTriggerOnly)
-	{
-		if (CurrentTime - LastExecutionTime < 1 / RunRate)
-		{
-			return;
-		}
-		RunState = 1;
-	}else if (RunState != 1)
-	{
+	// All readback slots are still waiting to be parsed
+	if (!ReadbackRing.IsValid() || !ReadbackRing->HasFreeSlot())
 		return;
-	}
 
-	LastExecutionTime = CurrentTime;
-	ExecutionCounter += 1;
-	CurrentTimestamp = FDateTime::Now().ToUnixTimestamp();
+	if (!ShouldExecute())
+		return;
 
 	// Setup RGS
 	const FGlobalShaderMap* ShaderMap = GetGlobalShaderMap(GMaxRHIFeatureLevel);
@@ -414,11 +572,16 @@ void FSonoTrace::Execute_RenderThread(FPostOpaqueRenderParameters& Parameters)
 			}
 		}
 	);	
-	AddEnqueueCopyPass(*GraphBuilder, CachedParams.GPUReadback, StructuredOutputBufferRef, NumOutput * sizeof(FStructuredOutputBufferElem));
+	FSonoTraceFrameInfo FrameInfo = CachedParams.FrameInfo;
+	FrameInfo.ExecutionCounter = ExecutionCounter;
+	FrameInfo.Timestamp = CurrentTimestamp;
+	ISonoTraceReadback* Readback = ReadbackRing->BeginTrace(FrameInfo);
+	AddEnqueueCopyPass(*GraphBuilder, Readback->GetGPUReadback(), StructuredOutputBufferRef, NumOutput * sizeof(FStructuredOutputBufferElem));
 
 	RunState = 2;
 }
 #else // !RHI_RAYTRACING
+void FSonoTrace::Execute_RenderThread(FPostOpaqueRenderParameters& Parameters)
 {
 	unimplemented();
 }
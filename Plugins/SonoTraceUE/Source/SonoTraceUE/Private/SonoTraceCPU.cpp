@@ -0,0 +1,768 @@
+// By Wouter Jansen & Jan Steckel, Cosys-Lab, University of Antwerp. See the LICENSE file for details.
+
+#include "SonoTraceCPU.h"
+#include "Async/ParallelFor.h"
+#include "Components/MeshComponent.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "UDynamicMesh.h"
+#include "DynamicMesh/DynamicMesh3.h"
+#include "GeometryScript/SceneUtilityFunctions.h"
+
+namespace SonoTraceCPU
+{
+	// Offset used to avoid intersecting the triangle a bounce or line-of-sight ray starts from
+	constexpr float SelfIntersectionEpsilon = 1e-3f;
+	constexpr int32 NumberOfSAHBins = 16;
+	constexpr int32 MaxSAHLeafSizeForced = 16;
+
+	FORCEINLINE float SurfaceArea(const FBox3f& Box)
+	{
+		if (!Box.IsValid)
+			return 0.0f;
+		const FVector3f Extent = Box.Max - Box.Min;
+		return 2.0f * (Extent.X * Extent.Y + Extent.Y * Extent.Z + Extent.Z * Extent.X);
+	}
+
+	FORCEINLINE FVector3f SafeInverse(const FVector3f& Direction)
+	{
+		constexpr float Tiny = 1e-20f;
+		return FVector3f(1.0f / (FMath::Abs(Direction.X) > Tiny ? Direction.X : Tiny),
+						 1.0f / (FMath::Abs(Direction.Y) > Tiny ? Direction.Y : Tiny),
+						 1.0f / (FMath::Abs(Direction.Z) > Tiny ? Direction.Z : Tiny));
+	}
+
+	FORCEINLINE bool IntersectBounds(const FSonoTraceBVHNode& Node, const FVector3f& Origin, const FVector3f& InvDirection, const float TMax, float& OutTEntry)
+	{
+		const float TX1 = (Node.BoundsMin.X - Origin.X) * InvDirection.X;
+		const float TX2 = (Node.BoundsMax.X - Origin.X) * InvDirection.X;
+		const float TY1 = (Node.BoundsMin.Y - Origin.Y) * InvDirection.Y;
+		const float TY2 = (Node.BoundsMax.Y - Origin.Y) * InvDirection.Y;
+		const float TZ1 = (Node.BoundsMin.Z - Origin.Z) * InvDirection.Z;
+		const float TZ2 = (Node.BoundsMax.Z - Origin.Z) * InvDirection.Z;
+		const float TEntry = FMath::Max3(FMath::Min(TX1, TX2), FMath::Min(TY1, TY2), FMath::Min(TZ1, TZ2));
+		const float TExit = FMath::Min3(FMath::Max(TX1, TX2), FMath::Max(TY1, TY2), FMath::Max(TZ1, TZ2));
+		OutTEntry = TEntry;
+		return TExit >= FMath::Max(TEntry, 0.0f) && TEntry <= TMax;
+	}
+
+	// Front-to-back traversal of a BVH. The leaf function returns true to stop the traversal (any hit queries)
+	// and can lower TMax to prune the remaining nodes (closest hit queries).
+	template <typename LeafFunctionType>
+	FORCEINLINE void TraverseBVH(const FSonoTraceBVH& BVH, const FVector3f& Origin, const FVector3f& InvDirection, float& TMax, LeafFunctionType&& LeafFunction)
+	{
+		struct FStackEntry
+		{
+			int32 NodeIndex;
+			float TEntry;
+		};
+		TArray<FStackEntry, TInlineAllocator<64>> Stack;
+
+		float RootTEntry;
+		if (BVH.IsEmpty() || !IntersectBounds(BVH.Nodes[0], Origin, InvDirection, TMax, RootTEntry))
+			return;
+		Stack.Add({0, RootTEntry});
+
+		while (!Stack.IsEmpty())
+		{
+			const FStackEntry Entry = Stack.Pop(EAllowShrinking::No);
+			if (Entry.TEntry > TMax)
+				continue;
+			const FSonoTraceBVHNode& Node = BVH.Nodes[Entry.NodeIndex];
+			if (Node.Count > 0)
+			{
+				if (LeafFunction(Node.FirstIndex, Node.Count, TMax))
+					return;
+				continue;
+			}
+			float TLeft, TRight;
+			const bool HitLeft = IntersectBounds(BVH.Nodes[Node.FirstIndex], Origin, InvDirection, TMax, TLeft);
+			const bool HitRight = IntersectBounds(BVH.Nodes[Node.FirstIndex + 1], Origin, InvDirection, TMax, TRight);
+			if (HitLeft && HitRight)
+			{
+				// Push the far child first so the near child is visited first
+				if (TLeft <= TRight)
+				{
+					Stack.Add({Node.FirstIndex + 1, TRight});
+					Stack.Add({Node.FirstIndex, TLeft});
+				}else
+				{
+					Stack.Add({Node.FirstIndex, TLeft});
+					Stack.Add({Node.FirstIndex + 1, TRight});
+				}
+			}else if (HitLeft)
+			{
+				Stack.Add({Node.FirstIndex, TLeft});
+			}else if (HitRight)
+			{
+				Stack.Add({Node.FirstIndex + 1, TRight});
+			}
+		}
+	}
+
+	// Möller-Trumbore ray/triangle intersection on the structure-of-arrays triangle storage
+	FORCEINLINE bool IntersectTriangle(const FSonoTraceCPUMesh& Mesh, const int32 Index, const FVector3f& Origin, const FVector3f& Direction, float& OutT)
+	{
+		const float E1X = Mesh.E1X[Index], E1Y = Mesh.E1Y[Index], E1Z = Mesh.E1Z[Index];
+		const float E2X = Mesh.E2X[Index], E2Y = Mesh.E2Y[Index], E2Z = Mesh.E2Z[Index];
+		const float PX = Direction.Y * E2Z - Direction.Z * E2Y;
+		const float PY = Direction.Z * E2X - Direction.X * E2Z;
+		const float PZ = Direction.X * E2Y - Direction.Y * E2X;
+		const float Determinant = E1X * PX + E1Y * PY + E1Z * PZ;
+		if (FMath::Abs(Determinant) < 1e-12f)
+			return false;
+		const float InvDeterminant = 1.0f / Determinant;
+		const float TX = Origin.X - Mesh.V0X[Index];
+		const float TY = Origin.Y - Mesh.V0Y[Index];
+		const float TZ = Origin.Z - Mesh.V0Z[Index];
+		const float U = (TX * PX + TY * PY + TZ * PZ) * InvDeterminant;
+		if (U < 0.0f || U > 1.0f)
+			return false;
+		const float QX = TY * E1Z - TZ * E1Y;
+		const float QY = TZ * E1X - TX * E1Z;
+		const float QZ = TX * E1Y - TY * E1X;
+		const float V = (Direction.X * QX + Direction.Y * QY + Direction.Z * QZ) * InvDeterminant;
+		if (V < 0.0f || U + V > 1.0f)
+			return false;
+		OutT = (E2X * QX + E2Y * QY + E2Z * QZ) * InvDeterminant;
+		return true;
+	}
+}
+
+void FSonoTraceBVH::Reset()
+{
+	Nodes.Reset();
+	PrimitiveOrder.Reset();
+}
+
+void FSonoTraceBVH::Build(const TArray<FBox3f>& PrimitiveBounds, const int32 MaxLeafSize)
+{
+	using namespace SonoTraceCPU;
+
+	Reset();
+	const int32 NumPrimitives = PrimitiveBounds.Num();
+	if (NumPrimitives == 0)
+		return;
+
+	TArray<FVector3f> Centroids;
+	Centroids.SetNumUninitialized(NumPrimitives);
+	PrimitiveOrder.SetNumUninitialized(NumPrimitives);
+	for (int32 PrimitiveIndex = 0; PrimitiveIndex < NumPrimitives; ++PrimitiveIndex)
+	{
+		Centroids[PrimitiveIndex] = PrimitiveBounds[PrimitiveIndex].GetCenter();
+		PrimitiveOrder[PrimitiveIndex] = PrimitiveIndex;
+	}
+
+	struct FBuildRange
+	{
+		int32 NodeIndex;
+		int32 Begin;
+		int32 End;
+	};
+	TArray<FBuildRange, TInlineAllocator<64>> Stack;
+	Nodes.Reserve(2 * NumPrimitives);
+	Nodes.AddZeroed();
+	Stack.Add({0, 0, NumPrimitives});
+
+	while (!Stack.IsEmpty())
+	{
+		const FBuildRange Range = Stack.Pop(EAllowShrinking::No);
+		const int32 Count = Range.End - Range.Begin;
+
+		FBox3f Bounds(ForceInit);
+		FBox3f CentroidBounds(ForceInit);
+		for (int32 OrderIndex = Range.Begin; OrderIndex < Range.End; ++OrderIndex)
+		{
+			Bounds += PrimitiveBounds[PrimitiveOrder[OrderIndex]];
+			CentroidBounds += Centroids[PrimitiveOrder[OrderIndex]];
+		}
+		Nodes[Range.NodeIndex].BoundsMin = Bounds.Min;
+		Nodes[Range.NodeIndex].BoundsMax = Bounds.Max;
+
+		if (Count <= MaxLeafSize)
+		{
+			Nodes[Range.NodeIndex].FirstIndex = Range.Begin;
+			Nodes[Range.NodeIndex].Count = Count;
+			continue;
+		}
+
+		// Binned SAH split search over all three axes
+		int32 BestAxis = -1;
+		int32 BestBin = -1;
+		float BestCost = TNumericLimits<float>::Max();
+		const FVector3f CentroidExtent = CentroidBounds.Max - CentroidBounds.Min;
+		for (int32 Axis = 0; Axis < 3; ++Axis)
+		{
+			if (CentroidExtent[Axis] <= UE_SMALL_NUMBER)
+				continue;
+
+			FBox3f BinBounds[NumberOfSAHBins];
+			int32 BinCounts[NumberOfSAHBins] = {};
+			for (FBox3f& BinBox : BinBounds)
+				BinBox.Init();
+
+			const float BinScale = NumberOfSAHBins / CentroidExtent[Axis];
+			for (int32 OrderIndex = Range.Begin; OrderIndex < Range.End; ++OrderIndex)
+			{
+				const int32 PrimitiveIndex = PrimitiveOrder[OrderIndex];
+				const int32 Bin = FMath::Min(NumberOfSAHBins - 1, static_cast<int32>((Centroids[PrimitiveIndex][Axis] - CentroidBounds.Min[Axis]) * BinScale));
+				BinCounts[Bin]++;
+				BinBounds[Bin] += PrimitiveBounds[PrimitiveIndex];
+			}
+
+			float RightAreas[NumberOfSAHBins - 1];
+			int32 RightCounts[NumberOfSAHBins - 1];
+			FBox3f Accumulated(ForceInit);
+			int32 AccumulatedCount = 0;
+			for (int32 Bin = NumberOfSAHBins - 1; Bin > 0; --Bin)
+			{
+				Accumulated += BinBounds[Bin];
+				AccumulatedCount += BinCounts[Bin];
+				RightCounts[Bin - 1] = AccumulatedCount;
+				RightAreas[Bin - 1] = SurfaceArea(Accumulated);
+			}
+			Accumulated.Init();
+			AccumulatedCount = 0;
+			for (int32 Bin = 0; Bin < NumberOfSAHBins - 1; ++Bin)
+			{
+				Accumulated += BinBounds[Bin];
+				AccumulatedCount += BinCounts[Bin];
+				if (AccumulatedCount == 0 || RightCounts[Bin] == 0)
+					continue;
+				const float Cost = AccumulatedCount * SurfaceArea(Accumulated) + RightCounts[Bin] * RightAreas[Bin];
+				if (Cost < BestCost)
+				{
+					BestCost = Cost;
+					BestAxis = Axis;
+					BestBin = Bin;
+				}
+			}
+		}
+
+		// Make a leaf when splitting is not worth it, but never allow very large leaves
+		const float LeafCost = Count * SurfaceArea(Bounds);
+		if (BestAxis != -1 && BestCost >= LeafCost && Count <= MaxSAHLeafSizeForced)
+		{
+			Nodes[Range.NodeIndex].FirstIndex = Range.Begin;
+			Nodes[Range.NodeIndex].Count = Count;
+			continue;
+		}
+
+		int32 Middle = Range.Begin;
+		if (BestAxis != -1)
+		{
+			const float BinScale = NumberOfSAHBins / CentroidExtent[BestAxis];
+			for (int32 OrderIndex = Range.Begin; OrderIndex < Range.End; ++OrderIndex)
+			{
+				const int32 PrimitiveIndex = PrimitiveOrder[OrderIndex];
+				const int32 Bin = FMath::Min(NumberOfSAHBins - 1, static_cast<int32>((Centroids[PrimitiveIndex][BestAxis] - CentroidBounds.Min[BestAxis]) * BinScale));
+				if (Bin <= BestBin)
+				{
+					Swap(PrimitiveOrder[OrderIndex], PrimitiveOrder[Middle]);
+					Middle++;
+				}
+			}
+		}
+		// All centroids coincide or the partition is degenerate, split in half
+		if (Middle == Range.Begin || Middle == Range.End)
+			Middle = Range.Begin + Count / 2;
+
+		const int32 LeftNodeIndex = Nodes.Num();
+		Nodes.AddZeroed(2);
+		Nodes[Range.NodeIndex].FirstIndex = LeftNodeIndex;
+		Nodes[Range.NodeIndex].Count = 0;
+		Stack.Add({LeftNodeIndex, Range.Begin, Middle});
+		Stack.Add({LeftNodeIndex + 1, Middle, Range.End});
+	}
+	Nodes.Shrink();
+}
+
+void FSonoTraceCPUMesh::Build(const TArray<FVector3f>& Vertices, const TArray<FIntVector>& Triangles)
+{
+	const int32 NumTriangles = Triangles.Num();
+	TArray<FBox3f> TriangleBounds;
+	TriangleBounds.SetNumUninitialized(NumTriangles);
+	LocalBounds.Init();
+	for (int32 Index = 0; Index < NumTriangles; ++Index)
+	{
+		FBox3f Box(ForceInit);
+		Box += Vertices[Triangles[Index].X];
+		Box += Vertices[Triangles[Index].Y];
+		Box += Vertices[Triangles[Index].Z];
+		TriangleBounds[Index] = Box;
+		LocalBounds += Box;
+	}
+	BVH.Build(TriangleBounds, 4);
+
+	for (TArray<float>* Array : {&V0X, &V0Y, &V0Z, &E1X, &E1Y, &E1Z, &E2X, &E2Y, &E2Z, &NX, &NY, &NZ})
+	{
+		Array->SetNumUninitialized(NumTriangles);
+	}
+	TriangleIndex.SetNumUninitialized(NumTriangles);
+
+	// Store the triangles in leaf order
+	for (int32 OrderIndex = 0; OrderIndex < NumTriangles; ++OrderIndex)
+	{
+		const int32 Index = BVH.PrimitiveOrder[OrderIndex];
+		const FVector3f& V0 = Vertices[Triangles[Index].X];
+		const FVector3f E1 = Vertices[Triangles[Index].Y] - V0;
+		const FVector3f E2 = Vertices[Triangles[Index].Z] - V0;
+		V0X[OrderIndex] = V0.X; V0Y[OrderIndex] = V0.Y; V0Z[OrderIndex] = V0.Z;
+		E1X[OrderIndex] = E1.X; E1Y[OrderIndex] = E1.Y; E1Z[OrderIndex] = E1.Z;
+		E2X[OrderIndex] = E2.X; E2Y[OrderIndex] = E2.Y; E2Z[OrderIndex] = E2.Z;
+		const FVector3f Normal = GetWindingNormal(V0, Vertices[Triangles[Index].Y], Vertices[Triangles[Index].Z]);
+		NX[OrderIndex] = Normal.X; NY[OrderIndex] = Normal.Y; NZ[OrderIndex] = Normal.Z;
+		TriangleIndex[OrderIndex] = Index;
+	}
+}
+
+bool FSonoTraceCPUMesh::IntersectClosest(const FVector3f& Origin, const FVector3f& Direction, const float TMin, const bool CullBackFacing, float& InOutTMax, int32& OutTriangleIndex, FVector3f& OutNormal) const
+{
+	int32 HitOrderIndex = -1;
+	SonoTraceCPU::TraverseBVH(BVH, Origin, SonoTraceCPU::SafeInverse(Direction), InOutTMax,
+		[&](const int32 First, const int32 Count, float& TMax)
+		{
+			for (int32 Index = First; Index < First + Count; ++Index)
+			{
+				if (CullBackFacing && Direction.X * NX[Index] + Direction.Y * NY[Index] + Direction.Z * NZ[Index] > 0.0f)
+					continue;
+				float T;
+				if (SonoTraceCPU::IntersectTriangle(*this, Index, Origin, Direction, T) && T > TMin && T < TMax)
+				{
+					TMax = T;
+					HitOrderIndex = Index;
+				}
+			}
+			return false;
+		});
+	if (HitOrderIndex == -1)
+		return false;
+	OutTriangleIndex = TriangleIndex[HitOrderIndex];
+	OutNormal = FVector3f(NX[HitOrderIndex], NY[HitOrderIndex], NZ[HitOrderIndex]);
+	return true;
+}
+
+bool FSonoTraceCPUMesh::IntersectAny(const FVector3f& Origin, const FVector3f& Direction, const float TMin, const float TMax) const
+{
+	bool IsHit = false;
+	float CurrentTMax = TMax;
+	SonoTraceCPU::TraverseBVH(BVH, Origin, SonoTraceCPU::SafeInverse(Direction), CurrentTMax,
+		[&](const int32 First, const int32 Count, float& LeafTMax)
+		{
+			for (int32 Index = First; Index < First + Count; ++Index)
+			{
+				float T;
+				if (SonoTraceCPU::IntersectTriangle(*this, Index, Origin, Direction, T) && T > TMin && T < LeafTMax)
+				{
+					IsHit = true;
+					return true;
+				}
+			}
+			return false;
+		});
+	return IsHit;
+}
+
+FSonoTraceCPUMeshPtr FSonoTraceCPU::CreateMesh(UMeshComponent* MeshComponent)
+{
+	UDynamicMesh* DynamicMesh = NewObject<UDynamicMesh>();
+
+	FGeometryScriptCopyMeshFromComponentOptions Options;
+	Options.bWantNormals = true;
+	Options.bWantTangents = false;
+	Options.bWantInstanceColors = false;
+
+	FTransform DummyTransform;
+	EGeometryScriptOutcomePins Outcome;
+	UGeometryScriptLibrary_SceneUtilityFunctions::CopyMeshFromComponent(MeshComponent, DynamicMesh, Options, false, DummyTransform, Outcome, nullptr);
+	if (Outcome != EGeometryScriptOutcomePins::Success)
+	{
+		UE_LOG(SonoTraceUE, Error, TEXT("CPU raytracing could not convert mesh of component '%s' to triangles."), *MeshComponent->GetName());
+		return nullptr;
+	}
+	const FDynamicMesh3* Mesh = DynamicMesh->GetMeshPtr();
+	if (!Mesh)
+	{
+		UE_LOG(SonoTraceUE, Error, TEXT("CPU raytracing could not access the mesh data of component '%s'."), *MeshComponent->GetName());
+		return nullptr;
+	}
+
+	// Compact the vertices and keep the triangle order identical to the one used when generating the mesh data
+	TArray<FVector3f> Vertices;
+	TArray<int32> VertexRemap;
+	VertexRemap.Init(INDEX_NONE, Mesh->MaxVertexID());
+	for (const int32 VertexID : Mesh->VertexIndicesItr())
+	{
+		VertexRemap[VertexID] = Vertices.Add(FVector3f(Mesh->GetVertex(VertexID)));
+	}
+	// The front side follows the winding as in the shader, not the vertex normals, so both backends cull and reflect on the same side
+	TArray<FIntVector> Triangles;
+	Triangles.Reserve(Mesh->TriangleCount());
+	for (const int32 TriangleID : Mesh->TriangleIndicesItr())
+	{
+		const UE::Geometry::FIndex3i TriVertices = Mesh->GetTriangle(TriangleID);
+		Triangles.Add(FIntVector(VertexRemap[TriVertices.A], VertexRemap[TriVertices.B], VertexRemap[TriVertices.C]));
+	}
+
+	TSharedPtr<FSonoTraceCPUMesh, ESPMode::ThreadSafe> NewMesh = MakeShared<FSonoTraceCPUMesh, ESPMode::ThreadSafe>();
+	NewMesh->Build(Vertices, Triangles);
+	return NewMesh;
+}
+
+bool FSonoTraceCPU::AddMeshComponent(UMeshComponent* MeshComponent, const UObject* MeshAsset, const int32 PersistentPrimitiveIndex)
+{
+	check(IsInGameThread());
+	if (!MeshComponent || !MeshAsset)
+		return false;
+	for (const FSonoTraceCPUInstance& Instance : Instances)
+	{
+		if (Instance.MeshComponent.Get() == MeshComponent)
+			return false;
+	}
+
+	FSonoTraceCPUMeshPtr Mesh;
+	if (const FSonoTraceCPUMeshPtr* ExistingMesh = Meshes.Find(MeshAsset))
+	{
+		Mesh = *ExistingMesh;
+	}else
+	{
+		const double CurrentTime = FPlatformTime::Seconds();
+		Mesh = CreateMesh(MeshComponent);
+		if (!Mesh.IsValid())
+			return false;
+		Meshes.Add(MeshAsset, Mesh);
+		UE_LOG(SonoTraceUE, Log, TEXT("Built CPU raytracing BVH for '%s' with %i triangles and %i nodes in %.5fs."),
+			   *MeshAsset->GetName(), Mesh->Num(), Mesh->BVH.Nodes.Num(), FPlatformTime::Seconds() - CurrentTime);
+	}
+
+	FSonoTraceCPUInstance NewInstance;
+	NewInstance.MeshComponent = MeshComponent;
+	NewInstance.Mesh = Mesh;
+	NewInstance.PersistentPrimitiveIndex = PersistentPrimitiveIndex;
+	if (const UInstancedStaticMeshComponent* InstancedMeshComponent = Cast<UInstancedStaticMeshComponent>(MeshComponent))
+	{
+		for (int32 InstanceIndex = 0; InstanceIndex < InstancedMeshComponent->GetInstanceCount(); ++InstanceIndex)
+		{
+			NewInstance.InstanceIndex = InstanceIndex;
+			Instances.Add(NewInstance);
+		}
+	}else
+	{
+		Instances.Add(NewInstance);
+	}
+	return true;
+}
+
+bool FSonoTraceCPU::RemoveMeshComponent(const UMeshComponent* MeshComponent)
+{
+	check(IsInGameThread());
+	// Instanced components own an entry per instance
+	if (Instances.RemoveAllSwap([MeshComponent](const FSonoTraceCPUInstance& Instance) { return Instance.MeshComponent.Get() == MeshComponent; }) == 0)
+		return false;
+	// Release the mesh geometry when no instance uses it anymore, scenes of running traces keep their own reference
+	TSet<const FSonoTraceCPUMesh*> UsedMeshes;
+	for (const FSonoTraceCPUInstance& Instance : Instances)
+	{
+		UsedMeshes.Add(Instance.Mesh.Get());
+	}
+	for (auto MeshIterator = Meshes.CreateIterator(); MeshIterator; ++MeshIterator)
+	{
+		if (!UsedMeshes.Contains(MeshIterator.Value().Get()))
+			MeshIterator.RemoveCurrent();
+	}
+	return true;
+}
+
+bool FSonoTraceCPU::AddMesh(const FSonoTraceCPUMeshPtr& Mesh, const FTransform& Transform, const int32 PersistentPrimitiveIndex)
+{
+	if (!Mesh.IsValid())
+		return false;
+	for (const FSonoTraceCPUInstance& Instance : Instances)
+	{
+		if (Instance.HasFixedTransform && Instance.Mesh == Mesh)
+			return false;
+	}
+	FSonoTraceCPUInstance& NewInstance = Instances.AddDefaulted_GetRef();
+	NewInstance.Mesh = Mesh;
+	NewInstance.PersistentPrimitiveIndex = PersistentPrimitiveIndex;
+	NewInstance.HasFixedTransform = true;
+	NewInstance.FixedTransform = Transform;
+	return true;
+}
+
+bool FSonoTraceCPU::RemoveMesh(const FSonoTraceCPUMesh* Mesh)
+{
+	// The mesh is owned by the caller, scenes of running traces keep their own reference
+	return Instances.RemoveAllSwap([Mesh](const FSonoTraceCPUInstance& Instance) { return Instance.HasFixedTransform && Instance.Mesh.Get() == Mesh; }) > 0;
+}
+
+FSonoTraceCPUScenePtr FSonoTraceCPU::CreateScene(const TMap<int32, int32>& PersistentPrimitiveIndexToScenePrimitiveIndex) const
+{
+	check(IsInGameThread());
+	TArray<FSonoTraceCPUScene::FInstance> SceneInstances;
+	SceneInstances.Reserve(Instances.Num());
+	for (const FSonoTraceCPUInstance& Instance : Instances)
+	{
+		if (!Instance.Mesh.IsValid() || Instance.Mesh->BVH.IsEmpty())
+			continue;
+		FTransform Transform = Instance.FixedTransform;
+		if (!Instance.HasFixedTransform)
+		{
+			const UMeshComponent* MeshComponent = Instance.MeshComponent.Get();
+			if (!MeshComponent || !MeshComponent->IsRegistered() || !MeshComponent->IsVisible())
+				continue;
+			Transform = MeshComponent->GetComponentTransform();
+			if (Instance.InstanceIndex != INDEX_NONE)
+			{
+				const UInstancedStaticMeshComponent* InstancedMeshComponent = Cast<UInstancedStaticMeshComponent>(MeshComponent);
+				if (!InstancedMeshComponent || !InstancedMeshComponent->GetInstanceTransform(Instance.InstanceIndex, Transform, true))
+					continue;
+			}
+		}
+		const FMatrix LocalToWorld = Transform.ToMatrixWithScale();
+		FSonoTraceCPUScene::FInstance& SceneInstance = SceneInstances.AddDefaulted_GetRef();
+		SceneInstance.Mesh = Instance.Mesh;
+		SceneInstance.LocalToWorld = FMatrix44f(LocalToWorld);
+		SceneInstance.WorldToLocal = FMatrix44f(LocalToWorld.Inverse());
+		const int32* ScenePrimitiveIndex = PersistentPrimitiveIndexToScenePrimitiveIndex.Find(Instance.PersistentPrimitiveIndex);
+		SceneInstance.ScenePrimitiveIndex = ScenePrimitiveIndex ? *ScenePrimitiveIndex : -1;
+	}
+	TSharedPtr<FSonoTraceCPUScene, ESPMode::ThreadSafe> Scene = MakeShared<FSonoTraceCPUScene, ESPMode::ThreadSafe>();
+	Scene->Build(MoveTemp(SceneInstances));
+	return Scene;
+}
+
+void FSonoTraceCPU::Trace(const FSonoTraceParameters& Parameters, const TMap<int32, int32>& PersistentPrimitiveIndexToScenePrimitiveIndex, TArray<FStructuredOutputBufferElem>& OutputBuffer) const
+{
+	CreateScene(PersistentPrimitiveIndexToScenePrimitiveIndex)->Trace(Parameters, OutputBuffer);
+}
+
+void FSonoTraceCPUScene::Build(TArray<FInstance>&& InInstances)
+{
+	Instances = MoveTemp(InInstances);
+	TArray<FBox3f> InstanceBounds;
+	InstanceBounds.SetNumUninitialized(Instances.Num());
+	for (int32 InstanceIndex = 0; InstanceIndex < Instances.Num(); ++InstanceIndex)
+	{
+		InstanceBounds[InstanceIndex] = Instances[InstanceIndex].Mesh->LocalBounds.TransformBy(Instances[InstanceIndex].LocalToWorld);
+	}
+	InstanceBVH.Build(InstanceBounds, 1);
+}
+
+bool FSonoTraceCPUScene::TraceClosest(const FVector3f& Origin, const FVector3f& Direction, const float TMin, const float TMax, const bool CullBackFacing, FTraceHit& OutHit) const
+{
+	float ClosestT = TMax;
+	int32 HitInstanceIndex = -1;
+	int32 HitTriangleIndex = -1;
+	FVector3f HitLocalNormal;
+	SonoTraceCPU::TraverseBVH(InstanceBVH, Origin, SonoTraceCPU::SafeInverse(Direction), ClosestT,
+		[&](const int32 First, const int32 Count, float& LeafTMax)
+		{
+			for (int32 OrderIndex = First; OrderIndex < First + Count; ++OrderIndex)
+			{
+				const int32 InstanceIndex = InstanceBVH.PrimitiveOrder[OrderIndex];
+				const FInstance& Instance = Instances[InstanceIndex];
+				// The local direction is not normalized so the hit distance stays expressed in world units
+				const FVector3f LocalOrigin = Instance.WorldToLocal.TransformPosition(Origin);
+				const FVector3f LocalDirection = Instance.WorldToLocal.TransformVector(Direction);
+				if (Instance.Mesh->IntersectClosest(LocalOrigin, LocalDirection, TMin, CullBackFacing, LeafTMax, HitTriangleIndex, HitLocalNormal))
+					HitInstanceIndex = InstanceIndex;
+			}
+			return false;
+		});
+	if (HitInstanceIndex == -1)
+		return false;
+
+	const FInstance& HitInstance = Instances[HitInstanceIndex];
+	OutHit.HitT = ClosestT;
+	OutHit.ScenePrimitiveIndex = HitInstance.ScenePrimitiveIndex;
+	OutHit.TriangleIndex = HitTriangleIndex;
+	OutHit.WorldNormal = HitInstance.WorldToLocal.GetTransposed().TransformVector(HitLocalNormal).GetSafeNormal();
+	return true;
+}
+
+bool FSonoTraceCPUScene::TraceAny(const FVector3f& Origin, const FVector3f& Direction, const float TMin, const float TMax) const
+{
+	bool IsHit = false;
+	float CurrentTMax = TMax;
+	SonoTraceCPU::TraverseBVH(InstanceBVH, Origin, SonoTraceCPU::SafeInverse(Direction), CurrentTMax,
+		[&](const int32 First, const int32 Count, float& LeafTMax)
+		{
+			for (int32 OrderIndex = First; OrderIndex < First + Count; ++OrderIndex)
+			{
+				const FInstance& Instance = Instances[InstanceBVH.PrimitiveOrder[OrderIndex]];
+				if (Instance.Mesh->IntersectAny(Instance.WorldToLocal.TransformPosition(Origin), Instance.WorldToLocal.TransformVector(Direction), TMin, LeafTMax))
+				{
+					IsHit = true;
+					return true;
+				}
+			}
+			return false;
+		});
+	return IsHit;
+}
+
+void FSonoTraceCPUScene::Trace(const FSonoTraceParameters& Parameters, TArray<FStructuredOutputBufferElem>& OutputBuffer) const
+{
+	// Set up all angles and figure out counts, identical to the GPU dispatch
+	uint32 NumOfRays = Parameters.NumDistributionRays;
+	TArray<float> AzimuthAngles = Parameters.DistributionAzimuthAngles;
+	TArray<float> ElevationAngles = Parameters.DistributionElevationAngles;
+	if (Parameters.EnableDirectPath)
+	{
+		NumOfRays += Parameters.DirectPathAzimuthAngles.Num();
+		AzimuthAngles.Append(Parameters.DirectPathAzimuthAngles);
+		ElevationAngles.Append(Parameters.DirectPathElevationAngles);
+	}
+	const uint32 MaxBounces = Parameters.MaxBounces;
+	const uint32 DistributionRayCount = Parameters.NumDistributionRays;
+	const uint32 EmitterCount = FMath::Min(Parameters.EmitterCount, MaxEmitterCount);
+	const float MaxDistance = Parameters.MaxTraceDistance;
+	OutputBuffer.SetNumZeroed(NumOfRays * MaxBounces);
+
+	const FVector3f SensorPosition = FVector3f(Parameters.SensorPosition);
+	TArray<FVector3f> EmitterPositions;
+	for (uint32 EmitterIndex = 0; EmitterIndex < EmitterCount; EmitterIndex++)
+	{
+		EmitterPositions.Add(FVector3f(Parameters.EmitterPositions[EmitterIndex]));
+	}
+
+	// Rotation = Yaw * Pitch * Roll with the same sign conventions as the ray generation shader
+	const float Roll = FMath::DegreesToRadians(-static_cast<float>(Parameters.SensorRotation.Roll));
+	const float Pitch = FMath::DegreesToRadians(-static_cast<float>(Parameters.SensorRotation.Pitch));
+	const float Yaw = FMath::DegreesToRadians(static_cast<float>(Parameters.SensorRotation.Yaw));
+	const float CR = FMath::Cos(Roll), SR = FMath::Sin(Roll);
+	const float CP = FMath::Cos(Pitch), SP = FMath::Sin(Pitch);
+	const float CY = FMath::Cos(Yaw), SY = FMath::Sin(Yaw);
+
+	ParallelFor(static_cast<int32>(NumOfRays), [&](const int32 RayIndex)
+	{
+		const float Azimuth = AzimuthAngles[RayIndex];
+		const float Elevation = ElevationAngles[RayIndex];
+		const FVector3f LocalRayDirection = FVector3f(FMath::Cos(Elevation) * FMath::Cos(Azimuth),
+													  FMath::Cos(Elevation) * FMath::Sin(Azimuth),
+													  FMath::Sin(Elevation)).GetSafeNormal();
+		const FVector3f RolledDirection(LocalRayDirection.X,
+										CR * LocalRayDirection.Y - SR * LocalRayDirection.Z,
+										SR * LocalRayDirection.Y + CR * LocalRayDirection.Z);
+		const FVector3f PitchedDirection(CP * RolledDirection.X + SP * RolledDirection.Z,
+										 RolledDirection.Y,
+										 -SP * RolledDirection.X + CP * RolledDirection.Z);
+		FVector3f WorldRayDirection = FVector3f(CY * PitchedDirection.X - SY * PitchedDirection.Y,
+												SY * PitchedDirection.X + CY * PitchedDirection.Y,
+												PitchedDirection.Z).GetSafeNormal();
+		if (WorldRayDirection.ContainsNaN() || WorldRayDirection.IsNearlyZero())
+			WorldRayDirection = FVector3f(0, 0, 1);
+
+		FVector3f CurrentOrigin = SensorPosition;
+		FVector3f CurrentDirection = WorldRayDirection;
+		float RayTotalDistanceSoFar = 0.0f;
+		float DistanceFromEmitterSoFar[MaxEmitterCount];
+
+		if (static_cast<uint32>(RayIndex) < DistributionRayCount)
+		{
+			for (uint32 BounceIndex = 0; BounceIndex < MaxBounces; BounceIndex++)
+			{
+				FStructuredOutputBufferElem& Output = OutputBuffer[RayIndex * MaxBounces + BounceIndex];
+				FTraceHit Hit;
+				// Only the first bounce starts exactly at the sensor, later bounces start on a surface
+				const float TMin = BounceIndex == 0 ? 0.0f : SonoTraceCPU::SelfIntersectionEpsilon;
+				if (!TraceClosest(CurrentOrigin, CurrentDirection, TMin, MaxDistance, true, Hit))
+				{
+					// No hit: Set IsHit = false for the rest of the bounces
+					for (uint32 RemainingBounceIndex = BounceIndex; RemainingBounceIndex < MaxBounces; RemainingBounceIndex++)
+					{
+						OutputBuffer[RayIndex * MaxBounces + RemainingBounceIndex].IsHit = false;
+					}
+					break;
+				}
+
+				const FVector3f ReflectionDirection = (CurrentDirection - 2.0f * FVector3f::DotProduct(CurrentDirection, Hit.WorldNormal) * Hit.WorldNormal).GetSafeNormal();
+				const FVector3f HitPos = CurrentOrigin + CurrentDirection * Hit.HitT;
+				RayTotalDistanceSoFar += Hit.HitT;
+
+				Output.IsHit = true;
+				Output.HitScenePrimitiveIndex = Hit.ScenePrimitiveIndex;
+				Output.HitTriangleIndex = Hit.TriangleIndex;
+				Output.HitPosX = HitPos.X;
+				Output.HitPosY = HitPos.Y;
+				Output.HitPosZ = HitPos.Z;
+				Output.HitReflectionX = ReflectionDirection.X;
+				Output.HitReflectionY = ReflectionDirection.Y;
+				Output.HitReflectionZ = ReflectionDirection.Z;
+				Output.RayDistanceTotal = RayTotalDistanceSoFar;
+				Output.DirectPath = 0;
+
+				// Calculate the total distance from each emitter to the current hit
+				// Only for the first bounce the distance is different based on the emitter position
+				for (uint32 EmitterIndex = 0; EmitterIndex < EmitterCount; EmitterIndex++)
+				{
+					float DistanceFromEmitter;
+					if (BounceIndex == 0)
+					{
+						DistanceFromEmitter = FVector3f::Distance(HitPos, EmitterPositions[EmitterIndex]);
+						DistanceFromEmitterSoFar[EmitterIndex] = DistanceFromEmitter;
+					}else
+					{
+						DistanceFromEmitter = DistanceFromEmitterSoFar[EmitterIndex] + Hit.HitT;
+					}
+					if (FMath::IsNaN(DistanceFromEmitter))
+					{
+						Output.IsHit = false;
+					}else
+					{
+						Output.DistancesFromEmitterTotal[EmitterIndex] = DistanceFromEmitter;
+					}
+				}
+
+				// Update for next bounce
+				CurrentOrigin = HitPos;
+				CurrentDirection = ReflectionDirection;
+
+				if (BounceIndex > 0) // Skip LOS check for the first bounce
+				{
+					const FVector3f ToSensor = SensorPosition - CurrentOrigin;
+					const float DistanceToSensor = ToSensor.Size();
+					Output.HitLineOfSightToSensor = !TraceAny(CurrentOrigin, ToSensor / FMath::Max(DistanceToSensor, UE_SMALL_NUMBER), SonoTraceCPU::SelfIntersectionEpsilon, DistanceToSensor);
+				}else
+				{
+					Output.HitLineOfSightToSensor = true;
+				}
+			}
+		}else
+		{
+			// The secondary optional component where there is a LOS check between the sensor and the receivers to see
+			// if there is a direct path between them
+			FStructuredOutputBufferElem& Output = OutputBuffer[RayIndex * MaxBounces];
+			FTraceHit Hit;
+			Output.HitScenePrimitiveIndex = -1;
+			Output.HitTriangleIndex = -1;
+			Output.HitReflectionX = CurrentDirection.X;
+			Output.HitReflectionY = CurrentDirection.Y;
+			Output.HitReflectionZ = CurrentDirection.Z;
+			Output.DirectPath = 1;
+			// The closest hit is used as the GPU accept-first-hit result is not guaranteed to be the nearest one
+			if (!TraceClosest(CurrentOrigin, CurrentDirection, 0.0f, MaxDistance, false, Hit))
+			{
+				Output.IsHit = true;
+				Output.HitPosX = CurrentOrigin.X;
+				Output.HitPosY = CurrentOrigin.Y;
+				Output.HitPosZ = CurrentOrigin.Z;
+				Output.RayDistanceTotal = -1;
+			}else
+			{
+				const FVector3f HitPos = CurrentOrigin + CurrentDirection * Hit.HitT;
+				Output.IsHit = false;
+				Output.HitPosX = HitPos.X;
+				Output.HitPosY = HitPos.Y;
+				Output.HitPosZ = HitPos.Z;
+				Output.RayDistanceTotal = Hit.HitT;
+			}
+
+			// No hit: Set IsHit = false for the rest of the bounce fields
+			for (uint32 RemainingBounceIndex = 1; RemainingBounceIndex < MaxBounces; RemainingBounceIndex++)
+			{
+				OutputBuffer[RayIndex * MaxBounces + RemainingBounceIndex].IsHit = false;
+			}
+		}
+	});
+}
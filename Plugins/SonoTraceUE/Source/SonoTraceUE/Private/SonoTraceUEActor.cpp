@@ -8,6 +8,12 @@
 #include "SceneInterface.h"
 #include "Engine/DataTable.h"
 #include "SonoTrace.h"
+#include "SonoTraceCPU.h"
+#include "SonoTraceUEMeshCache.h"
+#include "SonoTraceUEParser.h"
+#include "SonoTraceUEStrengthKernels.h"
+#include "SonoTraceUEStatistics.h"
+#include "SonoTraceUESubsystem.h"
 #include "Math/UnrealMathUtility.h"
 #include <string>
 #include "ObjectDeliverer/Public/Protocol/ProtocolTcpIpClient.h"
@@ -15,6 +21,8 @@
 #include "ObjectDeliverer/Public/PacketRule/PacketRuleSizeBody.h"
 #include "ObjectDeliverer/Public/PacketRule/PacketRuleNodivision.h"
 #include "Components/DynamicMeshComponent.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "LandscapeProxy.h"
 #include "DynamicMesh/DynamicMesh3.h"
 #include "GeometryScript/SceneUtilityFunctions.h"
 #include "MeshCurvature.h"
@@ -65,7 +73,8 @@ void ASonoTraceUEActor::BeginPlay()
 
 	if ((EnableSimulationEnableOverride && EnableSimulation) || (!EnableSimulationEnableOverride && InputSettings->EnableSimulation))
 	{
-		GeneratedSettings = GenerateInputSettings(InputSettings, &AssetToObjectTypeIndexSettings);
+		GeneratedSettings = GenerateInputSettings(InputSettings, nullptr);
+		MeshRegistry = GetWorld()->GetSubsystem<USonoTraceUESubsystem>()->RegisterSensor(this, InputSettings);
 		CurrentEmitterSignalIndexes = GeneratedSettings.DefaultEmitterSignalIndexes;
 
 		if (InputSettings->EnableDirectPathComponentCalculation)
@@ -83,18 +92,10 @@ void ASonoTraceUEActor::BeginPlay()
 
 	if (InputSettings->EnableRaytracing)
 	{
-		SonoTrace = FSonoTrace(InputSettings->SimulationRate, InputSettings->EnableRunSimulationOnlyOnTrigger);
-	
-		if (GPUReadback != nullptr)
-		{
-			UpdateShaderParameters();
-		}else
-		{
-			GPUReadback = new FRHIGPUBufferReadback(TEXT("SonoTraceReadback"));
-		}
+		// Triggered traces are handled one at a time so only continuous mode uses multiple readback slots
+		const int32 NumberOfInFlightTraces = InputSettings->EnableRunSimulationOnlyOnTrigger ? 1 : InputSettings->NumberOfInFlightTraces;
+		SonoTrace = FSonoTrace(InputSettings->SimulationRate, InputSettings->EnableRunSimulationOnlyOnTrigger, InputSettings->RaytracingBackend == ESonoTraceUERaytracingBackendEnum::CPU, NumberOfInFlightTraces);
 	}
-	
-	RandomStream.Initialize(FPlatformTime::Cycles());
 
 	UpdateTransformations();
 	
@@ -104,43 +105,50 @@ void ASonoTraceUEActor::BeginPlay()
 
 void ASonoTraceUEActor::GenerateAllInitialMeshData()
 {
-	for (TActorIterator<AActor> ActorItr(GetWorld()); ActorItr; ++ActorItr)
+	// The first sensor adds the objects of the world, later sensors only need them in their own CPU raytracing scene
+	if (MeshRegistry->InitialMeshDataGenerated)
 	{
-		AddActor(*ActorItr, true, false);
-	}
-}
-
-void ASonoTraceUEActor::UpdateScenePrimitiveIndexToPersistentPrimitiveIndexTable()
-{
-	TArray<int32> PersistentPrimitiveIndexes;
-	ScenePrimitiveIndexToPersistentPrimitiveIndex.GenerateValueArray(PersistentPrimitiveIndexes);
-	ScenePrimitiveIndexToPersistentPrimitiveIndex.Empty();	
-
-	if (PersistentPrimitiveIndexes.Num() > 0)
-	{
-		FScene* RenderScene = GetWorld()->Scene->GetRenderScene();
-		for (int32 PersistentPrimitiveIndex : PersistentPrimitiveIndexes)
+		if (SonoTrace.IsUsingCPUBackend())
 		{
-			FPersistentPrimitiveIndex CurrentPersistentPrimitiveIndex;
-			CurrentPersistentPrimitiveIndex.Index = PersistentPrimitiveIndex;
-			int32 ScenePrimitiveIndex = RenderScene->GetPrimitiveIndex(CurrentPersistentPrimitiveIndex);
-			ScenePrimitiveIndexToPersistentPrimitiveIndex.Add(ScenePrimitiveIndex, PersistentPrimitiveIndex);
+			for (const TPair<int32, UPrimitiveComponent*>& PersistentPrimitiveIndexAndComponent : MeshRegistry->PersistentPrimitiveIndexToPrimitiveComponent)
+			{
+				if (UStaticMeshComponent* StaticMeshComponent = Cast<UStaticMeshComponent>(PersistentPrimitiveIndexAndComponent.Value))
+					SonoTrace.GetCPUBackend()->AddMeshComponent(StaticMeshComponent, StaticMeshComponent->GetStaticMesh(), PersistentPrimitiveIndexAndComponent.Key);
+				else if (USkeletalMeshComponent* SkeletalMeshComponent = Cast<USkeletalMeshComponent>(PersistentPrimitiveIndexAndComponent.Value))
+					SonoTrace.GetCPUBackend()->AddMeshComponent(SkeletalMeshComponent, SkeletalMeshComponent->GetSkeletalMeshAsset(), PersistentPrimitiveIndexAndComponent.Key);
+			}
+			for (const FSonoTraceUELandscape& Landscape : MeshRegistry->Landscapes)
+			{
+				for (const TPair<FIntPoint, FSonoTraceUELandscapeTile>& Tile : Landscape.Tiles)
+				{
+					if (Tile.Value.MeshDataIndex != INDEX_NONE && !Tile.Value.Task.IsValid() && Tile.Value.CPUMesh.IsValid())
+						SonoTrace.GetCPUBackend()->AddMesh(Tile.Value.CPUMesh, Landscape.GetTileTransform(), Landscape.PersistentPrimitiveIndexes[0]);
+				}
+			}
 		}
+		return;
+	}
+	for (TActorIterator<AActor> ActorItr(GetWorld()); ActorItr; ++ActorItr)
+	{
+		AddActor(*ActorItr, true);
 	}
-	UE_LOG(SonoTraceUE, Log, TEXT("Updated SPI to PPI table."));
+	MeshRegistry->InitialMeshDataGenerated = true;
 }
 
-bool ASonoTraceUEActor::AddActor(AActor* Actor, const bool OverrideInitialization, const bool UpdateTable)
+bool ASonoTraceUEActor::AddActor(AActor* Actor, const bool OverrideInitialization)
 {
-	if (!Initialized && !OverrideInitialization)
+	if ((!Initialized && !OverrideInitialization) || !MeshRegistry)
 		return false;
+	// The nanite mesh of a landscape is a static mesh component, landscapes are handled through their heightfield instead
+	if (ALandscapeProxy* Landscape = Cast<ALandscapeProxy>(Actor))
+		return AddLandscape(Landscape, Actor->GetName(), OverrideInitialization);
 	TArray<UStaticMeshComponent*> StaticMeshComponents;
 	Actor->GetComponents<UStaticMeshComponent>(StaticMeshComponents, true);
 	FString ActorName = Actor->GetName();
 	bool ReturnValue = true;
 	for (UStaticMeshComponent* MeshComponent : StaticMeshComponents)
 	{
-		const bool CurrentSuccess = AddStaticMeshComponent(MeshComponent, ActorName, OverrideInitialization, false);
+		const bool CurrentSuccess = AddStaticMeshComponent(MeshComponent, ActorName, OverrideInitialization);
 		if (!CurrentSuccess)
 			ReturnValue = false;
 	}
@@ -148,26 +156,25 @@ bool ASonoTraceUEActor::AddActor(AActor* Actor, const bool OverrideInitializatio
 	Actor->GetComponents<USkeletalMeshComponent>(SkeletalMeshComponents,true);
 	for (USkeletalMeshComponent* MeshComponent : SkeletalMeshComponents)
 	{
-		const bool CurrentSuccess = AddSkeletalMeshComponent(MeshComponent, ActorName, OverrideInitialization, false);
+		const bool CurrentSuccess = AddSkeletalMeshComponent(MeshComponent, ActorName, OverrideInitialization);
 		if (!CurrentSuccess)
 			ReturnValue = false;
 	}
-	if (UpdateTable) UpdateScenePrimitiveIndexToPersistentPrimitiveIndexTable();
 	return ReturnValue;
 }
 
-bool ASonoTraceUEActor::AddStaticMeshComponent(UStaticMeshComponent* MeshComponent, FString ObjectNamePrefix, const bool OverrideInitialization, const bool UpdateTable, const bool OverrideAddingToLoadList, const int32 PreviousAttempts)
+bool ASonoTraceUEActor::AddStaticMeshComponent(UStaticMeshComponent* MeshComponent, FString ObjectNamePrefix, const bool OverrideInitialization, const bool OverrideAddingToLoadList, const int32 PreviousAttempts)
 {
-	if (!Initialized && !OverrideInitialization)
+	if ((!Initialized && !OverrideInitialization) || !MeshRegistry)
 		return false;
 	if (MeshComponent && MeshComponent->GetStaticMesh())
 	{
-		FSonoTraceUEObjectSettingsStruct* ObjectSettings = &GeneratedSettings.ObjectSettings[0];
+		FSonoTraceUEObjectSettingsStruct* ObjectSettings = &MeshRegistry->ObjectSettings[0];
 		int32 ObjectTypeIndex = 0;
-		if (AssetToObjectTypeIndexSettings.Contains(MeshComponent->GetStaticMesh()))
+		if (MeshRegistry->AssetToObjectTypeIndexSettings.Contains(MeshComponent->GetStaticMesh()))
 		{
-			ObjectTypeIndex = AssetToObjectTypeIndexSettings.FindChecked(MeshComponent->GetStaticMesh());
-			ObjectSettings = &GeneratedSettings.ObjectSettings[ObjectTypeIndex];
+			ObjectTypeIndex = MeshRegistry->AssetToObjectTypeIndexSettings.FindChecked(MeshComponent->GetStaticMesh());
+			ObjectSettings = &MeshRegistry->ObjectSettings[ObjectTypeIndex];
 		}
 		if (MeshComponent->SceneProxy)
 		{
@@ -177,38 +184,33 @@ bool ASonoTraceUEActor::AddStaticMeshComponent(UStaticMeshComponent* MeshCompone
 			FName Label = FName(ObjectNamePrefix + TEXT("_") + MeshComponent->GetName() + TEXT("_") + StaticMesh->GetName());
 			if (ScenePrimitiveIndex != -1)
 			{
-				if (PersistentPrimitiveIndexToMeshDataIndex.Contains(PersistentPrimitiveIndex))
+				if (MeshRegistry->PersistentPrimitiveIndexToMeshDataIndex.Contains(PersistentPrimitiveIndex))
 				{
 					UE_LOG(SonoTraceUE, Warning, TEXT("Object with PPI #%d, SPI #%d and label '%s' using StaticMesh '%s' and object type '%s (#%d)' was already added."),
 						   PersistentPrimitiveIndex, ScenePrimitiveIndex, *Label.ToString(), *StaticMesh->GetName(), *ObjectSettings->Name.ToString(), ObjectTypeIndex);
-					if (UpdateTable) UpdateScenePrimitiveIndexToPersistentPrimitiveIndexTable();
 					return false;
 				}
-				if (!StaticMeshToMeshDataIndex.Contains(StaticMesh)) // Only process unique meshes
+				if (!MeshRegistry->StaticMeshToMeshDataIndex.Contains(StaticMesh)) // Only process unique meshes
 				{
-					FSonoTraceUEMeshDataStruct NewMeshData;
-					CalculateMeshCurvature(MeshComponent, NewMeshData, InputSettings->CurvatureScale, InputSettings->EnableCurvatureTriangleSizeBasedScaler,
-						InputSettings->CurvatureScalerMinimumEffect, InputSettings->CurvatureScalerMaximumEffect, InputSettings->CurvatureScalerLowerTriangleSizeThreshold, InputSettings->CurvatureScalerUpperTriangleSizeThreshold, InputSettings->DiffractionTriangleSizeThreshold);
-					GenerateBRDFAndMaterial(ObjectSettings, &NewMeshData);
-					if (ObjectSettings->DrawDebugFirstOccurrence)
-						DrawMeshDebug(MeshComponent, NewMeshData);
-					const int32 MeshDataIndex = MeshData.Num();
-					MeshData.Add(NewMeshData);
-					PersistentPrimitiveIndexToMeshDataIndex.Add(PersistentPrimitiveIndex, MeshDataIndex);
-					StaticMeshToMeshDataIndex.Add(StaticMesh, MeshDataIndex);
-					StaticMeshCounter.Add(StaticMesh, 1);
+					const int32 MeshDataIndex = MeshRegistry->AddMeshData(MeshComponent, StaticMesh, ObjectTypeIndex);
+					MeshRegistry->PersistentPrimitiveIndexToMeshDataIndex.Add(PersistentPrimitiveIndex, MeshDataIndex);
+					MeshRegistry->StaticMeshToMeshDataIndex.Add(StaticMesh, MeshDataIndex);
+					MeshRegistry->StaticMeshCounter.Add(StaticMesh, 1);
 				}else
 				{
-					PersistentPrimitiveIndexToMeshDataIndex.Add(PersistentPrimitiveIndex, StaticMeshToMeshDataIndex.FindChecked(StaticMesh));
-					const int32 CurrentCount = StaticMeshCounter.FindChecked(StaticMesh);
-					StaticMeshCounter.Add(StaticMesh, CurrentCount + 1);
+					MeshRegistry->PersistentPrimitiveIndexToMeshDataIndex.Add(PersistentPrimitiveIndex, MeshRegistry->StaticMeshToMeshDataIndex.FindChecked(StaticMesh));
+					const int32 CurrentCount = MeshRegistry->StaticMeshCounter.FindChecked(StaticMesh);
+					MeshRegistry->StaticMeshCounter.Add(StaticMesh, CurrentCount + 1);
 				}
-				PersistentPrimitiveIndexToPrimitiveComponent.Add(PersistentPrimitiveIndex, MeshComponent);
-				ScenePrimitiveIndexToPersistentPrimitiveIndex.Add(ScenePrimitiveIndex, PersistentPrimitiveIndex);
+				MeshRegistry->PersistentPrimitiveIndexToPrimitiveComponent.Add(PersistentPrimitiveIndex, MeshComponent);
+				MeshRegistry->AddMeshComponentToSensors(MeshComponent, StaticMesh, PersistentPrimitiveIndex);
 				UE_LOG(SonoTraceUE, Log, TEXT("Added object with PPI #%d, SPI #%d and label '%s' using StaticMesh '%s' and object type '%s (#%d)'."),
 					   PersistentPrimitiveIndex, ScenePrimitiveIndex, *Label.ToString(), *StaticMesh->GetName(), *ObjectSettings->Name.ToString(), ObjectTypeIndex);
-				PersistentPrimitiveIndexToLabelsAndObjectTypes.Add(PersistentPrimitiveIndex, TTuple<FName, int32>(Label, ObjectTypeIndex));
-				if (UpdateTable) UpdateScenePrimitiveIndexToPersistentPrimitiveIndexTable();
+				MeshRegistry->PersistentPrimitiveIndexToLabelsAndObjectTypes.Add(PersistentPrimitiveIndex, TTuple<FName, int32>(Label, ObjectTypeIndex));
+				// ISM, HISM and foliage share the mesh data of their static mesh, their instances are resolved through the instance bounds
+				if (const UInstancedStaticMeshComponent* InstancedMeshComponent = Cast<UInstancedStaticMeshComponent>(MeshComponent))
+					MeshRegistry->AddInstanceHierarchy(PersistentPrimitiveIndex, InstancedMeshComponent);
+				MeshRegistry->SetScenePrimitiveIndex(PersistentPrimitiveIndex, ScenePrimitiveIndex);
 				return true;
 			}
 			if (OverrideAddingToLoadList)
@@ -219,26 +221,24 @@ bool ASonoTraceUEActor::AddStaticMeshComponent(UStaticMeshComponent* MeshCompone
 			{
 				StaticMeshComponentsToLoad.Add(TTuple<FString, UStaticMeshComponent*, int32>(ObjectNamePrefix, MeshComponent, PreviousAttempts + 1));
 			}
-			if (UpdateTable) UpdateScenePrimitiveIndexToPersistentPrimitiveIndexTable();
 			return false;
 		}	
 	}
-	if (UpdateTable) UpdateScenePrimitiveIndexToPersistentPrimitiveIndexTable();
 	return false;
 }
 
-bool ASonoTraceUEActor::AddSkeletalMeshComponent(USkeletalMeshComponent* MeshComponent, FString ObjectNamePrefix, const bool OverrideInitialization, const bool UpdateTable, const bool OverrideAddingToLoadList, const int32 PreviousAttempts)
+bool ASonoTraceUEActor::AddSkeletalMeshComponent(USkeletalMeshComponent* MeshComponent, FString ObjectNamePrefix, const bool OverrideInitialization, const bool OverrideAddingToLoadList, const int32 PreviousAttempts)
 {
-	if (!Initialized && !OverrideInitialization)
+	if ((!Initialized && !OverrideInitialization) || !MeshRegistry)
 		return false;
 	if (MeshComponent && MeshComponent->GetSkeletalMeshAsset())
     {
-    	FSonoTraceUEObjectSettingsStruct* ObjectSettings = &GeneratedSettings.ObjectSettings[0];
+    	FSonoTraceUEObjectSettingsStruct* ObjectSettings = &MeshRegistry->ObjectSettings[0];
     	int32 ObjectTypeIndex = 0;
-    	if (AssetToObjectTypeIndexSettings.Contains(MeshComponent->GetSkeletalMeshAsset()))
+    	if (MeshRegistry->AssetToObjectTypeIndexSettings.Contains(MeshComponent->GetSkeletalMeshAsset()))
     	{
-    		ObjectTypeIndex = AssetToObjectTypeIndexSettings.FindChecked(MeshComponent->GetSkeletalMeshAsset());
-    		ObjectSettings = &GeneratedSettings.ObjectSettings[ObjectTypeIndex];
+    		ObjectTypeIndex = MeshRegistry->AssetToObjectTypeIndexSettings.FindChecked(MeshComponent->GetSkeletalMeshAsset());
+    		ObjectSettings = &MeshRegistry->ObjectSettings[ObjectTypeIndex];
     	}
     	if (MeshComponent->SceneProxy)
     	{
@@ -248,38 +248,30 @@ bool ASonoTraceUEActor::AddSkeletalMeshComponent(USkeletalMeshComponent* MeshCom
     		FName Label = FName(ObjectNamePrefix + TEXT("_") + MeshComponent->GetName() + TEXT("_") + SkeletalMesh->GetName());
     		if (ScenePrimitiveIndex != -1)
     		{
-    			if (PersistentPrimitiveIndexToMeshDataIndex.Contains(PersistentPrimitiveIndex))
+    			if (MeshRegistry->PersistentPrimitiveIndexToMeshDataIndex.Contains(PersistentPrimitiveIndex))
     			{
 				    UE_LOG(SonoTraceUE, Warning, TEXT("Object with PPI #%d, SPI #%d and label '%s' using SkeletalMesh '%s' and object type '%s (#%d)' was already added."),
 				           PersistentPrimitiveIndex, ScenePrimitiveIndex, *Label.ToString(), *SkeletalMesh->GetName(), *ObjectSettings->Name.ToString(), ObjectTypeIndex);
-				    if (UpdateTable) UpdateScenePrimitiveIndexToPersistentPrimitiveIndexTable();
 				    return false;
 			    }
-			    if (!SkeletalMeshToMeshDataIndex.Contains(SkeletalMesh)) 
+			    if (!MeshRegistry->SkeletalMeshToMeshDataIndex.Contains(SkeletalMesh)) 
 			    {
-				    FSonoTraceUEMeshDataStruct NewMeshData;
-				    // CalculateSkeletalMeshCurvature(SkeletalMesh, NewMeshData);
-			    	CalculateMeshCurvature(MeshComponent, NewMeshData, InputSettings->CurvatureScale, InputSettings->EnableCurvatureTriangleSizeBasedScaler,
-						InputSettings->CurvatureScalerMinimumEffect, InputSettings->CurvatureScalerMaximumEffect, InputSettings->CurvatureScalerLowerTriangleSizeThreshold, InputSettings->CurvatureScalerUpperTriangleSizeThreshold, InputSettings->DiffractionTriangleSizeThreshold);
-			    	GenerateBRDFAndMaterial(ObjectSettings, &NewMeshData);
-			    	if (ObjectSettings->DrawDebugFirstOccurrence)
-			    		DrawMeshDebug(MeshComponent, NewMeshData);
-				    const int32 MeshDataIndex = MeshData.Num();
-				    MeshData.Add(NewMeshData);
-				    PersistentPrimitiveIndexToMeshDataIndex.Add(PersistentPrimitiveIndex, MeshDataIndex);
-				    SkeletalMeshToMeshDataIndex.Add(SkeletalMesh, MeshDataIndex);
-				    SkeletalMeshCounter.Add(SkeletalMesh, 1);
+				    const int32 MeshDataIndex = MeshRegistry->AddMeshData(MeshComponent, SkeletalMesh, ObjectTypeIndex);
+				    MeshRegistry->PersistentPrimitiveIndexToMeshDataIndex.Add(PersistentPrimitiveIndex, MeshDataIndex);
+				    MeshRegistry->SkeletalMeshToMeshDataIndex.Add(SkeletalMesh, MeshDataIndex);
+				    MeshRegistry->SkeletalMeshCounter.Add(SkeletalMesh, 1);
 			    }else
 			    {
-				    PersistentPrimitiveIndexToMeshDataIndex.Add(PersistentPrimitiveIndex, SkeletalMeshToMeshDataIndex.FindChecked(SkeletalMesh));
-				    const int32 CurrentCount = SkeletalMeshCounter.FindChecked(SkeletalMesh);
-				    SkeletalMeshCounter.Add(SkeletalMesh, CurrentCount + 1);
+				    MeshRegistry->PersistentPrimitiveIndexToMeshDataIndex.Add(PersistentPrimitiveIndex, MeshRegistry->SkeletalMeshToMeshDataIndex.FindChecked(SkeletalMesh));
+				    const int32 CurrentCount = MeshRegistry->SkeletalMeshCounter.FindChecked(SkeletalMesh);
+				    MeshRegistry->SkeletalMeshCounter.Add(SkeletalMesh, CurrentCount + 1);
 			    }
-			    PersistentPrimitiveIndexToPrimitiveComponent.Add(PersistentPrimitiveIndex, MeshComponent);
+			    MeshRegistry->PersistentPrimitiveIndexToPrimitiveComponent.Add(PersistentPrimitiveIndex, MeshComponent);
+			    MeshRegistry->AddMeshComponentToSensors(MeshComponent, SkeletalMesh, PersistentPrimitiveIndex);
 			    UE_LOG(SonoTraceUE, Log, TEXT("Added object with PPI #%d, SPI #%d and label '%s' using SkeletalMesh '%s' and object type '%s (#%d)'."),
 			           PersistentPrimitiveIndex, ScenePrimitiveIndex, *Label.ToString(), *SkeletalMesh->GetName(), *ObjectSettings->Name.ToString(), ObjectTypeIndex);
-			    PersistentPrimitiveIndexToLabelsAndObjectTypes.Add(PersistentPrimitiveIndex, TTuple<FName, int32>(Label, ObjectTypeIndex));
-			    if (UpdateTable) UpdateScenePrimitiveIndexToPersistentPrimitiveIndexTable();
+			    MeshRegistry->PersistentPrimitiveIndexToLabelsAndObjectTypes.Add(PersistentPrimitiveIndex, TTuple<FName, int32>(Label, ObjectTypeIndex));
+			    MeshRegistry->SetScenePrimitiveIndex(PersistentPrimitiveIndex, ScenePrimitiveIndex);
 			    return true;
 		    }
 		    if (OverrideAddingToLoadList)
@@ -290,24 +282,24 @@ bool ASonoTraceUEActor::AddSkeletalMeshComponent(USkeletalMeshComponent* MeshCom
 		    {
 			    SkeletalMeshComponentsToLoad.Add(TTuple<FString, USkeletalMeshComponent*, int32>(ObjectNamePrefix, MeshComponent, PreviousAttempts + 1));
 		    }
-		    if (UpdateTable) UpdateScenePrimitiveIndexToPersistentPrimitiveIndexTable();
 		    return false;
 	    }	
     }
-	if (UpdateTable) UpdateScenePrimitiveIndexToPersistentPrimitiveIndexTable();
 	return false;
 }
 
-bool ASonoTraceUEActor::RemoveActor(AActor* Actor, const bool UpdateTable)
+bool ASonoTraceUEActor::RemoveActor(AActor* Actor)
 {
-	if (!Initialized)
+	if (!Initialized || !MeshRegistry)
 		return false;
+	if (ALandscapeProxy* Landscape = Cast<ALandscapeProxy>(Actor))
+		return RemoveLandscape(Landscape);
 	TArray<UStaticMeshComponent*> StaticMeshComponents;
 	Actor->GetComponents<UStaticMeshComponent>(StaticMeshComponents, true);
 	bool ReturnValue = true;
 	for (UStaticMeshComponent* MeshComponent : StaticMeshComponents)
 	{
-		const bool CurrentSuccess = RemoveStaticMeshComponent(MeshComponent, false);
+		const bool CurrentSuccess = RemoveStaticMeshComponent(MeshComponent);
 		if (!CurrentSuccess)
 			ReturnValue = false;
 	}
@@ -315,19 +307,17 @@ bool ASonoTraceUEActor::RemoveActor(AActor* Actor, const bool UpdateTable)
 	Actor->GetComponents<USkeletalMeshComponent>(SkeletalMeshComponents,true);
 	for (USkeletalMeshComponent* MeshComponent : SkeletalMeshComponents)
 	{
-		const bool CurrentSuccess = RemoveSkeletalMeshComponent(MeshComponent, false);
+		const bool CurrentSuccess = RemoveSkeletalMeshComponent(MeshComponent);
 		if (!CurrentSuccess)
 			ReturnValue = false;
 	}
-	if (UpdateTable) UpdateScenePrimitiveIndexToPersistentPrimitiveIndexTable();
 	return ReturnValue;
 }
 
-bool ASonoTraceUEActor::RemoveStaticMeshComponent(UStaticMeshComponent* MeshComponent, const bool UpdateTable)
+bool ASonoTraceUEActor::RemoveStaticMeshComponent(UStaticMeshComponent* MeshComponent)
 {
-	if (!Initialized)
+	if (!Initialized || !MeshRegistry)
 		return false;
-	UpdateScenePrimitiveIndexToPersistentPrimitiveIndexTable();
 	if (MeshComponent && MeshComponent->GetStaticMesh())
 	{
 		if (MeshComponent->SceneProxy)
@@ -335,35 +325,37 @@ bool ASonoTraceUEActor::RemoveStaticMeshComponent(UStaticMeshComponent* MeshComp
 			const int32 PersistentPrimitiveIndex = MeshComponent->SceneProxy->GetPrimitiveSceneInfo()->GetPersistentIndex().Index;
 			const int32 ScenePrimitiveIndex = MeshComponent->SceneProxy->GetPrimitiveSceneInfo()->GetIndex();
 			const UStaticMesh* StaticMesh = MeshComponent->GetStaticMesh();
-			if (StaticMeshCounter.Contains(StaticMesh) && PersistentPrimitiveIndexToLabelsAndObjectTypes.Contains(PersistentPrimitiveIndex))
+			if (MeshRegistry->StaticMeshCounter.Contains(StaticMesh) && MeshRegistry->PersistentPrimitiveIndexToLabelsAndObjectTypes.Contains(PersistentPrimitiveIndex))
 			{
-				TTuple<FName, int32> ObjectNameAndTypeIndex = PersistentPrimitiveIndexToLabelsAndObjectTypes.FindChecked(PersistentPrimitiveIndex);
+				TTuple<FName, int32> ObjectNameAndTypeIndex = MeshRegistry->PersistentPrimitiveIndexToLabelsAndObjectTypes.FindChecked(PersistentPrimitiveIndex);
 				const FName ObjectName = ObjectNameAndTypeIndex.Get<0>();
-				PersistentPrimitiveIndexToMeshDataIndex.Remove(PersistentPrimitiveIndex);
-				PersistentPrimitiveIndexToPrimitiveComponent.Remove(PersistentPrimitiveIndex);
-				PersistentPrimitiveIndexToLabelsAndObjectTypes.Remove(PersistentPrimitiveIndex);
-				ScenePrimitiveIndexToPersistentPrimitiveIndex.Remove(ScenePrimitiveIndex);
+				MeshRegistry->PersistentPrimitiveIndexToMeshDataIndex.Remove(PersistentPrimitiveIndex);
+				MeshRegistry->PersistentPrimitiveIndexToPrimitiveComponent.Remove(PersistentPrimitiveIndex);
+				MeshRegistry->PersistentPrimitiveIndexToLabelsAndObjectTypes.Remove(PersistentPrimitiveIndex);
+				MeshRegistry->RemoveScenePrimitiveIndex(PersistentPrimitiveIndex);
+				MeshRegistry->RemoveMeshComponentFromSensors(MeshComponent);
 				UE_LOG(SonoTraceUE, Log, TEXT("Removed object with PPI #%d, SPI #%d, and label '%s' using StaticMesh '%s'."),
 	                   PersistentPrimitiveIndex, ScenePrimitiveIndex, *ObjectName.ToString(), *StaticMesh->GetName());
-				if (StaticMeshCounter.FindChecked(StaticMesh) == 1)
+				if (MeshRegistry->StaticMeshCounter.FindChecked(StaticMesh) == 1)
 				{
-					StaticMeshCounter.Remove(StaticMesh);
-					MeshData.RemoveAt(StaticMeshToMeshDataIndex.FindChecked(StaticMesh));
-					StaticMeshToMeshDataIndex.Remove(StaticMesh);
+					MeshRegistry->StaticMeshCounter.Remove(StaticMesh);
+					MeshRegistry->RemoveMeshData(MeshRegistry->StaticMeshToMeshDataIndex.FindChecked(StaticMesh));
+					MeshRegistry->StaticMeshToMeshDataIndex.Remove(StaticMesh);
 					UE_LOG(SonoTraceUE, Log, TEXT("Removed StaticMesh '%s' mesh data."), *StaticMesh->GetName());
+				}else
+				{
+					MeshRegistry->StaticMeshCounter.FindChecked(StaticMesh)--;
 				}
-				if (UpdateTable) UpdateScenePrimitiveIndexToPersistentPrimitiveIndexTable();
 				return true;
 			}	
 		}
 	}
-	if (UpdateTable) UpdateScenePrimitiveIndexToPersistentPrimitiveIndexTable();
 	return false;
 }
 
-bool ASonoTraceUEActor::RemoveSkeletalMeshComponent(USkeletalMeshComponent* MeshComponent, const bool UpdateTable)
+bool ASonoTraceUEActor::RemoveSkeletalMeshComponent(USkeletalMeshComponent* MeshComponent)
 {
-	if (!Initialized)
+	if (!Initialized || !MeshRegistry)
 		return false;
 	if (MeshComponent && MeshComponent->GetSkeletalMeshAsset())
 	{
@@ -372,32 +364,48 @@ bool ASonoTraceUEActor::RemoveSkeletalMeshComponent(USkeletalMeshComponent* Mesh
 			const int32 PersistentPrimitiveIndex = MeshComponent->SceneProxy->GetPrimitiveSceneInfo()->GetPersistentIndex().Index;
 			const int32 ScenePrimitiveIndex = MeshComponent->SceneProxy->GetPrimitiveSceneInfo()->GetIndex();
 			const USkeletalMesh* SkeletalMesh = MeshComponent->GetSkeletalMeshAsset();
-			if (SkeletalMeshCounter.Contains(SkeletalMesh) && PersistentPrimitiveIndexToLabelsAndObjectTypes.Contains(PersistentPrimitiveIndex))
+			if (MeshRegistry->SkeletalMeshCounter.Contains(SkeletalMesh) && MeshRegistry->PersistentPrimitiveIndexToLabelsAndObjectTypes.Contains(PersistentPrimitiveIndex))
 			{
-				TTuple<FName, int32> ObjectNameAndTypeIndex = PersistentPrimitiveIndexToLabelsAndObjectTypes.FindChecked(PersistentPrimitiveIndex);
+				TTuple<FName, int32> ObjectNameAndTypeIndex = MeshRegistry->PersistentPrimitiveIndexToLabelsAndObjectTypes.FindChecked(PersistentPrimitiveIndex);
 				const FName ObjectName = ObjectNameAndTypeIndex.Get<0>();
-				PersistentPrimitiveIndexToMeshDataIndex.Remove(PersistentPrimitiveIndex);
-				PersistentPrimitiveIndexToPrimitiveComponent.Remove(PersistentPrimitiveIndex);
-				PersistentPrimitiveIndexToLabelsAndObjectTypes.Remove(PersistentPrimitiveIndex);
-				ScenePrimitiveIndexToPersistentPrimitiveIndex.Remove(ScenePrimitiveIndex);
+				MeshRegistry->PersistentPrimitiveIndexToMeshDataIndex.Remove(PersistentPrimitiveIndex);
+				MeshRegistry->PersistentPrimitiveIndexToPrimitiveComponent.Remove(PersistentPrimitiveIndex);
+				MeshRegistry->PersistentPrimitiveIndexToLabelsAndObjectTypes.Remove(PersistentPrimitiveIndex);
+				MeshRegistry->RemoveScenePrimitiveIndex(PersistentPrimitiveIndex);
+				MeshRegistry->RemoveMeshComponentFromSensors(MeshComponent);
 				UE_LOG(SonoTraceUE, Log, TEXT("Removed object with PPI #%d, SPI #%d and label '%s' using SkeletalMesh '%s'."),
 	                   PersistentPrimitiveIndex, ScenePrimitiveIndex, *ObjectName.ToString(), *SkeletalMesh->GetName());
-				if (SkeletalMeshCounter.FindChecked(SkeletalMesh) == 1)
+				if (MeshRegistry->SkeletalMeshCounter.FindChecked(SkeletalMesh) == 1)
 				{
-					SkeletalMeshCounter.Remove(SkeletalMesh);
-					MeshData.RemoveAt(SkeletalMeshToMeshDataIndex.FindChecked(SkeletalMesh));
-					SkeletalMeshToMeshDataIndex.Remove(SkeletalMesh);
+					MeshRegistry->SkeletalMeshCounter.Remove(SkeletalMesh);
+					MeshRegistry->RemoveMeshData(MeshRegistry->SkeletalMeshToMeshDataIndex.FindChecked(SkeletalMesh));
+					MeshRegistry->SkeletalMeshToMeshDataIndex.Remove(SkeletalMesh);
 					UE_LOG(SonoTraceUE, Log, TEXT("Removed SkeletalMesh '%s' mesh data."), *SkeletalMesh->GetName());
+				}else
+				{
+					MeshRegistry->SkeletalMeshCounter.FindChecked(SkeletalMesh)--;
 				}
-				if (UpdateTable) UpdateScenePrimitiveIndexToPersistentPrimitiveIndexTable();
 				return true;
 			}	
 		}
 	}
-	if (UpdateTable) UpdateScenePrimitiveIndexToPersistentPrimitiveIndexTable();
 	return false;
 }
 
+bool ASonoTraceUEActor::AddLandscape(ALandscapeProxy* Landscape, FString ObjectNamePrefix, const bool OverrideInitialization)
+{
+	if ((!Initialized && !OverrideInitialization) || !MeshRegistry)
+		return false;
+	return MeshRegistry->AddLandscape(Landscape, ObjectNamePrefix);
+}
+
+bool ASonoTraceUEActor::RemoveLandscape(ALandscapeProxy* Landscape)
+{
+	if (!Initialized || !MeshRegistry)
+		return false;
+	return MeshRegistry->RemoveLandscape(Landscape);
+}
+
 void ASonoTraceUEActor::UpdateTransformations()
 {
 	SensorLocation = GetActorLocation();
@@ -629,7 +637,9 @@ void ASonoTraceUEActor::SendInterfaceSettings()
 	// Receiver settings
 	DataToSend.Append(reinterpret_cast<const uint8*>(&InputSettings->EnableStaticReceivers), sizeof(bool));
 	DataToSend.Append(reinterpret_cast<const uint8*>(&InputSettings->EnableUseWorldCoordinatesReceivers), sizeof(bool));
-    DataToSend.Append(reinterpret_cast<const uint8*>(&InputSettings->EnableEmitterPatternSimulation), sizeof(bool));
+    // An aggregated emitter pattern is already summed per real receiver, so the client has no virtual receivers to merge
+    const bool EnableVirtualReceivers = InputSettings->EnableEmitterPatternSimulation && !InputSettings->EnableEmitterPatternAggregation;
+    DataToSend.Append(reinterpret_cast<const uint8*>(&EnableVirtualReceivers), sizeof(bool));
     DataToSend.Append(reinterpret_cast<const uint8*>(&InputSettings->EmitterPatternRadius), sizeof(InputSettings->EmitterPatternRadius));
     DataToSend.Append(reinterpret_cast<const uint8*>(&InputSettings->EmitterPatternSpacing), sizeof(InputSettings->EmitterPatternSpacing));
 
@@ -923,7 +933,7 @@ void ASonoTraceUEActor::SendInterfaceMeasurement()
 		DataToSend.Append(reinterpret_cast<uint8*>(&ReflectedPointsCount), sizeof(int32));
 		for (FSonoTraceUEPointStruct& Point : SonoTraceUEOutputToSend.ReflectedPoints)
 		{
-			TArray<uint8> SerializedPoint = SerializePointStruct(&Point);
+			TArray<uint8> SerializedPoint = SerializePointStruct(&Point, SonoTraceUEOutputToSend.StrengthTensor);
 			int32 PointSize = SerializedPoint.Num();
 			DataToSend.Append(reinterpret_cast<uint8*>(&PointSize), sizeof(int32));
 			DataToSend.Append(SerializedPoint.GetData(), PointSize);
@@ -958,7 +968,7 @@ void ASonoTraceUEActor::SendInterfaceMeasurement()
 			DataToSend.Append(reinterpret_cast<uint8*>(&SpecularSubResultReflectedPointsCount), sizeof(int32));
 			for (FSonoTraceUEPointStruct& Point : SonoTraceUEOutputToSend.SpecularSubOutput.ReflectedPoints)
 			{
-				TArray<uint8> SerializedPoint = SerializePointStruct(&Point);
+				TArray<uint8> SerializedPoint = SerializePointStruct(&Point, SonoTraceUEOutputToSend.SpecularSubOutput.StrengthTensor);
 				int32 PointSize = SerializedPoint.Num();
 				DataToSend.Append(reinterpret_cast<uint8*>(&PointSize), sizeof(int32));
 				DataToSend.Append(SerializedPoint.GetData(), PointSize);
@@ -997,7 +1007,7 @@ void ASonoTraceUEActor::SendInterfaceMeasurement()
 			DataToSend.Append(reinterpret_cast<uint8*>(&DiffractionSubResultReflectedPointsCount), sizeof(int32));
 			for (FSonoTraceUEPointStruct& Point : SonoTraceUEOutputToSend.DiffractionSubOutput.ReflectedPoints)
 			{
-				TArray<uint8> SerializedPoint = SerializePointStruct(&Point);
+				TArray<uint8> SerializedPoint = SerializePointStruct(&Point, SonoTraceUEOutputToSend.DiffractionSubOutput.StrengthTensor);
 				int32 PointSize = SerializedPoint.Num();
 				DataToSend.Append(reinterpret_cast<uint8*>(&PointSize), sizeof(int32));
 				DataToSend.Append(SerializedPoint.GetData(), PointSize);
@@ -1036,7 +1046,7 @@ void ASonoTraceUEActor::SendInterfaceMeasurement()
 			DataToSend.Append(reinterpret_cast<uint8*>(&DirectPathSubResultReflectedPointsCount), sizeof(int32));
 			for (FSonoTraceUEPointStruct& Point : SonoTraceUEOutputToSend.DirectPathSubOutput.ReflectedPoints)
 			{
-				TArray<uint8> SerializedPoint = SerializePointStruct(&Point);
+				TArray<uint8> SerializedPoint = SerializePointStruct(&Point, SonoTraceUEOutputToSend.DirectPathSubOutput.StrengthTensor);
 				int32 PointSize = SerializedPoint.Num();
 				DataToSend.Append(reinterpret_cast<uint8*>(&PointSize), sizeof(int32));
 				DataToSend.Append(SerializedPoint.GetData(), PointSize);
@@ -1072,7 +1082,11 @@ void ASonoTraceUEActor::UpdateShaderParameters()
 {
 	FSonoTraceParameters Parameters;
 	Parameters.Scene = GetWorld()->Scene->GetRenderScene();
-	Parameters.GPUReadback = GPUReadback;
+	Parameters.FrameInfo.SensorLocation = SensorLocation;
+	Parameters.FrameInfo.SensorRotation = SensorRotation;
+	Parameters.FrameInfo.EmitterPoses = EmitterPoses;
+	Parameters.FrameInfo.ReceiverPoses = ReceiverPoses;
+	Parameters.FrameInfo.OverrideEmitterSignalIndexes = TriggerTemporaryEmitterSignalIndexes;
 	Parameters.SensorPosition = GetActorLocation(); 
 	Parameters.SensorRotation = GetActorRotation();  
 	Parameters.DistributionAzimuthAngles = GeneratedSettings.AzimuthAngles;
@@ -1107,6 +1121,8 @@ bool ASonoTraceUEActor::ExecuteRayTracingOnce(const TArray<int32> OverrideEmitte
 			} else {
 				TriggerTemporaryEmitterSignalIndexes.Empty();
 			}
+			// Store the override with the trace itself
+			UpdateShaderParameters();
 			SonoTrace.RunState = 1;
 			AwaitingRayTracingResult = true;
 			return true;
@@ -1131,7 +1147,10 @@ void ASonoTraceUEActor::Tick(float DeltaTime)
 
 	if ((EnableSimulationEnableOverride && EnableSimulation) || (!EnableSimulationEnableOverride && InputSettings->EnableSimulation))
 	{
-		if (Initialized && !StaticMeshComponentsToLoad.IsEmpty())
+		CompleteRunSimulation();
+
+		// New mesh data is only added while no parse or simulation task is reading it
+		if (Initialized && !ParseTask.IsValid() && !SimulationTask.IsValid() && !StaticMeshComponentsToLoad.IsEmpty())
 		{
 			for (int i = StaticMeshComponentsToLoad.Num() - 1; i >= 0; i--)
 			{
@@ -1140,10 +1159,10 @@ void ASonoTraceUEActor::Tick(float DeltaTime)
 				UStaticMeshComponent* StaticMeshComponent = ObjectNameAndStaticMeshComponentAndAttempts.Get<1>();
 				int32 Attempts = ObjectNameAndStaticMeshComponentAndAttempts.Get<2>();				
 				StaticMeshComponentsToLoad.RemoveAt(i);
-				AddStaticMeshComponent(StaticMeshComponent, ObjectName, false, false, Attempts == InputSettings->MeshDataGenerationAttempts, Attempts);					
+				AddStaticMeshComponent(StaticMeshComponent, ObjectName, false, Attempts == InputSettings->MeshDataGenerationAttempts, Attempts);					
 			}
 		}
-		if (Initialized && !SkeletalMeshComponentsToLoad.IsEmpty())
+		if (Initialized && !ParseTask.IsValid() && !SimulationTask.IsValid() && !SkeletalMeshComponentsToLoad.IsEmpty())
 		{
 			for (int i = SkeletalMeshComponentsToLoad.Num() - 1; i >= 0; i--)
 			{
@@ -1152,13 +1171,13 @@ void ASonoTraceUEActor::Tick(float DeltaTime)
 				USkeletalMeshComponent* SkeletalMeshComponent = ObjectNameAndSkeletalMeshComponentAndAttempts.Get<1>();
 				int32 Attempts = ObjectNameAndSkeletalMeshComponentAndAttempts.Get<2>();
 				SkeletalMeshComponentsToLoad.RemoveAt(i);
-				AddSkeletalMeshComponent(SkeletalMeshComponent, ObjectName, false, false, Attempts == InputSettings->MeshDataGenerationAttempts, Attempts);
+				AddSkeletalMeshComponent(SkeletalMeshComponent, ObjectName, false, Attempts == InputSettings->MeshDataGenerationAttempts, Attempts);
 
 			}
 		}
 		if (InputSettings->EnableRaytracing)
 		{
-			if (GPUReadback != nullptr && TranscurredTime > 3.0f)
+			if (SonoTrace.GetReadbackRing().IsValid() && TranscurredTime > 3.0f)
 			{
 				UpdateShaderParameters();		
 
@@ -1184,18 +1203,23 @@ void ASonoTraceUEActor::Tick(float DeltaTime)
 				}
 			}
 			
+			// The CPU backend snapshots the scene on the game thread and traces in a task, a new trace only starts if a readback slot is free
+			if (Initialized && SonoTrace.IsUsingCPUBackend())
+			{
+				double CurrentTime = FPlatformTime::Seconds();
+				if (SonoTrace.Execute_GameThread(MeshRegistry->PersistentPrimitiveIndexToScenePrimitiveIndex) && InputSettings->EnableDebugLogExecutionTimes)
+					UE_LOG(SonoTraceUE, Log, TEXT("CPU raytracing scene snapshot: %.5fs"), FPlatformTime::Seconds() - CurrentTime);
+			}
+			
 			if (AwaitingRayTracingResult)
 			{
 				ParseRayTracing();
 			}
 			
-			if (ReadyToUseRayTracingResult)
+			// A parsed result waits for the previous simulation to finish before it is picked up
+			if (!SimulationTask.IsValid() && CompleteParseRayTracing())
 			{
-				double CurrentTime = FPlatformTime::Seconds();
-				RunSimulation(TriggerTemporaryEmitterSignalIndexes);
-				if (InputSettings->EnableDebugLogExecutionTimes)
-					UE_LOG(SonoTraceUE, Log, TEXT("Complete simulation generation: %.5fs"), FPlatformTime::Seconds() - CurrentTime);
-				ReadyToUseRayTracingResult = false;
+				RunSimulation(RayTracingFrameInfo.OverrideEmitterSignalIndexes);
 				TriggerTemporaryEmitterSignalIndexes.Empty();
 				if (!InputSettings->EnableRunSimulationOnlyOnTrigger)
 					AwaitingRayTracingResult = true;
@@ -1212,10 +1236,7 @@ void ASonoTraceUEActor::Tick(float DeltaTime)
 				}
 				if (!InputSettings->EnableRunSimulationOnlyOnTrigger)
 				{
-					double CurrentTime = FPlatformTime::Seconds();
 					RunSimulation(TArray<int32>());
-					if (InputSettings->EnableDebugLogExecutionTimes)
-						UE_LOG(SonoTraceUE, Log, TEXT("Complete simulation generation: %.5fs"), FPlatformTime::Seconds() - CurrentTime);
 				}
 			}
 		}
@@ -1229,14 +1250,29 @@ void ASonoTraceUEActor::Tick(float DeltaTime)
 	}
 }
 
+void ASonoTraceUEActor::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	// The simulation task traces against the world
+	WaitForPendingTasks();
+	// Objects added or removed after this point are ignored, the mesh registry is released below
+	Initialized = false;
+	if (MeshRegistry)
+	{
+		if (USonoTraceUESubsystem* Subsystem = GetWorld()->GetSubsystem<USonoTraceUESubsystem>())
+			Subsystem->UnregisterSensor(this, MeshRegistry);
+		MeshRegistry = nullptr;
+	}
+	Super::EndPlay(EndPlayReason);
+}
+
 void ASonoTraceUEActor::BeginDestroy()
 {
+	// The parse and simulation tasks read the mesh data of the registry
+	WaitForPendingTasks();
 	SonoTrace.EndRendering();
-	if (GPUReadback)
-	{
-		delete GPUReadback;
-		GPUReadback = nullptr;
-	}	
+	// Render commands capture the actor and copy from the readbacks, they have to finish before the readbacks are released
+	FlushRenderingCommands();
+	SonoTrace.ReleaseReadbacks();
 	Super::BeginDestroy();
 }
 
@@ -1288,8 +1324,7 @@ bool ASonoTraceUEActor::TriggerSimulationOverrideEmitterSignals(const TArray<int
 			}						
 			if (InputSettings->EnableRaytracing)
 				return ExecuteRayTracingOnce(OverrideEmitterSignalIndexes);
-			RunSimulation(OverrideEmitterSignalIndexes);
-			return true;
+			return RunSimulation(OverrideEmitterSignalIndexes);
 		}
 	}
 	return false;
@@ -1357,325 +1392,566 @@ int32 ASonoTraceUEActor::GetEmitterSignalCount() const
 	return InputSettings->EmitterSignals.Num();
 }
 
+int32 ASonoTraceUEActor::GetNumberOfPendingMeshData() const
+{
+	return MeshRegistry ? MeshRegistry->GetNumberOfPendingMeshData() : 0;
+}
+
+void ASonoTraceUEActor::LogMeshDataMemoryReport() const
+{
+	if (MeshRegistry)
+		MeshRegistry->LogMemoryReport();
+}
+
+TArray<float> ASonoTraceUEActor::GetCurrentOutputPointStrengths(const int32 PointIndex, const int32 EmitterIndex, const int32 ReceiverIndex) const
+{
+	if (!CurrentOutput.ReflectedPoints.IsValidIndex(PointIndex))
+		return TArray<float>();
+	return TArray<float>(CurrentOutput.StrengthTensor.GetStrengths(CurrentOutput.ReflectedPoints[PointIndex].StrengthTensorIndex, EmitterIndex, ReceiverIndex));
+}
+
+float ASonoTraceUEActor::GetCurrentOutputPointTotalDistanceToReceiver(const int32 PointIndex, const int32 EmitterIndex, const int32 ReceiverIndex) const
+{
+	if (!CurrentOutput.ReflectedPoints.IsValidIndex(PointIndex))
+		return -1.0f;
+	return CurrentOutput.StrengthTensor.GetTotalDistanceToReceiver(CurrentOutput.ReflectedPoints[PointIndex].StrengthTensorIndex, EmitterIndex, ReceiverIndex);
+}
+
 void ASonoTraceUEActor::ParseRayTracing()
 {
-	if (GPUReadback != nullptr && TranscurredTime > 3.0f && Initialized && SonoTrace.RunState == 2 && SonoTrace.ExecutionCounter > SonoTracePreviousIndex && !CurrentlyParsingRaytracing)
-	{	
-		ENQUEUE_RENDER_COMMAND(FSonoTrace) (
-		[this](FRHICommandListImmediate& RHICmdList)
+	const TSharedPtr<FSonoTraceReadbackRing, ESPMode::ThreadSafe> ReadbackRing = SonoTrace.GetReadbackRing();
+	// The readback is polled first so the copy and the parse task are only launched once the oldest trace has finished
+	if (ReadbackRing.IsValid() && TranscurredTime > 3.0f && Initialized && !ParseTask.IsValid() && ReadbackRing->IsOldestReady())
+	{
+		AddResolvedScenePrimitives();
+
+		const int32 NumElements = (GeneratedSettings.AzimuthAngles.Num() + DirectPathAzimuthAngles.Num()) * InputSettings->MaximumBounces;
+		TSharedRef<FSonoTraceUEParseResult, ESPMode::ThreadSafe> Result = MakeShared<FSonoTraceUEParseResult, ESPMode::ThreadSafe>();
+		UE::Tasks::FTaskEvent ReadbackCopiedEvent(UE_SOURCE_LOCATION);
+
+		// Everything the parse task needs is copied here so it does not touch the actor while the game thread continues.
+		// The sensor and emitter poses are taken from the frame info of the trace itself.
+		FSonoTraceUEParseContext ParseContext;
+		ParseContext.NumberOfRays = GeneratedSettings.AzimuthAngles.Num();
+		ParseContext.MaximumBounces = InputSettings->MaximumBounces;
+		ParseContext.EmitterDirectivities = GeneratedSettings.FinalEmitterDirectivities;
+		ParseContext.EnableEmitterDirectivity = InputSettings->EnableEmitterDirectivity;
+		ParseContext.DefaultTriangleBRDF = &MeshRegistry->ObjectSettings[0].DefaultTriangleBRDF;
+		ParseContext.DefaultTriangleMaterial = &MeshRegistry->ObjectSettings[0].DefaultTriangleMaterial;
+		ParseContext.ObjectSettings = &MeshRegistry->ObjectSettings;
+		ParseContext.EnableDirectPath = InputSettings->EnableDirectPathComponentCalculation;
+		ParseContext.NumberOfDirectPathRays = DirectPathAzimuthAngles.Num();
+		ParseContext.MaximumRayDistance = InputSettings->MaximumRayDistance;
+
+		// Copy the oldest finished trace into a staging buffer, on the render thread for the GPU backend as it owns the readbacks
+		auto CopyReadback = [this, Result, ReadbackRing, NumElements]()
 		{
-			CurrentlyParsingRaytracing = true;
-			if (GPUReadback->IsReady())
+			FSonoTraceUEStagingBufferPool::FBufferRef StagingBuffer = StagingBufferPool.Acquire(0);
+			if (ReadbackRing->PopReady(*StagingBuffer, Result->FrameInfo))
 			{
-
-				const uint32 AllocatedSize = GPUReadback->GetGPUSizeBytes();
-				
-				if (const uint32 ExpectedSize = (GeneratedSettings.AzimuthAngles.Num() + DirectPathAzimuthAngles.Num()) * static_cast<uint32>(InputSettings->MaximumBounces) * sizeof(FStructuredOutputBufferElem); AllocatedSize != ExpectedSize)
+				if (StagingBuffer->Num() != NumElements)
 				{
-					UE_LOG(SonoTraceUE, Error, TEXT("GPU readback size mismatch. Expected: %i, Actual: %i"), ExpectedSize, AllocatedSize);
+					UE_LOG(SonoTraceUE, Error, TEXT("Raytracing readback size mismatch. Expected: %i, Actual: %i elements"), NumElements, StagingBuffer->Num());
+				}else
+				{
+					Result->RawOutput = StagingBuffer;
+					Result->IsValid = true;
 				}
+			}
+		};
+		if (SonoTrace.IsUsingCPUBackend())
+		{
+			CopyReadback();
+			ReadbackCopiedEvent.Trigger();
+		}else
+		{
+			// The render thread only copies the readback into a staging buffer, all parsing happens in the task below
+			ENQUEUE_RENDER_COMMAND(FSonoTrace) (
+			[CopyReadback, ReadbackCopiedEvent](FRHICommandListImmediate& RHICmdList) mutable
+			{
+				CopyReadback();
+				ReadbackCopiedEvent.Trigger();
+			});
+		}
 
-				
-				double CurrentTime = FPlatformTime::Seconds();
-				RayTracingSubOutput.ReflectedPoints.Init(FSonoTraceUEPointStruct(), GeneratedSettings.AzimuthAngles.Num() * InputSettings->MaximumBounces);
-				RayTracingSubOutput.HitPersistentPrimitiveIndexes.Empty();
-				SonoTracePreviousIndex = SonoTrace.ExecutionCounter;
+		PendingParseResult = Result;
+		ParseTask = UE::Tasks::Launch(UE_SOURCE_LOCATION,
+		[Result, ParseContext, Lookup = MeshRegistry->PrimitiveLookup.Publish(), MeshData = MeshRegistry->PublishMeshData()]() mutable
+		{
+			if (!Result->IsValid)
+				return;
+			const double CurrentTime = FPlatformTime::Seconds();
+			ParseContext.RawOutput = Result->RawOutput->GetData();
+			ParseContext.PrimitiveLookup = Lookup.Get();
+			ParseContext.MeshData = MeshData.Get();
+			ParseContext.SensorLocation = Result->FrameInfo.SensorLocation;
+			ParseContext.EmitterPoses = Result->FrameInfo.EmitterPoses;
+			ParseContext.ReceiverPoses = Result->FrameInfo.ReceiverPoses;
+			Result->UnknownScenePrimitiveIndexes = FSonoTraceUEParser::FindUnknownScenePrimitiveIndexes(ParseContext);
+			Result->SubOutput.Timestamp = Result->FrameInfo.Timestamp;
+			Result->SubOutput.MaximumStrength = 0.0f;
+			TArray<int32> HitScenePrimitiveIndexes;
+			FSonoTraceUEParser::Parse(ParseContext, Result->SubOutput, &HitScenePrimitiveIndexes);
+			Result->HitScenePrimitives.Reserve(HitScenePrimitiveIndexes.Num());
+			for (int32 HitIndex = 0; HitIndex < HitScenePrimitiveIndexes.Num(); HitIndex++)
+			{
+				Result->HitScenePrimitives.Emplace(HitScenePrimitiveIndexes[HitIndex], Result->SubOutput.HitPersistentPrimitiveIndexes[HitIndex]);
+			}
+			FSonoTraceUEParser::ParseDirectPath(ParseContext, Result->DirectPathReceiverOutput);
+			Result->ParseTime = FPlatformTime::Seconds() - CurrentTime;
+		}, UE::Tasks::Prerequisites(ReadbackCopiedEvent));
+	}
+}
 
-				// Lock the data to access it on the CPU
-				RayTracingRawOutput = static_cast<FStructuredOutputBufferElem*>(
-					GPUReadback->Lock((GeneratedSettings.AzimuthAngles.Num() + DirectPathAzimuthAngles.Num()) * static_cast<uint32>(InputSettings->MaximumBounces) * sizeof(FStructuredOutputBufferElem))); 
+bool ASonoTraceUEActor::CompleteParseRayTracing()
+{
+	if (!ParseTask.IsValid() || !ParseTask.IsCompleted())
+		return false;
+	const TSharedPtr<FSonoTraceUEParseResult, ESPMode::ThreadSafe> Result = MoveTemp(PendingParseResult);
+	ParseTask = UE::Tasks::FTask();
 
-				// Validate that the saved data is valid
-				if (RayTracingRawOutput)
-				{
-					RayTracingSubOutput.Timestamp = SonoTrace.CurrentTimestamp;
-					RayTracingSubOutput.MaximumCurvature = 0.0f;
-					RayTracingSubOutput.MaximumStrength = 0.0f;
-					RayTracingSubOutput.MaximumTotalDistance = 0.0f;
+	// The readback was not ready yet, it will be copied again on the next tick
+	if (!Result.IsValid() || !Result->IsValid)
+		return false;
 
-					// Get the render scene to later find unknown objects
-					FScene* RenderScene = GetWorld()->Scene->GetRenderScene();
-				
-					// Loop the rays
-					int32 SavedPointIndex = 0;					
-					for (int32 RayIndex = 0; RayIndex < GeneratedSettings.AzimuthAngles.Num(); RayIndex++)
+	SonoTracePreviousIndex = Result->FrameInfo.ExecutionCounter;
+	RayTracingFrameInfo = MoveTemp(Result->FrameInfo);
+	RayTracingSubOutput = MoveTemp(Result->SubOutput);
+	RayTracingRawOutputBuffer = Result->RawOutput;
+	RayTracingRawOutput = RayTracingRawOutputBuffer->GetData();
+	for (int32 ReceiverIndex = 0; ReceiverIndex < FMath::Min(DirectPathReceiverOutput.Num(), Result->DirectPathReceiverOutput.Num()); ReceiverIndex++)
+	{
+		DirectPathReceiverOutput[ReceiverIndex] = Result->DirectPathReceiverOutput[ReceiverIndex];
+	}
+
+	// Unknown objects and known objects that moved to another SPI when the render scene was compacted can only be looked up on the render thread.
+	// They are updated in the tables on a next tick.
+	if (!Result->UnknownScenePrimitiveIndexes.IsEmpty() || !Result->HitScenePrimitives.IsEmpty())
+	{
+		ENQUEUE_RENDER_COMMAND(FSonoTrace) (
+		[this, UnknownScenePrimitiveIndexes = MoveTemp(Result->UnknownScenePrimitiveIndexes), HitScenePrimitives = MoveTemp(Result->HitScenePrimitives)](FRHICommandListImmediate& RHICmdList)
+		{
+			FScene* RenderScene = GetWorld()->Scene->GetRenderScene();
+			if (!RenderScene)
+				return;
+			FScopeLock Lock(&ResolvedScenePrimitivesCriticalSection);
+			auto ResolveScenePrimitive = [&](const int32 CurrentScenePrimitiveIndex)
+			{
+				if (const FPrimitiveSceneInfo* PrimitiveSceneInfo = RenderScene->Primitives[CurrentScenePrimitiveIndex])
+				{
+					if (const FPrimitiveSceneProxy* PrimitiveSceneProxy = PrimitiveSceneInfo->Proxy)
 					{
-						// Start multi-bounce loop
-						bool CurrentRayIsHitting = false;						
-						TArray<float> CachedSourceDirectivities;
-						CachedSourceDirectivities.Init(1.0f, EmitterPoses.Num());						
-						for (int32 BounceIndex = 0; BounceIndex < InputSettings->MaximumBounces; BounceIndex++)
-						{
-							// Compute the output index for this ray and this bounce
-							const int32 OutputIndex = RayIndex * InputSettings->MaximumBounces + BounceIndex;
+						ResolvedScenePrimitives.Add(TTuple<int32, int32, FName, FName>(CurrentScenePrimitiveIndex, PrimitiveSceneInfo->GetPersistentIndex().Index,
+							FName(PrimitiveSceneProxy->GetOwnerName().ToString() + TEXT("_") + PrimitiveSceneProxy->GetResourceName().ToString()), PrimitiveSceneProxy->GetResourceName()));
+					}
+				}
+			};
+			for (const int32 CurrentScenePrimitiveIndex : UnknownScenePrimitiveIndexes)
+			{
+				if (CurrentScenePrimitiveIndex < RenderScene->Primitives.Num())
+					ResolveScenePrimitive(CurrentScenePrimitiveIndex);
+			}
+			// A different primitive than the one in the lookup was hit, the scene was compacted since the lookup was updated.
+			// The primitive of the lookup is looked up as well, INDEX_NONE when it was removed from the scene.
+			for (const TPair<int32, int32>& HitScenePrimitive : HitScenePrimitives)
+			{
+				if (HitScenePrimitive.Key < RenderScene->Primitives.Num() && RenderScene->Primitives[HitScenePrimitive.Key] &&
+					RenderScene->Primitives[HitScenePrimitive.Key]->GetPersistentIndex().Index != HitScenePrimitive.Value)
+				{
+					ResolveScenePrimitive(HitScenePrimitive.Key);
+					FPersistentPrimitiveIndex MovedPersistentPrimitiveIndex;
+					MovedPersistentPrimitiveIndex.Index = HitScenePrimitive.Value;
+					MovedScenePrimitives.AddUnique(TPair<int32, int32>(HitScenePrimitive.Value, RenderScene->GetPrimitiveIndex(MovedPersistentPrimitiveIndex)));
+				}
+			}
+		});
+	}
 
-							if (OutputIndex < 0 || OutputIndex >= GeneratedSettings.AzimuthAngles.Num() * InputSettings->MaximumBounces)
-							{
-								UE_LOG(SonoTraceUE, Error, TEXT("OutputIndex [%d] is out of bounds!"), OutputIndex);
-								continue; // Skip invalid accesses
-							}
+	RayTracingExecutionCount++;
+	AwaitingRayTracingResult = false;
+	if (InputSettings->EnableDebugLogExecutionTimes)
+		UE_LOG(SonoTraceUE, Log, TEXT("Raytracing parsing: %.5fs"), Result->ParseTime);
+	
+	if (!InputSettings->EnableRunSimulationOnlyOnTrigger)
+	{
+		double CurrentTimeNow = FPlatformTime::Seconds(); // Get the current time in seconds
+		if (CurrentTimeNow - RayTracingLastLoggedTime >= 5.0)       // Check if 5 seconds have passed
+		{
+			double Frequency = RayTracingExecutionCount / (CurrentTimeNow - RayTracingLastLoggedTime); // Calculate frequency
+			if (InputSettings->EnableDebugLogExecutionTimes)
+				UE_LOG(SonoTraceUE, Log, TEXT("Raytracing Frequency: %.2f Hz"), Frequency);
 
-							// Check if this ray was a hit			
-							if (const FStructuredOutputBufferElem& CurrentRayTracingOutput = RayTracingRawOutput[OutputIndex]; CurrentRayTracingOutput.IsHit)
-							{
-								CurrentRayIsHitting = true;
+			// Reset counters
+			RayTracingLastLoggedTime = CurrentTimeNow;
+			RayTracingExecutionCount = 0;
+		}
+	}
+	return true;
+}
 
-								// Check if it has line-of-sight to the sensor
-								if (CurrentRayTracingOutput.HitLineOfSightToSensor)
-								{
-									const int32 CurrentScenePrimitiveIndex = CurrentRayTracingOutput.HitScenePrimitiveIndex;
-									const int32 CurrentTriangleIndex = CurrentRayTracingOutput.HitTriangleIndex;
-									int32 CurrentPersistentPrimitiveIndex = -1;
-									if (ScenePrimitiveIndexToPersistentPrimitiveIndex.Find(CurrentScenePrimitiveIndex))
-										CurrentPersistentPrimitiveIndex = ScenePrimitiveIndexToPersistentPrimitiveIndex[CurrentScenePrimitiveIndex];										
-
-									// Compute the hit location in world space
-									FVector HitLocation = FVector(CurrentRayTracingOutput.HitPosX,
-																  CurrentRayTracingOutput.HitPosY,
-																  CurrentRayTracingOutput.HitPosZ);
-
-									FVector HitReflectionDirection(CurrentRayTracingOutput.HitReflectionX,
-																   CurrentRayTracingOutput.HitReflectionY,
-																   CurrentRayTracingOutput.HitReflectionZ);
-									
-									// If this is the original transmission, calculate the angle for source directivity and cache it
-									if (InputSettings->EnableEmitterDirectivity){
-										if (BounceIndex == 0){
-											for (int32 EmitterIndex = 0; EmitterIndex < EmitterPoses.Num(); ++EmitterIndex){
-												FVector LaunchVector = (HitLocation - EmitterPoses[EmitterIndex].GetLocation()).GetSafeNormal();
-												FVector EmitterForward = EmitterPoses[EmitterIndex].GetUnitAxis(EAxis::X);
-												float Dot = FVector::DotProduct(LaunchVector, EmitterForward);																					
-												float Directivity = (1.0f - GeneratedSettings.FinalEmitterDirectivities[EmitterIndex]) + (GeneratedSettings.FinalEmitterDirectivities[EmitterIndex] * Dot);
-												CachedSourceDirectivities[EmitterIndex] = FMath::Max(0.0f, Directivity);
-											}
-										}										
-									}
-
-									const float DistanceToSensor = FVector::Distance(HitLocation, SensorLocation);
-									FName ObjectName = "UNKNOWN";
-									int32 ObjectTypeIndex = 0;
-									const float RayDistanceTotal = CurrentRayTracingOutput.RayDistanceTotal;
-									TArray<float> RayDistancesTotalFromEmitters;
-									RayDistancesTotalFromEmitters.Append(CurrentRayTracingOutput.DistancesFromEmitterTotal, EmitterPoses.Num());
-
-									float CurvatureMagnitude = 0;
-									TArray<float>* SurfaceBRDF;
-									TArray<float>* SurfaceMaterial;
-
-									// Retrieve the object that was hit or add it first if not in tables yet
-									bool AddNewObject = true;
-									if (CurrentPersistentPrimitiveIndex != -1)
-									{
-										if(PersistentPrimitiveIndexToLabelsAndObjectTypes.Contains(CurrentPersistentPrimitiveIndex))
-											AddNewObject = false;										
-									}
-									if(!AddNewObject){
-										TTuple<FName, int32> ObjectNameAndTypeIndex = PersistentPrimitiveIndexToLabelsAndObjectTypes.FindChecked(CurrentPersistentPrimitiveIndex);
-										ObjectName = ObjectNameAndTypeIndex.Get<0>();
-										ObjectTypeIndex = ObjectNameAndTypeIndex.Get<1>();
-									}else
-									{
-										if (RenderScene && CurrentScenePrimitiveIndex >= 0 && CurrentScenePrimitiveIndex < RenderScene->Primitives.Num())
-										{
-											if (const FPrimitiveSceneInfo* PrimitiveSceneInfo = RenderScene->Primitives[CurrentScenePrimitiveIndex])
-											{
-												if (const FPrimitiveSceneProxy* PrimitiveSceneProxy = PrimitiveSceneInfo->Proxy)
-												{
-													CurrentPersistentPrimitiveIndex = PrimitiveSceneInfo->GetPersistentIndex().Index;
-													FName NewObjectName = FName(PrimitiveSceneProxy->GetOwnerName().ToString() + TEXT("_") + PrimitiveSceneProxy->GetResourceName().ToString());
-													PersistentPrimitiveIndexToLabelsAndObjectTypes.Add(CurrentPersistentPrimitiveIndex, TTuple<FName, int32>(NewObjectName, 0));
-													ScenePrimitiveIndexToPersistentPrimitiveIndex.Add(CurrentScenePrimitiveIndex, CurrentPersistentPrimitiveIndex);
-													ObjectName = NewObjectName;
-													UE_LOG(SonoTraceUE, Log, TEXT("Added unknown object with PPI #%d, SPI #%d and label '%s' using resource '%s' and object type 'default (#0)'."),
-																					CurrentPersistentPrimitiveIndex, CurrentScenePrimitiveIndex, *NewObjectName.ToString(), *PrimitiveSceneProxy->GetResourceName().ToString());
-												}
-											}		
-										}
-									}
-									RayTracingSubOutput.HitPersistentPrimitiveIndexes.AddUnique(CurrentPersistentPrimitiveIndex);
-									if (PersistentPrimitiveIndexToMeshDataIndex.Contains(CurrentPersistentPrimitiveIndex))
-									{
-										const int32 MeshDataIndex = PersistentPrimitiveIndexToMeshDataIndex[CurrentPersistentPrimitiveIndex];
-										FSonoTraceUEMeshDataStruct* CurrentMeshData = &MeshData[MeshDataIndex];
-										if (CurrentMeshData->TriangleCurvatureMagnitude.Num() > CurrentTriangleIndex)
-										{
-											CurvatureMagnitude = CurrentMeshData->TriangleCurvatureMagnitude[CurrentTriangleIndex];
-											SurfaceBRDF = &CurrentMeshData->TriangleBRDF[CurrentTriangleIndex];
-											SurfaceMaterial = &CurrentMeshData->TriangleMaterial[CurrentTriangleIndex];
-										}else
-										{
-											// TODO: Fix why this happens
-										    UE_LOG(SonoTraceUE, Warning, TEXT("Mesh data triangle index out of bounds. Object name: %s, PPI: %i, SPI: %i and triangle Index: %i"), 
-											                          *ObjectName.ToString(), CurrentPersistentPrimitiveIndex, CurrentScenePrimitiveIndex, CurrentTriangleIndex);
-											SurfaceBRDF = &GeneratedSettings.ObjectSettings[0].DefaultTriangleBRDF;
-											SurfaceMaterial = &GeneratedSettings.ObjectSettings[0].DefaultTriangleMaterial;
-										}
-									}else
-									{
-										SurfaceBRDF = &GeneratedSettings.ObjectSettings[0].DefaultTriangleBRDF;
-										SurfaceMaterial = &GeneratedSettings.ObjectSettings[0].DefaultTriangleMaterial;
-									}
-
-									RayTracingSubOutput.ReflectedPoints[SavedPointIndex] = FSonoTraceUEPointStruct(HitLocation,
-																													HitReflectionDirection,
-																													ObjectName,
-																													OutputIndex,
-																													RayDistanceTotal,
-																													RayDistancesTotalFromEmitters,
-																													DistanceToSensor,
-																													ObjectTypeIndex,
-																													CurvatureMagnitude,
-																													SurfaceBRDF,
-																													SurfaceMaterial,
-																													RayIndex,
-																													BounceIndex,
-																													CachedSourceDirectivities);
-									SavedPointIndex++;
-									if (CurvatureMagnitude > RayTracingSubOutput.MaximumCurvature)
-										RayTracingSubOutput.MaximumCurvature = CurvatureMagnitude;
-									if (RayDistanceTotal > RayTracingSubOutput.MaximumTotalDistance)
-										RayTracingSubOutput.MaximumTotalDistance = RayDistanceTotal;
-								}
-							}
-							else{
-								if (CurrentRayIsHitting)
-									RayTracingSubOutput.ReflectedPoints[SavedPointIndex - 1].IsLastHit = true;
-								break;
-							}
-						}
-					}
-					if (InputSettings->EnableDirectPathComponentCalculation)
+void ASonoTraceUEActor::AddResolvedScenePrimitives()
+{
+	FScopeLock Lock(&ResolvedScenePrimitivesCriticalSection);
+	for (const TTuple<int32, int32, FName, FName>& ResolvedScenePrimitive : ResolvedScenePrimitives)
+	{
+		MeshRegistry->ResolveScenePrimitive(ResolvedScenePrimitive.Get<0>(), ResolvedScenePrimitive.Get<1>(), ResolvedScenePrimitive.Get<2>(), ResolvedScenePrimitive.Get<3>());
+	}
+	ResolvedScenePrimitives.Empty();
+	for (const TPair<int32, int32>& MovedScenePrimitive : MovedScenePrimitives)
+	{
+		MeshRegistry->MoveScenePrimitive(MovedScenePrimitive.Key, MovedScenePrimitive.Value);
+	}
+	MovedScenePrimitives.Empty();
+}
+
+bool ASonoTraceUEActor::RunSimulation(const TArray<int32> OverrideEmitterSignalIndexes)
+{
+	// Only one simulation runs at a time, its result is swapped into CurrentOutput when it completes
+	if (SimulationTask.IsValid())
+		return false;
+
+	TSharedRef<FSonoTraceUESimulationInput, ESPMode::ThreadSafe> Input = MakeShared<FSonoTraceUESimulationInput, ESPMode::ThreadSafe>();
+	Input->Index = CurrentOutput.Index + 1;
+	Input->StartTime = FPlatformTime::Seconds();
+
+	// The simulation task only reads this copy of the settings
+	FSonoTraceUESimulationSettings& Settings = Input->Settings;
+	Settings.NumberOfSimFrequencies = InputSettings->NumberOfSimFrequencies;
+	Settings.EnableSpecularComponentCalculation = InputSettings->EnableSpecularComponentCalculation;
+	Settings.EnableSpecularSimulationOnlyOnLastHits = InputSettings->EnableSpecularSimulationOnlyOnLastHits;
+	Settings.SpecularMinimumStrength = InputSettings->SpecularMinimumStrength;
+	Settings.EnableReceiverDirectivity = InputSettings->EnableReceiverDirectivity;
+	Settings.EnableEmitterDirectivity = InputSettings->EnableEmitterDirectivity;
+	Settings.EnableDiffractionComponentCalculation = InputSettings->EnableDiffractionComponentCalculation;
+	Settings.NumberOfInitialRays = InputSettings->NumberOfInitialRays;
+	Settings.DiffractionSimDivisionFactor = InputSettings->DiffractionSimDivisionFactor;
+	Settings.SensorLowerAzimuthLimit = InputSettings->SensorLowerAzimuthLimit;
+	Settings.SensorUpperAzimuthLimit = InputSettings->SensorUpperAzimuthLimit;
+	Settings.SensorLowerElevationLimit = InputSettings->SensorLowerElevationLimit;
+	Settings.SensorUpperElevationLimit = InputSettings->SensorUpperElevationLimit;
+	Settings.MaximumRayDistance = InputSettings->MaximumRayDistance;
+	Settings.DiffractionSampleBudget = InputSettings->DiffractionSampleBudget;
+	Settings.RandomSeed = InputSettings->RandomSeed;
+	Settings.DiffractionSampling = InputSettings->DiffractionSampling;
+	Settings.EnableDiffractionLineOfSightRequired = InputSettings->EnableDiffractionLineOfSightRequired;
+	Settings.DiffractionMinimumStrength = InputSettings->DiffractionMinimumStrength;
+	Settings.EnableDirectPathComponentCalculation = InputSettings->EnableDirectPathComponentCalculation;
+	Settings.DirectPathMinimumStrength = InputSettings->DirectPathMinimumStrength;
+	Settings.DirectPathStrength = InputSettings->DirectPathStrength;
+	Settings.EnableSimulationSubOutput = InputSettings->EnableSimulationSubOutput;
+	Settings.PointsInSensorFrame = InputSettings->PointsInSensorFrame;
+	Settings.EnableDebugLogExecutionTimes = InputSettings->EnableDebugLogExecutionTimes;
+	Settings.FinalReceiverDirectivities = GeneratedSettings.FinalReceiverDirectivities;
+	Settings.LogAbsorptions = GeneratedSettings.LogAbsorptions;
+	Settings.EmitterPatternGainTable = GeneratedSettings.EmitterPatternGainTable;
+	Settings.ObjectSettings = &MeshRegistry->ObjectSettings;
+
+	// Raytracing results are simulated with the poses the trace was submitted with
+	if (InputSettings->EnableRaytracing)
+	{
+		Input->SensorLocation = RayTracingFrameInfo.SensorLocation;
+		Input->SensorRotation = RayTracingFrameInfo.SensorRotation;
+		Input->EmitterPoses = RayTracingFrameInfo.EmitterPoses;
+		Input->ReceiverPoses = RayTracingFrameInfo.ReceiverPoses;
+	}else
+	{
+		Input->SensorLocation = SensorLocation;
+		Input->SensorRotation = SensorRotation;
+		Input->EmitterPoses = EmitterPoses;
+		Input->ReceiverPoses = ReceiverPoses;
+	}
+	Input->SensorToOwnerTranslation = SensorToOwnerTranslation;
+	Input->SensorToOwnerRotation = SensorToOwnerRotation;
+	Input->OwnerLocation = OwnerLocation;
+	Input->OwnerRotation = OwnerRotation;
+	if (!OverrideEmitterSignalIndexes.IsEmpty())
+	{
+		Input->EmitterSignalIndexes = OverrideEmitterSignalIndexes;
+	}else
+	{
+		Input->EmitterSignalIndexes = CurrentEmitterSignalIndexes;
+	}
+	Input->RayTracingSubOutput = MoveTemp(RayTracingSubOutput);
+	Input->DirectPathReceiverOutput = DirectPathReceiverOutput;
+	if (InputSettings->EnableDiffractionComponentCalculation)
+		GatherDiffractionObjects(*Input);
+
+	SimulationTask = UE::Tasks::Launch(UE_SOURCE_LOCATION,
+	[this, Input, World = GetWorld()]()
+	{
+		SimulateOutput(*Input, SimulationBackOutput, World);
+		SimulationTime = FPlatformTime::Seconds() - Input->StartTime;
+	});
+	return true;
+}
+
+bool ASonoTraceUEActor::CompleteRunSimulation()
+{
+	if (!SimulationTask.IsValid() || !SimulationTask.IsCompleted())
+		return false;
+	SimulationTask = UE::Tasks::FTask();
+
+	// The finished back buffer becomes the front buffer that drawing, Blueprints and the interface read from
+	Swap(CurrentOutput, SimulationBackOutput);
+	if (InputSettings->EnableDebugLogExecutionTimes)
+		UE_LOG(SonoTraceUE, Log, TEXT("Complete simulation generation: %.5fs"), SimulationTime);
+
+	if (InterfaceConnected)		
+	{
+		PrepareInterfaceMeasurementData(CurrentOutput);
+	}
+	return true;
+}
+
+void ASonoTraceUEActor::WaitForPendingTasks()
+{
+	if (ParseTask.IsValid())
+		ParseTask.Wait();
+	if (SimulationTask.IsValid())
+		SimulationTask.Wait();
+}
+
+void ASonoTraceUEActor::GatherDiffractionObjects(FSonoTraceUESimulationInput& Input)
+{
+	TArray<UPrimitiveComponent*> HitComponents;
+	auto AddHitObject = [&Input, &HitComponents](UPrimitiveComponent* Component, const int32 PersistentPrimitiveIndex, const int32 InstanceIndex)
+	{
+		HitComponents.Add(Component);
+		Input.HitObjectsPersistentPrimitiveIndexes.Add(PersistentPrimitiveIndex);
+		Input.HitObjectInstanceIndexes.Add(InstanceIndex);
+	};
+	if (InputSettings->EnableRaytracing)
+	{
+		// Instanced objects only add the instances that were hit
+		for (int32 PersistentPrimitiveIndex : Input.RayTracingSubOutput.HitPersistentPrimitiveIndexes)
+		{
+			if (MeshRegistry->PersistentPrimitiveIndexToMeshDataIndex.Contains(PersistentPrimitiveIndex) && !MeshRegistry->PersistentPrimitiveIndexToInstanceHierarchy.Contains(PersistentPrimitiveIndex))
+				AddHitObject(MeshRegistry->PersistentPrimitiveIndexToPrimitiveComponent.FindChecked(PersistentPrimitiveIndex), PersistentPrimitiveIndex, INDEX_NONE);
+		}
+		for (const FIntPoint& HitInstance : Input.RayTracingSubOutput.HitInstances)
+		{
+			if (MeshRegistry->PersistentPrimitiveIndexToMeshDataIndex.Contains(HitInstance.X))
+				AddHitObject(MeshRegistry->PersistentPrimitiveIndexToPrimitiveComponent.FindChecked(HitInstance.X), HitInstance.X, HitInstance.Y);
+		}
+	}else
+	{
+		// Find all actors in range
+		TArray<UPrimitiveComponent*> OutComponents;
+		TArray<TEnumAsByte<EObjectTypeQuery>> ObjectTypes;
+		if (InputSettings->EnableDiffractionForDynamicObjects)
+		{
+			ObjectTypes = {};
+		}else
+		{
+			ObjectTypes = {UEngineTypes::ConvertToObjectType(ECC_WorldStatic)};
+		}
+		UKismetSystemLibrary::SphereOverlapComponents(
+			GetWorld(),
+			Input.SensorLocation, 
+			InputSettings->MaximumRayDistance,
+			ObjectTypes,
+			nullptr, 
+			{},           
+			OutComponents
+		);
+
+		for (UPrimitiveComponent* Component : OutComponents)
+		{				
+			if (Cast<USkeletalMeshComponent>(Component) || Cast<UStaticMeshComponent>(Component))
+			{
+				UMeshComponent* MeshComponent = Cast<UMeshComponent>(Component);
+				if (MeshComponent->SceneProxy)
+				{
+					const int32 PersistentPrimitiveIndex = MeshComponent->SceneProxy->GetPrimitiveSceneInfo()->GetPersistentIndex().Index;
+					if (MeshRegistry->PersistentPrimitiveIndexToMeshDataIndex.Contains(PersistentPrimitiveIndex))
 					{
-						for (int32 ReceiverIndex = 0; ReceiverIndex < DirectPathAzimuthAngles.Num(); ReceiverIndex++)
+						TTuple<FName, int32> ObjectNameAndTypeIndex = MeshRegistry->PersistentPrimitiveIndexToLabelsAndObjectTypes.FindChecked(PersistentPrimitiveIndex);
+						if (const FSonoTraceUEInstanceHierarchyPtr* InstanceHierarchy = MeshRegistry->PersistentPrimitiveIndexToInstanceHierarchy.Find(PersistentPrimitiveIndex))
 						{
-							int32 DataIndex = GeneratedSettings.AzimuthAngles.Num() * InputSettings->MaximumBounces + ReceiverIndex * InputSettings->MaximumBounces;
-							const FStructuredOutputBufferElem& CurrentRayTracingOutput = RayTracingRawOutput[DataIndex];
-							
-							if (CurrentRayTracingOutput.DirectPath == 1 && CurrentRayTracingOutput.IsHit)
+							// The component overlaps when any instance does, only the instances in range are added
+							TArray<int32> InstancesInRange;
+							(*InstanceHierarchy)->OverlapSphere(FVector3f(Input.SensorLocation), InputSettings->MaximumRayDistance, InstancesInRange);
+							UE_LOG(SonoTraceUE, Verbose, TEXT("Object with label '%s' and object type #%d detected for diffraction with %d of %d instances in range."), *ObjectNameAndTypeIndex.Get<0>().ToString(),
+							       ObjectNameAndTypeIndex.Get<1>(), InstancesInRange.Num(), (*InstanceHierarchy)->Num());
+							for (const int32 InstanceIndex : InstancesInRange)
 							{
-								float DistanceSensorToReceiver = FVector::Distance(ReceiverPoses[ReceiverIndex].GetLocation(), SensorLocation);
-								if (DistanceSensorToReceiver < InputSettings->MaximumRayDistance * 2)
-								{
-									DirectPathReceiverOutput[ReceiverIndex] = TTuple<bool, FVector>(true, ReceiverPoses[ReceiverIndex].GetLocation());
-								}else
-								{
-									DirectPathReceiverOutput[ReceiverIndex] = TTuple<bool, FVector>(false, FVector(NAN, NAN,NAN));
-								}
-							}else
-							{
-								FVector HitLocation = FVector(CurrentRayTracingOutput.HitPosX, CurrentRayTracingOutput.HitPosY, CurrentRayTracingOutput.HitPosZ);
-								float DistanceSensorToReceiver = FVector::Distance(ReceiverPoses[ReceiverIndex].GetLocation(), SensorLocation);
-								if (DistanceSensorToReceiver < CurrentRayTracingOutput.RayDistanceTotal)
-								{
-									DirectPathReceiverOutput[ReceiverIndex] = TTuple<bool, FVector>(true, ReceiverPoses[ReceiverIndex].GetLocation());
-								}else
-								{
-									DirectPathReceiverOutput[ReceiverIndex] = TTuple<bool, FVector>(false, HitLocation);
-								}								
+								AddHitObject(MeshComponent, PersistentPrimitiveIndex, InstanceIndex);
 							}
+						}else
+						{
+							UE_LOG(SonoTraceUE, Verbose, TEXT("Object with label '%s' and object type #%d detected for diffraction."), *ObjectNameAndTypeIndex.Get<0>().ToString(), ObjectNameAndTypeIndex.Get<1>());
+							AddHitObject(MeshComponent, PersistentPrimitiveIndex, INDEX_NONE);
 						}
 					}
-					// Remove the remaining part of the struct.
-					RayTracingSubOutput.ReflectedPoints.RemoveAt(SavedPointIndex, RayTracingSubOutput.ReflectedPoints.Num() - SavedPointIndex);
-				}				
-				// Unlock the buffer when done
-				GPUReadback->Unlock();
-
-				RayTracingExecutionCount++;
-
-				AwaitingRayTracingResult = false;
-				ReadyToUseRayTracingResult = true;
-				if (InputSettings->EnableDebugLogExecutionTimes)
-					UE_LOG(SonoTraceUE, Log, TEXT("Raytracing parsing: %.5fs"), FPlatformTime::Seconds() - CurrentTime);
-				
-				if (!InputSettings->EnableRunSimulationOnlyOnTrigger)
-				{
-					double CurrentTimeNow = FPlatformTime::Seconds(); // Get the current time in seconds
-					if (CurrentTimeNow - RayTracingLastLoggedTime >= 5.0)       // Check if 5 seconds have passed
-					{
-						double Frequency = RayTracingExecutionCount / (CurrentTimeNow - RayTracingLastLoggedTime); // Calculate frequency
-						if (InputSettings->EnableDebugLogExecutionTimes)
-							UE_LOG(SonoTraceUE, Log, TEXT("Raytracing Frequency: %.2f Hz"), Frequency);
-
-						// Reset counters
-						RayTracingLastLoggedTime = CurrentTimeNow;
-						RayTracingExecutionCount = 0;
-					}
 				}
 			}
-			CurrentlyParsingRaytracing = false;
-		});
+		}
 	}
-}
 
-void ASonoTraceUEActor::RunSimulation(const TArray<int32> OverrideEmitterSignalIndexes)
-{
-	int32 NewIndex =  CurrentOutput.Index + 1;
-	CurrentOutput = FSonoTraceUEOutputStruct();
-	CurrentOutput.Index = NewIndex;
-	CurrentOutput.Timestamp = FDateTime::Now().ToUnixTimestamp();
-	CurrentOutput.SensorLocation = SensorLocation;
-	CurrentOutput.SensorRotation = SensorRotation;
-	CurrentOutput.SensorToOwnerTranslation = SensorToOwnerTranslation;
-	CurrentOutput.SensorToOwnerRotation = SensorToOwnerRotation;
-	CurrentOutput.OwnerLocation = OwnerLocation;
-	CurrentOutput.OwnerRotation = OwnerRotation;
-	CurrentOutput.EmitterPoses = EmitterPoses;
-	CurrentOutput.ReceiverPoses = ReceiverPoses;
-	if (!OverrideEmitterSignalIndexes.IsEmpty())
+	// Component state is only read here on the game thread, the simulation task works on the copies.
+	// Instance transforms are only fetched for the instances that were selected.
+	for (int32 HitIndex = 0; HitIndex < Input.HitObjectsPersistentPrimitiveIndexes.Num(); ++HitIndex)
+	{
+		const int32 PersistentPrimitiveIndex = Input.HitObjectsPersistentPrimitiveIndexes[HitIndex];
+		const TTuple<FName, int32> ObjectNameAndTypeIndex = MeshRegistry->PersistentPrimitiveIndexToLabelsAndObjectTypes.FindChecked(PersistentPrimitiveIndex);
+		Input.HitObjectLabels.Add(ObjectNameAndTypeIndex.Get<0>());
+		Input.HitObjectTypes.Add(ObjectNameAndTypeIndex.Get<1>());
+		Input.HitObjectMeshData.Add(MeshRegistry->MeshData[MeshRegistry->PersistentPrimitiveIndexToMeshDataIndex.FindChecked(PersistentPrimitiveIndex)]);
+		FTransform& HitObjectTransform = Input.HitObjectTransforms.Add_GetRef(HitComponents[HitIndex]->GetComponentTransform());
+		const UInstancedStaticMeshComponent* InstancedMeshComponent = Cast<UInstancedStaticMeshComponent>(HitComponents[HitIndex]);
+		if (InstancedMeshComponent && Input.HitObjectInstanceIndexes[HitIndex] != INDEX_NONE)
+			InstancedMeshComponent->GetInstanceTransform(Input.HitObjectInstanceIndexes[HitIndex], HitObjectTransform, true);
+		FCollisionQueryParams& TraceParams = Input.HitObjectTraceParams.Emplace_GetRef(FName(TEXT("DiffractionTrace")), true);
+		TraceParams.AddIgnoredActor(HitComponents[HitIndex]->GetOwner());
+		TraceParams.AddIgnoredActor(this);
+		Input.HitObjectKeys.Add(Input.HitObjectInstanceIndexes[HitIndex] == INDEX_NONE ? static_cast<uint32>(PersistentPrimitiveIndex) :
+			HashCombineFast(static_cast<uint32>(PersistentPrimitiveIndex), static_cast<uint32>(Input.HitObjectInstanceIndexes[HitIndex])));
+	}
+
+	// Every loaded tile of a landscape in range is its own hit object, its mesh data is in the frame of the landscape without its scale.
+	// With raytracing only landscapes that were hit are added.
+	const TArray<FVector> SensorLocations = {Input.SensorLocation};
+	for (const FSonoTraceUELandscape& Landscape : MeshRegistry->Landscapes)
 	{
-		CurrentOutput.EmitterSignalIndexes = OverrideEmitterSignalIndexes;
-	}else
+		if (!Landscape.Landscape.IsValid() || Landscape.PersistentPrimitiveIndexes.IsEmpty())
+			continue;
+		if (InputSettings->EnableRaytracing && !Landscape.PersistentPrimitiveIndexes.ContainsByPredicate([&Input](const int32 PersistentPrimitiveIndex)
+			{ return Input.RayTracingSubOutput.HitPersistentPrimitiveIndexes.Contains(PersistentPrimitiveIndex); }))
+			continue;
+		const int32 PersistentPrimitiveIndex = Landscape.PersistentPrimitiveIndexes[0];
+		const FTransform TileTransform = Landscape.GetTileTransform();
+		int32 NumberOfTiles = 0;
+		for (const TPair<FIntPoint, FSonoTraceUELandscapeTile>& Tile : Landscape.Tiles)
+		{
+			if (Tile.Value.MeshDataIndex == INDEX_NONE || Landscape.GetTileDistance(Tile.Key, SensorLocations) > InputSettings->MaximumRayDistance)
+				continue;
+			Input.HitObjectsPersistentPrimitiveIndexes.Add(PersistentPrimitiveIndex);
+			Input.HitObjectInstanceIndexes.Add(INDEX_NONE);
+			Input.HitObjectLabels.Add(Landscape.Label);
+			Input.HitObjectTypes.Add(Landscape.ObjectTypeIndex);
+			Input.HitObjectMeshData.Add(MeshRegistry->MeshData[Tile.Value.MeshDataIndex]);
+			Input.HitObjectTransforms.Add(TileTransform);
+			FCollisionQueryParams& TraceParams = Input.HitObjectTraceParams.Emplace_GetRef(FName(TEXT("DiffractionTrace")), true);
+			TraceParams.AddIgnoredActor(Landscape.Landscape.Get());
+			TraceParams.AddIgnoredActor(this);
+			Input.HitObjectKeys.Add(HashCombineFast(static_cast<uint32>(PersistentPrimitiveIndex), GetTypeHash(Tile.Key)));
+			NumberOfTiles++;
+		}
+		UE_LOG(SonoTraceUE, Verbose, TEXT("Landscape with label '%s' and object type #%d detected for diffraction with %d tiles in range."), *Landscape.Label.ToString(), Landscape.ObjectTypeIndex, NumberOfTiles);
+	}
+}
+namespace
+{
+	typedef TArray<float, TInlineAllocator<256>> FReceiverGains;
+
+	// With an aggregated emitter pattern every receiver gets the array gain toward the direction the sound arrives from, otherwise the gains stay empty
+	void CalculateReceiverGains(const FSonoTraceUESimulationInput& Input, const FVector& SourceLocation, FReceiverGains& OutGains)
 	{
-		CurrentOutput.EmitterSignalIndexes = CurrentEmitterSignalIndexes;
+		OutGains.Reset();
+		if (!Input.Settings.EmitterPatternGainTable.IsValid() || !Input.Settings.EmitterPatternGainTable->IsValid())
+			return;
+		const FSonoTraceUEArrayGainTable& GainTable = *Input.Settings.EmitterPatternGainTable;
+		OutGains.SetNumUninitialized(Input.ReceiverPoses.Num() * GainTable.NumberOfFrequencies);
+		for (int32 ReceiverIndex = 0; ReceiverIndex < Input.ReceiverPoses.Num(); ++ReceiverIndex)
+		{
+			TArrayView<float> Gains = TArrayView<float>(OutGains).Slice(ReceiverIndex * GainTable.NumberOfFrequencies, GainTable.NumberOfFrequencies);
+			const FVector ReceiverLocation = Input.ReceiverPoses[ReceiverIndex].GetLocation();
+			if (ReceiverLocation.ContainsNaN())
+			{
+				for (float& Gain : Gains)
+					Gain = 1.0f;
+				continue;
+			}
+			GainTable.GetGains(Input.SensorRotation.UnrotateVector(SourceLocation - ReceiverLocation), Gains);
+		}
 	}
+}
 
-	FTransform SensorTransform(SensorRotation, SensorLocation);    
+void ASonoTraceUEActor::SimulateOutput(FSonoTraceUESimulationInput& Input, FSonoTraceUEOutputStruct& Output, const UWorld* World)
+{
+	const FSonoTraceUESimulationSettings& Settings = Input.Settings;
+
+	// The strength tensor of the back buffer keeps its allocation between runs
+	FSonoTraceUEStrengthTensor StrengthTensor = MoveTemp(Output.StrengthTensor);
+	Output = FSonoTraceUEOutputStruct();
+	Output.StrengthTensor = MoveTemp(StrengthTensor);
+	Output.StrengthTensor.Reset(Input.EmitterPoses.Num(), Input.ReceiverPoses.Num(), Settings.NumberOfSimFrequencies);
+	Output.Index = Input.Index;
+	Output.Timestamp = FDateTime::Now().ToUnixTimestamp();
+	Output.SensorLocation = Input.SensorLocation;
+	Output.SensorRotation = Input.SensorRotation;
+	Output.SensorToOwnerTranslation = Input.SensorToOwnerTranslation;
+	Output.SensorToOwnerRotation = Input.SensorToOwnerRotation;
+	Output.OwnerLocation = Input.OwnerLocation;
+	Output.OwnerRotation = Input.OwnerRotation;
+	Output.EmitterPoses = Input.EmitterPoses;
+	Output.ReceiverPoses = Input.ReceiverPoses;
+	Output.EmitterSignalIndexes = Input.EmitterSignalIndexes;
+
+	FTransform SensorTransform(Input.SensorRotation, Input.SensorLocation);    
 	FTransform WorldToSensorTransform = SensorTransform.Inverse();
 	
-	if (InputSettings->EnableSpecularComponentCalculation)
+	if (Settings.EnableSpecularComponentCalculation)
 	{
 		double CurrentTime = FPlatformTime::Seconds();
-		RayTracingSubOutput.ReflectedStrengths.Init(0.0f, RayTracingSubOutput.ReflectedPoints.Num());
-		ParallelFor(RayTracingSubOutput.ReflectedPoints.Num(), [&](int32 ReflectedPointIndex)
-		// for (int32 ReflectedPointIndex = 0; ReflectedPointIndex < RayTracingSubOutput.ReflectedPoints.Num(); ++ReflectedPointIndex)
+		Input.RayTracingSubOutput.ReflectedStrengths.Init(0.0f, Input.RayTracingSubOutput.ReflectedPoints.Num());
+
+		// Only the simulated points get a block in the strength tensor
+		FSonoTraceUEStrengthTensor& SpecularStrengthTensor = Input.RayTracingSubOutput.StrengthTensor;
+		SpecularStrengthTensor.Reset(Input.EmitterPoses.Num(), Input.ReceiverPoses.Num(), Settings.NumberOfSimFrequencies);
+		int32 NumberOfSimulatedPoints = 0;
+		for (FSonoTraceUEPointStruct& ReflectedPoint : Input.RayTracingSubOutput.ReflectedPoints)
+		{
+			if ((ReflectedPoint.IsLastHit && Settings.EnableSpecularSimulationOnlyOnLastHits) || !Settings.EnableSpecularSimulationOnlyOnLastHits)
+				ReflectedPoint.StrengthTensorIndex = NumberOfSimulatedPoints++;
+		}
+		SpecularStrengthTensor.AddBlocks(NumberOfSimulatedPoints);
+
+		// Points that are not simulated have no strength and are only kept without a minimum strength.
+		// The kernel compares the summed squared strength of all paths and frequencies against the minimum, so it is scaled by their count.
+		TArray<uint8> SpecularKeepMask;
+		SpecularKeepMask.Init(Settings.SpecularMinimumStrength > 0.0f ? 0 : 1, Input.RayTracingSubOutput.ReflectedPoints.Num());
+		const float SpecularStrengthNormalization = Input.ReceiverPoses.Num() * Input.EmitterPoses.Num() * Settings.NumberOfSimFrequencies;
+		const float SpecularMinimumSummedSquaredStrength = Settings.SpecularMinimumStrength > 0.0f ? Settings.SpecularMinimumStrength * SpecularStrengthNormalization : -1.0f;
+		
+		// The curvature and total distance maxima of the parser already cover all points, only the strength is added here
+		const FSonoTraceUEPointStatistics SpecularStatistics = ParallelForWithStatistics(Input.RayTracingSubOutput.ReflectedPoints.Num(), [&](FSonoTraceUEPointStatistics& Statistics, int32 ReflectedPointIndex)
+		// for (int32 ReflectedPointIndex = 0; ReflectedPointIndex < Input.RayTracingSubOutput.ReflectedPoints.Num(); ++ReflectedPointIndex)
 		{
-			FSonoTraceUEPointStruct& ReflectedPoint = RayTracingSubOutput.ReflectedPoints[ReflectedPointIndex];	
-			if ((ReflectedPoint.IsLastHit && InputSettings->EnableSpecularSimulationOnlyOnLastHits) || !InputSettings->EnableSpecularSimulationOnlyOnLastHits)
+			FSonoTraceUEPointStruct& ReflectedPoint = Input.RayTracingSubOutput.ReflectedPoints[ReflectedPointIndex];	
+			if (ReflectedPoint.StrengthTensorIndex != INDEX_NONE)
 			{
-				ReflectedPoint.TotalDistancesToReceivers.Init(TArray<float>(), EmitterPoses.Num());
-				ReflectedPoint.Strengths.SetNum(EmitterPoses.Num());
-				for (int32 EmitterIndex = 0; EmitterIndex < EmitterPoses.Num(); ++EmitterIndex)
-				{
-					ReflectedPoint.Strengths[EmitterIndex].Init(TArray<float>(), ReceiverPoses.Num());
-					ReflectedPoint.TotalDistancesToReceivers[EmitterIndex].Init(0, ReceiverPoses.Num());
-				}
-				
-				for (int32 ReceiverIndex = 0; ReceiverIndex < ReceiverPoses.Num(); ++ReceiverIndex)
+				// Per emitter and receiver path the cosine of the reflection angle and the frequency independent strength factors, invalid receivers keep a zero scale
+				const int32 NumberOfPaths = Input.EmitterPoses.Num() * Input.ReceiverPoses.Num();
+				TArray<float, TInlineAllocator<64>> ReflectionCosines;
+				TArray<float, TInlineAllocator<64>> Scales;
+				ReflectionCosines.Init(1.0f, NumberOfPaths);
+				Scales.Init(0.0f, NumberOfPaths);
+				for (int32 ReceiverIndex = 0; ReceiverIndex < Input.ReceiverPoses.Num(); ++ReceiverIndex)
 				{
-					if (const FTransform& ReceiverPose = ReceiverPoses[ReceiverIndex]; !ReceiverPose.GetLocation().ContainsNaN())
+					if (const FTransform& ReceiverPose = Input.ReceiverPoses[ReceiverIndex]; !ReceiverPose.GetLocation().ContainsNaN())
 					{						
 						// Calculate the normalized direction vector from the reflection point to the receiver
 						FVector VecReceiverToReflection = (ReceiverPose.GetLocation() - ReflectedPoint.Location).GetSafeNormal();
 						
 						// Calculate receiver directivity strength (Weight = (1-P) + P*cos(theta))
 						float ReceiverDirectivity = 1.0f;
-						if (InputSettings->EnableReceiverDirectivity)
+						if (Settings.EnableReceiverDirectivity)
 						{
 							const float RecDot = FVector::DotProduct(-VecReceiverToReflection, ReceiverPose.GetUnitAxis(EAxis::X));							
-							 ReceiverDirectivity = (1.0f - GeneratedSettings.FinalReceiverDirectivities[ReceiverIndex]) + (GeneratedSettings.FinalReceiverDirectivities[ReceiverIndex] * RecDot);
+							 ReceiverDirectivity = (1.0f - Settings.FinalReceiverDirectivities[ReceiverIndex]) + (Settings.FinalReceiverDirectivities[ReceiverIndex] * RecDot);
 							 ReceiverDirectivity = FMath::Max(0.0f, ReceiverDirectivity);
 						}
 		
-						// Calculate the angle of reflection (in degrees)
-						const float AngleReflection = FMath::RadiansToDegrees(FMath::Acos(FVector::DotProduct(ReflectedPoint.ReflectionDirection, VecReceiverToReflection)));
+						// The angle of reflection is calculated from its cosine in the kernel
+						const float ReflectionCosine = FVector::DotProduct(ReflectedPoint.ReflectionDirection, VecReceiverToReflection);
 						
-						for (int32 EmitterIndex = 0; EmitterIndex < EmitterPoses.Num(); ++EmitterIndex)
+						for (int32 EmitterIndex = 0; EmitterIndex < Input.EmitterPoses.Num(); ++EmitterIndex)
 						{					
 							
 							// Source directivity retrieval
 							float SourceDirectivity = 1.0f;
-							if (InputSettings->EnableEmitterDirectivity)
+							if (Settings.EnableEmitterDirectivity)
 							{
 								if (ReflectedPoint.EmitterDirectivities.IsValidIndex(EmitterIndex)) 
 								{
@@ -1685,34 +1961,31 @@ void ASonoTraceUEActor::RunSimulation(const TArray<int32> OverrideEmitterSignalI
 							
 							// Calculate distance to receiver and add it to the total path length (in centimeters)
 							const float TotalDistanceToSensor = ReflectedPoint.TotalDistancesFromEmitters[EmitterIndex] + FVector::Distance(ReflectedPoint.Location, ReceiverPose.GetLocation());
-							ReflectedPoint.TotalDistancesToReceivers[EmitterIndex][ReceiverIndex] = TotalDistanceToSensor;
+							SpecularStrengthTensor.GetTotalDistanceToReceiver(ReflectedPoint.StrengthTensorIndex, EmitterIndex, ReceiverIndex) = TotalDistanceToSensor;
 		
 							// Path loss (geometrical spreading loss) in meters
 							const float ReflectionStrengthPathLoss = 1.0f / FMath::Square(TotalDistanceToSensor / 100.0f);
-		
-							// Loop the simulation frequencies and calculate the specular reflection strength with the BRDF
-							ReflectedPoint.Strengths[EmitterIndex][ReceiverIndex].Init(0, InputSettings->NumberOfSimFrequencies);
-							ReflectedPoint.SummedStrength = 0;
-							for (int32 FrequencyIndex = 0; FrequencyIndex < InputSettings->NumberOfSimFrequencies; FrequencyIndex++)
-							{
-								const float SurfaceBRDF = (*ReflectedPoint.SurfaceBRDF)[FrequencyIndex];
-								const float SurfaceBRDFExponent = -1/ (2 * SurfaceBRDF * SurfaceBRDF);
-								const float SurfaceMaterial = (*ReflectedPoint.SurfaceMaterial)[FrequencyIndex];
-								const float AlphaAbsorption = 0.038 * (GeneratedSettings.Frequencies[FrequencyIndex] / 1000) - 0.3;
-								const float PathlossAbsorption = FMath::Pow(10.0f, -(AlphaAbsorption * ReflectedPoint.TotalDistance / 100) / 20);
-								const float ReflectionStrengthBRDF = exp(SurfaceBRDFExponent * (AngleReflection * AngleReflection));
-								const float Strength = ReflectionStrengthBRDF * ReflectionStrengthPathLoss * SurfaceMaterial * PathlossAbsorption * ReceiverDirectivity * SourceDirectivity;								
-								ReflectedPoint.Strengths[EmitterIndex][ReceiverIndex][FrequencyIndex] = Strength;
-								ReflectedPoint.SummedStrength += Strength * Strength;
-							}
+
+							const int32 PathIndex = EmitterIndex * Input.ReceiverPoses.Num() + ReceiverIndex;
+							ReflectionCosines[PathIndex] = ReflectionCosine;
+							Scales[PathIndex] = ReflectionStrengthPathLoss * ReceiverDirectivity * SourceDirectivity;
 						}
 					}					
 				}
-				ReflectedPoint.SummedStrength = ReflectedPoint.SummedStrength / ReceiverPoses.Num() / EmitterPoses.Num() / InputSettings->NumberOfSimFrequencies;
-				RayTracingSubOutput.ReflectedStrengths[ReflectedPointIndex] = ReflectedPoint.SummedStrength;
-				if (ReflectedPoint.SummedStrength > RayTracingSubOutput.MaximumStrength)
-					RayTracingSubOutput.MaximumStrength = ReflectedPoint.SummedStrength;
-				if (InputSettings->PointsInSensorFrame)
+
+				// Specular reflection strength with the BRDF for all paths and simulation frequencies at once
+				FReceiverGains ReceiverGains;
+				CalculateReceiverGains(Input, ReflectedPoint.Location, ReceiverGains);
+				const FSonoTraceUEStrengthKernelResult Strength = FSonoTraceUEStrengthKernels::Specular(SpecularStrengthTensor.GetBlockStrengths(ReflectedPoint.StrengthTensorIndex), ReflectionCosines, Scales,
+				                                                                                        *ReflectedPoint.SurfaceBRDF, *ReflectedPoint.SurfaceMaterial, Settings.LogAbsorptions, ReflectedPoint.TotalDistance / 100.0f,
+				                                                                                        ReceiverGains, SpecularMinimumSummedSquaredStrength);
+				Statistics.Add(Strength.SummedSquaredStrength / SpecularStrengthNormalization, ReflectedPoint.CurvatureMagnitude, ReflectedPoint.TotalDistance);
+				if (!Strength.IsKept)
+					return;
+				SpecularKeepMask[ReflectedPointIndex] = 1;
+				ReflectedPoint.SummedStrength = Strength.SummedSquaredStrength / SpecularStrengthNormalization;
+				Input.RayTracingSubOutput.ReflectedStrengths[ReflectedPointIndex] = ReflectedPoint.SummedStrength;
+				if (Settings.PointsInSensorFrame)
 				{    
 					ReflectedPoint.Location = WorldToSensorTransform.TransformPosition(ReflectedPoint.Location);
 					ReflectedPoint.ReflectionDirection = WorldToSensorTransform.TransformVector(ReflectedPoint.ReflectionDirection);
@@ -1720,424 +1993,447 @@ void ASonoTraceUEActor::RunSimulation(const TArray<int32> OverrideEmitterSignalI
 			}
 		}
 		);
-		if (InputSettings->SpecularMinimumStrength > 0.0f)
-		{
-			for (int32 ReflectedPointIndex = RayTracingSubOutput.ReflectedPoints.Num() - 1; ReflectedPointIndex >= 0; --ReflectedPointIndex)
-			{
-				if (RayTracingSubOutput.ReflectedStrengths[ReflectedPointIndex] < InputSettings->SpecularMinimumStrength)
-				{
-					RayTracingSubOutput.ReflectedPoints.RemoveAt(ReflectedPointIndex);
-					RayTracingSubOutput.ReflectedStrengths.RemoveAt(ReflectedPointIndex);
-				}
-			}
-		}
-		if (InputSettings->EnableSpecularComponentCalculation)
+		Input.RayTracingSubOutput.MaximumStrength = SpecularStatistics.MaximumStrength;
+		Input.RayTracingSubOutput.Compact(SpecularKeepMask);
+		if (Settings.EnableSpecularComponentCalculation)
 		{
-			CurrentOutput.SpecularSubOutput = RayTracingSubOutput;
+			Output.SpecularSubOutput = Input.RayTracingSubOutput;
 		}
-		CurrentOutput.Timestamp = RayTracingSubOutput.Timestamp;		
-		CurrentOutput.ReflectedPoints.Append(RayTracingSubOutput.ReflectedPoints);
+		Output.Timestamp = Input.RayTracingSubOutput.Timestamp;		
+		Output.AppendPoints(Input.RayTracingSubOutput);
 		
-		if (InputSettings->EnableDebugLogExecutionTimes)
-			UE_LOG(SonoTraceUE, Log, TEXT("Specular component calculation: %.5fs"), FPlatformTime::Seconds() - CurrentTime);
+		if (Settings.EnableDebugLogExecutionTimes)
+			UE_LOG(SonoTraceUE, Log, TEXT("Specular component calculation: %.5fs, %d simulated points"), FPlatformTime::Seconds() - CurrentTime, SpecularStatistics.NumberOfHits);
 	}
 
 	FSonoTraceUESubOutputStruct DiffractionSubOutput = FSonoTraceUESubOutputStruct();
-	if (InputSettings->EnableDiffractionComponentCalculation)
+	if (Settings.EnableDiffractionComponentCalculation)
 	{
 		double CurrentTime = FPlatformTime::Seconds();
-		DiffractionSubOutput.MaximumCurvature = 0.0f;
-		DiffractionSubOutput.MaximumStrength = 0.0f;
-		DiffractionSubOutput.MaximumTotalDistance = 0.0f;
-		DiffractionSubOutput.Timestamp = CurrentOutput.Timestamp;
-		
-		TArray<int32> HitObjectsPersistentPrimitiveIndexes;
-		TArray<int32> HitObjectTypes;
-		TArray<FName> HitObjectLabels;
-		TArray<FTransform> HitObjectTransforms;
-		if (InputSettings->EnableRaytracing)
+		DiffractionSubOutput.Timestamp = Output.Timestamp;
+		const int32 NumDiffractionCandidates = SimulateDiffraction(Input, World, DiffractionSubOutput);
+		if (Settings.EnableSimulationSubOutput)
 		{
-			for (int32 PersistentPrimitiveIndex : RayTracingSubOutput.HitPersistentPrimitiveIndexes)
-			{
-				if (PersistentPrimitiveIndexToMeshDataIndex.Contains(PersistentPrimitiveIndex))
-				{
-					TTuple<FName, int32> ObjectNameAndTypeIndex = PersistentPrimitiveIndexToLabelsAndObjectTypes.FindChecked(PersistentPrimitiveIndex);
-					FName ObjectName = ObjectNameAndTypeIndex.Get<0>();
-					int32 ObjectTypeIndex = ObjectNameAndTypeIndex.Get<1>();
-					// UE_LOG(SonoTraceUE, Log, TEXT("Object with label '%s' and object type #%d detected for diffraction."), *ObjectName.ToString(), ObjectTypeIndex);
-					HitObjectsPersistentPrimitiveIndexes.Add(PersistentPrimitiveIndex);
-					HitObjectTypes.Add(ObjectTypeIndex);
-					HitObjectLabels.Add(ObjectName);
-					HitObjectTransforms.Add(PersistentPrimitiveIndexToPrimitiveComponent.FindChecked(PersistentPrimitiveIndex)->GetComponentTransform());
-				}
-			}						
-		}else
+			Output.DiffractionSubOutput = DiffractionSubOutput;
+		}
+		Output.AppendPoints(DiffractionSubOutput);
+		if (Settings.EnableDebugLogExecutionTimes)
+			UE_LOG(SonoTraceUE, Log, TEXT("Diffraction component calculation:%.5fs, %d points from %d candidates on %d workers, summed strength %g +- %g"), FPlatformTime::Seconds() - CurrentTime, DiffractionSubOutput.ReflectedPoints.Num(),
+			       NumDiffractionCandidates, FTaskGraphInterface::Get().GetNumWorkerThreads(), DiffractionSubOutput.SummedStrength, DiffractionSubOutput.SummedStrengthStandardError);
+	}
+
+	FSonoTraceUESubOutputStruct DirectPathSubOutput = FSonoTraceUESubOutputStruct();
+	if (Settings.EnableDirectPathComponentCalculation)
+	{
+		double CurrentTime = FPlatformTime::Seconds();
+		DirectPathSubOutput.MaximumCurvature = 0.0f;
+		DirectPathSubOutput.MaximumStrength = 0.0f;
+		DirectPathSubOutput.MaximumTotalDistance = 0.0f;
+		DirectPathSubOutput.Timestamp = Input.RayTracingSubOutput.Timestamp;
+		Output.DirectPathLOS.Init(false, Input.ReceiverPoses.Num());
+		FSonoTraceUEStrengthTensor& DirectPathStrengthTensor = DirectPathSubOutput.StrengthTensor;
+		DirectPathStrengthTensor.Reset(Input.EmitterPoses.Num(), Input.ReceiverPoses.Num(), Settings.NumberOfSimFrequencies);
+		FSonoTraceUEPointStatistics DirectPathStatistics;
+		// Every emitter gets its point, points below the minimum strength are compacted away afterwards like the other components
+		const float DirectPathStrengthNormalization = Input.ReceiverPoses.Num() * Input.EmitterPoses.Num() * Settings.NumberOfSimFrequencies;
+		const float DirectPathMinimumSummedSquaredStrength = Settings.DirectPathMinimumStrength > 0.0f ? Settings.DirectPathMinimumStrength * DirectPathStrengthNormalization : -1.0f;
+		TArray<uint8> DirectPathKeepMask;
+		DirectPathKeepMask.Init(0, Input.EmitterPoses.Num());
+
+		for (int32 EmitterIndex = 0; EmitterIndex < Input.EmitterPoses.Num(); ++EmitterIndex)
 		{
-			// Find all actors in range
-			TArray<UPrimitiveComponent*> OutComponents;
-			TArray<TEnumAsByte<EObjectTypeQuery>> ObjectTypes;
-			if (InputSettings->EnableDiffractionForDynamicObjects)
-			{
-				ObjectTypes = {};
-			}else
+			const int32 StrengthTensorIndex = DirectPathStrengthTensor.AddBlocks(1);
+
+			for (int32 EmitterIndex2 = 0; EmitterIndex2 < Input.EmitterPoses.Num(); ++EmitterIndex2)
 			{
-				ObjectTypes = {UEngineTypes::ConvertToObjectType(ECC_WorldStatic)};
+				for (int32 ReceiverIndex = 0; ReceiverIndex < Input.ReceiverPoses.Num(); ++ReceiverIndex)
+				{
+					DirectPathStrengthTensor.GetTotalDistanceToReceiver(StrengthTensorIndex, EmitterIndex2, ReceiverIndex) = FVector::Distance(Input.EmitterPoses[EmitterIndex2].GetLocation(), Input.ReceiverPoses[ReceiverIndex].GetLocation());
+				}				
 			}
-			UKismetSystemLibrary::SphereOverlapComponents(
-				GetWorld(),
-				SensorLocation, 
-				InputSettings->MaximumRayDistance,
-				ObjectTypes,
-				nullptr, 
-				{},           
-				OutComponents
-			);
 
-			for (UPrimitiveComponent* Component : OutComponents)
-			{				
-				if (Cast<USkeletalMeshComponent>(Component) || Cast<UStaticMeshComponent>(Component))
+			// Receivers without line-of-sight keep a zero distance so the kernel leaves their strengths at zero
+			TArray<float, TInlineAllocator<32>> DistancesToReceiverMeters;
+			DistancesToReceiverMeters.Init(0.0f, Input.ReceiverPoses.Num());
+			for (int32 ReceiverIndex = 0; ReceiverIndex < Input.ReceiverPoses.Num(); ++ReceiverIndex)
+			{
+
+				TTuple<bool, FVector> LOSFoundAndTransformResult = Input.DirectPathReceiverOutput[ReceiverIndex];
+
+				if (LOSFoundAndTransformResult.Get<0>())
 				{
-					UMeshComponent* MeshComponent = Cast<UMeshComponent>(Component);
-					if (MeshComponent->SceneProxy)
-					{
-						const int32 PersistentPrimitiveIndex = MeshComponent->SceneProxy->GetPrimitiveSceneInfo()->GetPersistentIndex().Index;
-						if (PersistentPrimitiveIndexToMeshDataIndex.Contains(PersistentPrimitiveIndex))
-						{
-							TTuple<FName, int32> ObjectNameAndTypeIndex = PersistentPrimitiveIndexToLabelsAndObjectTypes.FindChecked(PersistentPrimitiveIndex);
-							FName ObjectName = ObjectNameAndTypeIndex.Get<0>();
-							int32 ObjectTypeIndex = ObjectNameAndTypeIndex.Get<1>();
-							UE_LOG(SonoTraceUE, Log, TEXT("Object with label '%s' and object type #%d detected for diffraction."), *ObjectName.ToString(), ObjectTypeIndex);
-							HitObjectsPersistentPrimitiveIndexes.Add(PersistentPrimitiveIndex);
-							HitObjectTypes.Add(ObjectTypeIndex);
-							HitObjectLabels.Add(ObjectName);
-							HitObjectTransforms.Add(MeshComponent->GetComponentTransform());
-						}
-					}
-				}
+					if (EmitterIndex == 0)
+						Output.DirectPathLOS[ReceiverIndex] = true;
+					DistancesToReceiverMeters[ReceiverIndex] = DirectPathStrengthTensor.GetTotalDistanceToReceiver(StrengthTensorIndex, EmitterIndex, ReceiverIndex) / 100.0f;
+				}				
 			}
+			FReceiverGains ReceiverGains;
+			CalculateReceiverGains(Input, Input.EmitterPoses[EmitterIndex].GetLocation(), ReceiverGains);
+			const int32 EmitterStrengthsSize = Input.ReceiverPoses.Num() * Settings.NumberOfSimFrequencies;
+			const FSonoTraceUEStrengthKernelResult Strength = FSonoTraceUEStrengthKernels::DirectPath(DirectPathStrengthTensor.GetBlockStrengths(StrengthTensorIndex).Slice(EmitterIndex * EmitterStrengthsSize, EmitterStrengthsSize),
+			                                                                                          DistancesToReceiverMeters, Settings.DirectPathStrength, Settings.LogAbsorptions, ReceiverGains,
+			                                                                                          DirectPathMinimumSummedSquaredStrength);
+			const float SummedStrength = Strength.SummedSquaredStrength / DirectPathStrengthNormalization;
+
+			const float SensorDistance = FVector::Distance(Input.EmitterPoses[EmitterIndex].GetLocation(), Input.SensorLocation);
+			DirectPathStatistics.Add(SummedStrength, 0.0f, SensorDistance);
+			DirectPathSubOutput.ReflectedPoints.AddDefaulted();
+			DirectPathSubOutput.ReflectedStrengths.Add(0.0f);
+			if (!Strength.IsKept)
+				continue;
+			DirectPathKeepMask[EmitterIndex] = 1;
+			const FName Label = FName(*(FString::Printf(TEXT("DIRECT_EMITTER_%d"), EmitterIndex)));
+			FSonoTraceUEPointStruct DirectPathPoint = FSonoTraceUEPointStruct(Input.EmitterPoses[EmitterIndex].GetLocation(), Input.SensorRotation.Vector(), Label, EmitterIndex,
+																			  SensorDistance, SensorDistance, SummedStrength, StrengthTensorIndex);
+			if (Settings.PointsInSensorFrame)
+			{    
+				DirectPathPoint.Location = WorldToSensorTransform.TransformPosition(DirectPathPoint.Location);
+				DirectPathPoint.ReflectionDirection = WorldToSensorTransform.TransformVector(DirectPathPoint.ReflectionDirection);
+			}
+			DirectPathSubOutput.ReflectedPoints[EmitterIndex] = DirectPathPoint;
+			DirectPathSubOutput.ReflectedStrengths[EmitterIndex] = SummedStrength;
+		}
+		DirectPathSubOutput.Compact(DirectPathKeepMask);
+		DirectPathSubOutput.MaximumStrength = DirectPathStatistics.MaximumStrength;
+		DirectPathSubOutput.MaximumTotalDistance = DirectPathStatistics.MaximumTotalDistance;
+		if (Settings.EnableSimulationSubOutput)
+		{
+			Output.DirectPathSubOutput = DirectPathSubOutput;
 		}		
-		int32 NumDiffractionPoints = FMath::CeilToInt32(static_cast<float>(InputSettings->NumberOfInitialRays) / static_cast<float>(InputSettings->DiffractionSimDivisionFactor));
-		DiffractionSubOutput.HitPersistentPrimitiveIndexes = HitObjectsPersistentPrimitiveIndexes;
-		for (int32 HitIndex = 0; HitIndex < HitObjectsPersistentPrimitiveIndexes.Num(); ++HitIndex)
+		Output.AppendPoints(DirectPathSubOutput);
+		Output.Timestamp = DirectPathSubOutput.Timestamp;
+		if (Settings.EnableDebugLogExecutionTimes)
+			UE_LOG(SonoTraceUE, Log, TEXT("Direct path component calculation: %.5fs"), FPlatformTime::Seconds() - CurrentTime);
+	}
+
+	Output.MaximumCurvature = FMath::Max(DirectPathSubOutput.MaximumCurvature,FMath::Max(Input.RayTracingSubOutput.MaximumCurvature, DiffractionSubOutput.MaximumCurvature));
+	Output.MaximumStrength = FMath::Max(DirectPathSubOutput.MaximumStrength,FMath::Max(Input.RayTracingSubOutput.MaximumStrength, DiffractionSubOutput.MaximumStrength));
+	Output.MaximumTotalDistance = FMath::Max(DirectPathSubOutput.MaximumTotalDistance,FMath::Max(Input.RayTracingSubOutput.MaximumTotalDistance, DiffractionSubOutput.MaximumTotalDistance));
+}
+
+int32 ASonoTraceUEActor::SimulateDiffraction(const FSonoTraceUESimulationInput& Input, const UWorld* World, FSonoTraceUESubOutputStruct& DiffractionSubOutput)
+{
+	const FSonoTraceUESimulationSettings& Settings = Input.Settings;
+	const FTransform WorldToSensorTransform = FTransform(Input.SensorRotation, Input.SensorLocation).Inverse();
+	DiffractionSubOutput.MaximumCurvature = 0.0f;
+	DiffractionSubOutput.MaximumStrength = 0.0f;
+	DiffractionSubOutput.MaximumTotalDistance = 0.0f;
+	DiffractionSubOutput.StrengthTensor.Reset(Input.EmitterPoses.Num(), Input.ReceiverPoses.Num(), Settings.NumberOfSimFrequencies);
+	
+	const int32 NumDiffractionPoints = FMath::CeilToInt32(static_cast<float>(Settings.NumberOfInitialRays) / static_cast<float>(Settings.DiffractionSimDivisionFactor));
+	DiffractionSubOutput.HitPersistentPrimitiveIndexes = TSet<int32>(Input.HitObjectsPersistentPrimitiveIndexes).Array();
+	for (int32 HitIndex = 0; HitIndex < Input.HitObjectsPersistentPrimitiveIndexes.Num(); ++HitIndex)
+	{
+		if (Input.HitObjectInstanceIndexes[HitIndex] != INDEX_NONE)
+			DiffractionSubOutput.HitInstances.Emplace(Input.HitObjectsPersistentPrimitiveIndexes[HitIndex], Input.HitObjectInstanceIndexes[HitIndex]);
+	}
+	// A diffraction point is only seen by emitters it faces, its normal points away from the emitter
+	auto IsFacingEmitter = [&Input](const FVector& Position, const FVector& Normal, const int32 EmitterIndex, FVector& OutEmitterToPointNormed)
+	{
+		const FVector DiffractionVector = Position - Input.EmitterPoses[EmitterIndex].GetLocation();
+		const float Norm = DiffractionVector.Size();
+		OutEmitterToPointNormed = Norm > KINDA_SMALL_NUMBER ? DiffractionVector / Norm : FVector::ZeroVector;
+		const float Angle = FMath::RadiansToDegrees(FMath::Acos(FMath::Clamp(FVector::DotProduct(Normal, OutEmitterToPointNormed), -1.0f, 1.0f)));
+		return Angle > 90 && Angle < 270;
+	};
+
+	struct FDiffractionCandidate
+	{
+		FVector Position;
+		FVector Normal;
+		int32 TriangleIndex;
+		int32 HitIndex;
+		int32 SampleIndex;
+	};
+
+	// The clusters of every hit object that can hold a diffraction point in this measurement, culled against the frustum and the emitters in parallel
+	struct FDiffractionObjectSampling
+	{
+		TArray<int32> Clusters;
+		FSonoTraceUEAliasTable ClusterTable;
+		float VisibleImportance = 0.0f;
+		float Weight = 0.0f;
+	};
+	const int32 NumHitObjects = Input.HitObjectsPersistentPrimitiveIndexes.Num();
+	TArray<FVector, TInlineAllocator<16>> EmitterLocations;
+	for (const FTransform& EmitterPose : Input.EmitterPoses)
+	{
+		EmitterLocations.Add(EmitterPose.GetLocation());
+	}
+	FSonoTraceUEDiffractionClusters::FView ClusterView;
+	ClusterView.SensorLocation = Input.SensorLocation;
+	ClusterView.SensorRotation = Input.SensorRotation;
+	ClusterView.LowerAzimuthLimit = Settings.SensorLowerAzimuthLimit;
+	ClusterView.UpperAzimuthLimit = Settings.SensorUpperAzimuthLimit;
+	ClusterView.LowerElevationLimit = Settings.SensorLowerElevationLimit;
+	ClusterView.UpperElevationLimit = Settings.SensorUpperElevationLimit;
+	ClusterView.MaximumDistance = Settings.MaximumRayDistance;
+	ClusterView.EmitterLocations = EmitterLocations;
+	TArray<FDiffractionObjectSampling> ObjectSamplings;
+	ObjectSamplings.SetNum(NumHitObjects);
+	ParallelFor(NumHitObjects, [&](const int32 HitIndex)
+	{
+		FDiffractionObjectSampling& ObjectSampling = ObjectSamplings[HitIndex];
+		const FSonoTraceUEDiffractionClusters& Clusters = Input.HitObjectMeshData[HitIndex]->DiffractionClusters;
+		TArray<float> ClusterImportances;
+		ObjectSampling.Weight = Clusters.Cull(Input.HitObjectTransforms[HitIndex], ClusterView, ObjectSampling.Clusters, ClusterImportances);
+		for (const float ClusterImportance : ClusterImportances)
 		{
-			int32 PersistentPrimitiveIndex = HitObjectsPersistentPrimitiveIndexes[HitIndex];
-			int32 MeshDataIndex = PersistentPrimitiveIndexToMeshDataIndex.FindChecked(PersistentPrimitiveIndex);
-			FSonoTraceUEMeshDataStruct* CurrentMeshData = &MeshData[MeshDataIndex];
-
-			TArray<float> ImportanceVertexCDF;
-			ImportanceVertexCDF.Reserve(CurrentMeshData->ImportanceVertexOrderedBRDFValue.Num());
-			float CumulativeSum = 0.0f;
-			for (int32 i = 0; i < CurrentMeshData->ImportanceVertexOrderedBRDFValue.Num(); ++i)
-			{
-				const float Noise = 0.00001f * FMath::FRand(); 
-				const float NoisyValue = CurrentMeshData->ImportanceVertexOrderedBRDFValue[i] + Noise;
-				CumulativeSum += NoisyValue;
-				ImportanceVertexCDF.Add(CumulativeSum);
-			}
-			
-			float MaxCDFValue = TNumericLimits<float>::Min();
-			for (float Value : ImportanceVertexCDF)
-			{
-				MaxCDFValue = FMath::Max(MaxCDFValue, Value);
-			}
-			if (MaxCDFValue > 0.0f) 
-			{
-				for (float& Value : ImportanceVertexCDF)
-				{
-					Value /= MaxCDFValue;
-				}
-			}
+			ObjectSampling.VisibleImportance += ClusterImportance;
+		}
+		ObjectSampling.ClusterTable.Build(ClusterImportances);
+	});
 
-			TArray<float> SamplesRandomUniform;
-			SamplesRandomUniform.Reserve(NumDiffractionPoints);
+	// Without a budget every object keeps the samples that would have landed on its visible clusters when sampling the whole mesh,
+	// with a budget the samples are split over the objects by their projected importance
+	TArray<int32> SampleCounts;
+	if (Settings.DiffractionSampleBudget > 0)
+	{
+		TArray<float> ObjectWeights;
+		for (const FDiffractionObjectSampling& ObjectSampling : ObjectSamplings)
+		{
+			ObjectWeights.Add(ObjectSampling.ClusterTable.IsValid() ? ObjectSampling.Weight : 0.0f);
+		}
+		FSonoTraceUEDiffractionClusters::SplitBudget(ObjectWeights, Settings.DiffractionSampleBudget, SampleCounts);
+	}
+	else
+	{
+		SampleCounts.SetNumZeroed(NumHitObjects);
+		for (int32 HitIndex = 0; HitIndex < NumHitObjects; ++HitIndex)
+		{
+			const float MeshImportance = Input.HitObjectMeshData[HitIndex]->DiffractionClusters.MeshImportance;
+			if (ObjectSamplings[HitIndex].ClusterTable.IsValid() && MeshImportance > 0.0f)
+				SampleCounts[HitIndex] = FMath::RoundToInt32(NumDiffractionPoints * ObjectSamplings[HitIndex].VisibleImportance / MeshImportance);
+		}
+	}
 
-			for (int32 i = 0; i < NumDiffractionPoints; ++i)
-			{
-				SamplesRandomUniform.Add(FMath::FRand()); 
-			}
-			TArray<float> Indices;
-			for (int32 i = 0; i < ImportanceVertexCDF.Num(); ++i)
-			{
-				Indices.Add(static_cast<float>(i));
-			}
-			TArray<float> InterpolatedResults = Interpolate(ImportanceVertexCDF, Indices, SamplesRandomUniform);
-			
-			TArray<int32> SamplesRandomImportance;
-			for (float Value : InterpolatedResults)
+	// Every hit object owns a range of sample slots, chunks of slots are sampled and filtered in parallel and compacted afterwards
+	TArray<int32> SlotOffsets;
+	TArray<TPair<int32, int32>> SampleChunks; // Hit index, first sample
+	int32 NumSampleSlots = 0;
+	for (int32 HitIndex = 0; HitIndex < NumHitObjects; ++HitIndex)
+	{
+		SlotOffsets.Add(NumSampleSlots);
+		for (int32 FirstSampleIndex = 0; FirstSampleIndex < SampleCounts[HitIndex]; FirstSampleIndex += SonoTraceUECompaction::ElementsPerChunk)
+		{
+			SampleChunks.Emplace(HitIndex, FirstSampleIndex);
+		}
+		NumSampleSlots += SampleCounts[HitIndex];
+	}
+	const FSonoTraceUEPhilox DiffractionRandom(static_cast<uint32>(Settings.RandomSeed), FSonoTraceUEPhilox::EStream::Diffraction);
+	const FSonoTraceUEPhilox DiffractionSequenceRandom(static_cast<uint32>(Settings.RandomSeed), FSonoTraceUEPhilox::EStream::DiffractionSequence);
+	const bool UseSobolSampling = Settings.DiffractionSampling == ESonoTraceUEDiffractionSamplingEnum::Sobol;
+
+	// The samples of every object are interleaved over independent replicates, the spread of the replicate totals estimates the sampling error
+	constexpr int32 NumberOfDiffractionReplicates = 4;
+	const float MaxDistanceSquared = FMath::Square(Settings.MaximumRayDistance);
+	TArray<FDiffractionCandidate> DiffractionCandidates;
+	DiffractionCandidates.SetNumUninitialized(NumSampleSlots);
+	TArray<uint8> DiffractionKeepMask;
+	DiffractionKeepMask.SetNumZeroed(NumSampleSlots);
+	ParallelFor(SampleChunks.Num(), [&](const int32 ChunkIndex)
+	{
+		const int32 HitIndex = SampleChunks[ChunkIndex].Key;
+		const FSonoTraceUEMeshDataStruct* CurrentMeshData = Input.HitObjectMeshData[HitIndex].Get();
+		const FDiffractionObjectSampling& ObjectSampling = ObjectSamplings[HitIndex];
+
+		// Diffraction points are drawn proportional to the importance of the triangles, first a visible cluster and then a triangle from the alias table of the cluster.
+		// The random numbers of a sample only depend on the measurement, object and sample, so they do not change with the chunking.
+		const uint32 ObjectKey = Input.HitObjectKeys[HitIndex];
+		const uint32 ObjectSequenceSeed = DiffractionSequenceRandom.GetSeed(Input.Index, ObjectKey);
+		const int32 FirstSampleIndex = SampleChunks[ChunkIndex].Value;
+		const int32 LastSampleIndex = FMath::Min(FirstSampleIndex + SonoTraceUECompaction::ElementsPerChunk, SampleCounts[HitIndex]);
+		for (int32 SampleIndex = FirstSampleIndex; SampleIndex < LastSampleIndex; ++SampleIndex)
+		{
+			float Uniforms[4];
+			if (UseSobolSampling)
 			{
-				SamplesRandomImportance.Add(FMath::RoundToInt32(Value));
+				// Every replicate is its own scrambled sequence, so each is a well spread set of samples on its own
+				const int32 ReplicateIndex = SampleIndex % NumberOfDiffractionReplicates;
+				FSonoTraceUESobol::GetUniforms(SampleIndex / NumberOfDiffractionReplicates, HashCombineFast(ObjectSequenceSeed, static_cast<uint32>(ReplicateIndex)), Uniforms);
 			}
-
-			TArray<FVector> DiffractionPositions;
-			TArray<FVector> DiffractionNormals;
-			TArray<int32> DiffractionTriangleIndexes;
-			float MaxDistanceSquared = FMath::Square(InputSettings->MaximumRayDistance);
-			for (int32 Index : SamplesRandomImportance)
+			else
 			{
-
-				int32 SortedTriangleIndex = CurrentMeshData->ImportanceVertexOrderedIndex[Index];
-				FVector LocalPosition = CurrentMeshData->TrianglePosition[SortedTriangleIndex];
-				FVector WorldPosition = HitObjectTransforms[HitIndex].TransformPosition(LocalPosition);
-				FVector DirectionToPoint = WorldPosition - SensorLocation;	
-				if (float DistanceSquared = DirectionToPoint.SizeSquared(); DistanceSquared <= MaxDistanceSquared && DistanceSquared > KINDA_SMALL_NUMBER && CurrentMeshData->TriangleSize[SortedTriangleIndex] < InputSettings->DiffractionTriangleSizeThreshold)
-				{
-					DirectionToPoint.Normalize();
-					FVector LocalDirection = SensorRotation.UnrotateVector(DirectionToPoint);
-					float ElevationAngle = FMath::RadiansToDegrees(FMath::Asin(LocalDirection.Z));
-					float AzimuthAngle = FMath::RadiansToDegrees(FMath::Atan2(LocalDirection.Y, LocalDirection.X));
-
-					if (ElevationAngle >= InputSettings->SensorLowerElevationLimit
-						&& ElevationAngle <= InputSettings->SensorUpperElevationLimit
-						&& AzimuthAngle >=  InputSettings->SensorLowerAzimuthLimit
-						&& AzimuthAngle <=  InputSettings->SensorUpperAzimuthLimit)
-					{
-						DiffractionPositions.Add(WorldPosition);
-						DiffractionTriangleIndexes.Add(SortedTriangleIndex);
-						FVector LocalNormal = CurrentMeshData->TriangleNormal[SortedTriangleIndex];
-						FVector WorldNormal = HitObjectTransforms[HitIndex].TransformVectorNoScale(LocalNormal);
-						DiffractionNormals.Add(WorldNormal);
-					}
-				}
+				DiffractionRandom.GetUniforms(Input.Index, ObjectKey, SampleIndex, 0, Uniforms);
 			}
-			
-			TArray<TArray<FVector>> VectorEmitterToDiffractionNormed;
-			VectorEmitterToDiffractionNormed.Init(TArray<FVector>(), EmitterPoses.Num());
-			for (int32 EmitterIndex = 0; EmitterIndex < EmitterPoses.Num(); ++EmitterIndex)
+			const int32 ClusterIndex = ObjectSampling.Clusters[ObjectSampling.ClusterTable.Sample(Uniforms[0], Uniforms[1])];
+			const int32 TriangleIndex = CurrentMeshData->DiffractionClusters.SampleTriangle(ClusterIndex, Uniforms[2], Uniforms[3]);
+			FVector LocalPosition = CurrentMeshData->TrianglePosition[TriangleIndex];
+			FVector WorldPosition = Input.HitObjectTransforms[HitIndex].TransformPosition(LocalPosition);
+			FVector DirectionToPoint = WorldPosition - Input.SensorLocation;	
+			if (float DistanceSquared = DirectionToPoint.SizeSquared(); DistanceSquared <= MaxDistanceSquared && DistanceSquared > KINDA_SMALL_NUMBER)
 			{
-				VectorEmitterToDiffractionNormed[EmitterIndex].Reserve(DiffractionPositions.Num());
-				FVector EmitterLocation = EmitterPoses[EmitterIndex].GetLocation();
-				for (const FVector& DiffractionPoint : DiffractionPositions)
+				DirectionToPoint.Normalize();
+				FVector LocalDirection = Input.SensorRotation.UnrotateVector(DirectionToPoint);
+				float ElevationAngle = FMath::RadiansToDegrees(FMath::Asin(LocalDirection.Z));
+				float AzimuthAngle = FMath::RadiansToDegrees(FMath::Atan2(LocalDirection.Y, LocalDirection.X));
+
+				if (ElevationAngle >= Settings.SensorLowerElevationLimit
+					&& ElevationAngle <= Settings.SensorUpperElevationLimit
+					&& AzimuthAngle >=  Settings.SensorLowerAzimuthLimit
+					&& AzimuthAngle <=  Settings.SensorUpperAzimuthLimit)
 				{
-					FVector DiffractionVector = DiffractionPoint - EmitterLocation;
-					if (float Norm = DiffractionVector.Size(); Norm > KINDA_SMALL_NUMBER)
-					{
-						VectorEmitterToDiffractionNormed[EmitterIndex].Add(DiffractionVector / Norm);
-					}
-					else
-					{
-						VectorEmitterToDiffractionNormed[EmitterIndex].Add(FVector::ZeroVector);
-					}
-				}
-			}			
+					FVector LocalNormal = CurrentMeshData->TriangleNormal[TriangleIndex];
+					FVector WorldNormal = Input.HitObjectTransforms[HitIndex].TransformVectorNoScale(LocalNormal);
 
-			UPrimitiveComponent* CurrentPrimitiveComponent = PersistentPrimitiveIndexToPrimitiveComponent.FindChecked(PersistentPrimitiveIndex);
-			TArray<AActor*> IgnoreActors;
-			IgnoreActors.Add(CurrentPrimitiveComponent->GetOwner());
-			IgnoreActors.Add(this);
-			FCollisionQueryParams TraceParams(FName(TEXT("DiffractionTrace")), true);
-			TraceParams.AddIgnoredActors(IgnoreActors);
-
-			int32 NumReceivers = GeneratedSettings.FinalReceiverPositions.Num();			
-			for (int32 SampleIndex = 0; SampleIndex < DiffractionNormals.Num(); ++SampleIndex)
-			{
-				bool ValidLOS = true;
-				if (InputSettings->EnableDiffractionLineOfSightRequired)
-				{								
-					FHitResult HitResult;			
-					bool bHit = GetWorld()->LineTraceSingleByChannel(
-						HitResult,
-						SensorLocation,
-						DiffractionPositions[SampleIndex],
-						ECC_Visibility,
-						TraceParams
-					);
-					if (bHit)
-						ValidLOS = false;
-				}
-				if (ValidLOS)
-				{
+					// Samples no emitter can reach are dropped before they cost a trace
 					bool PointIsValidOnce = false;
-					TArray<float> VectorEmitterToDiffractionDistance;
-					TArray<bool> VectorEmitterValidAngle;
-					VectorEmitterToDiffractionDistance.Init(0, EmitterPoses.Num());
-					VectorEmitterValidAngle.Init(false, EmitterPoses.Num());
-					FVector PointLocation = DiffractionPositions[SampleIndex];
-
-					for (int32 EmitterIndex = 0; EmitterIndex < EmitterPoses.Num(); ++EmitterIndex)
+					FVector EmitterToPointNormed;
+					for (int32 EmitterIndex = 0; EmitterIndex < Input.EmitterPoses.Num() && !PointIsValidOnce; ++EmitterIndex)
 					{
-						float DotProduct = FVector::DotProduct(DiffractionNormals[SampleIndex], VectorEmitterToDiffractionNormed[EmitterIndex][SampleIndex]);
-						DotProduct = FMath::Clamp(DotProduct, -1.0f, 1.0f);
-						float Angle = FMath::RadiansToDegrees(FMath::Acos(DotProduct));
-						if (Angle > 90 && Angle < 270)
-						{
-							PointIsValidOnce = true;
-							VectorEmitterValidAngle[EmitterIndex] = true;
-							VectorEmitterToDiffractionDistance[EmitterIndex] = FVector::Dist(PointLocation, EmitterPoses[EmitterIndex].GetLocation());
-						}
+						PointIsValidOnce = IsFacingEmitter(WorldPosition, WorldNormal, EmitterIndex, EmitterToPointNormed);
 					}
 					if (PointIsValidOnce)
-					{						
-						float DistancePointToSensor = FVector::Dist(PointLocation, SensorLocation);
-						int32 TriangleIndex = DiffractionTriangleIndexes[SampleIndex];
-
-						FSonoTraceUEPointStruct NewPoint;
-						NewPoint.TotalDistancesToReceivers.Init(TArray<float>(), EmitterPoses.Num());
-						NewPoint.Strengths.SetNum(EmitterPoses.Num());
-
-						float SummedStrength = 0.0f;
-						for (int32 EmitterIndex = 0; EmitterIndex < EmitterPoses.Num(); ++EmitterIndex)
-						{
-							NewPoint.Strengths[EmitterIndex].Init(TArray<float>(), ReceiverPoses.Num());
-							NewPoint.TotalDistancesToReceivers[EmitterIndex].Init(0, ReceiverPoses.Num());
-							for (int32 ReceiverIndex = 0; ReceiverIndex < NumReceivers; ++ReceiverIndex)
-							{
-								NewPoint.Strengths[EmitterIndex][ReceiverIndex].Init(0, InputSettings->NumberOfSimFrequencies);
-								for (int32 FreqIndex = 0; FreqIndex < InputSettings->NumberOfSimFrequencies; ++FreqIndex)
-								{
-									FVector ReceiverLocation = ReceiverPoses[ReceiverIndex].GetLocation();
-									float DistanceEmitterToPoint = (EmitterPoses[EmitterIndex].GetLocation() - PointLocation).Size();
-									float DistanceMicToPoint = (ReceiverLocation - PointLocation).Size();
-									float FullDistance = DistanceEmitterToPoint + DistanceMicToPoint;
-									NewPoint.TotalDistancesToReceivers[EmitterIndex][ReceiverIndex] = FullDistance;
-									float FullDistanceMeters = FullDistance / 100.0f;
-									float PathLossDiff = 1.0f / FMath::Square(FullDistanceMeters);			        			
-									float AlphaAbsorption = 0.038f * (GeneratedSettings.Frequencies[FreqIndex] / 1000.0f) - 0.3f;
-									float PathLossAbsorption = FMath::Pow(10.0f, -(AlphaAbsorption * FullDistanceMeters) / 20.0f);			        			
-									float Strength = GeneratedSettings.ObjectSettings[HitObjectTypes[HitIndex]].MaterialStrengthsDiffraction[FreqIndex] *
-													 PathLossDiff * PathLossAbsorption;
-									NewPoint.Strengths[EmitterIndex][ReceiverIndex][FreqIndex] = Strength;						  
-									SummedStrength += Strength * Strength;
-								}
-							}
-						}
-						SummedStrength = SummedStrength / NumReceivers / EmitterPoses.Num() / InputSettings->NumberOfSimFrequencies;
-						if (SummedStrength > InputSettings->DiffractionMinimumStrength)
-						{
-							NewPoint.Location = PointLocation;
-							NewPoint.ReflectionDirection = VectorEmitterToDiffractionNormed[0][SampleIndex];
-							NewPoint.Label = HitObjectLabels[HitIndex];
-							NewPoint.Index = SampleIndex;
-							NewPoint.SummedStrength = SummedStrength;
-							NewPoint.TotalDistance = DistancePointToSensor;
-							NewPoint.TotalDistancesFromEmitters = VectorEmitterToDiffractionDistance;
-							NewPoint.DistanceToSensor = DistancePointToSensor;
-							NewPoint.ObjectTypeIndex = HitObjectTypes[HitIndex];
-							NewPoint.IsHit = true;
-							NewPoint.IsLastHit = true;
-							NewPoint.CurvatureMagnitude = CurrentMeshData->TriangleCurvatureMagnitude[TriangleIndex];	
-							NewPoint.SurfaceBRDF = &CurrentMeshData->TriangleBRDF[TriangleIndex];
-							NewPoint.SurfaceMaterial = &CurrentMeshData->TriangleMaterial[TriangleIndex];
-							NewPoint.IsSpecular = false;
-							NewPoint.IsDiffraction = true;
-						
-							if (InputSettings->PointsInSensorFrame)
-							{    
-								NewPoint.Location = WorldToSensorTransform.TransformPosition(NewPoint.Location);
-								NewPoint.ReflectionDirection = WorldToSensorTransform.TransformVector(NewPoint.ReflectionDirection);
-							}
-						
-							DiffractionSubOutput.ReflectedPoints.Add(NewPoint);
-							DiffractionSubOutput.ReflectedStrengths.Add(SummedStrength);
-							if (NewPoint.SummedStrength > DiffractionSubOutput.MaximumStrength)
-								DiffractionSubOutput.MaximumStrength = SummedStrength;
-							if (NewPoint.CurvatureMagnitude > DiffractionSubOutput.MaximumCurvature)
-								DiffractionSubOutput.MaximumCurvature = NewPoint.CurvatureMagnitude;
-							if (NewPoint.TotalDistance > DiffractionSubOutput.MaximumTotalDistance)
-								DiffractionSubOutput.MaximumTotalDistance = NewPoint.TotalDistance;
-						}		
+					{
+						const int32 SlotIndex = SlotOffsets[HitIndex] + SampleIndex;
+						DiffractionCandidates[SlotIndex] = {WorldPosition, WorldNormal, TriangleIndex, HitIndex, SampleIndex};
+						DiffractionKeepMask[SlotIndex] = 1;
 					}
-				}			
+				}
 			}
 		}
-		if (InputSettings->EnableSimulationSubOutput)
-		{
-			CurrentOutput.DiffractionSubOutput = DiffractionSubOutput;
-		}
-		CurrentOutput.ReflectedPoints.Append(DiffractionSubOutput.ReflectedPoints);
-		if (InputSettings->EnableDebugLogExecutionTimes)
-			UE_LOG(SonoTraceUE, Log, TEXT("Diffraction component calculation:%.5fs"), FPlatformTime::Seconds() - CurrentTime);
-	}
+	});
+	const int32 NumDiffractionCandidates = SonoTraceUECompaction::Compact(DiffractionCandidates, DiffractionKeepMask);
 
-	FSonoTraceUESubOutputStruct DirectPathSubOutput = FSonoTraceUESubOutputStruct();
-	if (InputSettings->EnableDirectPathComponentCalculation)
+	// All line of sight traces of the measurement run in parallel from the simulation task. Every scene query takes the read lock of the physics scene
+	// for its own duration, so game thread writes only wait for single traces and never for the whole batch.
+	DiffractionKeepMask.Init(1, NumDiffractionCandidates);
+	if (Settings.EnableDiffractionLineOfSightRequired && World)
 	{
-		double CurrentTime = FPlatformTime::Seconds();
-		DirectPathSubOutput.MaximumCurvature = 0.0f;
-		DirectPathSubOutput.MaximumStrength = 0.0f;
-		DirectPathSubOutput.MaximumTotalDistance = 0.0f;
-		DirectPathSubOutput.Timestamp = RayTracingSubOutput.Timestamp;
-		CurrentOutput.DirectPathLOS.Init(false, ReceiverPoses.Num());
-
-		for (int32 EmitterIndex = 0; EmitterIndex < EmitterPoses.Num(); ++EmitterIndex)
+		ParallelFor(NumDiffractionCandidates, [&](const int32 CandidateIndex)
 		{
-			TArray<TArray<TArray<float>>> Strengths; // Emitter // Receiver // Frequency
-			TArray<TArray<float>> TotalDistancesToReceivers; // Emitter // Receiver
-			float SummedStrength = 0.0f;
+			const FDiffractionCandidate& Candidate = DiffractionCandidates[CandidateIndex];
+			FHitResult HitResult;
+			if (World->LineTraceSingleByChannel(HitResult, Input.SensorLocation, Candidate.Position, ECC_Visibility, Input.HitObjectTraceParams[Candidate.HitIndex]))
+				DiffractionKeepMask[CandidateIndex] = 0;
+		});
+	}
 
-			TotalDistancesToReceivers.Init(TArray<float>(), EmitterPoses.Num());
-			Strengths.SetNum(EmitterPoses.Num());
-			for (int32 EmitterIndex2 = 0; EmitterIndex2 < EmitterPoses.Num(); ++EmitterIndex2)
+	// Every candidate gets its point and strength tensor block up front, points without line of sight or strength are compacted away afterwards
+	const int32 NumReceivers = Input.ReceiverPoses.Num();
+	FSonoTraceUEStrengthTensor& DiffractionStrengthTensor = DiffractionSubOutput.StrengthTensor;
+	DiffractionStrengthTensor.AddBlocks(NumDiffractionCandidates);
+	DiffractionSubOutput.ReflectedPoints.SetNum(NumDiffractionCandidates);
+	DiffractionSubOutput.ReflectedStrengths.SetNumZeroed(NumDiffractionCandidates);
+	TArray<float> DiffractionSampleStrengths;
+	DiffractionSampleStrengths.SetNumZeroed(NumDiffractionCandidates);
+	const FSonoTraceUEPointStatistics DiffractionStatistics = ParallelForWithStatistics(NumDiffractionCandidates, [&](FSonoTraceUEPointStatistics& Statistics, const int32 CandidateIndex)
+	{
+		if (!DiffractionKeepMask[CandidateIndex])
+			return;
+		const FDiffractionCandidate& Candidate = DiffractionCandidates[CandidateIndex];
+		const int32 HitIndex = Candidate.HitIndex;
+		const int32 TriangleIndex = Candidate.TriangleIndex;
+		const FSonoTraceUEMeshDataStruct* CurrentMeshData = Input.HitObjectMeshData[HitIndex].Get();
+		const FVector PointLocation = Candidate.Position;
+
+		// The distances to every emitter and receiver are computed once per point, the total path lengths are their sums
+		TArray<float> VectorEmitterToDiffractionDistance;
+		VectorEmitterToDiffractionDistance.Init(0, Input.EmitterPoses.Num());
+		TArray<float, TInlineAllocator<16>> DistancesEmitterToPoint;
+		DistancesEmitterToPoint.SetNumUninitialized(Input.EmitterPoses.Num());
+		FVector FirstEmitterToPointNormed = FVector::ZeroVector;
+		for (int32 EmitterIndex = 0; EmitterIndex < Input.EmitterPoses.Num(); ++EmitterIndex)
+		{
+			DistancesEmitterToPoint[EmitterIndex] = FVector::Dist(PointLocation, Input.EmitterPoses[EmitterIndex].GetLocation());
+			FVector EmitterToPointNormed;
+			if (IsFacingEmitter(PointLocation, Candidate.Normal, EmitterIndex, EmitterToPointNormed))
 			{
-				Strengths[EmitterIndex2].Init(TArray<float>(), ReceiverPoses.Num());
-				TotalDistancesToReceivers[EmitterIndex2].Init(0, ReceiverPoses.Num());
-				for (int32 ReceiverIndex = 0; ReceiverIndex < ReceiverPoses.Num(); ++ReceiverIndex)
-				{
-					Strengths[EmitterIndex2][ReceiverIndex].Init(0, InputSettings->NumberOfSimFrequencies);
-					TotalDistancesToReceivers[EmitterIndex2][ReceiverIndex] = FVector::Distance(EmitterPoses[EmitterIndex2].GetLocation(), ReceiverPoses[ReceiverIndex].GetLocation());
-				}				
+				VectorEmitterToDiffractionDistance[EmitterIndex] = DistancesEmitterToPoint[EmitterIndex];
 			}
+			if (EmitterIndex == 0)
+				FirstEmitterToPointNormed = EmitterToPointNormed;
+		}
+		TArray<float, TInlineAllocator<64>> DistancesReceiverToPoint;
+		DistancesReceiverToPoint.SetNumUninitialized(NumReceivers);
+		for (int32 ReceiverIndex = 0; ReceiverIndex < NumReceivers; ++ReceiverIndex)
+		{
+			DistancesReceiverToPoint[ReceiverIndex] = FVector::Dist(PointLocation, Input.ReceiverPoses[ReceiverIndex].GetLocation());
+		}
 
-			for (int32 ReceiverIndex = 0; ReceiverIndex < ReceiverPoses.Num(); ++ReceiverIndex)
+		TArray<float, TInlineAllocator<64>> FullDistancesMeters;
+		FullDistancesMeters.SetNumUninitialized(Input.EmitterPoses.Num() * NumReceivers);
+		TArrayView<float> TotalDistancesToReceivers = DiffractionStrengthTensor.GetBlockTotalDistancesToReceivers(CandidateIndex);
+		for (int32 EmitterIndex = 0; EmitterIndex < Input.EmitterPoses.Num(); ++EmitterIndex)
+		{
+			for (int32 ReceiverIndex = 0; ReceiverIndex < NumReceivers; ++ReceiverIndex)
 			{
-
-				TTuple<bool, FVector> LOSFoundAndTransformResult = DirectPathReceiverOutput[ReceiverIndex];
-
-				if (LOSFoundAndTransformResult.Get<0>())
-				{
-					if (EmitterIndex == 0)
-						CurrentOutput.DirectPathLOS[ReceiverIndex] = true;
-
-					// Path loss (geometrical spreading loss) in meters
-					const float ReflectionStrengthPathLoss = 1.0f / FMath::Square(TotalDistancesToReceivers[EmitterIndex][ReceiverIndex] / 100.0f);
-
-					// Loop the simulation frequencies and calculate the specular reflection strength with the BRDF
-					Strengths[EmitterIndex][ReceiverIndex].Init(0, InputSettings->NumberOfSimFrequencies);
-					for (int32 FrequencyIndex = 0; FrequencyIndex < InputSettings->NumberOfSimFrequencies; FrequencyIndex++)
-					{					
-						const float AlphaAbsorption = 0.038 * (GeneratedSettings.Frequencies[FrequencyIndex] / 1000) - 0.3;
-						const float PathlossAbsorption = FMath::Pow(10.0f, -(AlphaAbsorption * TotalDistancesToReceivers[EmitterIndex][ReceiverIndex] / 100) / 20);
-						const float Strength = InputSettings->DirectPathStrength * ReflectionStrengthPathLoss * PathlossAbsorption;
-						Strengths[EmitterIndex][ReceiverIndex][FrequencyIndex] = Strength;
-						SummedStrength += Strength * Strength;
-					}
-				}				
+				const int32 PathIndex = EmitterIndex * NumReceivers + ReceiverIndex;
+				const float FullDistance = DistancesEmitterToPoint[EmitterIndex] + DistancesReceiverToPoint[ReceiverIndex];
+				TotalDistancesToReceivers[PathIndex] = FullDistance;
+				FullDistancesMeters[PathIndex] = FullDistance / 100.0f;
 			}
-			SummedStrength = SummedStrength / ReceiverPoses.Num() / EmitterPoses.Num() / InputSettings->NumberOfSimFrequencies;
-			if (SummedStrength > DirectPathSubOutput.MaximumStrength)
-				DirectPathSubOutput.MaximumStrength = SummedStrength;
-
-			const FName Label = FName(*(FString::Printf(TEXT("DIRECT_EMITTER_%d"), EmitterIndex)));
-			const float SensorDistance = FVector::Distance(EmitterPoses[EmitterIndex].GetLocation(), SensorLocation);
-			FSonoTraceUEPointStruct DirectPathPoint = FSonoTraceUEPointStruct(EmitterPoses[EmitterIndex].GetLocation(), SensorRotation.Vector(), Label, EmitterIndex,
-																			  SensorDistance, SensorDistance, SummedStrength, TotalDistancesToReceivers, Strengths);
-			if (InputSettings->PointsInSensorFrame)
-			{    
-				DirectPathPoint.Location = WorldToSensorTransform.TransformPosition(DirectPathPoint.Location);
-				DirectPathPoint.ReflectionDirection = WorldToSensorTransform.TransformVector(DirectPathPoint.ReflectionDirection);
-			}
-			DirectPathSubOutput.ReflectedPoints.Add(DirectPathPoint);
-			DirectPathSubOutput.ReflectedStrengths.Add(SummedStrength);
 		}
-		if (InputSettings->EnableSimulationSubOutput)
+		FReceiverGains ReceiverGains;
+		CalculateReceiverGains(Input, PointLocation, ReceiverGains);
+		const float DiffractionStrengthNormalization = NumReceivers * Input.EmitterPoses.Num() * Settings.NumberOfSimFrequencies;
+		const FSonoTraceUEStrengthKernelResult Strength = FSonoTraceUEStrengthKernels::Diffraction(DiffractionStrengthTensor.GetBlockStrengths(CandidateIndex), FullDistancesMeters,
+		                                                                                           (*Settings.ObjectSettings)[Input.HitObjectTypes[HitIndex]].MaterialStrengthsDiffraction, Settings.LogAbsorptions,
+		                                                                                           ReceiverGains, Settings.DiffractionMinimumStrength * DiffractionStrengthNormalization);
+		const float SummedStrength = Strength.SummedSquaredStrength / DiffractionStrengthNormalization;
+		DiffractionSampleStrengths[CandidateIndex] = SummedStrength;
+		if (!Strength.IsKept)
 		{
-			CurrentOutput.DirectPathSubOutput = DirectPathSubOutput;
-		}		
-		CurrentOutput.ReflectedPoints.Append(DirectPathSubOutput.ReflectedPoints);
-		CurrentOutput.Timestamp = DirectPathSubOutput.Timestamp;
-		if (InputSettings->EnableDebugLogExecutionTimes)
-			UE_LOG(SonoTraceUE, Log, TEXT("Direct path component calculation: %.5fs"), FPlatformTime::Seconds() - CurrentTime);
-	}
+			DiffractionKeepMask[CandidateIndex] = 0;
+			return;
+		}
 
-	CurrentOutput.MaximumCurvature = FMath::Max(DirectPathSubOutput.MaximumCurvature,FMath::Max(RayTracingSubOutput.MaximumCurvature, DiffractionSubOutput.MaximumCurvature));
-	CurrentOutput.MaximumStrength = FMath::Max(DirectPathSubOutput.MaximumStrength,FMath::Max(RayTracingSubOutput.MaximumStrength, DiffractionSubOutput.MaximumStrength));
-	CurrentOutput.MaximumTotalDistance = FMath::Max(DirectPathSubOutput.MaximumTotalDistance,FMath::Max(RayTracingSubOutput.MaximumTotalDistance, DiffractionSubOutput.MaximumTotalDistance));
+		const float DistancePointToSensor = FVector::Dist(PointLocation, Input.SensorLocation);
+		FSonoTraceUEPointStruct& NewPoint = DiffractionSubOutput.ReflectedPoints[CandidateIndex];
+		NewPoint.StrengthTensorIndex = CandidateIndex;
+		NewPoint.Location = PointLocation;
+		NewPoint.ReflectionDirection = FirstEmitterToPointNormed;
+		NewPoint.Label = Input.HitObjectLabels[HitIndex];
+		NewPoint.InstanceIndex = Input.HitObjectInstanceIndexes[HitIndex];
+		NewPoint.Index = Candidate.SampleIndex;
+		NewPoint.SummedStrength = SummedStrength;
+		NewPoint.TotalDistance = DistancePointToSensor;
+		NewPoint.TotalDistancesFromEmitters = VectorEmitterToDiffractionDistance;
+		NewPoint.DistanceToSensor = DistancePointToSensor;
+		NewPoint.ObjectTypeIndex = Input.HitObjectTypes[HitIndex];
+		NewPoint.IsHit = true;
+		NewPoint.IsLastHit = true;
+		NewPoint.CurvatureMagnitude = CurrentMeshData->TriangleCurvatureMagnitude[TriangleIndex];
+		const FSonoTraceUESurfaceTable& SurfaceTable = (*Settings.ObjectSettings)[Input.HitObjectTypes[HitIndex]].SurfaceTable;
+		const int32 SurfaceLevel = SurfaceTable.GetLevel(NewPoint.CurvatureMagnitude);
+		NewPoint.SurfaceBRDF = &SurfaceTable.BRDF[SurfaceLevel];
+		NewPoint.SurfaceMaterial = &SurfaceTable.Material[SurfaceLevel];
+		NewPoint.IsSpecular = false;
+		NewPoint.IsDiffraction = true;
 	
-	CurrentOutput = CurrentOutput;
+		if (Settings.PointsInSensorFrame)
+		{    
+			NewPoint.Location = WorldToSensorTransform.TransformPosition(NewPoint.Location);
+			NewPoint.ReflectionDirection = WorldToSensorTransform.TransformVector(NewPoint.ReflectionDirection);
+		}
+		DiffractionSubOutput.ReflectedStrengths[CandidateIndex] = SummedStrength;
+		Statistics.Add(NewPoint.SummedStrength, NewPoint.CurvatureMagnitude, NewPoint.TotalDistance);
+	});
+	DiffractionSubOutput.Compact(DiffractionKeepMask);
 
-	if (InterfaceConnected)		
+	// Samples that were rejected or have no line of sight add zero strength to their replicate
+	double ReplicateTotals[NumberOfDiffractionReplicates] = {};
+	for (int32 CandidateIndex = 0; CandidateIndex < NumDiffractionCandidates; ++CandidateIndex)
 	{
-		PrepareInterfaceMeasurementData(CurrentOutput);
-	}	
+		ReplicateTotals[DiffractionCandidates[CandidateIndex].SampleIndex % NumberOfDiffractionReplicates] += DiffractionSampleStrengths[CandidateIndex];
+	}
+	double DiffractionTotal = 0.0;
+	for (const double ReplicateTotal : ReplicateTotals)
+	{
+		DiffractionTotal += ReplicateTotal;
+	}
+	double DiffractionVariance = 0.0;
+	for (const double ReplicateTotal : ReplicateTotals)
+	{
+		DiffractionVariance += FMath::Square(ReplicateTotal * NumberOfDiffractionReplicates - DiffractionTotal);
+	}
+	DiffractionVariance /= NumberOfDiffractionReplicates * (NumberOfDiffractionReplicates - 1);
+	DiffractionSubOutput.SummedStrength = static_cast<float>(DiffractionTotal);
+	DiffractionSubOutput.SummedStrengthStandardError = static_cast<float>(FMath::Sqrt(DiffractionVariance));
+	DiffractionSubOutput.MaximumStrength = DiffractionStatistics.MaximumStrength;
+	DiffractionSubOutput.MaximumCurvature = DiffractionStatistics.MaximumCurvature;
+	DiffractionSubOutput.MaximumTotalDistance = DiffractionStatistics.MaximumTotalDistance;
+	return NumDiffractionCandidates;
 }
 
 void ASonoTraceUEActor::PrepareInterfaceMeasurementData(const FSonoTraceUEOutputStruct& Output)
@@ -2793,7 +3089,8 @@ void ASonoTraceUEActor::DrawSimulationResult()
 				TArray<int32> SelectedIndices;
 				if (InputSettings->RandomizeDrawSelection)
 				{
-					FRandomIterator Iterator (PointsToDraw, 0, CurrentOutputSize - 2);
+					const FSonoTraceUEPhilox DrawSelectionRandom(static_cast<uint32>(InputSettings->RandomSeed), FSonoTraceUEPhilox::EStream::DrawSelection);
+					FRandomIterator Iterator (PointsToDraw, 0, CurrentOutputSize - 2, DrawSelectionRandom.GetSeed(CurrentOutput.Index, 0));
 					while(Iterator.HasNext())
 					{
 						SelectedIndices.Add(Iterator.Next());
@@ -3111,7 +3408,8 @@ void ASonoTraceUEActor::DrawSimulationDebug()
 		TArray<int32> SelectedIndices;
 		if (InputSettings->RandomizeDrawDebugRaysSelection)
 		{
-			FRandomIterator Iterator (RaysToDraw, 0, GeneratedSettings.AzimuthAngles.Num() - 2);
+			const FSonoTraceUEPhilox DrawSelectionRandom(static_cast<uint32>(InputSettings->RandomSeed), FSonoTraceUEPhilox::EStream::DrawSelection);
+			FRandomIterator Iterator (RaysToDraw, 0, GeneratedSettings.AzimuthAngles.Num() - 2, DrawSelectionRandom.GetSeed(CurrentOutput.Index, 1));
 			while(Iterator.HasNext())
 			{
 				SelectedIndices.Add(Iterator.Next());
@@ -3273,7 +3571,7 @@ void ASonoTraceUEActor::DrawSimulationDebug()
 	}
 }
 
-void ASonoTraceUEActor::DrawMeshDebug(const UMeshComponent* MeshComponent, FSonoTraceUEMeshDataStruct& NewMeshData) const
+void ASonoTraceUEActor::DrawMeshDebug(const UMeshComponent* MeshComponent, const FSonoTraceUEMeshDataStruct& NewMeshData, const FSonoTraceUEObjectSettingsStruct* ObjectSettings) const
 {
 	if (InputSettings->EnableDrawDebugMeshData)
 	{
@@ -3284,7 +3582,8 @@ void ASonoTraceUEActor::DrawMeshDebug(const UMeshComponent* MeshComponent, FSono
 		SelectedIndices.Empty();
 		if (InputSettings->RandomizeDrawDebugMeshData)
 		{
-			FRandomIterator Iterator (TrianglesToDraw, 0, TrianglesToDrawActual - 2);
+			const FSonoTraceUEPhilox DrawSelectionRandom(static_cast<uint32>(InputSettings->RandomSeed), FSonoTraceUEPhilox::EStream::DrawSelection);
+			FRandomIterator Iterator (TrianglesToDraw, 0, TrianglesToDrawActual - 2, DrawSelectionRandom.GetSeed(0, 2));
 			while(Iterator.HasNext())
 			{
 				SelectedIndices.Add(Iterator.Next());
@@ -3325,7 +3624,8 @@ void ASonoTraceUEActor::DrawMeshDebug(const UMeshComponent* MeshComponent, FSono
 					    }
 					case ESonoTraceUEMeshModeEnum::SurfaceBRDF:
 					    {
-					        const float PointOpeningAngleValue = NewMeshData.TriangleBRDF[SelectedTriangleIndex][InputSettings->DrawDebugMeshOpeningAngleFrequencyIndex];					        
+					        const int32 SurfaceLevel = ObjectSettings->SurfaceTable.GetLevel(NewMeshData.TriangleCurvatureMagnitude[SelectedTriangleIndex]);
+					        const float PointOpeningAngleValue = ObjectSettings->SurfaceTable.BRDF[SurfaceLevel][InputSettings->DrawDebugMeshOpeningAngleFrequencyIndex];					        
 					        const float MinLimit = InputSettings->DrawDebugMeshOpeningAngleLimits.X;
 					        const float MaxLimit = InputSettings->DrawDebugMeshOpeningAngleLimits.Y;
 					        const float ClampedValue = FMath::Max(PointOpeningAngleValue - MinLimit, 0.0f);
@@ -3335,7 +3635,8 @@ void ASonoTraceUEActor::DrawMeshDebug(const UMeshComponent* MeshComponent, FSono
 					    }
 					case ESonoTraceUEMeshModeEnum::SurfaceMaterial:
 					    {
-					        const float PointReflectionStrength = NewMeshData.TriangleMaterial[SelectedTriangleIndex][InputSettings->DrawDebugMeshOpeningAngleFrequencyIndex];					        
+					        const int32 SurfaceLevel = ObjectSettings->SurfaceTable.GetLevel(NewMeshData.TriangleCurvatureMagnitude[SelectedTriangleIndex]);
+					        const float PointReflectionStrength = ObjectSettings->SurfaceTable.Material[SurfaceLevel][InputSettings->DrawDebugMeshOpeningAngleFrequencyIndex];					        
 					        const float MinLimit = InputSettings->DrawDebugMeshReflectionStrengthLimits.X;
 					        const float MaxLimit = InputSettings->DrawDebugMeshReflectionStrengthLimits.Y;
 					        const float ClampedValue = FMath::Max(PointReflectionStrength - MinLimit, 0.0f);
@@ -3552,44 +3853,59 @@ float ASonoTraceUEActor::SigmoidMix(const float X, const float Slope, const floa
 	return Mixed;
 }
 
-void ASonoTraceUEActor::GenerateBRDFAndMaterial(const FSonoTraceUEObjectSettingsStruct* ObjectSettings, FSonoTraceUEMeshDataStruct* MeshData)
+void ASonoTraceUEActor::GenerateMeshData(UMeshComponent* MeshComponent, const UObject* MeshAsset, const USonoTraceUEInputSettingsData* InputSettings, const FSonoTraceUEObjectSettingsStruct* ObjectSettings, FSonoTraceUEMeshDataStruct& OutMeshData)
 {
-	MeshData->TriangleBRDF.Init(TArray<float>(), MeshData->TriangleCurvatureMagnitude.Num());
-	MeshData->TriangleMaterial.Init(TArray<float>(), MeshData->TriangleCurvatureMagnitude.Num());
-	for (TArray<float>& InnerArray : MeshData->TriangleBRDF)
-	{
-		InnerArray.Init(0.0f, ObjectSettings->BrdfExponentsDiffraction.Num());
-	}
-	for (TArray<float>& InnerArray : MeshData->TriangleMaterial)
+	FString CacheKey;
+	FString PackKey;
+	GetMeshDataCacheKeys(MeshAsset, InputSettings, ObjectSettings, CacheKey, PackKey);
+	if (LoadCachedMeshData(CacheKey, PackKey, OutMeshData))
 	{
-		InnerArray.Init(0.0f, ObjectSettings->BrdfExponentsDiffraction.Num());
+		UE_LOG(SonoTraceUE, Log, TEXT("Loaded mesh data of '%s' from the mesh data cache."), *MeshAsset->GetName());
+		return;
 	}
+	UE::Geometry::FDynamicMesh3 Mesh;
+	if (CopyMeshFromComponent(MeshComponent, Mesh))
+		ProcessMeshData(Mesh, InputSettings, ObjectSettings, CacheKey, OutMeshData);
+}
 
-	// A slope of 1 feels "natural" but is too slow in material transition.
-	// It should be 8 or 10 or so.
-	// Therefore, this factor is added.
-	const float SigmoidSlopeMultiplier = 8;
-	
+void ASonoTraceUEActor::GetMeshDataCacheKeys(const UObject* MeshAsset, const USonoTraceUEInputSettingsData* InputSettings, const FSonoTraceUEObjectSettingsStruct* ObjectSettings, FString& OutCacheKey, FString& OutPackKey)
+{
+	if (!InputSettings->EnableMeshDataCache)
+		return;
+	OutCacheKey = FSonoTraceUEMeshCache::GetKey(MeshAsset, *ObjectSettings, *InputSettings);
+	// Packaged builds ship the mesh data precomputed by the SonoTraceUE commandlet
+	if (FPlatformProperties::RequiresCookedData())
+		OutPackKey = FSonoTraceUEMeshCache::GetPackKey(MeshAsset, *ObjectSettings, *InputSettings);
+}
+
+bool ASonoTraceUEActor::LoadCachedMeshData(const FString& CacheKey, const FString& PackKey, FSonoTraceUEMeshDataStruct& OutMeshData)
+{
+	return (!CacheKey.IsEmpty() && FSonoTraceUEMeshCache::Load(CacheKey, OutMeshData)) || (!PackKey.IsEmpty() && FSonoTraceUEMeshCache::LoadFromPack(PackKey, OutMeshData));
+}
+
+void ASonoTraceUEActor::ProcessMeshData(const UE::Geometry::FDynamicMesh3& Mesh, const USonoTraceUEInputSettingsData* InputSettings, const FSonoTraceUEObjectSettingsStruct* ObjectSettings, const FString& CacheKey, FSonoTraceUEMeshDataStruct& OutMeshData)
+{
+	CalculateMeshCurvature(Mesh, OutMeshData, InputSettings->CurvatureScale, InputSettings->EnableCurvatureTriangleSizeBasedScaler,
+		InputSettings->CurvatureScalerMinimumEffect, InputSettings->CurvatureScalerMaximumEffect, InputSettings->CurvatureScalerLowerTriangleSizeThreshold, InputSettings->CurvatureScalerUpperTriangleSizeThreshold, InputSettings->DiffractionTriangleSizeThreshold);
+	GenerateBRDFAndMaterial(ObjectSettings, &OutMeshData, InputSettings->DiffractionTriangleSizeThreshold);
+	// Meshes that failed to convert are not cached so they are retried next session
+	if (!CacheKey.IsEmpty() && OutMeshData.TriangleCurvatureMagnitude.Num() > 0)
+		FSonoTraceUEMeshCache::Save(CacheKey, OutMeshData);
+}
+
+void ASonoTraceUEActor::GenerateBRDFAndMaterial(const FSonoTraceUEObjectSettingsStruct* ObjectSettings, FSonoTraceUEMeshDataStruct* MeshData, const float DiffractionTriangleSizeThreshold)
+{
+	// The BRDF and material of a triangle are looked up in the surface table of the object type when hit, only the diffraction importance is stored per mesh
+	const FSonoTraceUESurfaceTable& SurfaceTable = ObjectSettings->SurfaceTable;
+	const bool HasFrequencies = SurfaceTable.IsValid() && SurfaceTable.BRDF[0].Num() > 0;
 	TArray<float> ImportanceVertexValues;
-	for (int32 FrequencyIndex = 0; FrequencyIndex < ObjectSettings->BrdfExponentsDiffraction.Num(); ++FrequencyIndex)
+	ImportanceVertexValues.SetNumZeroed(MeshData->TriangleCurvatureMagnitude.Num());
+	for (int32 TriangleIndex = 0; HasFrequencies && TriangleIndex < MeshData->TriangleCurvatureMagnitude.Num(); ++TriangleIndex)
 	{
-		for (int32 TriangleIndex = 0; TriangleIndex < MeshData->TriangleCurvatureMagnitude.Num(); ++TriangleIndex)
-		{
-			const float CurCurvatureMagnitude = MeshData->TriangleCurvatureMagnitude[TriangleIndex];
-			float SurfaceBRDF = SigmoidMix(CurCurvatureMagnitude, SigmoidSlopeMultiplier * ObjectSettings->BrdfTransitionSlope, ObjectSettings->BrdfTransitionPosition,
-										   ObjectSettings->BrdfExponentsDiffraction[FrequencyIndex], ObjectSettings->BrdfExponentsSpecular[FrequencyIndex]);
-			float SurfaceMaterial = SigmoidMix(CurCurvatureMagnitude, SigmoidSlopeMultiplier * ObjectSettings->MaterialsTransitionSlope, ObjectSettings->MaterialsTransitionPosition,
-							   ObjectSettings->MaterialStrengthsDiffraction[FrequencyIndex], ObjectSettings->MaterialStrengthsSpecular[FrequencyIndex]);
-			MeshData->TriangleBRDF[TriangleIndex][FrequencyIndex] = SurfaceBRDF;
-			MeshData->TriangleMaterial[TriangleIndex][FrequencyIndex] = SurfaceMaterial;
-			if (FrequencyIndex == 0)
-			{
-				ImportanceVertexValues.Add(SurfaceBRDF);
-			}
-		}
+		ImportanceVertexValues[TriangleIndex] = SurfaceTable.BRDF[SurfaceTable.GetLevel(MeshData->TriangleCurvatureMagnitude[TriangleIndex])][0];
 	}
 	
-	// Normalized and sorted importance vector based on BRDF of vertices	
+	// Normalized importance vector based on BRDF of vertices	
 	float MinValue = TNumericLimits<float>::Max();
 	for (const float Value : ImportanceVertexValues)
 	{
@@ -3632,21 +3948,23 @@ void ASonoTraceUEActor::GenerateBRDFAndMaterial(const FSonoTraceUEObjectSettings
 		}
 	}
 
-	TArray<FDiffractionImportancePair> ValueIndexPairs;
-	for (int32 Index = 0; Index < ImportanceVertexValues.Num(); ++Index)
+	// The jitter keeps triangles with zero importance reachable, so meshes of uniform curvature are sampled uniformly
+	for (float& Value : ImportanceVertexValues)
 	{
-		ValueIndexPairs.Add(FDiffractionImportancePair(ImportanceVertexValues[Index], Index));
+		Value += 0.000005f;
 	}
-	Algo::Sort(ValueIndexPairs);
-	for (const FDiffractionImportancePair& Pair : ValueIndexPairs)
+
+	// Only triangles below the size threshold can become diffraction points
+	TArray<uint8> EligibleMask;
+	EligibleMask.SetNumUninitialized(ImportanceVertexValues.Num());
+	for (int32 TriangleIndex = 0; TriangleIndex < ImportanceVertexValues.Num(); ++TriangleIndex)
 	{
-		MeshData->ImportanceVertexOrderedBRDFValue.Add(Pair.Value);
-		MeshData->ImportanceVertexOrderedIndex.Add(Pair.Index); 
+		EligibleMask[TriangleIndex] = MeshData->TriangleSize[TriangleIndex] < DiffractionTriangleSizeThreshold ? 1 : 0;
 	}
+	MeshData->DiffractionClusters.Build(MeshData->TrianglePosition, MeshData->TriangleNormal, ImportanceVertexValues, EligibleMask);
 }
 
-void ASonoTraceUEActor::CalculateMeshCurvature(UMeshComponent* MeshComponent, FSonoTraceUEMeshDataStruct& OutMeshData, const float CurvatureScaleFactor, const bool EnableCurvatureTriangleSizeBasedScaler,
-	                                            const float CurvatureScalerMinimumEffect, const float CurvatureScalerMaximumEffect, const float CurvatureScalerLowerTriangleSizeThreshold, const float CurvatureScalerUpperTriangleSizeThreshold, const float DiffractionTriangleSizeThreshold)
+bool ASonoTraceUEActor::CopyMeshFromComponent(UMeshComponent* MeshComponent, FDynamicMesh3& OutMesh)
 {	
    	UDynamicMesh* DynamicMesh = NewObject<UDynamicMesh>();
 	
@@ -3669,71 +3987,94 @@ void ASonoTraceUEActor::CalculateMeshCurvature(UMeshComponent* MeshComponent, FS
 	
 	if (Outcome != EGeometryScriptOutcomePins::Success)
 	{
-		UE_LOG(LogTemp, Error, TEXT("Failed to convert StaticMesh to DynamicMesh!"));		
-	}else
-	{			
-		const FDynamicMesh3* Mesh = DynamicMesh->GetMeshPtr();
-		if (!Mesh)
-		{
-			UE_LOG(LogTemp, Warning, TEXT("Failed to access internal mesh data!"));			
-		}else
+		UE_LOG(LogTemp, Error, TEXT("Failed to convert StaticMesh to DynamicMesh!"));
+		return false;
+	}
+	const FDynamicMesh3* Mesh = DynamicMesh->GetMeshPtr();
+	if (!Mesh)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Failed to access internal mesh data!"));
+		return false;
+	}
+	OutMesh = *Mesh;
+	return true;
+}
+
+void ASonoTraceUEActor::CalculateMeshCurvature(const FDynamicMesh3& Mesh, FSonoTraceUEMeshDataStruct& OutMeshData, const float CurvatureScaleFactor, const bool EnableCurvatureTriangleSizeBasedScaler,
+	                                            const float CurvatureScalerMinimumEffect, const float CurvatureScalerMaximumEffect, const float CurvatureScalerLowerTriangleSizeThreshold, const float CurvatureScalerUpperTriangleSizeThreshold, const float DiffractionTriangleSizeThreshold)
+{
+	// Every vertex is shared by about six triangles, so its curvature is evaluated once in a first pass
+	// based on equations in http://www.geometry.caltech.edu/pubs/DMSB_III.pdf
+	TArray<double> VertexCurvatureMagnitudes;
+	VertexCurvatureMagnitudes.SetNumZeroed(Mesh.MaxVertexID());
+	ParallelFor(Mesh.MaxVertexID(), [&](const int32 VertexID)
+	{
+		if (Mesh.IsVertex(VertexID))
+			VertexCurvatureMagnitudes[VertexID] = UE::MeshCurvature::MeanCurvatureNormal(Mesh, VertexID).Length() / 2;
+	}, EParallelForFlags::Unbalanced);
+
+	// Triangles are stored in iteration order, which skips the IDs of removed triangles
+	TArray<int32> TriangleIDs;
+	TriangleIDs.Reserve(Mesh.TriangleCount());
+	for (const int32 TriangleID : Mesh.TriangleIndicesItr())
+	{
+		TriangleIDs.Add(TriangleID);
+	}
+	const int32 FirstTriangle = OutMeshData.TriangleCurvatureMagnitude.Num();
+	OutMeshData.TrianglePosition.SetNumUninitialized(FirstTriangle + TriangleIDs.Num());
+	OutMeshData.TriangleNormal.SetNumUninitialized(FirstTriangle + TriangleIDs.Num());
+	OutMeshData.TriangleSize.SetNumUninitialized(FirstTriangle + TriangleIDs.Num());
+	OutMeshData.TriangleCurvatureMagnitude.SetNumUninitialized(FirstTriangle + TriangleIDs.Num());
+
+	ParallelFor(TriangleIDs.Num(), [&](const int32 TriangleIndex)
+	{
+		const UE::Geometry::FIndex3i TriVertices = Mesh.GetTriangle(TriangleIDs[TriangleIndex]);
+		const int32 OutputIndex = FirstTriangle + TriangleIndex;
+		
+		FVector3d Vertex1Position = Mesh.GetVertex(TriVertices.A);
+		FVector3d Vertex2Position = Mesh.GetVertex(TriVertices.B);
+		FVector3d Vertex3Position = Mesh.GetVertex(TriVertices.C);
+		OutMeshData.TrianglePosition[OutputIndex] = (Vertex1Position + Vertex2Position + Vertex3Position) / 3.0;
+
+		FVector3f Vertex1Normal = Mesh.GetVertexNormal(TriVertices.A);
+		FVector Edge1 = FVector(Vertex2Position) - FVector(Vertex1Position);
+		FVector Edge2 = FVector(Vertex3Position) - FVector(Vertex1Position);
+		FVector TriangleNormal = FVector::CrossProduct(Edge1, Edge2);
+		float DotNormal = FVector::DotProduct( TriangleNormal, FVector(Vertex1Normal));
+		if (DotNormal < 0.0f)
+			TriangleNormal = -TriangleNormal;
+		OutMeshData.TriangleNormal[OutputIndex] = TriangleNormal;
+
+		float TriangleSize = FVector3d::CrossProduct(Vertex2Position - Vertex1Position, Vertex3Position - Vertex1Position).Length() * 0.5;
+		OutMeshData.TriangleSize[OutputIndex] = TriangleSize;
+
+		// Compute magnitudes of the curvature normals
+		double CurvatureMag1 = VertexCurvatureMagnitudes[TriVertices.A];
+		double CurvatureMag2 = VertexCurvatureMagnitudes[TriVertices.B];
+		double CurvatureMag3 = VertexCurvatureMagnitudes[TriVertices.C];
+
+		// Compute the range of magnitudes for the triangle
+		double MaxCurvature = FMath::Max3(CurvatureMag1, CurvatureMag2, CurvatureMag3);
+		double MinCurvature = FMath::Min3(CurvatureMag1, CurvatureMag2, CurvatureMag3);
+		double CurvatureRange = MaxCurvature - MinCurvature;
+
+		// Use CurvatureRange as the sharpness metric
+		double MeanCurvatureNormal = CurvatureRange;				
+		// FVector3d MeanCurvatureNormal = (Vertex1CurvatureNormal + Vertex2CurvatureNormal + Vertex3CurvatureNormal) / 3.0;
+		if (EnableCurvatureTriangleSizeBasedScaler)
 		{
-			for (int32 TriangleIndex : Mesh->TriangleIndicesItr())
-			{
-				UE::Geometry::FIndex3i TriVertices = Mesh->GetTriangle(TriangleIndex);
-				
-				FVector3d Vertex1Position = Mesh->GetVertex(TriVertices.A);
-				FVector3d Vertex2Position = Mesh->GetVertex(TriVertices.B);
-				FVector3d Vertex3Position = Mesh->GetVertex(TriVertices.C);
-				FVector3d TrianglePosition = (Vertex1Position + Vertex2Position + Vertex3Position) / 3.0;
-				OutMeshData.TrianglePosition.Add(TrianglePosition);
-
-				FVector3f Vertex1Normal = Mesh->GetVertexNormal(TriVertices.A);
-				FVector Edge1 = FVector(Vertex2Position) - FVector(Vertex1Position);
-				FVector Edge2 = FVector(Vertex3Position) - FVector(Vertex1Position);
-				FVector TriangleNormal = FVector::CrossProduct(Edge1, Edge2);
-				float DotNormal = FVector::DotProduct( TriangleNormal, FVector(Vertex1Normal));
-				if (DotNormal < 0.0f)
-					TriangleNormal = -TriangleNormal;
-				OutMeshData.TriangleNormal.Add(TriangleNormal);
-
-				float TriangleSize = FVector3d::CrossProduct(Vertex2Position - Vertex1Position, Vertex3Position - Vertex1Position).Length() * 0.5;
-				OutMeshData.TriangleSize.Add(TriangleSize);		
-
-				// based on equations in http://www.geometry.caltech.edu/pubs/DMSB_III.pdf
-				FVector3d Vertex1CurvatureNormal = UE::MeshCurvature::MeanCurvatureNormal(*Mesh, TriVertices.A);
-				FVector3d Vertex2CurvatureNormal = UE::MeshCurvature::MeanCurvatureNormal(*Mesh, TriVertices.B);
-				FVector3d Vertex3CurvatureNormal = UE::MeshCurvature::MeanCurvatureNormal(*Mesh, TriVertices.C);
-
-				// Compute magnitudes of the curvature normals
-				double CurvatureMag1 = Vertex1CurvatureNormal.Length() / 2;
-				double CurvatureMag2 = Vertex2CurvatureNormal.Length() / 2;
-				double CurvatureMag3 = Vertex3CurvatureNormal.Length() / 2;
-
-				// Compute the range of magnitudes for the triangle
-				double MaxCurvature = FMath::Max3(CurvatureMag1, CurvatureMag2, CurvatureMag3);
-				double MinCurvature = FMath::Min3(CurvatureMag1, CurvatureMag2, CurvatureMag3);
-				double CurvatureRange = MaxCurvature - MinCurvature;
-
-				// Use CurvatureRange as the sharpness metric
-				double MeanCurvatureNormal = CurvatureRange;				
-				// FVector3d MeanCurvatureNormal = (Vertex1CurvatureNormal + Vertex2CurvatureNormal + Vertex3CurvatureNormal) / 3.0;
-				if (EnableCurvatureTriangleSizeBasedScaler)
-				{
-					float ScaledAreaEffect = 0;
-				    if(TriangleSize <= CurvatureScalerLowerTriangleSizeThreshold){
-				    	ScaledAreaEffect = CurvatureScalerMinimumEffect + (1 - CurvatureScalerMinimumEffect) / CurvatureScalerLowerTriangleSizeThreshold * TriangleSize;
-				    }else if(TriangleSize > CurvatureScalerLowerTriangleSizeThreshold && TriangleSize <= CurvatureScalerUpperTriangleSizeThreshold){
-				    	ScaledAreaEffect = 1 + (CurvatureScalerMaximumEffect - 1) / (CurvatureScalerUpperTriangleSizeThreshold - CurvatureScalerLowerTriangleSizeThreshold) * (TriangleSize - CurvatureScalerLowerTriangleSizeThreshold);
-				    }else if(TriangleSize > CurvatureScalerUpperTriangleSizeThreshold && TriangleSize <= DiffractionTriangleSizeThreshold){
-				    	ScaledAreaEffect = CurvatureScalerMaximumEffect - CurvatureScalerMaximumEffect / (DiffractionTriangleSizeThreshold - CurvatureScalerUpperTriangleSizeThreshold) * (TriangleSize - CurvatureScalerUpperTriangleSizeThreshold);
-				    }
-					MeanCurvatureNormal = MeanCurvatureNormal * ScaledAreaEffect;
-				}
-				OutMeshData.TriangleCurvatureMagnitude.Add(MeanCurvatureNormal * CurvatureScaleFactor);								
-			}
+			float ScaledAreaEffect = 0;
+		    if(TriangleSize <= CurvatureScalerLowerTriangleSizeThreshold){
+		    	ScaledAreaEffect = CurvatureScalerMinimumEffect + (1 - CurvatureScalerMinimumEffect) / CurvatureScalerLowerTriangleSizeThreshold * TriangleSize;
+		    }else if(TriangleSize > CurvatureScalerLowerTriangleSizeThreshold && TriangleSize <= CurvatureScalerUpperTriangleSizeThreshold){
+		    	ScaledAreaEffect = 1 + (CurvatureScalerMaximumEffect - 1) / (CurvatureScalerUpperTriangleSizeThreshold - CurvatureScalerLowerTriangleSizeThreshold) * (TriangleSize - CurvatureScalerLowerTriangleSizeThreshold);
+		    }else if(TriangleSize > CurvatureScalerUpperTriangleSizeThreshold && TriangleSize <= DiffractionTriangleSizeThreshold){
+		    	ScaledAreaEffect = CurvatureScalerMaximumEffect - CurvatureScalerMaximumEffect / (DiffractionTriangleSizeThreshold - CurvatureScalerUpperTriangleSizeThreshold) * (TriangleSize - CurvatureScalerUpperTriangleSizeThreshold);
+		    }
+			MeanCurvatureNormal = MeanCurvatureNormal * ScaledAreaEffect;
 		}
-	} 
+		OutMeshData.TriangleCurvatureMagnitude[OutputIndex] = FFloat16(static_cast<float>(MeanCurvatureNormal * CurvatureScaleFactor));
+	});
 }
 
 FVector ASonoTraceUEActor::CalculateTrianglePosition(const FVector3f& Vertex1, const FVector3f& Vertex2, const FVector3f& Vertex3)
@@ -3791,6 +4132,7 @@ FSonoTraceUEGeneratedInputStruct ASonoTraceUEActor::GenerateInputSettings(const
 	GeneratedInputSettings.LoadedReceiverPositions = PopulatePositions(InputSettings->EnableReceiverPositionsDataTable, InputSettings->ReceiverPositionsDataTable, InputSettings->ReceiverPositions, FString(TEXT("receivers")));	
 	GeneratedInputSettings.ObjectSettings = PopulateObjectSettings(InputSettings, AssetToObjectTypeIndexSettings);
 	GeneratedInputSettings.Frequencies = GenerateLinearSpacedArray(InputSettings->MinimumSimFrequency, InputSettings->MaximumSimFrequency, InputSettings->NumberOfSimFrequencies);
+	FSonoTraceUEStrengthKernels::CalculateLogAbsorptions(GeneratedInputSettings.Frequencies, GeneratedInputSettings.LogAbsorptions);
 
 	GeneratedInputSettings.EmitterSignals.SetNum(InputSettings->EmitterSignals.Num());
 	for (int32 EmitterSignalIndex = 0; EmitterSignalIndex < InputSettings->EmitterSignals.Num(); ++EmitterSignalIndex)
@@ -3836,7 +4178,20 @@ FSonoTraceUEGeneratedInputStruct ASonoTraceUEActor::GenerateInputSettings(const
 	GeneratedInputSettings.FinalEmitterDirectivities.Empty();
 	if(InputSettings->EnableEmitterDirectivity)GeneratedInputSettings.FinalEmitterDirectivities.Append(LoadedEmitterDirectivity);	
 
-	if(InputSettings->EnableEmitterPatternSimulation)
+	if(InputSettings->EnableEmitterPatternSimulation && InputSettings->EnableEmitterPatternAggregation)
+	{
+		// The virtual receivers are not generated, their summed contribution is applied as array gain per real receiver
+		TArray<FVector> CircularArrayOffsets = GenerateCircularArray(InputSettings->EmitterPatternSpacing, InputSettings->EmitterPatternRadius, InputSettings->EmitterPatternHexagonalLattice, InputSettings->EmitterPatternPlane);
+		const TSharedRef<FSonoTraceUEArrayGainTable, ESPMode::ThreadSafe> EmitterPatternGainTable = MakeShared<FSonoTraceUEArrayGainTable, ESPMode::ThreadSafe>();
+		EmitterPatternGainTable->Build(CircularArrayOffsets, GeneratedInputSettings.Frequencies, InputSettings->SpeedOfSound);
+		GeneratedInputSettings.EmitterPatternGainTable = EmitterPatternGainTable;
+		for (int32 ReceiverIndex = 0; ReceiverIndex < GeneratedInputSettings.LoadedReceiverPositions.Num(); ++ReceiverIndex)
+		{
+			GeneratedInputSettings.FinalReceiverPositions.Add(GeneratedInputSettings.LoadedReceiverPositions[ReceiverIndex] + InputSettings->ReceiverPositionsOffset);
+		}
+		GeneratedInputSettings.FinalReceiverDirectivities.Empty();
+		if(InputSettings->EnableReceiverDirectivity)GeneratedInputSettings.FinalReceiverDirectivities.Append(LoadedReceiverDirectivity);
+	}else if(InputSettings->EnableEmitterPatternSimulation)
 	{
 		TArray<FVector> CircularArrayOffsets = GenerateCircularArray(InputSettings->EmitterPatternSpacing, InputSettings->EmitterPatternRadius, InputSettings->EmitterPatternHexagonalLattice, InputSettings->EmitterPatternPlane);
 		
@@ -3944,8 +4299,10 @@ TArray<FSonoTraceUEObjectSettingsStruct>  ASonoTraceUEActor::PopulateObjectSetti
 		NewObjectSetting.DefaultTriangleBRDF.Add(SurfaceBRDF);
 		NewObjectSetting.DefaultTriangleMaterial.Add(SurfaceMaterial);
 	}
+	NewObjectSetting.SurfaceTable.Build(NewObjectSetting);
 	ObjectSettings.Add(NewObjectSetting);
-	AssetToObjectTypeIndexSettings->Add(nullptr, 0);
+	if (AssetToObjectTypeIndexSettings)
+		AssetToObjectTypeIndexSettings->Add(nullptr, 0);
 	
 	if (InputSettings->ObjectSettingsDataTable)
 	{
@@ -3990,8 +4347,10 @@ TArray<FSonoTraceUEObjectSettingsStruct>  ASonoTraceUEActor::PopulateObjectSetti
 					CurrentNewObjectSetting.DefaultTriangleBRDF.Add(SurfaceBRDF);
 					CurrentNewObjectSetting.DefaultTriangleMaterial.Add(SurfaceMaterial);
 				}
+				CurrentNewObjectSetting.SurfaceTable.Build(CurrentNewObjectSetting);
 				ObjectSettings.Add(CurrentNewObjectSetting);
-				AssetToObjectTypeIndexSettings->Add(Row->Asset, UniqueIndexCounter);
+				if (AssetToObjectTypeIndexSettings)
+					AssetToObjectTypeIndexSettings->Add(Row->Asset, UniqueIndexCounter);
 				UniqueIndexCounter++;
 			}
 		}
@@ -4278,7 +4637,7 @@ TArray<uint8> ASonoTraceUEActor::SerializeObjectSettingsStruct(FSonoTraceUEObjec
 	return ByteArray;
 }
 
-TArray<uint8> ASonoTraceUEActor::SerializePointStruct(FSonoTraceUEPointStruct* PointStruct){
+TArray<uint8> ASonoTraceUEActor::SerializePointStruct(FSonoTraceUEPointStruct* PointStruct, const FSonoTraceUEStrengthTensor& StrengthTensor){
 	TArray<uint8> ByteArray;
 	FMemoryWriter Writer(ByteArray, true);
 
@@ -4319,23 +4678,15 @@ TArray<uint8> ASonoTraceUEActor::SerializePointStruct(FSonoTraceUEPointStruct* P
 		Writer << EmitterDirectivity;
 	}	
 
-	for (const TArray<TArray<float>>& EmitterRow : PointStruct->Strengths)
+	// Points that were not simulated have no strengths or distances to the receivers
+	for (float FrequencyValue : StrengthTensor.GetBlockStrengths(PointStruct->StrengthTensorIndex))
 	{
-		for (const TArray<float>& ReceiverRow : EmitterRow)
-		{
-			for (float FrequencyValue : ReceiverRow)
-			{
-				Writer << FrequencyValue;
-			}
-		}
+		Writer << FrequencyValue;
 	}
 	
-	for (const TArray<float>& EmitterDistanceRow : PointStruct->TotalDistancesToReceivers)
+	for (float ReceiverDistanceValue : StrengthTensor.GetBlockTotalDistancesToReceivers(PointStruct->StrengthTensorIndex))
 	{
-		for (float ReceiverDistanceValue : EmitterDistanceRow)
-		{
-			Writer << ReceiverDistanceValue;
-		}
+		Writer << ReceiverDistanceValue;
 	}
 
 	const FString LabelString = PointStruct->Label.ToString();
@@ -0,0 +1,61 @@
+// By Wouter Jansen & Jan Steckel, Cosys-Lab, University of Antwerp. See the LICENSE file for details.
+
+#include "SonoTraceUEAliasTable.h"
+
+void FSonoTraceUEAliasTable::Build(TConstArrayView<float> Weights)
+{
+	const int32 NumberOfWeights = Weights.Num();
+	Probabilities.SetNumUninitialized(NumberOfWeights);
+	Aliases.SetNumUninitialized(NumberOfWeights);
+	if (NumberOfWeights == 0)
+		return;
+
+	double TotalWeight = 0.0;
+	for (const float Weight : Weights)
+	{
+		TotalWeight += FMath::Max(Weight, 0.0f);
+	}
+
+	// Scale the weights so the average bin holds exactly one, then split them in under- and overfull bins
+	TArray<double> ScaledWeights;
+	ScaledWeights.SetNumUninitialized(NumberOfWeights);
+	TArray<int32> Small;
+	TArray<int32> Large;
+	Small.Reserve(NumberOfWeights);
+	Large.Reserve(NumberOfWeights);
+	for (int32 Index = 0; Index < NumberOfWeights; Index++)
+	{
+		ScaledWeights[Index] = TotalWeight > 0.0 ? FMath::Max(Weights[Index], 0.0f) * NumberOfWeights / TotalWeight : 1.0;
+		if (ScaledWeights[Index] < 1.0)
+			Small.Add(Index);
+		else
+			Large.Add(Index);
+	}
+
+	// Every underfull bin is topped up by an overfull one, which becomes underfull itself once it drops below one
+	while (Small.Num() > 0 && Large.Num() > 0)
+	{
+		const int32 SmallIndex = Small.Pop(EAllowShrinking::No);
+		const int32 LargeIndex = Large.Last();
+		Probabilities[SmallIndex] = static_cast<float>(ScaledWeights[SmallIndex]);
+		Aliases[SmallIndex] = LargeIndex;
+		ScaledWeights[LargeIndex] -= 1.0 - ScaledWeights[SmallIndex];
+		if (ScaledWeights[LargeIndex] < 1.0)
+		{
+			Large.Pop(EAllowShrinking::No);
+			Small.Add(LargeIndex);
+		}
+	}
+
+	// What remains is full up to rounding errors
+	for (const int32 Index : Large)
+	{
+		Probabilities[Index] = 1.0f;
+		Aliases[Index] = Index;
+	}
+	for (const int32 Index : Small)
+	{
+		Probabilities[Index] = 1.0f;
+		Aliases[Index] = Index;
+	}
+}
@@ -0,0 +1,172 @@
+// By Wouter Jansen & Jan Steckel, Cosys-Lab, University of Antwerp. See the LICENSE file for details.
+
+#include "SonoTraceUECommandlet.h"
+#include "SonoTraceUEActor.h"
+#include "SonoTraceUEMeshCache.h"
+#include "Async/ParallelFor.h"
+#include "DynamicMesh/DynamicMesh3.h"
+#include "Serialization/MemoryWriter.h"
+#include "UObject/Package.h"
+#include "UObject/UObjectHash.h"
+
+USonoTraceUECommandlet::USonoTraceUECommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = true;
+	LogToConsole = true;
+}
+
+int32 USonoTraceUECommandlet::Main(const FString& Params)
+{
+	FString SettingsPath;
+	if (!FParse::Value(*Params, TEXT("Settings="), SettingsPath))
+	{
+		UE_LOG(SonoTraceUE, Error, TEXT("No input settings given, use -Settings=<InputSettings asset>."));
+		return 1;
+	}
+	const USonoTraceUEInputSettingsData* InputSettings = LoadObject<USonoTraceUEInputSettingsData>(nullptr, *SettingsPath);
+	if (!InputSettings)
+	{
+		UE_LOG(SonoTraceUE, Error, TEXT("Could not load input settings '%s'."), *SettingsPath);
+		return 1;
+	}
+	FString OutputPath = FSonoTraceUEMeshCache::GetPackPath();
+	FParse::Value(*Params, TEXT("Output="), OutputPath);
+
+	// Same object type lookup as the actor, meshes without a row in the object settings table use the default settings
+	TMap<UObject*, int32> AssetToObjectTypeIndexSettings;
+	const TArray<FSonoTraceUEObjectSettingsStruct> ObjectSettings = ASonoTraceUEActor::PopulateObjectSettings(InputSettings, &AssetToObjectTypeIndexSettings);
+
+	TArray<UObject*> MeshAssets;
+	FString Maps;
+	if (FParse::Value(*Params, TEXT("Maps="), Maps, false))
+	{
+		TArray<FString> MapNames;
+		Maps.ParseIntoArray(MapNames, TEXT("+"));
+		for (const FString& MapName : MapNames)
+		{
+			UPackage* MapPackage = LoadPackage(nullptr, *MapName, LOAD_None);
+			if (!MapPackage)
+			{
+				UE_LOG(SonoTraceUE, Error, TEXT("Could not load map '%s'."), *MapName);
+				return 1;
+			}
+			// Only the actors stored in the map package itself, maps with external actors need their meshes listed with -Meshes
+			ForEachObjectWithPackage(MapPackage, [&MeshAssets](UObject* Object)
+			{
+				if (const UStaticMeshComponent* StaticMeshComponent = Cast<UStaticMeshComponent>(Object); StaticMeshComponent && StaticMeshComponent->GetStaticMesh())
+					MeshAssets.AddUnique(StaticMeshComponent->GetStaticMesh());
+				else if (const USkeletalMeshComponent* SkeletalMeshComponent = Cast<USkeletalMeshComponent>(Object); SkeletalMeshComponent && SkeletalMeshComponent->GetSkeletalMeshAsset())
+					MeshAssets.AddUnique(SkeletalMeshComponent->GetSkeletalMeshAsset());
+				return true;
+			});
+		}
+	}
+	FString Meshes;
+	if (FParse::Value(*Params, TEXT("Meshes="), Meshes, false))
+	{
+		TArray<FString> MeshNames;
+		Meshes.ParseIntoArray(MeshNames, TEXT("+"));
+		for (const FString& MeshName : MeshNames)
+		{
+			UObject* MeshAsset = LoadObject<UObject>(nullptr, *MeshName);
+			if (!Cast<UStaticMesh>(MeshAsset) && !Cast<USkeletalMesh>(MeshAsset))
+			{
+				UE_LOG(SonoTraceUE, Error, TEXT("Could not load static or skeletal mesh '%s'."), *MeshName);
+				return 1;
+			}
+			MeshAssets.AddUnique(MeshAsset);
+		}
+	}
+	if (MeshAssets.Num() == 0)
+	{
+		UE_LOG(SonoTraceUE, Error, TEXT("No meshes found, use -Maps=<Map>+<Map> and/or -Meshes=<Mesh>+<Mesh>."));
+		return 1;
+	}
+	UE_LOG(SonoTraceUE, Display, TEXT("Generating mesh data of %d meshes with %d workers."), MeshAssets.Num(), FTaskGraphInterface::Get().GetNumWorkerThreads() + 1);
+
+	// The conversion to a dynamic mesh creates objects and runs on this thread, the curvature and BRDF generation of a batch runs in parallel
+	const double StartTime = FPlatformTime::Seconds();
+	TMap<FString, TArray<uint8>> PackEntries;
+	int32 NumberOfTriangles = 0;
+	for (int32 FirstMesh = 0; FirstMesh < MeshAssets.Num(); FirstMesh += MeshesPerBatch)
+	{
+		const int32 NumberOfMeshes = FMath::Min(MeshesPerBatch, MeshAssets.Num() - FirstMesh);
+		TArray<UE::Geometry::FDynamicMesh3> DynamicMeshes;
+		TArray<double> ConversionTimes;
+		DynamicMeshes.SetNum(NumberOfMeshes);
+		ConversionTimes.SetNumZeroed(NumberOfMeshes);
+		for (int32 MeshIndex = 0; MeshIndex < NumberOfMeshes; MeshIndex++)
+		{
+			const double ConversionStartTime = FPlatformTime::Seconds();
+			UMeshComponent* MeshComponent;
+			if (UStaticMesh* StaticMesh = Cast<UStaticMesh>(MeshAssets[FirstMesh + MeshIndex]))
+			{
+				UStaticMeshComponent* StaticMeshComponent = NewObject<UStaticMeshComponent>(GetTransientPackage());
+				StaticMeshComponent->SetStaticMesh(StaticMesh);
+				MeshComponent = StaticMeshComponent;
+			}else
+			{
+				USkeletalMeshComponent* SkeletalMeshComponent = NewObject<USkeletalMeshComponent>(GetTransientPackage());
+				SkeletalMeshComponent->SetSkeletalMeshAsset(Cast<USkeletalMesh>(MeshAssets[FirstMesh + MeshIndex]));
+				MeshComponent = SkeletalMeshComponent;
+			}
+			ASonoTraceUEActor::CopyMeshFromComponent(MeshComponent, DynamicMeshes[MeshIndex]);
+			ConversionTimes[MeshIndex] = FPlatformTime::Seconds() - ConversionStartTime;
+		}
+
+		TArray<FString> CacheKeys;
+		TArray<FString> PackKeys;
+		TArray<TArray<uint8>> EntryData;
+		TArray<double> ProcessingTimes;
+		TArray<int32> TriangleCounts;
+		CacheKeys.SetNum(NumberOfMeshes);
+		PackKeys.SetNum(NumberOfMeshes);
+		EntryData.SetNum(NumberOfMeshes);
+		ProcessingTimes.SetNumZeroed(NumberOfMeshes);
+		TriangleCounts.SetNumZeroed(NumberOfMeshes);
+		for (int32 MeshIndex = 0; MeshIndex < NumberOfMeshes; MeshIndex++)
+		{
+			UObject* MeshAsset = MeshAssets[FirstMesh + MeshIndex];
+			const FSonoTraceUEObjectSettingsStruct& MeshObjectSettings = ObjectSettings[AssetToObjectTypeIndexSettings.FindRef(MeshAsset)];
+			CacheKeys[MeshIndex] = FSonoTraceUEMeshCache::GetKey(MeshAsset, MeshObjectSettings, *InputSettings);
+			PackKeys[MeshIndex] = FSonoTraceUEMeshCache::GetPackKey(MeshAsset, MeshObjectSettings, *InputSettings);
+		}
+		ParallelFor(NumberOfMeshes, [&](const int32 MeshIndex)
+		{
+			if (DynamicMeshes[MeshIndex].TriangleCount() == 0)
+				return;
+			const double ProcessingStartTime = FPlatformTime::Seconds();
+			const FSonoTraceUEObjectSettingsStruct& MeshObjectSettings = ObjectSettings[AssetToObjectTypeIndexSettings.FindRef(MeshAssets[FirstMesh + MeshIndex])];
+			FSonoTraceUEMeshDataStruct MeshData;
+			ASonoTraceUEActor::CalculateMeshCurvature(DynamicMeshes[MeshIndex], MeshData, InputSettings->CurvatureScale, InputSettings->EnableCurvatureTriangleSizeBasedScaler,
+				InputSettings->CurvatureScalerMinimumEffect, InputSettings->CurvatureScalerMaximumEffect, InputSettings->CurvatureScalerLowerTriangleSizeThreshold, InputSettings->CurvatureScalerUpperTriangleSizeThreshold, InputSettings->DiffractionTriangleSizeThreshold);
+			ASonoTraceUEActor::GenerateBRDFAndMaterial(&MeshObjectSettings, &MeshData, InputSettings->DiffractionTriangleSizeThreshold);
+			FMemoryWriter Writer(EntryData[MeshIndex]);
+			FSonoTraceUEMeshCache::Write(Writer, MeshData);
+			FSonoTraceUEMeshCache::Save(CacheKeys[MeshIndex], MeshData);
+			TriangleCounts[MeshIndex] = MeshData.TriangleCurvatureMagnitude.Num();
+			ProcessingTimes[MeshIndex] = FPlatformTime::Seconds() - ProcessingStartTime;
+		});
+
+		for (int32 MeshIndex = 0; MeshIndex < NumberOfMeshes; MeshIndex++)
+		{
+			UObject* MeshAsset = MeshAssets[FirstMesh + MeshIndex];
+			if (TriangleCounts[MeshIndex] == 0)
+			{
+				UE_LOG(SonoTraceUE, Warning, TEXT("Mesh '%s' has no triangles or could not be converted, skipped."), *MeshAsset->GetPathName());
+				continue;
+			}
+			UE_LOG(SonoTraceUE, Display, TEXT("Mesh '%s' with object type '%s': %d triangles, conversion %.3fs, curvature and BRDF %.3fs."), *MeshAsset->GetPathName(),
+			       *ObjectSettings[AssetToObjectTypeIndexSettings.FindRef(MeshAsset)].Name.ToString(), TriangleCounts[MeshIndex], ConversionTimes[MeshIndex], ProcessingTimes[MeshIndex]);
+			PackEntries.Add(PackKeys[MeshIndex], MoveTemp(EntryData[MeshIndex]));
+			NumberOfTriangles += TriangleCounts[MeshIndex];
+		}
+	}
+
+	if (!FSonoTraceUEMeshCache::WritePack(OutputPath, PackEntries))
+		return 1;
+	UE_LOG(SonoTraceUE, Display, TEXT("Wrote mesh data of %d meshes with %d triangles to '%s' in %.3fs."), PackEntries.Num(), NumberOfTriangles, *OutputPath, FPlatformTime::Seconds() - StartTime);
+	return 0;
+}
@@ -0,0 +1,188 @@
+// By Wouter Jansen & Jan Steckel, Cosys-Lab, University of Antwerp. See the LICENSE file for details.
+
+#include "SonoTraceUEDiffractionClusters.h"
+
+namespace
+{
+	// Spreads the lower 10 bits of a value over every third bit
+	uint32 SpreadBits(uint32 Value)
+	{
+		Value &= 0x000003ff;
+		Value = (Value ^ (Value << 16)) & 0xff0000ff;
+		Value = (Value ^ (Value << 8)) & 0x0300f00f;
+		Value = (Value ^ (Value << 4)) & 0x030c30c3;
+		Value = (Value ^ (Value << 2)) & 0x09249249;
+		return Value;
+	}
+}
+
+void FSonoTraceUEDiffractionClusters::Build(TConstArrayView<FVector> Positions, TConstArrayView<FVector> Normals, TConstArrayView<float> Weights, TConstArrayView<uint8> EligibleMask)
+{
+	Clusters.Reset();
+	Triangles.Reset();
+	MeshImportance = 0.0f;
+
+	FBox Bounds(ForceInit);
+	for (int32 TriangleIndex = 0; TriangleIndex < Weights.Num(); TriangleIndex++)
+	{
+		MeshImportance += Weights[TriangleIndex];
+		if (EligibleMask[TriangleIndex])
+			Bounds += Positions[TriangleIndex];
+	}
+	if (!Bounds.IsValid)
+		return;
+
+	// Sorting along the Morton curve of the positions keeps the triangles of a cluster close together
+	const FVector Extent = (Bounds.Max - Bounds.Min).ComponentMax(FVector(KINDA_SMALL_NUMBER));
+	TArray<uint64> SortKeys;
+	for (int32 TriangleIndex = 0; TriangleIndex < Weights.Num(); TriangleIndex++)
+	{
+		if (!EligibleMask[TriangleIndex])
+			continue;
+		const FVector Normalized = (Positions[TriangleIndex] - Bounds.Min) / Extent * 1023.0;
+		const uint32 MortonCode = SpreadBits(static_cast<uint32>(Normalized.X)) | SpreadBits(static_cast<uint32>(Normalized.Y)) << 1 | SpreadBits(static_cast<uint32>(Normalized.Z)) << 2;
+		SortKeys.Add(static_cast<uint64>(MortonCode) << 32 | static_cast<uint32>(TriangleIndex));
+	}
+	SortKeys.Sort();
+	Triangles.SetNumUninitialized(SortKeys.Num());
+	for (int32 Index = 0; Index < SortKeys.Num(); Index++)
+	{
+		Triangles[Index] = static_cast<int32>(SortKeys[Index] & 0xffffffff);
+	}
+
+	Clusters.SetNum(FMath::DivideAndRoundUp(Triangles.Num(), TrianglesPerCluster));
+	TArray<float> ClusterWeights;
+	for (int32 ClusterIndex = 0; ClusterIndex < Clusters.Num(); ClusterIndex++)
+	{
+		FCluster& Cluster = Clusters[ClusterIndex];
+		Cluster.FirstTriangle = ClusterIndex * TrianglesPerCluster;
+		Cluster.NumTriangles = FMath::Min(TrianglesPerCluster, Triangles.Num() - Cluster.FirstTriangle);
+		TConstArrayView<int32> ClusterTriangles(Triangles.GetData() + Cluster.FirstTriangle, Cluster.NumTriangles);
+
+		FBox ClusterBounds(ForceInit);
+		FVector SummedNormal = FVector::ZeroVector;
+		ClusterWeights.Reset();
+		for (const int32 TriangleIndex : ClusterTriangles)
+		{
+			ClusterBounds += Positions[TriangleIndex];
+			SummedNormal += Normals[TriangleIndex];
+			ClusterWeights.Add(Weights[TriangleIndex]);
+			Cluster.Importance += Weights[TriangleIndex];
+		}
+		Cluster.Center = ClusterBounds.GetCenter();
+		for (const int32 TriangleIndex : ClusterTriangles)
+		{
+			Cluster.Radius = FMath::Max(Cluster.Radius, static_cast<float>(FVector::Dist(Cluster.Center, Positions[TriangleIndex])));
+		}
+
+		// Without a dominant normal direction the cone covers the full sphere and never culls
+		Cluster.ConeHalfAngle = PI;
+		if (SummedNormal.Normalize(KINDA_SMALL_NUMBER))
+		{
+			Cluster.ConeAxis = SummedNormal;
+			float MinimumCosine = 1.0f;
+			for (const int32 TriangleIndex : ClusterTriangles)
+			{
+				MinimumCosine = FMath::Min(MinimumCosine, static_cast<float>(FVector::DotProduct(SummedNormal, Normals[TriangleIndex].GetSafeNormal())));
+			}
+			Cluster.ConeHalfAngle = FMath::Acos(FMath::Clamp(MinimumCosine, -1.0f, 1.0f));
+		}
+		Cluster.AliasTable.Build(ClusterWeights);
+	}
+}
+
+float FSonoTraceUEDiffractionClusters::Cull(const FTransform& Transform, const FView& View, TArray<int32>& OutClusters, TArray<float>& OutImportances) const
+{
+	OutClusters.Reset();
+	OutImportances.Reset();
+	const float RadiusScale = Transform.GetMaximumAxisScale();
+	float WeightedSolidAngle = 0.0f;
+	for (int32 ClusterIndex = 0; ClusterIndex < Clusters.Num(); ClusterIndex++)
+	{
+		const FCluster& Cluster = Clusters[ClusterIndex];
+		const FVector Center = Transform.TransformPosition(Cluster.Center);
+		const float Radius = Cluster.Radius * RadiusScale;
+
+		FVector ToCenter = Center - View.SensorLocation;
+		const float Distance = ToCenter.Size();
+		if (Distance - Radius > View.MaximumDistance)
+			continue;
+
+		// Angular radius of the bounding sphere as seen from the sensor, the sensor inside the sphere sees half the sphere of directions
+		float AngularRadius = HALF_PI;
+		if (Distance > Radius)
+		{
+			AngularRadius = FMath::Asin(Radius / Distance);
+			const FVector LocalDirection = View.SensorRotation.UnrotateVector(ToCenter / Distance);
+			const float Elevation = FMath::Asin(FMath::Clamp(static_cast<float>(LocalDirection.Z), -1.0f, 1.0f));
+			const float AngularRadiusDegrees = FMath::RadiansToDegrees(AngularRadius);
+			const float ElevationDegrees = FMath::RadiansToDegrees(Elevation);
+			if (ElevationDegrees + AngularRadiusDegrees < View.LowerElevationLimit || ElevationDegrees - AngularRadiusDegrees > View.UpperElevationLimit)
+				continue;
+
+			// The azimuth extent of the sphere widens towards the poles, spheres over a pole or across the back seam are kept
+			if (FMath::Abs(Elevation) + AngularRadius < HALF_PI)
+			{
+				const float AzimuthDegrees = FMath::RadiansToDegrees(FMath::Atan2(LocalDirection.Y, LocalDirection.X));
+				const float AzimuthRadiusDegrees = FMath::RadiansToDegrees(FMath::Asin(FMath::Min(FMath::Sin(AngularRadius) / FMath::Cos(Elevation), 1.0f)));
+				if (AzimuthDegrees - AzimuthRadiusDegrees >= -180.0f && AzimuthDegrees + AzimuthRadiusDegrees <= 180.0f
+					&& (AzimuthDegrees + AzimuthRadiusDegrees < View.LowerAzimuthLimit || AzimuthDegrees - AzimuthRadiusDegrees > View.UpperAzimuthLimit))
+					continue;
+			}
+		}
+
+		// A diffraction point needs a normal pointing away from an emitter, the widest angle between the normals and the emitter directions bounds that
+		bool FacesEmitter = Cluster.ConeHalfAngle >= HALF_PI;
+		const FVector ConeAxis = Transform.TransformVectorNoScale(Cluster.ConeAxis);
+		for (int32 EmitterIndex = 0; EmitterIndex < View.EmitterLocations.Num() && !FacesEmitter; EmitterIndex++)
+		{
+			const FVector EmitterToCenter = Center - View.EmitterLocations[EmitterIndex];
+			const float EmitterDistance = EmitterToCenter.Size();
+			if (EmitterDistance <= Radius)
+			{
+				FacesEmitter = true;
+				break;
+			}
+			const float AxisAngle = FMath::Acos(FMath::Clamp(static_cast<float>(FVector::DotProduct(ConeAxis, EmitterToCenter / EmitterDistance)), -1.0f, 1.0f));
+			FacesEmitter = AxisAngle + Cluster.ConeHalfAngle + FMath::Asin(Radius / EmitterDistance) >= HALF_PI;
+		}
+		if (!FacesEmitter)
+			continue;
+
+		OutClusters.Add(ClusterIndex);
+		OutImportances.Add(Cluster.Importance);
+		WeightedSolidAngle += 2.0f * PI * (1.0f - FMath::Cos(AngularRadius)) * Cluster.Importance / Cluster.NumTriangles;
+	}
+	return WeightedSolidAngle;
+}
+
+void FSonoTraceUEDiffractionClusters::SplitBudget(TConstArrayView<float> Weights, const int32 Budget, TArray<int32>& OutCounts)
+{
+	OutCounts.SetNumZeroed(Weights.Num());
+	double TotalWeight = 0.0;
+	for (const float Weight : Weights)
+	{
+		TotalWeight += FMath::Max(Weight, 0.0f);
+	}
+	if (TotalWeight <= 0.0 || Budget <= 0)
+		return;
+
+	TArray<TPair<double, int32>> Remainders;
+	int32 Assigned = 0;
+	for (int32 Index = 0; Index < Weights.Num(); Index++)
+	{
+		const double Quota = FMath::Max(Weights[Index], 0.0f) / TotalWeight * Budget;
+		OutCounts[Index] = FMath::FloorToInt32(Quota);
+		Assigned += OutCounts[Index];
+		if (Weights[Index] > 0.0f)
+			Remainders.Emplace(Quota - OutCounts[Index], Index);
+	}
+	Remainders.Sort([](const TPair<double, int32>& A, const TPair<double, int32>& B)
+	{
+		return A.Key != B.Key ? A.Key > B.Key : A.Value < B.Value;
+	});
+	for (int32 Index = 0; Index < Remainders.Num() && Assigned < Budget; Index++, Assigned++)
+	{
+		OutCounts[Remainders[Index].Value]++;
+	}
+}
@@ -0,0 +1,147 @@
+// By Wouter Jansen & Jan Steckel, Cosys-Lab, University of Antwerp. See the LICENSE file for details.
+
+#include "SonoTraceUEHeightfield.h"
+#include "SonoTraceUEActor.h"
+#include "Async/ParallelFor.h"
+
+void FSonoTraceUEHeightfieldTileSamples::Init(const int32 InNumberOfQuads, const FVector2D& InOrigin, const FVector2D& InQuadSize)
+{
+	NumberOfQuads = InNumberOfQuads;
+	Origin = InOrigin;
+	QuadSize = InQuadSize;
+	Heights.Init(0.0f, FMath::Square(GetNumberOfSamplesPerSide()));
+	Valid.Init(0, FMath::Square(GetNumberOfSamplesPerSide()));
+}
+
+float FSonoTraceUEHeightfieldTileSamples::GetMeanCurvature(const int32 X, const int32 Y) const
+{
+	// Mean curvature of the graph of the height function, H = ((1 + hx^2) hyy - 2 hx hy hxy + (1 + hy^2) hxx) / (2 (1 + hx^2 + hy^2)^(3/2))
+	const double Center = Heights[GetSampleIndex(X, Y)];
+	auto Height = [this, Center](const int32 SampleX, const int32 SampleY)
+	{
+		const int32 SampleIndex = GetSampleIndex(SampleX, SampleY);
+		return Valid[SampleIndex] ? static_cast<double>(Heights[SampleIndex]) : Center;
+	};
+	const double SpacingX = QuadSize.X;
+	const double SpacingY = QuadSize.Y;
+	const double Hx = (Height(X + 1, Y) - Height(X - 1, Y)) / (2.0 * SpacingX);
+	const double Hy = (Height(X, Y + 1) - Height(X, Y - 1)) / (2.0 * SpacingY);
+	const double Hxx = (Height(X + 1, Y) - 2.0 * Center + Height(X - 1, Y)) / (SpacingX * SpacingX);
+	const double Hyy = (Height(X, Y + 1) - 2.0 * Center + Height(X, Y - 1)) / (SpacingY * SpacingY);
+	const double Hxy = (Height(X + 1, Y + 1) - Height(X + 1, Y - 1) - Height(X - 1, Y + 1) + Height(X - 1, Y - 1)) / (4.0 * SpacingX * SpacingY);
+	const double GradientTerm = 1.0 + Hx * Hx + Hy * Hy;
+	const double MeanCurvature = ((1.0 + Hx * Hx) * Hyy - 2.0 * Hx * Hy * Hxy + (1.0 + Hy * Hy) * Hxx) / (2.0 * GradientTerm * FMath::Sqrt(GradientTerm));
+	return static_cast<float>(FMath::Abs(MeanCurvature));
+}
+
+void FSonoTraceUEHeightfieldTileSamples::CalculateMeshData(const float CurvatureScaleFactor, FSonoTraceUEMeshDataStruct& OutMeshData) const
+{
+	// The curvature of every vertex is evaluated once, each is shared by six triangles
+	const int32 NumberOfVerticesPerSide = NumberOfQuads + 1;
+	TArray<float> VertexCurvatureMagnitudes;
+	VertexCurvatureMagnitudes.SetNumUninitialized(FMath::Square(NumberOfVerticesPerSide));
+	ParallelFor(NumberOfVerticesPerSide, [&](const int32 Y)
+	{
+		for (int32 X = 0; X < NumberOfVerticesPerSide; X++)
+		{
+			VertexCurvatureMagnitudes[Y * NumberOfVerticesPerSide + X] = GetMeanCurvature(X, Y);
+		}
+	});
+
+	const int32 NumberOfTriangles = 2 * NumberOfQuads * NumberOfQuads;
+	OutMeshData.TrianglePosition.SetNumUninitialized(NumberOfTriangles);
+	OutMeshData.TriangleNormal.SetNumUninitialized(NumberOfTriangles);
+	OutMeshData.TriangleSize.SetNumUninitialized(NumberOfTriangles);
+	OutMeshData.TriangleCurvatureMagnitude.SetNumUninitialized(NumberOfTriangles);
+	ParallelFor(NumberOfQuads, [&](const int32 Y)
+	{
+		for (int32 X = 0; X < NumberOfQuads; X++)
+		{
+			// First triangle below the diagonal, second one above it, both wound so their normal points up
+			const FIntPoint Corners[2][3] = {{{X, Y}, {X + 1, Y}, {X + 1, Y + 1}}, {{X, Y}, {X + 1, Y + 1}, {X, Y + 1}}};
+			for (int32 Half = 0; Half < 2; Half++)
+			{
+				const int32 TriangleIndex = 2 * (Y * NumberOfQuads + X) + Half;
+				const FVector Vertex1 = GetVertex(Corners[Half][0].X, Corners[Half][0].Y);
+				const FVector Vertex2 = GetVertex(Corners[Half][1].X, Corners[Half][1].Y);
+				const FVector Vertex3 = GetVertex(Corners[Half][2].X, Corners[Half][2].Y);
+				const FVector Cross = FVector::CrossProduct(Vertex2 - Vertex1, Vertex3 - Vertex1);
+				OutMeshData.TrianglePosition[TriangleIndex] = (Vertex1 + Vertex2 + Vertex3) / 3.0;
+				OutMeshData.TriangleNormal[TriangleIndex] = Cross.GetSafeNormal();
+				OutMeshData.TriangleSize[TriangleIndex] = Cross.Length() * 0.5;
+
+				float MinimumCurvature = TNumericLimits<float>::Max();
+				float MaximumCurvature = 0.0f;
+				bool AllValid = true;
+				for (const FIntPoint& Corner : Corners[Half])
+				{
+					const float VertexCurvature = VertexCurvatureMagnitudes[Corner.Y * NumberOfVerticesPerSide + Corner.X];
+					MinimumCurvature = FMath::Min(MinimumCurvature, VertexCurvature);
+					MaximumCurvature = FMath::Max(MaximumCurvature, VertexCurvature);
+					AllValid &= Valid[GetSampleIndex(Corner.X, Corner.Y)] != 0;
+				}
+				OutMeshData.TriangleCurvatureMagnitude[TriangleIndex] = FFloat16(AllValid ? (MaximumCurvature - MinimumCurvature) * CurvatureScaleFactor : 0.0f);
+			}
+		}
+	});
+}
+
+void FSonoTraceUEHeightfieldTileSamples::GetTriangles(TArray<FVector3f>& OutVertices, TArray<FIntVector>& OutTriangles) const
+{
+	const int32 NumberOfVerticesPerSide = NumberOfQuads + 1;
+	OutVertices.SetNumUninitialized(FMath::Square(NumberOfVerticesPerSide));
+	for (int32 Y = 0; Y < NumberOfVerticesPerSide; Y++)
+	{
+		for (int32 X = 0; X < NumberOfVerticesPerSide; X++)
+		{
+			OutVertices[Y * NumberOfVerticesPerSide + X] = FVector3f(GetVertex(X, Y));
+		}
+	}
+
+	OutTriangles.SetNumUninitialized(2 * NumberOfQuads * NumberOfQuads);
+	for (int32 Y = 0; Y < NumberOfQuads; Y++)
+	{
+		for (int32 X = 0; X < NumberOfQuads; X++)
+		{
+			// Same corners as in CalculateMeshData, the second and third corner are swapped as the winding normal of the shader is the opposite cross product
+			const FIntPoint Corners[2][3] = {{{X, Y}, {X + 1, Y + 1}, {X + 1, Y}}, {{X, Y}, {X, Y + 1}, {X + 1, Y + 1}}};
+			for (int32 Half = 0; Half < 2; Half++)
+			{
+				bool AllValid = true;
+				int32 VertexIndexes[3];
+				for (int32 CornerIndex = 0; CornerIndex < 3; CornerIndex++)
+				{
+					const FIntPoint& Corner = Corners[Half][CornerIndex];
+					AllValid &= Valid[GetSampleIndex(Corner.X, Corner.Y)] != 0;
+					VertexIndexes[CornerIndex] = Corner.Y * NumberOfVerticesPerSide + Corner.X;
+				}
+				OutTriangles[2 * (Y * NumberOfQuads + X) + Half] = AllValid ? FIntVector(VertexIndexes[0], VertexIndexes[1], VertexIndexes[2]) : FIntVector(VertexIndexes[0]);
+			}
+		}
+	}
+}
+
+int32 FSonoTraceUEHeightfieldTileSamples::GetTriangleIndex(const int32 NumberOfQuads, const FVector2D& TilePosition)
+{
+	const int32 QuadX = FMath::Clamp(FMath::FloorToInt32(TilePosition.X), 0, NumberOfQuads - 1);
+	const int32 QuadY = FMath::Clamp(FMath::FloorToInt32(TilePosition.Y), 0, NumberOfQuads - 1);
+	const bool AboveDiagonal = TilePosition.Y - QuadY > TilePosition.X - QuadX;
+	return 2 * (QuadY * NumberOfQuads + QuadX) + (AboveDiagonal ? 1 : 0);
+}
+
+FIntPoint FSonoTraceUEHeightfield::GetTile(const FVector2D& LocalPosition, const int32 TileNumberOfQuads)
+{
+	return FIntPoint(FMath::FloorToInt32(LocalPosition.X / TileNumberOfQuads), FMath::FloorToInt32(LocalPosition.Y / TileNumberOfQuads));
+}
+
+bool FSonoTraceUEHeightfield::FindTriangle(const FVector& WorldPosition, int32& OutMeshDataIndex, int32& OutTriangleIndex) const
+{
+	const FVector LocalPosition = LandscapeTransform.InverseTransformPosition(WorldPosition);
+	const FIntPoint Tile = GetTile(FVector2D(LocalPosition), TileNumberOfQuads);
+	const int32* MeshDataIndex = TileMeshDataIndexes.Find(Tile);
+	if (!MeshDataIndex)
+		return false;
+	OutMeshDataIndex = *MeshDataIndex;
+	OutTriangleIndex = FSonoTraceUEHeightfieldTileSamples::GetTriangleIndex(TileNumberOfQuads, FVector2D(LocalPosition) - FVector2D(Tile * TileNumberOfQuads));
+	return true;
+}
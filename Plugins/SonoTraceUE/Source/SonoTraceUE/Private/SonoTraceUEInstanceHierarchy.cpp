@@ -0,0 +1,119 @@
+// By Wouter Jansen & Jan Steckel, Cosys-Lab, University of Antwerp. See the LICENSE file for details.
+
+#include "SonoTraceUEInstanceHierarchy.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "Engine/StaticMesh.h"
+#include "Hash/CityHash.h"
+
+namespace
+{
+	// Tolerance on the bounds of an instance when resolving a hit position, hits lie on the surface so they can be just outside after float rounding
+	constexpr float InstanceBoundsTolerance = 1.0f;
+	constexpr int32 InstancesPerLeaf = 4;
+}
+
+void FSonoTraceUEInstanceHierarchy::Build(const TArray<FBox3f>& InstanceBounds)
+{
+	Bounds = InstanceBounds;
+	BVH.Build(Bounds, InstancesPerLeaf);
+}
+
+FSonoTraceUEInstanceHierarchyPtr FSonoTraceUEInstanceHierarchy::Create(const UInstancedStaticMeshComponent* Component)
+{
+	check(IsInGameThread());
+	if (!Component || !Component->GetStaticMesh())
+		return nullptr;
+	const FBox LocalBounds = Component->GetStaticMesh()->GetBoundingBox();
+	TArray<FBox3f> InstanceBounds;
+	InstanceBounds.SetNumUninitialized(Component->GetInstanceCount());
+	for (int32 InstanceIndex = 0; InstanceIndex < InstanceBounds.Num(); InstanceIndex++)
+	{
+		FTransform InstanceTransform;
+		Component->GetInstanceTransform(InstanceIndex, InstanceTransform, true);
+		InstanceBounds[InstanceIndex] = FBox3f(LocalBounds.TransformBy(InstanceTransform));
+	}
+	TSharedPtr<FSonoTraceUEInstanceHierarchy, ESPMode::ThreadSafe> Hierarchy = MakeShared<FSonoTraceUEInstanceHierarchy, ESPMode::ThreadSafe>();
+	Hierarchy->Build(InstanceBounds);
+	Hierarchy->ComponentTransform = Component->GetComponentTransform();
+	Hierarchy->InstanceDataHash = HashInstanceData(Component);
+	return Hierarchy;
+}
+
+uint64 FSonoTraceUEInstanceHierarchy::HashInstanceData(const UInstancedStaticMeshComponent* Component)
+{
+	// One pass over the raw instance transforms, cheaper than fetching and comparing every transform
+	const TArray<FInstancedStaticMeshInstanceData>& InstanceData = Component->PerInstanceSMData;
+	return CityHash64(reinterpret_cast<const char*>(InstanceData.GetData()), InstanceData.Num() * sizeof(FInstancedStaticMeshInstanceData));
+}
+
+bool FSonoTraceUEInstanceHierarchy::IsUpToDate(const UInstancedStaticMeshComponent* Component) const
+{
+	return Component && Component->GetInstanceCount() == Bounds.Num() && Component->GetComponentTransform().Equals(ComponentTransform) &&
+	       HashInstanceData(Component) == InstanceDataHash;
+}
+
+template <typename NodeTestType, typename LeafFunctionType>
+void FSonoTraceUEInstanceHierarchy::Traverse(NodeTestType&& NodeTest, LeafFunctionType&& LeafFunction) const
+{
+	if (BVH.IsEmpty())
+		return;
+	TArray<int32, TInlineAllocator<64>> Stack;
+	Stack.Add(0);
+	while (!Stack.IsEmpty())
+	{
+		const FSonoTraceBVHNode& Node = BVH.Nodes[Stack.Pop(EAllowShrinking::No)];
+		if (!NodeTest(Node))
+			continue;
+		if (Node.Count > 0)
+		{
+			for (int32 OrderIndex = Node.FirstIndex; OrderIndex < Node.FirstIndex + Node.Count; OrderIndex++)
+			{
+				LeafFunction(BVH.PrimitiveOrder[OrderIndex]);
+			}
+			continue;
+		}
+		Stack.Add(Node.FirstIndex);
+		Stack.Add(Node.FirstIndex + 1);
+	}
+}
+
+int32 FSonoTraceUEInstanceHierarchy::FindInstance(const FVector3f& Position) const
+{
+	auto Contains = [&Position](const FVector3f& Min, const FVector3f& Max)
+	{
+		return Position.X >= Min.X - InstanceBoundsTolerance && Position.X <= Max.X + InstanceBoundsTolerance &&
+		       Position.Y >= Min.Y - InstanceBoundsTolerance && Position.Y <= Max.Y + InstanceBoundsTolerance &&
+		       Position.Z >= Min.Z - InstanceBoundsTolerance && Position.Z <= Max.Z + InstanceBoundsTolerance;
+	};
+	int32 ClosestInstance = INDEX_NONE;
+	float ClosestDistanceSquared = TNumericLimits<float>::Max();
+	Traverse([&](const FSonoTraceBVHNode& Node) { return Contains(Node.BoundsMin, Node.BoundsMax); },
+		[&](const int32 InstanceIndex)
+		{
+			const FBox3f& InstanceBounds = Bounds[InstanceIndex];
+			if (!Contains(InstanceBounds.Min, InstanceBounds.Max))
+				return;
+			const float DistanceSquared = FVector3f::DistSquared(InstanceBounds.GetCenter(), Position);
+			if (DistanceSquared < ClosestDistanceSquared || (DistanceSquared == ClosestDistanceSquared && InstanceIndex < ClosestInstance))
+			{
+				ClosestDistanceSquared = DistanceSquared;
+				ClosestInstance = InstanceIndex;
+			}
+		});
+	return ClosestInstance;
+}
+
+void FSonoTraceUEInstanceHierarchy::OverlapSphere(const FVector3f& Center, const float Radius, TArray<int32>& OutInstances) const
+{
+	const float RadiusSquared = FMath::Square(Radius);
+	auto Overlaps = [&](const FVector3f& Min, const FVector3f& Max)
+	{
+		return (Center.BoundToBox(Min, Max) - Center).SizeSquared() <= RadiusSquared;
+	};
+	Traverse([&](const FSonoTraceBVHNode& Node) { return Overlaps(Node.BoundsMin, Node.BoundsMax); },
+		[&](const int32 InstanceIndex)
+		{
+			if (Overlaps(Bounds[InstanceIndex].Min, Bounds[InstanceIndex].Max))
+				OutInstances.Add(InstanceIndex);
+		});
+}
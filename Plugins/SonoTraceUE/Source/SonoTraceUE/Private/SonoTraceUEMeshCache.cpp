@@ -0,0 +1,277 @@
+// By Wouter Jansen & Jan Steckel, Cosys-Lab, University of Antwerp. See the LICENSE file for details.
+
+#include "SonoTraceUEMeshCache.h"
+#include "SonoTraceUEActor.h"
+#include "SonoTrace.h"
+#include "Engine/StaticMesh.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformFileManager.h"
+#include "Hash/xxhash.h"
+#include "Misc/FileHelper.h"
+#include "Misc/PackageName.h"
+#include "Memory/MemoryView.h"
+#include "Misc/Paths.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+#include "StaticMeshResources.h"
+
+FString FSonoTraceUEMeshCache::GetKey(const UObject* MeshAsset, const FSonoTraceUEObjectSettingsStruct& ObjectSettings, const USonoTraceUEInputSettingsData& InputSettings)
+{
+	if (!MeshAsset)
+		return FString();
+	const UPackage* Package = MeshAsset->GetPackage();
+	if (!Package || Package == GetTransientPackage() || Package->IsDirty())
+		return FString();
+
+	FString MeshIdentifier = MeshAsset->GetPathName();
+#if WITH_EDITORONLY_DATA
+	// The derived data key changes with the source geometry and build settings of the mesh
+	if (const UStaticMesh* StaticMesh = Cast<UStaticMesh>(MeshAsset); StaticMesh && StaticMesh->GetRenderData() && !StaticMesh->GetRenderData()->DerivedDataKey.IsEmpty())
+		return GetKey(MeshIdentifier + TEXT("|") + StaticMesh->GetRenderData()->DerivedDataKey, ObjectSettings, InputSettings);
+#endif
+
+	// Otherwise the package file on disk identifies the geometry, cooked content can only change together with the executable
+	FString Filename;
+	if (FPlatformProperties::RequiresCookedData())
+		Filename = FPlatformProcess::ExecutablePath();
+	else if (!FPackageName::TryConvertLongPackageNameToFilename(Package->GetName(), Filename, FPackageName::GetAssetPackageExtension()))
+		return FString();
+	const FFileStatData StatData = IFileManager::Get().GetStatData(*Filename);
+	if (!StatData.bIsValid)
+		return FString();
+	MeshIdentifier += FString::Printf(TEXT("|%s|%lld"), *StatData.ModificationTime.ToString(), StatData.FileSize);
+	return GetKey(MeshIdentifier, ObjectSettings, InputSettings);
+}
+
+FString FSonoTraceUEMeshCache::GetKey(const FString& MeshIdentifier, const FSonoTraceUEObjectSettingsStruct& ObjectSettings, const USonoTraceUEInputSettingsData& InputSettings)
+{
+	// All settings read by CalculateMeshCurvature and GenerateBRDFAndMaterial
+	TArray<uint8> KeyData;
+	FMemoryWriter Writer(KeyData);
+	uint32 KeyVersion = Version;
+	FString Identifier = MeshIdentifier;
+	Writer << KeyVersion << Identifier;
+
+	float CurvatureScale = InputSettings.CurvatureScale;
+	bool EnableCurvatureTriangleSizeBasedScaler = InputSettings.EnableCurvatureTriangleSizeBasedScaler;
+	float CurvatureScalerMinimumEffect = InputSettings.CurvatureScalerMinimumEffect;
+	float CurvatureScalerMaximumEffect = InputSettings.CurvatureScalerMaximumEffect;
+	float CurvatureScalerLowerTriangleSizeThreshold = InputSettings.CurvatureScalerLowerTriangleSizeThreshold;
+	float CurvatureScalerUpperTriangleSizeThreshold = InputSettings.CurvatureScalerUpperTriangleSizeThreshold;
+	float DiffractionTriangleSizeThreshold = InputSettings.DiffractionTriangleSizeThreshold;
+	Writer << CurvatureScale << EnableCurvatureTriangleSizeBasedScaler << CurvatureScalerMinimumEffect << CurvatureScalerMaximumEffect
+	       << CurvatureScalerLowerTriangleSizeThreshold << CurvatureScalerUpperTriangleSizeThreshold << DiffractionTriangleSizeThreshold;
+
+	FSonoTraceUEObjectSettingsStruct Settings = ObjectSettings;
+	Writer << Settings.BrdfTransitionPosition << Settings.BrdfTransitionSlope << Settings.BrdfExponentsSpecular << Settings.BrdfExponentsDiffraction
+	       << Settings.MaterialsTransitionPosition << Settings.MaterialsTransitionSlope << Settings.MaterialStrengthsSpecular << Settings.MaterialStrengthsDiffraction;
+
+	return FString::Printf(TEXT("%016llx"), FXxHash64::HashBuffer(KeyData.GetData(), KeyData.Num()).Hash);
+}
+
+FString FSonoTraceUEMeshCache::GetDirectory()
+{
+	return FPaths::ProjectSavedDir() / TEXT("SonoTraceUE") / TEXT("MeshCache");
+}
+
+FString FSonoTraceUEMeshCache::GetPath(const FString& Key)
+{
+	return GetDirectory() / Key + TEXT(".bin");
+}
+
+bool FSonoTraceUEMeshCache::Load(const FString& Key, FSonoTraceUEMeshDataStruct& OutMeshData)
+{
+	const FString Path = GetPath(Key);
+	if (Key.IsEmpty() || !FPlatformFileManager::Get().GetPlatformFile().FileExists(*Path))
+		return false;
+
+	// The entry is deserialized into the mesh data arrays anyway, so it is read in one go instead of being mapped
+	TArray<uint8> FileData;
+	if (!FFileHelper::LoadFileToArray(FileData, *Path, FILEREAD_Silent))
+		return false;
+	FMemoryReader Reader(FileData);
+	const bool Success = Read(Reader, OutMeshData);
+	if (!Success)
+	{
+		UE_LOG(SonoTraceUE, Warning, TEXT("Mesh data cache entry '%s' is outdated or corrupt and will be regenerated."), *Path);
+		OutMeshData = FSonoTraceUEMeshDataStruct();
+	}
+	return Success;
+}
+
+bool FSonoTraceUEMeshCache::Save(const FString& Key, const FSonoTraceUEMeshDataStruct& MeshData)
+{
+	if (Key.IsEmpty())
+		return false;
+	TArray<uint8> FileData;
+	FMemoryWriter Writer(FileData);
+	Write(Writer, MeshData);
+
+	// Write next to the entry and move it in place, so other sessions never read a partially written file
+	const FString Path = GetPath(Key);
+	const FString TemporaryPath = FPaths::CreateTempFilename(*GetDirectory(), *Key, TEXT(".tmp"));
+	if (!FFileHelper::SaveArrayToFile(FileData, *TemporaryPath) || !IFileManager::Get().Move(*Path, *TemporaryPath, true, true))
+	{
+		IFileManager::Get().Delete(*TemporaryPath, false, false, true);
+		UE_LOG(SonoTraceUE, Warning, TEXT("Could not write mesh data cache entry '%s'."), *Path);
+		return false;
+	}
+	return true;
+}
+
+namespace
+{
+	// Table of contents of the pack with the mapped or loaded file it points into.
+	// The pack holds the entries of whole levels, mapping it only pages in the entries that are looked up.
+	struct FMeshDataPack
+	{
+		FCriticalSection Lock;
+		bool Loaded = false;
+		TUniquePtr<IMappedFileHandle> MappedFile;
+		TUniquePtr<IMappedFileRegion> MappedRegion;
+		TArray<uint8> FileData;
+		FMemoryView Data;
+		TMap<FString, TPair<int64, int64>> Entries; // Offset and size in bytes
+
+		void Load()
+		{
+			Loaded = true;
+			const FString Path = FSonoTraceUEMeshCache::GetPackPath();
+			IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+			if (!PlatformFile.FileExists(*Path))
+				return;
+			MappedFile.Reset(PlatformFile.OpenMapped(*Path));
+			MappedRegion.Reset(MappedFile ? MappedFile->MapRegion() : nullptr);
+			if (MappedRegion)
+			{
+				Data = MakeMemoryView(MappedRegion->GetMappedPtr(), MappedRegion->GetMappedSize());
+			}else if (FFileHelper::LoadFileToArray(FileData, *Path, FILEREAD_Silent))
+			{
+				Data = MakeMemoryView(FileData);
+			}
+
+			FMemoryReaderView Reader(Data);
+			uint32 FileMagic = 0;
+			uint32 FileVersion = 0;
+			int32 NumberOfEntries = 0;
+			Reader << FileMagic << FileVersion << NumberOfEntries;
+			if (Reader.IsError() || FileMagic != FSonoTraceUEMeshCache::PackMagic || FileVersion != FSonoTraceUEMeshCache::Version || NumberOfEntries < 0)
+			{
+				UE_LOG(SonoTraceUE, Warning, TEXT("Mesh data pack '%s' is outdated or corrupt and is ignored, rerun the SonoTraceUE commandlet."), *Path);
+				return;
+			}
+			for (int32 EntryIndex = 0; EntryIndex < NumberOfEntries && !Reader.IsError(); EntryIndex++)
+			{
+				FString Key;
+				int64 Offset = 0;
+				int64 Size = 0;
+				Reader << Key << Offset << Size;
+				if (Offset >= 0 && Size >= 0 && static_cast<uint64>(Offset + Size) <= Data.GetSize())
+					Entries.Add(Key, TPair<int64, int64>(Offset, Size));
+			}
+			UE_LOG(SonoTraceUE, Log, TEXT("Loaded mesh data pack '%s' with %d entries."), *Path, Entries.Num());
+		}
+	};
+
+	// The pack is read on the first lookup
+	const FMeshDataPack& GetMeshDataPack()
+	{
+		static FMeshDataPack Pack;
+		FScopeLock ScopeLock(&Pack.Lock);
+		if (!Pack.Loaded)
+			Pack.Load();
+		return Pack;
+	}
+}
+
+FString FSonoTraceUEMeshCache::GetPackPath()
+{
+	return FPaths::ProjectContentDir() / TEXT("SonoTraceUE") / TEXT("MeshData.stmd");
+}
+
+FString FSonoTraceUEMeshCache::GetPackKey(const UObject* MeshAsset, const FSonoTraceUEObjectSettingsStruct& ObjectSettings, const USonoTraceUEInputSettingsData& InputSettings)
+{
+	return MeshAsset ? GetKey(MeshAsset->GetPathName(), ObjectSettings, InputSettings) : FString();
+}
+
+bool FSonoTraceUEMeshCache::LoadFromPack(const FString& Key, FSonoTraceUEMeshDataStruct& OutMeshData)
+{
+	const FMeshDataPack& Pack = GetMeshDataPack();
+	const TPair<int64, int64>* Entry = Pack.Entries.Find(Key);
+	if (!Entry)
+		return false;
+	FMemoryReaderView Reader(Pack.Data.Mid(Entry->Key, Entry->Value));
+	if (!Read(Reader, OutMeshData))
+	{
+		OutMeshData = FSonoTraceUEMeshDataStruct();
+		return false;
+	}
+	return true;
+}
+
+bool FSonoTraceUEMeshCache::Contains(const FString& Key, const FString& PackKey)
+{
+	return (!Key.IsEmpty() && IFileManager::Get().FileExists(*GetPath(Key))) || (!PackKey.IsEmpty() && GetMeshDataPack().Entries.Contains(PackKey));
+}
+
+bool FSonoTraceUEMeshCache::WritePack(const FString& Path, const TMap<FString, TArray<uint8>>& Entries)
+{
+	// The table of contents has a fixed size per key, so it is written twice: once to measure it and once with the final offsets
+	TArray<uint8> Header;
+	auto WriteHeader = [&Header, &Entries](const int64 FirstOffset)
+	{
+		Header.Reset();
+		FMemoryWriter Writer(Header);
+		uint32 FileMagic = PackMagic;
+		uint32 FileVersion = Version;
+		int32 NumberOfEntries = Entries.Num();
+		Writer << FileMagic << FileVersion << NumberOfEntries;
+		int64 Offset = FirstOffset;
+		for (const TPair<FString, TArray<uint8>>& Entry : Entries)
+		{
+			FString Key = Entry.Key;
+			int64 Size = Entry.Value.Num();
+			Writer << Key << Offset << Size;
+			Offset += Size;
+		}
+	};
+	WriteHeader(0);
+	WriteHeader(Header.Num());
+
+	TUniquePtr<FArchive> FileWriter(IFileManager::Get().CreateFileWriter(*Path));
+	if (!FileWriter)
+	{
+		UE_LOG(SonoTraceUE, Error, TEXT("Could not write mesh data pack '%s'."), *Path);
+		return false;
+	}
+	FileWriter->Serialize(Header.GetData(), Header.Num());
+	for (const TPair<FString, TArray<uint8>>& Entry : Entries)
+	{
+		FileWriter->Serialize(const_cast<uint8*>(Entry.Value.GetData()), Entry.Value.Num());
+	}
+	return FileWriter->Close();
+}
+
+bool FSonoTraceUEMeshCache::Read(FArchive& Ar, FSonoTraceUEMeshDataStruct& OutMeshData)
+{
+	uint32 FileMagic = 0;
+	uint32 FileVersion = 0;
+	Ar << FileMagic << FileVersion;
+	if (Ar.IsError() || FileMagic != Magic || FileVersion != Version)
+		return false;
+	Ar << OutMeshData;
+	if (Ar.IsError() || !Ar.AtEnd())
+		return false;
+
+	// Every per triangle array has to cover the same triangles
+	const int32 NumberOfTriangles = OutMeshData.TriangleCurvatureMagnitude.Num();
+	return OutMeshData.TriangleSize.Num() == NumberOfTriangles && OutMeshData.TriangleNormal.Num() == NumberOfTriangles && OutMeshData.TrianglePosition.Num() == NumberOfTriangles;
+}
+
+void FSonoTraceUEMeshCache::Write(FArchive& Ar, const FSonoTraceUEMeshDataStruct& MeshData)
+{
+	uint32 FileMagic = Magic;
+	uint32 FileVersion = Version;
+	Ar << FileMagic << FileVersion;
+	Ar << const_cast<FSonoTraceUEMeshDataStruct&>(MeshData);
+}
@@ -0,0 +1,454 @@
+// By Wouter Jansen & Jan Steckel, Cosys-Lab, University of Antwerp. See the LICENSE file for details.
+
+#include "SonoTraceUEParser.h"
+#include "SonoTraceUEActor.h"
+#include "SonoTraceUEStatistics.h"
+#include "Async/ParallelFor.h"
+#include "Misc/ScopeLock.h"
+
+namespace SonoTraceUEParser
+{
+	static const FName UnknownObjectName = FName(TEXT("UNKNOWN"));
+
+	// Sets a bit in a shared bitset, the read first avoids contention once a primitive has been marked
+	FORCEINLINE void SetBitAtomic(TArray<int32>& Words, const int32 BitIndex)
+	{
+		const int32 WordIndex = BitIndex >> 5;
+		const int32 Mask = 1 << (BitIndex & 31);
+		if ((FPlatformAtomics::AtomicRead(&Words[WordIndex]) & Mask) == 0)
+		{
+			FPlatformAtomics::InterlockedOr(&Words[WordIndex], Mask);
+		}
+	}
+
+	struct FChunkOutput
+	{
+		TArray<FSonoTraceUEPointStruct> Points;
+		TArray<FIntPoint> HitInstances;
+		FSonoTraceUEPointStatistics Statistics;
+	};
+}
+
+void FSonoTraceUEPrimitiveLookup::Reset()
+{
+	PersistentPrimitiveIndexes.Reset();
+	Labels.Reset();
+	ObjectTypeIndexes.Reset();
+	MeshDataIndexes.Reset();
+	InstanceHierarchies.Reset();
+	Heightfields.Reset();
+}
+
+void FSonoTraceUEPrimitiveLookup::Add(const int32 ScenePrimitiveIndex, const int32 PersistentPrimitiveIndex, const FName Label, const int32 ObjectTypeIndex, const int32 MeshDataIndex,
+                                      const FSonoTraceUEInstanceHierarchyPtr& InstanceHierarchy, const FSonoTraceUEHeightfieldPtr& Heightfield)
+{
+	if (ScenePrimitiveIndex < 0)
+		return;
+	if (ScenePrimitiveIndex >= PersistentPrimitiveIndexes.Num())
+	{
+		const int32 OldNum = PersistentPrimitiveIndexes.Num();
+		const int32 NewNum = ScenePrimitiveIndex + 1;
+		PersistentPrimitiveIndexes.SetNumUninitialized(NewNum);
+		MeshDataIndexes.SetNumUninitialized(NewNum);
+		for (int32 Index = OldNum; Index < NewNum; Index++)
+		{
+			PersistentPrimitiveIndexes[Index] = INDEX_NONE;
+			MeshDataIndexes[Index] = INDEX_NONE;
+		}
+		Labels.SetNum(NewNum);
+		ObjectTypeIndexes.SetNumZeroed(NewNum);
+		InstanceHierarchies.SetNum(NewNum);
+		Heightfields.SetNum(NewNum);
+	}
+	PersistentPrimitiveIndexes[ScenePrimitiveIndex] = PersistentPrimitiveIndex;
+	Labels[ScenePrimitiveIndex] = Label;
+	ObjectTypeIndexes[ScenePrimitiveIndex] = ObjectTypeIndex;
+	MeshDataIndexes[ScenePrimitiveIndex] = MeshDataIndex;
+	InstanceHierarchies[ScenePrimitiveIndex] = InstanceHierarchy;
+	Heightfields[ScenePrimitiveIndex] = Heightfield;
+}
+
+void FSonoTraceUEPrimitiveLookup::Remove(const int32 ScenePrimitiveIndex, const int32 PersistentPrimitiveIndex)
+{
+	if (!PersistentPrimitiveIndexes.IsValidIndex(ScenePrimitiveIndex) || PersistentPrimitiveIndexes[ScenePrimitiveIndex] != PersistentPrimitiveIndex)
+		return;
+	PersistentPrimitiveIndexes[ScenePrimitiveIndex] = INDEX_NONE;
+	Labels[ScenePrimitiveIndex] = NAME_None;
+	ObjectTypeIndexes[ScenePrimitiveIndex] = 0;
+	MeshDataIndexes[ScenePrimitiveIndex] = INDEX_NONE;
+	InstanceHierarchies[ScenePrimitiveIndex] = nullptr;
+	Heightfields[ScenePrimitiveIndex] = nullptr;
+}
+
+FSonoTraceUEPrimitiveLookupBuffer::FSonoTraceUEPrimitiveLookupBuffer()
+{
+	Tables[0] = MakeShared<FSonoTraceUEPrimitiveLookup, ESPMode::ThreadSafe>();
+	Tables[1] = MakeShared<FSonoTraceUEPrimitiveLookup, ESPMode::ThreadSafe>();
+}
+
+void FSonoTraceUEPrimitiveLookupBuffer::Add(const int32 ScenePrimitiveIndex, const int32 PersistentPrimitiveIndex, const FName Label, const int32 ObjectTypeIndex, const int32 MeshDataIndex,
+                                            const FSonoTraceUEInstanceHierarchyPtr& InstanceHierarchy, const FSonoTraceUEHeightfieldPtr& Heightfield)
+{
+	Changes.Add({ScenePrimitiveIndex, PersistentPrimitiveIndex, Label, ObjectTypeIndex, MeshDataIndex, InstanceHierarchy, Heightfield, false});
+}
+
+void FSonoTraceUEPrimitiveLookupBuffer::Remove(const int32 ScenePrimitiveIndex, const int32 PersistentPrimitiveIndex)
+{
+	Changes.Add({ScenePrimitiveIndex, PersistentPrimitiveIndex, NAME_None, 0, INDEX_NONE, nullptr, nullptr, true});
+}
+
+FSonoTraceUEPrimitiveLookupBuffer::FLookupPtr FSonoTraceUEPrimitiveLookupBuffer::Publish()
+{
+	check(IsInGameThread());
+	if (AppliedChanges[PublishedTable] == Changes.Num())
+		return Tables[PublishedTable];
+
+	// Parse tasks only drop their references from other threads, so a table held by nobody stays that way here
+	const int32 WriteTable = 1 - PublishedTable;
+	if (!Tables[WriteTable].IsUnique())
+	{
+		// Both tables are still being read, the changes continue on a copy of the published one
+		Tables[WriteTable] = MakeShared<FSonoTraceUEPrimitiveLookup, ESPMode::ThreadSafe>(*Tables[PublishedTable]);
+		AppliedChanges[WriteTable] = AppliedChanges[PublishedTable];
+	}
+	FSonoTraceUEPrimitiveLookup& Lookup = *Tables[WriteTable];
+	for (int32 ChangeIndex = AppliedChanges[WriteTable]; ChangeIndex < Changes.Num(); ChangeIndex++)
+	{
+		const FChange& Change = Changes[ChangeIndex];
+		if (Change.Remove)
+			Lookup.Remove(Change.ScenePrimitiveIndex, Change.PersistentPrimitiveIndex);
+		else
+			Lookup.Add(Change.ScenePrimitiveIndex, Change.PersistentPrimitiveIndex, Change.Label, Change.ObjectTypeIndex, Change.MeshDataIndex, Change.InstanceHierarchy, Change.Heightfield);
+	}
+	AppliedChanges[WriteTable] = Changes.Num();
+	PublishedTable = WriteTable;
+
+	// Changes both tables contain are no longer needed
+	const int32 NumberOfAppliedChanges = FMath::Min(AppliedChanges[0], AppliedChanges[1]);
+	Changes.RemoveAt(0, NumberOfAppliedChanges, EAllowShrinking::No);
+	AppliedChanges[0] -= NumberOfAppliedChanges;
+	AppliedChanges[1] -= NumberOfAppliedChanges;
+	return Tables[PublishedTable];
+}
+
+FSonoTraceUEStagingBufferPool::FBufferRef FSonoTraceUEStagingBufferPool::Acquire(const int32 NumElements)
+{
+	FScopeLock Lock(&CriticalSection);
+	for (const FBufferRef& Buffer : Buffers)
+	{
+		if (Buffer.GetSharedReferenceCount() == 1)
+		{
+			Buffer->SetNumUninitialized(NumElements, EAllowShrinking::No);
+			return Buffer;
+		}
+	}
+	FBufferRef NewBuffer = MakeShared<TArray<FStructuredOutputBufferElem>, ESPMode::ThreadSafe>();
+	NewBuffer->SetNumUninitialized(NumElements);
+	Buffers.Add(NewBuffer);
+	return NewBuffer;
+}
+
+int32 FSonoTraceUEStagingBufferPool::Num()
+{
+	FScopeLock Lock(&CriticalSection);
+	return Buffers.Num();
+}
+
+TArray<int32> FSonoTraceUEParser::FindUnknownScenePrimitiveIndexes(const FSonoTraceUEParseContext& Context)
+{
+	TArray<int32> UnknownScenePrimitiveIndexes;
+	if (!Context.RawOutput || !Context.PrimitiveLookup)
+		return UnknownScenePrimitiveIndexes;
+
+	// Mark every hit scene primitive that is missing from the lookup in a shared bitset.
+	// The highest scene primitive index is not known up front so out of range indexes are collected per chunk instead.
+	const FSonoTraceUEPrimitiveLookup& Lookup = *Context.PrimitiveLookup;
+	TArray<int32> UnknownWords;
+	UnknownWords.Init(0, FMath::DivideAndRoundUp(Lookup.Num(), 32));
+	const int32 NumChunks = FMath::DivideAndRoundUp(Context.NumberOfRays, RaysPerChunk);
+	TArray<TArray<int32>> OutOfRangeIndexes;
+	OutOfRangeIndexes.SetNum(NumChunks);
+	ParallelFor(NumChunks, [&](const int32 ChunkIndex)
+	{
+		const int32 FirstRay = ChunkIndex * RaysPerChunk;
+		const int32 LastRay = FMath::Min(FirstRay + RaysPerChunk, Context.NumberOfRays);
+		for (int32 RayIndex = FirstRay; RayIndex < LastRay; RayIndex++)
+		{
+			for (int32 BounceIndex = 0; BounceIndex < Context.MaximumBounces; BounceIndex++)
+			{
+				const FStructuredOutputBufferElem& Output = Context.RawOutput[RayIndex * Context.MaximumBounces + BounceIndex];
+				if (!Output.IsHit)
+					break;
+				if (!Output.HitLineOfSightToSensor || Output.HitScenePrimitiveIndex < 0)
+					continue;
+				if (Output.HitScenePrimitiveIndex >= Lookup.Num())
+					OutOfRangeIndexes[ChunkIndex].AddUnique(Output.HitScenePrimitiveIndex);
+				else if (Lookup.PersistentPrimitiveIndexes[Output.HitScenePrimitiveIndex] == INDEX_NONE)
+					SonoTraceUEParser::SetBitAtomic(UnknownWords, Output.HitScenePrimitiveIndex);
+			}
+		}
+	});
+
+	for (int32 WordIndex = 0; WordIndex < UnknownWords.Num(); WordIndex++)
+	{
+		for (uint32 Word = static_cast<uint32>(UnknownWords[WordIndex]); Word != 0; Word &= Word - 1)
+		{
+			UnknownScenePrimitiveIndexes.Add(WordIndex * 32 + static_cast<int32>(FMath::CountTrailingZeros(Word)));
+		}
+	}
+	for (const TArray<int32>& ChunkIndexes : OutOfRangeIndexes)
+	{
+		for (const int32 ScenePrimitiveIndex : ChunkIndexes)
+		{
+			UnknownScenePrimitiveIndexes.AddUnique(ScenePrimitiveIndex);
+		}
+	}
+	UnknownScenePrimitiveIndexes.Sort();
+	return UnknownScenePrimitiveIndexes;
+}
+
+void FSonoTraceUEParser::Parse(const FSonoTraceUEParseContext& Context, FSonoTraceUESubOutputStruct& OutSubOutput, TArray<int32>* OutHitScenePrimitiveIndexes)
+{
+	OutSubOutput.ReflectedPoints.Reset();
+	OutSubOutput.HitPersistentPrimitiveIndexes.Reset();
+	OutSubOutput.HitInstances.Reset();
+	if (OutHitScenePrimitiveIndexes)
+		OutHitScenePrimitiveIndexes->Reset();
+	OutSubOutput.MaximumCurvature = 0.0f;
+	OutSubOutput.MaximumTotalDistance = 0.0f;
+	if (!Context.RawOutput || !Context.PrimitiveLookup || Context.NumberOfRays <= 0 || Context.MaximumBounces <= 0)
+		return;
+
+	const FSonoTraceUEPrimitiveLookup& Lookup = *Context.PrimitiveLookup;
+	const int32 NumEmitters = Context.EmitterPoses.Num();
+	const int32 NumChunks = FMath::DivideAndRoundUp(Context.NumberOfRays, RaysPerChunk);
+
+	TArray<int32> HitWords;
+	HitWords.Init(0, FMath::DivideAndRoundUp(Lookup.Num(), 32));
+	int32 UnresolvedHit = 0;
+
+	TArray<SonoTraceUEParser::FChunkOutput> Chunks;
+	Chunks.SetNum(NumChunks);
+	ParallelFor(NumChunks, [&](const int32 ChunkIndex)
+	{
+		SonoTraceUEParser::FChunkOutput& Chunk = Chunks[ChunkIndex];
+		const int32 FirstRay = ChunkIndex * RaysPerChunk;
+		const int32 LastRay = FMath::Min(FirstRay + RaysPerChunk, Context.NumberOfRays);
+		Chunk.Points.Reserve((LastRay - FirstRay) * Context.MaximumBounces);
+
+		TArray<float> CachedSourceDirectivities;
+		TArray<float> RayDistancesTotalFromEmitters;
+		for (int32 RayIndex = FirstRay; RayIndex < LastRay; RayIndex++)
+		{
+			// Start multi-bounce loop
+			bool CurrentRayIsHitting = false;
+			CachedSourceDirectivities.Init(1.0f, NumEmitters);
+			for (int32 BounceIndex = 0; BounceIndex < Context.MaximumBounces; BounceIndex++)
+			{
+				const int32 OutputIndex = RayIndex * Context.MaximumBounces + BounceIndex;
+				const FStructuredOutputBufferElem& CurrentRayTracingOutput = Context.RawOutput[OutputIndex];
+				if (!CurrentRayTracingOutput.IsHit)
+				{
+					if (CurrentRayIsHitting && Chunk.Points.Num() > 0)
+						Chunk.Points.Last().IsLastHit = true;
+					break;
+				}
+				CurrentRayIsHitting = true;
+
+				// Only points with line-of-sight to the sensor are kept
+				if (!CurrentRayTracingOutput.HitLineOfSightToSensor)
+					continue;
+
+				const int32 CurrentScenePrimitiveIndex = CurrentRayTracingOutput.HitScenePrimitiveIndex;
+				int32 CurrentTriangleIndex = CurrentRayTracingOutput.HitTriangleIndex;
+				const FVector HitLocation(CurrentRayTracingOutput.HitPosX, CurrentRayTracingOutput.HitPosY, CurrentRayTracingOutput.HitPosZ);
+				const FVector HitReflectionDirection(CurrentRayTracingOutput.HitReflectionX, CurrentRayTracingOutput.HitReflectionY, CurrentRayTracingOutput.HitReflectionZ);
+
+				// If this is the original transmission, calculate the angle for source directivity and cache it
+				if (Context.EnableEmitterDirectivity && BounceIndex == 0)
+				{
+					for (int32 EmitterIndex = 0; EmitterIndex < NumEmitters; ++EmitterIndex)
+					{
+						const FVector LaunchVector = (HitLocation - Context.EmitterPoses[EmitterIndex].GetLocation()).GetSafeNormal();
+						const FVector EmitterForward = Context.EmitterPoses[EmitterIndex].GetUnitAxis(EAxis::X);
+						const float Dot = FVector::DotProduct(LaunchVector, EmitterForward);
+						const float Directivity = (1.0f - Context.EmitterDirectivities[EmitterIndex]) + (Context.EmitterDirectivities[EmitterIndex] * Dot);
+						CachedSourceDirectivities[EmitterIndex] = FMath::Max(0.0f, Directivity);
+					}
+				}
+
+				FName ObjectName = SonoTraceUEParser::UnknownObjectName;
+				int32 ObjectTypeIndex = 0;
+				int32 CurrentPersistentPrimitiveIndex = INDEX_NONE;
+				int32 MeshDataIndex = INDEX_NONE;
+				int32 InstanceIndex = INDEX_NONE;
+				if (Lookup.Contains(CurrentScenePrimitiveIndex))
+				{
+					CurrentPersistentPrimitiveIndex = Lookup.PersistentPrimitiveIndexes[CurrentScenePrimitiveIndex];
+					ObjectName = Lookup.Labels[CurrentScenePrimitiveIndex];
+					ObjectTypeIndex = Lookup.ObjectTypeIndexes[CurrentScenePrimitiveIndex];
+					MeshDataIndex = Lookup.MeshDataIndexes[CurrentScenePrimitiveIndex];
+					SonoTraceUEParser::SetBitAtomic(HitWords, CurrentScenePrimitiveIndex);
+
+					// All instances share the primitive and the triangle indexes of their mesh, the instance is found from the hit location
+					if (const FSonoTraceUEInstanceHierarchy* InstanceHierarchy = Lookup.InstanceHierarchies[CurrentScenePrimitiveIndex].Get())
+					{
+						InstanceIndex = InstanceHierarchy->FindInstance(FVector3f(HitLocation));
+						if (InstanceIndex != INDEX_NONE)
+							Chunk.HitInstances.AddUnique(FIntPoint(CurrentPersistentPrimitiveIndex, InstanceIndex));
+					}
+
+					// Landscapes have no mesh data of their own, the triangle is found in the mesh data of the loaded tile at the hit location
+					if (const FSonoTraceUEHeightfield* Heightfield = Lookup.Heightfields[CurrentScenePrimitiveIndex].Get())
+					{
+						if (!Heightfield->FindTriangle(HitLocation, MeshDataIndex, CurrentTriangleIndex))
+							MeshDataIndex = INDEX_NONE;
+					}
+				}else
+				{
+					FPlatformAtomics::InterlockedExchange(&UnresolvedHit, 1);
+				}
+
+				float CurvatureMagnitude = 0;
+				const TArray<float>* SurfaceBRDF = Context.DefaultTriangleBRDF;
+				const TArray<float>* SurfaceMaterial = Context.DefaultTriangleMaterial;
+				if (MeshDataIndex == INDEX_NONE && ObjectTypeIndex != 0 && Context.ObjectSettings && Context.ObjectSettings->IsValidIndex(ObjectTypeIndex))
+				{
+					// Objects without mesh data, such as landscape tiles that are not loaded yet, use the defaults of their object type
+					SurfaceBRDF = &(*Context.ObjectSettings)[ObjectTypeIndex].DefaultTriangleBRDF;
+					SurfaceMaterial = &(*Context.ObjectSettings)[ObjectTypeIndex].DefaultTriangleMaterial;
+				}
+				if (MeshDataIndex != INDEX_NONE && Context.MeshData && Context.MeshData->IsValidIndex(MeshDataIndex))
+				{
+					const FSonoTraceUEMeshDataStruct& CurrentMeshData = *(*Context.MeshData)[MeshDataIndex];
+					const FSonoTraceUEObjectSettingsStruct* ObjectSettings = Context.ObjectSettings && Context.ObjectSettings->IsValidIndex(ObjectTypeIndex) ? &(*Context.ObjectSettings)[ObjectTypeIndex] : nullptr;
+					if (CurrentMeshData.TriangleCurvatureMagnitude.Num() == 0)
+					{
+						// Mesh data still being generated in the background
+						if (ObjectSettings)
+						{
+							SurfaceBRDF = &ObjectSettings->DefaultTriangleBRDF;
+							SurfaceMaterial = &ObjectSettings->DefaultTriangleMaterial;
+						}
+					}else if (CurrentTriangleIndex >= 0 && CurrentMeshData.TriangleCurvatureMagnitude.Num() > CurrentTriangleIndex)
+					{
+						CurvatureMagnitude = CurrentMeshData.TriangleCurvatureMagnitude[CurrentTriangleIndex];
+						if (ObjectSettings && ObjectSettings->SurfaceTable.IsValid())
+						{
+							const int32 SurfaceLevel = ObjectSettings->SurfaceTable.GetLevel(CurvatureMagnitude);
+							SurfaceBRDF = &ObjectSettings->SurfaceTable.BRDF[SurfaceLevel];
+							SurfaceMaterial = &ObjectSettings->SurfaceTable.Material[SurfaceLevel];
+						}
+					}else
+					{
+						UE_LOG(SonoTraceUE, Warning, TEXT("Mesh data triangle index out of bounds. Object name: %s, PPI: %i, SPI: %i and triangle Index: %i"),
+						       *ObjectName.ToString(), CurrentPersistentPrimitiveIndex, CurrentScenePrimitiveIndex, CurrentTriangleIndex);
+					}
+				}
+
+				const float RayDistanceTotal = CurrentRayTracingOutput.RayDistanceTotal;
+				RayDistancesTotalFromEmitters.Reset();
+				RayDistancesTotalFromEmitters.Append(CurrentRayTracingOutput.DistancesFromEmitterTotal, NumEmitters);
+				FSonoTraceUEPointStruct& NewPoint = Chunk.Points.Emplace_GetRef(HitLocation,
+				                     HitReflectionDirection,
+				                     ObjectName,
+				                     OutputIndex,
+				                     RayDistanceTotal,
+				                     RayDistancesTotalFromEmitters,
+				                     FVector::Distance(HitLocation, Context.SensorLocation),
+				                     ObjectTypeIndex,
+				                     CurvatureMagnitude,
+				                     SurfaceBRDF,
+				                     SurfaceMaterial,
+				                     RayIndex,
+				                     BounceIndex,
+				                     CachedSourceDirectivities);
+				NewPoint.InstanceIndex = InstanceIndex;
+				Chunk.Statistics.Add(0.0f, CurvatureMagnitude, RayDistanceTotal);
+			}
+		}
+	});
+
+	// Exclusive prefix sum over the chunk sizes gives the write offset of every chunk
+	TArray<int32> ChunkOffsets;
+	ChunkOffsets.SetNumUninitialized(NumChunks);
+	int32 TotalPoints = 0;
+	FSonoTraceUEPointStatistics Statistics;
+	for (int32 ChunkIndex = 0; ChunkIndex < NumChunks; ChunkIndex++)
+	{
+		ChunkOffsets[ChunkIndex] = TotalPoints;
+		TotalPoints += Chunks[ChunkIndex].Points.Num();
+		Statistics.Merge(Chunks[ChunkIndex].Statistics);
+	}
+	OutSubOutput.MaximumCurvature = Statistics.MaximumCurvature;
+	OutSubOutput.MaximumTotalDistance = Statistics.MaximumTotalDistance;
+
+	OutSubOutput.ReflectedPoints.SetNum(TotalPoints);
+	ParallelFor(NumChunks, [&](const int32 ChunkIndex)
+	{
+		TArray<FSonoTraceUEPointStruct>& ChunkPoints = Chunks[ChunkIndex].Points;
+		const int32 Offset = ChunkOffsets[ChunkIndex];
+		for (int32 PointIndex = 0; PointIndex < ChunkPoints.Num(); PointIndex++)
+		{
+			OutSubOutput.ReflectedPoints[Offset + PointIndex] = MoveTemp(ChunkPoints[PointIndex]);
+		}
+	});
+
+	// Hit primitives in scene primitive order, unresolved hits are reported once as INDEX_NONE
+	for (int32 WordIndex = 0; WordIndex < HitWords.Num(); WordIndex++)
+	{
+		for (uint32 Word = static_cast<uint32>(HitWords[WordIndex]); Word != 0; Word &= Word - 1)
+		{
+			const int32 ScenePrimitiveIndex = WordIndex * 32 + static_cast<int32>(FMath::CountTrailingZeros(Word));
+			OutSubOutput.HitPersistentPrimitiveIndexes.Add(Lookup.PersistentPrimitiveIndexes[ScenePrimitiveIndex]);
+			if (OutHitScenePrimitiveIndexes)
+				OutHitScenePrimitiveIndexes->Add(ScenePrimitiveIndex);
+		}
+	}
+	if (UnresolvedHit)
+		OutSubOutput.HitPersistentPrimitiveIndexes.Add(INDEX_NONE);
+
+	TSet<FIntPoint> HitInstances;
+	for (const SonoTraceUEParser::FChunkOutput& Chunk : Chunks)
+	{
+		HitInstances.Append(Chunk.HitInstances);
+	}
+	OutSubOutput.HitInstances = HitInstances.Array();
+	OutSubOutput.HitInstances.Sort([](const FIntPoint& A, const FIntPoint& B) { return A.X < B.X || (A.X == B.X && A.Y < B.Y); });
+}
+
+void FSonoTraceUEParser::ParseDirectPath(const FSonoTraceUEParseContext& Context, TArray<TTuple<bool, FVector>>& OutDirectPathReceiverOutput)
+{
+	if (!Context.RawOutput || !Context.EnableDirectPath)
+		return;
+
+	const int32 NumberOfReceivers = FMath::Min(Context.NumberOfDirectPathRays, Context.ReceiverPoses.Num());
+	OutDirectPathReceiverOutput.SetNum(FMath::Max(OutDirectPathReceiverOutput.Num(), NumberOfReceivers));
+	for (int32 ReceiverIndex = 0; ReceiverIndex < NumberOfReceivers; ReceiverIndex++)
+	{
+		const int32 DataIndex = Context.NumberOfRays * Context.MaximumBounces + ReceiverIndex * Context.MaximumBounces;
+		const FStructuredOutputBufferElem& CurrentRayTracingOutput = Context.RawOutput[DataIndex];
+		const FVector ReceiverLocation = Context.ReceiverPoses[ReceiverIndex].GetLocation();
+		const float DistanceSensorToReceiver = FVector::Distance(ReceiverLocation, Context.SensorLocation);
+		if (CurrentRayTracingOutput.DirectPath == 1 && CurrentRayTracingOutput.IsHit)
+		{
+			if (DistanceSensorToReceiver < Context.MaximumRayDistance * 2)
+			{
+				OutDirectPathReceiverOutput[ReceiverIndex] = TTuple<bool, FVector>(true, ReceiverLocation);
+			}else
+			{
+				OutDirectPathReceiverOutput[ReceiverIndex] = TTuple<bool, FVector>(false, FVector(NAN, NAN,NAN));
+			}
+		}else
+		{
+			const FVector HitLocation = FVector(CurrentRayTracingOutput.HitPosX, CurrentRayTracingOutput.HitPosY, CurrentRayTracingOutput.HitPosZ);
+			if (DistanceSensorToReceiver < CurrentRayTracingOutput.RayDistanceTotal)
+			{
+				OutDirectPathReceiverOutput[ReceiverIndex] = TTuple<bool, FVector>(true, ReceiverLocation);
+			}else
+			{
+				OutDirectPathReceiverOutput[ReceiverIndex] = TTuple<bool, FVector>(false, HitLocation);
+			}
+		}
+	}
+}
@@ -0,0 +1,191 @@
+// By Wouter Jansen & Jan Steckel, Cosys-Lab, University of Antwerp. See the LICENSE file for details.
+
+#include "SonoTraceUEStrengthKernels.h"
+#include "Async/ParallelFor.h"
+
+#if INTEL_ISPC
+#include "SonoTraceUEStrengthKernels.ispc.generated.h"
+#endif
+
+void FSonoTraceUEStrengthKernels::CalculateLogAbsorptions(TConstArrayView<float> Frequencies, TArray<float>& OutLogAbsorptions)
+{
+	// The absorption of air in dB per meter is approximated as 0.038 * f[kHz] - 0.3, as amplitude factor that is 10^(-Alpha * Distance / 20)
+	const double LogTen = FMath::Loge(10.0);
+	OutLogAbsorptions.SetNumUninitialized(Frequencies.Num());
+	for (int32 FrequencyIndex = 0; FrequencyIndex < Frequencies.Num(); FrequencyIndex++)
+	{
+		const double AlphaAbsorption = 0.038 * (Frequencies[FrequencyIndex] / 1000.0) - 0.3;
+		OutLogAbsorptions[FrequencyIndex] = static_cast<float>(-AlphaAbsorption * LogTen / 20.0);
+	}
+}
+
+FSonoTraceUEStrengthKernelResult FSonoTraceUEStrengthKernels::Specular(TArrayView<float> OutStrengths, TConstArrayView<float> ReflectionCosines, TConstArrayView<float> Scales,
+                                                                       TConstArrayView<float> SurfaceBRDF, TConstArrayView<float> SurfaceMaterial, TConstArrayView<float> LogAbsorptions, const float AbsorptionDistance,
+                                                                       TConstArrayView<float> Gains, const float MinimumSummedSquaredStrength)
+{
+	const int32 NumberOfPaths = ReflectionCosines.Num();
+	const int32 NumberOfFrequencies = LogAbsorptions.Num();
+	const int32 NumberOfGainPaths = NumberOfFrequencies > 0 ? Gains.Num() / NumberOfFrequencies : 0;
+	check(Scales.Num() == NumberOfPaths && SurfaceBRDF.Num() >= NumberOfFrequencies && SurfaceMaterial.Num() >= NumberOfFrequencies && OutStrengths.Num() == NumberOfPaths * NumberOfFrequencies);
+#if INTEL_ISPC
+	return MakeResult(ispc::SpecularStrengths(OutStrengths.GetData(), ReflectionCosines.GetData(), Scales.GetData(), NumberOfPaths,
+	                                          SurfaceBRDF.GetData(), SurfaceMaterial.GetData(), LogAbsorptions.GetData(), NumberOfFrequencies, AbsorptionDistance,
+	                                          Gains.GetData(), NumberOfGainPaths), MinimumSummedSquaredStrength);
+#else
+	float SummedSquaredStrength = 0.0f;
+	for (int32 PathIndex = 0; PathIndex < NumberOfPaths; PathIndex++)
+	{
+		const float AngleReflection = FMath::RadiansToDegrees(FMath::Acos(FMath::Clamp(ReflectionCosines[PathIndex], -1.0f, 1.0f)));
+		const float SquaredAngleReflection = AngleReflection * AngleReflection;
+		const float Scale = Scales[PathIndex];
+		const float* PathGains = NumberOfGainPaths > 0 ? Gains.GetData() + (PathIndex % NumberOfGainPaths) * NumberOfFrequencies : nullptr;
+		float* PathStrengths = OutStrengths.GetData() + PathIndex * NumberOfFrequencies;
+		for (int32 FrequencyIndex = 0; FrequencyIndex < NumberOfFrequencies; FrequencyIndex++)
+		{
+			const float BRDF = SurfaceBRDF[FrequencyIndex];
+			const float Exponent = -SquaredAngleReflection / (2.0f * BRDF * BRDF) + LogAbsorptions[FrequencyIndex] * AbsorptionDistance;
+			const float Strength = Scale * SurfaceMaterial[FrequencyIndex] * FMath::Exp(Exponent) * (PathGains ? PathGains[FrequencyIndex] : 1.0f);
+			PathStrengths[FrequencyIndex] = Strength;
+			SummedSquaredStrength += Strength * Strength;
+		}
+	}
+	return MakeResult(SummedSquaredStrength, MinimumSummedSquaredStrength);
+#endif
+}
+
+FSonoTraceUEStrengthKernelResult FSonoTraceUEStrengthKernels::Diffraction(TArrayView<float> OutStrengths, TConstArrayView<float> Distances, TConstArrayView<float> MaterialStrengths, TConstArrayView<float> LogAbsorptions,
+                                                                          TConstArrayView<float> Gains, const float MinimumSummedSquaredStrength)
+{
+	const int32 NumberOfPaths = Distances.Num();
+	const int32 NumberOfFrequencies = LogAbsorptions.Num();
+	const int32 NumberOfGainPaths = NumberOfFrequencies > 0 ? Gains.Num() / NumberOfFrequencies : 0;
+	check(MaterialStrengths.Num() >= NumberOfFrequencies && OutStrengths.Num() == NumberOfPaths * NumberOfFrequencies);
+#if INTEL_ISPC
+	return MakeResult(ispc::DiffractionStrengths(OutStrengths.GetData(), Distances.GetData(), NumberOfPaths, MaterialStrengths.GetData(), LogAbsorptions.GetData(), NumberOfFrequencies,
+	                                             Gains.GetData(), NumberOfGainPaths), MinimumSummedSquaredStrength);
+#else
+	float SummedSquaredStrength = 0.0f;
+	for (int32 PathIndex = 0; PathIndex < NumberOfPaths; PathIndex++)
+	{
+		const float Distance = Distances[PathIndex];
+		const float PathLoss = 1.0f / (Distance * Distance);
+		const float* PathGains = NumberOfGainPaths > 0 ? Gains.GetData() + (PathIndex % NumberOfGainPaths) * NumberOfFrequencies : nullptr;
+		float* PathStrengths = OutStrengths.GetData() + PathIndex * NumberOfFrequencies;
+		for (int32 FrequencyIndex = 0; FrequencyIndex < NumberOfFrequencies; FrequencyIndex++)
+		{
+			const float Strength = MaterialStrengths[FrequencyIndex] * PathLoss * FMath::Exp(LogAbsorptions[FrequencyIndex] * Distance) * (PathGains ? PathGains[FrequencyIndex] : 1.0f);
+			PathStrengths[FrequencyIndex] = Strength;
+			SummedSquaredStrength += Strength * Strength;
+		}
+	}
+	return MakeResult(SummedSquaredStrength, MinimumSummedSquaredStrength);
+#endif
+}
+
+FSonoTraceUEStrengthKernelResult FSonoTraceUEStrengthKernels::DirectPath(TArrayView<float> OutStrengths, TConstArrayView<float> Distances, const float DirectPathStrength, TConstArrayView<float> LogAbsorptions,
+                                                                         TConstArrayView<float> Gains, const float MinimumSummedSquaredStrength)
+{
+	const int32 NumberOfPaths = Distances.Num();
+	const int32 NumberOfFrequencies = LogAbsorptions.Num();
+	const int32 NumberOfGainPaths = NumberOfFrequencies > 0 ? Gains.Num() / NumberOfFrequencies : 0;
+	check(OutStrengths.Num() == NumberOfPaths * NumberOfFrequencies);
+#if INTEL_ISPC
+	return MakeResult(ispc::DirectPathStrengths(OutStrengths.GetData(), Distances.GetData(), NumberOfPaths, DirectPathStrength, LogAbsorptions.GetData(), NumberOfFrequencies,
+	                                            Gains.GetData(), NumberOfGainPaths), MinimumSummedSquaredStrength);
+#else
+	float SummedSquaredStrength = 0.0f;
+	for (int32 PathIndex = 0; PathIndex < NumberOfPaths; PathIndex++)
+	{
+		const float Distance = Distances[PathIndex];
+		float* PathStrengths = OutStrengths.GetData() + PathIndex * NumberOfFrequencies;
+		if (Distance <= 0.0f)
+		{
+			FMemory::Memzero(PathStrengths, NumberOfFrequencies * sizeof(float));
+			continue;
+		}
+		const float Scale = DirectPathStrength / (Distance * Distance);
+		const float* PathGains = NumberOfGainPaths > 0 ? Gains.GetData() + (PathIndex % NumberOfGainPaths) * NumberOfFrequencies : nullptr;
+		for (int32 FrequencyIndex = 0; FrequencyIndex < NumberOfFrequencies; FrequencyIndex++)
+		{
+			const float Strength = Scale * FMath::Exp(LogAbsorptions[FrequencyIndex] * Distance) * (PathGains ? PathGains[FrequencyIndex] : 1.0f);
+			PathStrengths[FrequencyIndex] = Strength;
+			SummedSquaredStrength += Strength * Strength;
+		}
+	}
+	return MakeResult(SummedSquaredStrength, MinimumSummedSquaredStrength);
+#endif
+}
+
+void FSonoTraceUEArrayGainTable::Build(TConstArrayView<FVector> Offsets, TConstArrayView<float> Frequencies, const float SpeedOfSound)
+{
+	NumberOfFrequencies = Frequencies.Num();
+	Gains.SetNumZeroed(NumberOfElevations * NumberOfAzimuths * NumberOfFrequencies);
+	if (Offsets.Num() == 0 || NumberOfFrequencies == 0 || SpeedOfSound <= 0.0f)
+		return;
+
+	// Wave numbers per frequency in radians per meter
+	TArray<double> WaveNumbers;
+	WaveNumbers.SetNumUninitialized(NumberOfFrequencies);
+	for (int32 FrequencyIndex = 0; FrequencyIndex < NumberOfFrequencies; FrequencyIndex++)
+	{
+		WaveNumbers[FrequencyIndex] = 2.0 * UE_DOUBLE_PI * Frequencies[FrequencyIndex] / SpeedOfSound;
+	}
+
+	ParallelFor(NumberOfElevations * NumberOfAzimuths, [&](const int32 DirectionIndex)
+	{
+		const double Elevation = FMath::DegreesToRadians(-90.0 + (DirectionIndex / NumberOfAzimuths) * Resolution);
+		const double Azimuth = FMath::DegreesToRadians(-180.0 + (DirectionIndex % NumberOfAzimuths) * Resolution);
+		const FVector Direction(FMath::Cos(Elevation) * FMath::Cos(Azimuth), FMath::Cos(Elevation) * FMath::Sin(Azimuth), FMath::Sin(Elevation));
+
+		// Path length difference of every virtual receiver toward the direction, in meters
+		TArray<double, TInlineAllocator<128>> PathDifferences;
+		for (const FVector& Offset : Offsets)
+		{
+			PathDifferences.Add(FVector::DotProduct(Offset, Direction) / 100.0);
+		}
+
+		float* DirectionGains = Gains.GetData() + DirectionIndex * NumberOfFrequencies;
+		for (int32 FrequencyIndex = 0; FrequencyIndex < NumberOfFrequencies; FrequencyIndex++)
+		{
+			double Real = 0.0;
+			double Imaginary = 0.0;
+			for (const double PathDifference : PathDifferences)
+			{
+				const double Phase = WaveNumbers[FrequencyIndex] * PathDifference;
+				Real += FMath::Cos(Phase);
+				Imaginary += FMath::Sin(Phase);
+			}
+			DirectionGains[FrequencyIndex] = static_cast<float>(FMath::Sqrt(Real * Real + Imaginary * Imaginary));
+		}
+	});
+}
+
+void FSonoTraceUEArrayGainTable::GetGains(const FVector& LocalDirection, TArrayView<float> OutGains) const
+{
+	check(OutGains.Num() == NumberOfFrequencies);
+	if (!IsValid())
+	{
+		for (float& Gain : OutGains)
+			Gain = 1.0f;
+		return;
+	}
+
+	const FVector Direction = LocalDirection.GetSafeNormal();
+	const float Elevation = (FMath::RadiansToDegrees(FMath::Asin(FMath::Clamp(Direction.Z, -1.0, 1.0))) + 90.0f) / Resolution;
+	const float Azimuth = (FMath::RadiansToDegrees(FMath::Atan2(Direction.Y, Direction.X)) + 180.0f) / Resolution;
+	const int32 Elevation0 = FMath::Clamp(FMath::FloorToInt32(Elevation), 0, NumberOfElevations - 2);
+	const int32 Azimuth0 = FMath::Clamp(FMath::FloorToInt32(Azimuth), 0, NumberOfAzimuths - 2);
+	const float ElevationAlpha = FMath::Clamp(Elevation - Elevation0, 0.0f, 1.0f);
+	const float AzimuthAlpha = FMath::Clamp(Azimuth - Azimuth0, 0.0f, 1.0f);
+
+	const float* Gains00 = Gains.GetData() + (Elevation0 * NumberOfAzimuths + Azimuth0) * NumberOfFrequencies;
+	const float* Gains01 = Gains00 + NumberOfFrequencies;
+	const float* Gains10 = Gains00 + NumberOfAzimuths * NumberOfFrequencies;
+	const float* Gains11 = Gains10 + NumberOfFrequencies;
+	for (int32 FrequencyIndex = 0; FrequencyIndex < NumberOfFrequencies; FrequencyIndex++)
+	{
+		const float Lower = FMath::Lerp(Gains00[FrequencyIndex], Gains01[FrequencyIndex], AzimuthAlpha);
+		const float Upper = FMath::Lerp(Gains10[FrequencyIndex], Gains11[FrequencyIndex], AzimuthAlpha);
+		OutGains[FrequencyIndex] = FMath::Lerp(Lower, Upper, ElevationAlpha);
+	}
+}
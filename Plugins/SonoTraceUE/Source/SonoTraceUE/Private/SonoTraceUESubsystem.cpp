@@ -0,0 +1,782 @@
+// By Wouter Jansen & Jan Steckel, Cosys-Lab, University of Antwerp. See the LICENSE file for details.
+
+#include "SonoTraceUESubsystem.h"
+#include "Engine/World.h"
+#include "SonoTraceCPU.h"
+#include "SonoTraceUEMeshCache.h"
+#include "SonoTraceUEInstanceHierarchy.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "DynamicMesh/DynamicMesh3.h"
+#include "LandscapeProxy.h"
+#include "LandscapeComponent.h"
+
+double FSonoTraceUELandscape::GetTileDistance(const FIntPoint& Tile, const TArray<FVector>& SensorLocations) const
+{
+	const FVector Scale = LandscapeTransform.GetScale3D();
+	const double QuadSize = FMath::Min(FMath::Abs(Scale.X), FMath::Abs(Scale.Y));
+	const FBox2D TileBounds(FVector2D(Tile * TileNumberOfQuads), FVector2D((Tile + FIntPoint(1, 1)) * TileNumberOfQuads));
+	double ClosestDistance = TNumericLimits<double>::Max();
+	for (const FVector& SensorLocation : SensorLocations)
+	{
+		const FVector2D LocalSensorLocation(LandscapeTransform.InverseTransformPosition(SensorLocation));
+		ClosestDistance = FMath::Min(ClosestDistance, FMath::Sqrt(TileBounds.ComputeSquaredDistanceToPoint(LocalSensorLocation)) * QuadSize);
+	}
+	return ClosestDistance;
+}
+
+void USonoTraceUEMeshRegistry::Initialize(USonoTraceUEInputSettingsData* NewInputSettings)
+{
+	InputSettings = NewInputSettings;
+	ObjectSettings = ASonoTraceUEActor::PopulateObjectSettings(InputSettings, &AssetToObjectTypeIndexSettings);
+}
+
+void USonoTraceUEMeshRegistry::Tick()
+{
+	Sensors.RemoveAll([](const TWeakObjectPtr<ASonoTraceUEActor>& Sensor) { return !Sensor.IsValid(); });
+	UpdatePendingMeshData();
+	UpdateInstanceHierarchies();
+	UpdateLandscapeTiles();
+}
+
+void USonoTraceUEMeshRegistry::WaitForReaders() const
+{
+	for (const TWeakObjectPtr<ASonoTraceUEActor>& Sensor : Sensors)
+	{
+		if (Sensor.IsValid())
+			Sensor->WaitForPendingTasks();
+	}
+}
+
+FSonoTraceUEMeshDataSnapshotPtr USonoTraceUEMeshRegistry::PublishMeshData()
+{
+	// Only the pointers are copied, tasks holding the previous snapshot keep the mesh data it points to alive
+	if (MeshDataChanged || !PublishedMeshData.IsValid())
+	{
+		PublishedMeshData = MakeShared<const TArray<FSonoTraceUEMeshDataPtr>, ESPMode::ThreadSafe>(MeshData);
+		MeshDataChanged = false;
+	}
+	return PublishedMeshData;
+}
+
+void USonoTraceUEMeshRegistry::LogMemoryReport() const
+{
+	SIZE_T TotalSize = 0;
+	int32 TotalTriangles = 0;
+	auto LogMeshData = [this, &TotalSize, &TotalTriangles](const UObject* MeshAsset, const int32 MeshDataIndex)
+	{
+		const FSonoTraceUEMeshDataStruct& CurrentMeshData = *MeshData[MeshDataIndex];
+		const int32 NumberOfTriangles = CurrentMeshData.TriangleCurvatureMagnitude.Num();
+		const SIZE_T Size = CurrentMeshData.GetAllocatedSize();
+		UE_LOG(SonoTraceUE, Log, TEXT("Mesh data of '%s': %d triangles, %d diffraction clusters, %.3f MB, %.1f bytes per triangle."), *MeshAsset->GetName(), NumberOfTriangles,
+		       CurrentMeshData.DiffractionClusters.Clusters.Num(), Size / (1024.0 * 1024.0), NumberOfTriangles > 0 ? static_cast<double>(Size) / NumberOfTriangles : 0.0);
+		TotalSize += Size;
+		TotalTriangles += NumberOfTriangles;
+	};
+	for (const TPair<UStaticMesh*, int32>& Entry : StaticMeshToMeshDataIndex)
+	{
+		LogMeshData(Entry.Key, Entry.Value);
+	}
+	for (const TPair<USkeletalMesh*, int32>& Entry : SkeletalMeshToMeshDataIndex)
+	{
+		LogMeshData(Entry.Key, Entry.Value);
+	}
+	SIZE_T SurfaceTablesSize = 0;
+	for (const FSonoTraceUEObjectSettingsStruct& ObjectSetting : ObjectSettings)
+	{
+		SurfaceTablesSize += ObjectSetting.SurfaceTable.GetAllocatedSize();
+	}
+	UE_LOG(SonoTraceUE, Log, TEXT("Mesh data of %d meshes shared by %d sensors: %d triangles, %.3f MB. Surface tables of %d object types: %.3f MB."), StaticMeshToMeshDataIndex.Num() + SkeletalMeshToMeshDataIndex.Num(),
+	       Sensors.Num(), TotalTriangles, TotalSize / (1024.0 * 1024.0), ObjectSettings.Num(), SurfaceTablesSize / (1024.0 * 1024.0));
+	if (!PersistentPrimitiveIndexToInstanceHierarchy.IsEmpty())
+	{
+		SIZE_T InstanceHierarchiesSize = 0;
+		int32 TotalInstances = 0;
+		for (const TPair<int32, FSonoTraceUEInstanceHierarchyPtr>& Entry : PersistentPrimitiveIndexToInstanceHierarchy)
+		{
+			InstanceHierarchiesSize += Entry.Value->GetAllocatedSize();
+			TotalInstances += Entry.Value->Num();
+		}
+		UE_LOG(SonoTraceUE, Log, TEXT("Instance hierarchies of %d instanced objects: %d instances, %.3f MB."), PersistentPrimitiveIndexToInstanceHierarchy.Num(), TotalInstances,
+		       InstanceHierarchiesSize / (1024.0 * 1024.0));
+	}
+	for (const FSonoTraceUELandscape& Landscape : Landscapes)
+	{
+		SIZE_T TilesSize = 0;
+		int32 LoadedTiles = 0;
+		for (const TPair<FIntPoint, FSonoTraceUELandscapeTile>& Tile : Landscape.Tiles)
+		{
+			if (Tile.Value.MeshDataIndex == INDEX_NONE)
+				continue;
+			TilesSize += MeshData[Tile.Value.MeshDataIndex]->GetAllocatedSize();
+			LoadedTiles++;
+		}
+		UE_LOG(SonoTraceUE, Log, TEXT("Mesh data of landscape '%s': %d tiles of %dx%d quads loaded, %.3f MB."), *Landscape.Label.ToString(), LoadedTiles, Landscape.TileNumberOfQuads,
+		       Landscape.TileNumberOfQuads, TilesSize / (1024.0 * 1024.0));
+	}
+}
+
+int32 USonoTraceUEMeshRegistry::AddMeshData(UMeshComponent* MeshComponent, UObject* MeshAsset, const int32 ObjectTypeIndex)
+{
+	const int32 MeshDataIndex = AllocateMeshDataIndex();
+	if (InputSettings->EnableAsyncMeshDataGeneration)
+	{
+		FSonoTraceUEPendingMeshData& Pending = PendingMeshData.AddDefaulted_GetRef();
+		Pending.MeshComponent = MeshComponent;
+		Pending.MeshAsset = MeshAsset;
+		Pending.MeshDataIndex = MeshDataIndex;
+		Pending.ObjectTypeIndex = ObjectTypeIndex;
+		return MeshDataIndex;
+	}
+	const FSonoTraceUEObjectSettingsStruct* MeshObjectSettings = &ObjectSettings[ObjectTypeIndex];
+	TSharedRef<FSonoTraceUEMeshDataStruct, ESPMode::ThreadSafe> NewMeshData = MakeShared<FSonoTraceUEMeshDataStruct, ESPMode::ThreadSafe>();
+	ASonoTraceUEActor::GenerateMeshData(MeshComponent, MeshAsset, InputSettings, MeshObjectSettings, *NewMeshData);
+	if (MeshObjectSettings->DrawDebugFirstOccurrence)
+		DrawMeshDebug(MeshComponent, *NewMeshData, MeshObjectSettings);
+	SetMeshData(MeshDataIndex, NewMeshData);
+	return MeshDataIndex;
+}
+
+int32 USonoTraceUEMeshRegistry::AllocateMeshDataIndex()
+{
+	if (FreeMeshDataIndexes.Num() > 0)
+		return FreeMeshDataIndexes.Pop(EAllowShrinking::No);
+	MeshDataChanged = true;
+	return MeshData.Add(MakeShared<FSonoTraceUEMeshDataStruct, ESPMode::ThreadSafe>());
+}
+
+void USonoTraceUEMeshRegistry::SetMeshData(const int32 MeshDataIndex, FSonoTraceUEMeshDataPtr NewMeshData)
+{
+	MeshData[MeshDataIndex] = MoveTemp(NewMeshData);
+	MeshDataChanged = true;
+}
+
+void USonoTraceUEMeshRegistry::RemoveMeshData(const int32 MeshDataIndex)
+{
+	// A running task reads the input settings, it is finished before its slot can be reused
+	for (int32 PendingIndex = PendingMeshData.Num() - 1; PendingIndex >= 0; PendingIndex--)
+	{
+		if (PendingMeshData[PendingIndex].MeshDataIndex != MeshDataIndex)
+			continue;
+		if (PendingMeshData[PendingIndex].Task.IsValid())
+			PendingMeshData[PendingIndex].Task.Wait();
+		PendingMeshData.RemoveAt(PendingIndex);
+	}
+	SetMeshData(MeshDataIndex, MakeShared<FSonoTraceUEMeshDataStruct, ESPMode::ThreadSafe>());
+	FreeMeshDataIndexes.Add(MeshDataIndex);
+}
+
+void USonoTraceUEMeshRegistry::UpdatePendingMeshData()
+{
+	if (PendingMeshData.IsEmpty())
+		return;
+
+	// Components destroyed before they were removed can't be converted anymore
+	bool ResultsReady = false;
+	for (int32 PendingIndex = PendingMeshData.Num() - 1; PendingIndex >= 0; PendingIndex--)
+	{
+		const FSonoTraceUEPendingMeshData& Pending = PendingMeshData[PendingIndex];
+		if (!Pending.Task.IsValid() && !Pending.MeshComponent.IsValid())
+			PendingMeshData.RemoveAt(PendingIndex);
+		else if (Pending.Task.IsValid() && Pending.Task.IsCompleted())
+			ResultsReady = true;
+	}
+
+	// Finished results replace the empty mesh data of their slot, the tasks of the sensors keep the snapshot they were given
+	if (ResultsReady)
+	{
+		for (int32 PendingIndex = PendingMeshData.Num() - 1; PendingIndex >= 0; PendingIndex--)
+		{
+			FSonoTraceUEPendingMeshData& Pending = PendingMeshData[PendingIndex];
+			if (!Pending.Task.IsValid() || !Pending.Task.IsCompleted())
+				continue;
+			const UObject* MeshAsset = Pending.MeshAsset.Get();
+			const FString MeshName = MeshAsset ? MeshAsset->GetName() : TEXT("None");
+			if (Pending.Result->TriangleCurvatureMagnitude.Num() == 0)
+			{
+				if (Pending.LoadingFromCache)
+				{
+					// Outdated or corrupt cache entry, the mesh is generated instead
+					Pending.Task = UE::Tasks::FTask();
+					Pending.LoadingFromCache = false;
+					Pending.ForceGeneration = true;
+					continue;
+				}
+				UE_LOG(SonoTraceUE, Warning, TEXT("Could not generate mesh data of '%s', the default BRDF and material of its object type are used."), *MeshName);
+			}else
+			{
+				SetMeshData(Pending.MeshDataIndex, Pending.Result);
+				const FSonoTraceUEMeshDataStruct& NewMeshData = *MeshData[Pending.MeshDataIndex];
+				UE_LOG(SonoTraceUE, Verbose, TEXT("%s mesh data of '%s' with %d triangles (%.3f MB)."), Pending.LoadingFromCache ? TEXT("Loaded") : TEXT("Generated"), *MeshName,
+				       NewMeshData.TriangleCurvatureMagnitude.Num(), NewMeshData.GetAllocatedSize() / (1024.0 * 1024.0));
+				const UMeshComponent* MeshComponent = Pending.MeshComponent.Get();
+				if (MeshComponent && ObjectSettings[Pending.ObjectTypeIndex].DrawDebugFirstOccurrence)
+					DrawMeshDebug(MeshComponent, NewMeshData, &ObjectSettings[Pending.ObjectTypeIndex]);
+			}
+			PendingMeshData.RemoveAt(PendingIndex);
+		}
+	}
+
+	// Start the meshes closest to any sensor first, the dynamic mesh conversion runs on the game thread within the time budget
+	const double StartTime = FPlatformTime::Seconds();
+	const int32 MaximumRunningTasks = FMath::Max(1, FTaskGraphInterface::Get().GetNumWorkerThreads());
+	int32 RunningTasks = 0;
+	for (const FSonoTraceUEPendingMeshData& Pending : PendingMeshData)
+	{
+		if (Pending.Task.IsValid())
+			RunningTasks++;
+	}
+	while (RunningTasks < MaximumRunningTasks)
+	{
+		int32 ClosestIndex = INDEX_NONE;
+		double ClosestDistance = TNumericLimits<double>::Max();
+		for (int32 PendingIndex = 0; PendingIndex < PendingMeshData.Num(); PendingIndex++)
+		{
+			const FSonoTraceUEPendingMeshData& Pending = PendingMeshData[PendingIndex];
+			if (Pending.Task.IsValid() || !Pending.MeshComponent.IsValid())
+				continue;
+			for (const TWeakObjectPtr<ASonoTraceUEActor>& Sensor : Sensors)
+			{
+				if (!Sensor.IsValid())
+					continue;
+				const double Distance = FVector::DistSquared(Pending.MeshComponent->Bounds.Origin, Sensor->SensorLocation);
+				if (Distance < ClosestDistance)
+				{
+					ClosestDistance = Distance;
+					ClosestIndex = PendingIndex;
+				}
+			}
+		}
+		if (ClosestIndex == INDEX_NONE)
+			break;
+
+		FSonoTraceUEPendingMeshData& Pending = PendingMeshData[ClosestIndex];
+		TSharedPtr<FSonoTraceUEMeshDataStruct, ESPMode::ThreadSafe> Result = MakeShared<FSonoTraceUEMeshDataStruct, ESPMode::ThreadSafe>();
+		Pending.Result = Result;
+		FSonoTraceUEObjectSettingsStruct MeshObjectSettings = ObjectSettings[Pending.ObjectTypeIndex];
+		FString CacheKey;
+		FString PackKey;
+		if (Pending.MeshAsset.IsValid())
+			ASonoTraceUEActor::GetMeshDataCacheKeys(Pending.MeshAsset.Get(), InputSettings, &MeshObjectSettings, CacheKey, PackKey);
+		if (!Pending.ForceGeneration && FSonoTraceUEMeshCache::Contains(CacheKey, PackKey))
+		{
+			Pending.LoadingFromCache = true;
+			Pending.Task = UE::Tasks::Launch(UE_SOURCE_LOCATION,
+				[Result, CacheKey, PackKey]()
+				{
+					ASonoTraceUEActor::LoadCachedMeshData(CacheKey, PackKey, *Result);
+				}, UE::Tasks::ETaskPriority::BackgroundNormal);
+		}else
+		{
+			TSharedPtr<UE::Geometry::FDynamicMesh3, ESPMode::ThreadSafe> Mesh = MakeShared<UE::Geometry::FDynamicMesh3, ESPMode::ThreadSafe>();
+			ASonoTraceUEActor::CopyMeshFromComponent(Pending.MeshComponent.Get(), *Mesh);
+			const USonoTraceUEInputSettingsData* Settings = InputSettings;
+			Pending.Task = UE::Tasks::Launch(UE_SOURCE_LOCATION,
+				[Result, Mesh, Settings, MeshObjectSettings = MoveTemp(MeshObjectSettings), CacheKey]()
+				{
+					if (Mesh->TriangleCount() > 0)
+						ASonoTraceUEActor::ProcessMeshData(*Mesh, Settings, &MeshObjectSettings, CacheKey, *Result);
+				}, UE::Tasks::ETaskPriority::BackgroundNormal);
+		}
+		RunningTasks++;
+		if ((FPlatformTime::Seconds() - StartTime) * 1000.0 > InputSettings->MeshDataGenerationTimeBudget)
+			break;
+	}
+}
+
+void USonoTraceUEMeshRegistry::WaitForPendingMeshData()
+{
+	for (FSonoTraceUEPendingMeshData& Pending : PendingMeshData)
+	{
+		if (Pending.Task.IsValid())
+			Pending.Task.Wait();
+	}
+	PendingMeshData.Empty();
+	for (FSonoTraceUELandscape& Landscape : Landscapes)
+	{
+		for (TPair<FIntPoint, FSonoTraceUELandscapeTile>& Tile : Landscape.Tiles)
+		{
+			if (Tile.Value.Task.IsValid())
+				Tile.Value.Task.Wait();
+		}
+	}
+}
+
+void USonoTraceUEMeshRegistry::SetScenePrimitiveIndex(const int32 PersistentPrimitiveIndex, const int32 ScenePrimitiveIndex)
+{
+	const TTuple<FName, int32>* ObjectNameAndTypeIndex = PersistentPrimitiveIndexToLabelsAndObjectTypes.Find(PersistentPrimitiveIndex);
+	if (!ObjectNameAndTypeIndex || ScenePrimitiveIndex == INDEX_NONE)
+		return;
+	if (const int32* PreviousScenePrimitiveIndex = PersistentPrimitiveIndexToScenePrimitiveIndex.Find(PersistentPrimitiveIndex))
+	{
+		if (*PreviousScenePrimitiveIndex != ScenePrimitiveIndex)
+			PrimitiveLookup.Remove(*PreviousScenePrimitiveIndex, PersistentPrimitiveIndex);
+	}
+	PersistentPrimitiveIndexToScenePrimitiveIndex.Add(PersistentPrimitiveIndex, ScenePrimitiveIndex);
+	const int32* MeshDataIndex = PersistentPrimitiveIndexToMeshDataIndex.Find(PersistentPrimitiveIndex);
+	const FSonoTraceUEInstanceHierarchyPtr* InstanceHierarchy = PersistentPrimitiveIndexToInstanceHierarchy.Find(PersistentPrimitiveIndex);
+	const FSonoTraceUEHeightfieldPtr* Heightfield = PersistentPrimitiveIndexToHeightfield.Find(PersistentPrimitiveIndex);
+	PrimitiveLookup.Add(ScenePrimitiveIndex, PersistentPrimitiveIndex, ObjectNameAndTypeIndex->Get<0>(), ObjectNameAndTypeIndex->Get<1>(), MeshDataIndex ? *MeshDataIndex : INDEX_NONE,
+	                    InstanceHierarchy ? *InstanceHierarchy : nullptr, Heightfield ? *Heightfield : nullptr);
+}
+
+void USonoTraceUEMeshRegistry::RemoveScenePrimitiveIndex(const int32 PersistentPrimitiveIndex)
+{
+	PersistentPrimitiveIndexToInstanceHierarchy.Remove(PersistentPrimitiveIndex);
+	PersistentPrimitiveIndexToHeightfield.Remove(PersistentPrimitiveIndex);
+	int32 ScenePrimitiveIndex;
+	if (PersistentPrimitiveIndexToScenePrimitiveIndex.RemoveAndCopyValue(PersistentPrimitiveIndex, ScenePrimitiveIndex))
+		PrimitiveLookup.Remove(ScenePrimitiveIndex, PersistentPrimitiveIndex);
+}
+
+void USonoTraceUEMeshRegistry::AddInstanceHierarchy(const int32 PersistentPrimitiveIndex, const UInstancedStaticMeshComponent* MeshComponent)
+{
+	const FSonoTraceUEInstanceHierarchyPtr InstanceHierarchy = FSonoTraceUEInstanceHierarchy::Create(MeshComponent);
+	if (!InstanceHierarchy.IsValid())
+		return;
+	PersistentPrimitiveIndexToInstanceHierarchy.Add(PersistentPrimitiveIndex, InstanceHierarchy);
+	UE_LOG(SonoTraceUE, Verbose, TEXT("Built instance hierarchy of object with PPI #%d with %d instances."), PersistentPrimitiveIndex, InstanceHierarchy->Num());
+}
+
+void USonoTraceUEMeshRegistry::UpdateInstanceHierarchies()
+{
+	// Hierarchies are immutable as the parse tasks may hold them, a changed component gets a new one in the next published lookup
+	TArray<int32> StalePersistentPrimitiveIndexes;
+	for (const TPair<int32, FSonoTraceUEInstanceHierarchyPtr>& PersistentPrimitiveIndexAndHierarchy : PersistentPrimitiveIndexToInstanceHierarchy)
+	{
+		UPrimitiveComponent** PrimitiveComponent = PersistentPrimitiveIndexToPrimitiveComponent.Find(PersistentPrimitiveIndexAndHierarchy.Key);
+		const UInstancedStaticMeshComponent* MeshComponent = PrimitiveComponent ? Cast<UInstancedStaticMeshComponent>(*PrimitiveComponent) : nullptr;
+		if (MeshComponent && !PersistentPrimitiveIndexAndHierarchy.Value->IsUpToDate(MeshComponent))
+			StalePersistentPrimitiveIndexes.Add(PersistentPrimitiveIndexAndHierarchy.Key);
+	}
+	for (const int32 PersistentPrimitiveIndex : StalePersistentPrimitiveIndexes)
+	{
+		AddInstanceHierarchy(PersistentPrimitiveIndex, Cast<UInstancedStaticMeshComponent>(PersistentPrimitiveIndexToPrimitiveComponent.FindChecked(PersistentPrimitiveIndex)));
+		if (const int32* ScenePrimitiveIndex = PersistentPrimitiveIndexToScenePrimitiveIndex.Find(PersistentPrimitiveIndex))
+			SetScenePrimitiveIndex(PersistentPrimitiveIndex, *ScenePrimitiveIndex);
+	}
+}
+
+bool USonoTraceUEMeshRegistry::AddLandscape(ALandscapeProxy* Landscape, const FString& ObjectNamePrefix)
+{
+	if (!Landscape)
+		return false;
+	const FName Label = FName(ObjectNamePrefix + TEXT("_Landscape"));
+	if (Landscapes.ContainsByPredicate([Landscape](const FSonoTraceUELandscape& Existing) { return Existing.Landscape.Get() == Landscape; }))
+	{
+		UE_LOG(SonoTraceUE, Warning, TEXT("Landscape with label '%s' was already added."), *Label.ToString());
+		return false;
+	}
+
+	// Landscapes are matched to their object type on their landscape material
+	int32 ObjectTypeIndex = 0;
+	if (const int32* FoundObjectTypeIndex = AssetToObjectTypeIndexSettings.Find(Landscape->GetLandscapeMaterial()))
+		ObjectTypeIndex = *FoundObjectTypeIndex;
+
+	FSonoTraceUELandscape NewLandscape;
+	NewLandscape.Landscape = Landscape;
+	NewLandscape.Label = Label;
+	NewLandscape.ObjectTypeIndex = ObjectTypeIndex;
+	NewLandscape.LandscapeTransform = Landscape->LandscapeActorToWorld();
+	NewLandscape.TileNumberOfQuads = InputSettings->LandscapeTileSize;
+	NewLandscape.Extent = FIntRect(FIntPoint(MAX_int32), FIntPoint(MIN_int32));
+	for (const ULandscapeComponent* LandscapeComponent : Landscape->LandscapeComponents)
+	{
+		if (!LandscapeComponent)
+			continue;
+		const FIntPoint SectionBase = LandscapeComponent->GetSectionBase();
+		NewLandscape.Extent.Min = NewLandscape.Extent.Min.ComponentMin(SectionBase);
+		NewLandscape.Extent.Max = NewLandscape.Extent.Max.ComponentMax(SectionBase + FIntPoint(LandscapeComponent->ComponentSizeQuads + 1));
+	}
+
+	// Every rendered component of the landscape, including its nanite representation, resolves its hits through the heightfield
+	TArray<UPrimitiveComponent*> PrimitiveComponents;
+	Landscape->GetComponents<UPrimitiveComponent>(PrimitiveComponents);
+	TArray<TPair<int32, int32>> ScenePrimitiveIndexes;
+	for (const UPrimitiveComponent* PrimitiveComponent : PrimitiveComponents)
+	{
+		if (!PrimitiveComponent->SceneProxy)
+			continue;
+		const int32 PersistentPrimitiveIndex = PrimitiveComponent->SceneProxy->GetPrimitiveSceneInfo()->GetPersistentIndex().Index;
+		const int32 ScenePrimitiveIndex = PrimitiveComponent->SceneProxy->GetPrimitiveSceneInfo()->GetIndex();
+		PersistentPrimitiveIndexToLabelsAndObjectTypes.Add(PersistentPrimitiveIndex, TTuple<FName, int32>(Label, ObjectTypeIndex));
+		NewLandscape.PersistentPrimitiveIndexes.Add(PersistentPrimitiveIndex);
+		ScenePrimitiveIndexes.Emplace(PersistentPrimitiveIndex, ScenePrimitiveIndex);
+	}
+	if (NewLandscape.PersistentPrimitiveIndexes.IsEmpty() || NewLandscape.Extent.Min.X > NewLandscape.Extent.Max.X)
+	{
+		UE_LOG(SonoTraceUE, Warning, TEXT("Landscape with label '%s' has no spawned components so could not add."), *Label.ToString());
+		return false;
+	}
+
+	FSonoTraceUELandscape& AddedLandscape = Landscapes.Add_GetRef(MoveTemp(NewLandscape));
+	if (InputSettings->EnableLandscapeTiles)
+		PublishHeightfield(AddedLandscape);
+	for (const TPair<int32, int32>& PersistentPrimitiveIndexAndScenePrimitiveIndex : ScenePrimitiveIndexes)
+	{
+		SetScenePrimitiveIndex(PersistentPrimitiveIndexAndScenePrimitiveIndex.Key, PersistentPrimitiveIndexAndScenePrimitiveIndex.Value);
+	}
+	const FIntPoint ExtentSize = AddedLandscape.Extent.Size() - FIntPoint(1, 1);
+	UE_LOG(SonoTraceUE, Log, TEXT("Added landscape with label '%s' with %d components, %dx%d quads and object type '%s (#%d)'."), *Label.ToString(), AddedLandscape.PersistentPrimitiveIndexes.Num(),
+	       ExtentSize.X, ExtentSize.Y, *ObjectSettings[ObjectTypeIndex].Name.ToString(), ObjectTypeIndex);
+	return true;
+}
+
+bool USonoTraceUEMeshRegistry::RemoveLandscape(const ALandscapeProxy* Landscape)
+{
+	const int32 LandscapeIndex = Landscapes.IndexOfByPredicate([Landscape](const FSonoTraceUELandscape& Existing) { return Existing.Landscape.Get() == Landscape; });
+	if (LandscapeIndex == INDEX_NONE)
+		return false;
+	ReleaseLandscape(LandscapeIndex);
+	return true;
+}
+
+void USonoTraceUEMeshRegistry::ReleaseLandscape(const int32 LandscapeIndex)
+{
+	FSonoTraceUELandscape& Landscape = Landscapes[LandscapeIndex];
+	for (TPair<FIntPoint, FSonoTraceUELandscapeTile>& Tile : Landscape.Tiles)
+	{
+		if (Tile.Value.Task.IsValid())
+			Tile.Value.Task.Wait();
+		if (Tile.Value.MeshDataIndex != INDEX_NONE)
+			RemoveMeshData(Tile.Value.MeshDataIndex);
+		if (Tile.Value.CPUMesh.IsValid())
+			RemoveMeshFromSensors(Tile.Value.CPUMesh.Get());
+	}
+	for (const int32 PersistentPrimitiveIndex : Landscape.PersistentPrimitiveIndexes)
+	{
+		PersistentPrimitiveIndexToLabelsAndObjectTypes.Remove(PersistentPrimitiveIndex);
+		RemoveScenePrimitiveIndex(PersistentPrimitiveIndex);
+	}
+	UE_LOG(SonoTraceUE, Log, TEXT("Removed landscape with label '%s' and %d loaded tiles."), *Landscape.Label.ToString(), Landscape.Tiles.Num());
+	Landscapes.RemoveAt(LandscapeIndex);
+}
+
+void USonoTraceUEMeshRegistry::UpdateLandscapeTiles()
+{
+	for (int32 LandscapeIndex = Landscapes.Num() - 1; LandscapeIndex >= 0; LandscapeIndex--)
+	{
+		if (!Landscapes[LandscapeIndex].Landscape.IsValid())
+			ReleaseLandscape(LandscapeIndex);
+	}
+	if (Landscapes.IsEmpty() || !InputSettings->EnableLandscapeTiles)
+		return;
+	TArray<FVector> SensorLocations;
+	for (const TWeakObjectPtr<ASonoTraceUEActor>& Sensor : Sensors)
+	{
+		if (Sensor.IsValid())
+			SensorLocations.Add(Sensor->SensorLocation);
+	}
+	if (SensorLocations.IsEmpty())
+		return;
+	const double Range = InputSettings->MaximumRayDistance;
+
+	// Tiles are evicted a tile further than they are loaded, so a sensor moving along a tile border does not keep reloading it
+	auto GetEvictionDistance = [Range](const FSonoTraceUELandscape& Landscape)
+	{
+		const FVector Scale = Landscape.LandscapeTransform.GetScale3D();
+		return Range + Landscape.TileNumberOfQuads * FMath::Max(FMath::Abs(Scale.X), FMath::Abs(Scale.Y));
+	};
+	bool TilesChanged = false;
+	int32 RunningTasks = 0;
+	int32 NumberOfTiles = 0;
+	for (const FSonoTraceUELandscape& Landscape : Landscapes)
+	{
+		const double EvictionDistance = GetEvictionDistance(Landscape);
+		for (const TPair<FIntPoint, FSonoTraceUELandscapeTile>& Tile : Landscape.Tiles)
+		{
+			if (Tile.Value.Task.IsValid() && !Tile.Value.Task.IsCompleted())
+				RunningTasks++;
+			else if (Tile.Value.Task.IsValid() || Landscape.GetTileDistance(Tile.Key, SensorLocations) > EvictionDistance)
+				TilesChanged = true;
+		}
+		NumberOfTiles += Landscape.Tiles.Num();
+	}
+
+	// Finished tiles are moved into a mesh data slot and tiles out of range are freed
+	if (TilesChanged)
+	{
+		for (FSonoTraceUELandscape& Landscape : Landscapes)
+		{
+			const double EvictionDistance = GetEvictionDistance(Landscape);
+			bool LandscapeChanged = false;
+			for (TMap<FIntPoint, FSonoTraceUELandscapeTile>::TIterator TileIterator = Landscape.Tiles.CreateIterator(); TileIterator; ++TileIterator)
+			{
+				FSonoTraceUELandscapeTile& Tile = TileIterator.Value();
+				if (Tile.Task.IsValid() && !Tile.Task.IsCompleted())
+					continue;
+				if (Landscape.GetTileDistance(TileIterator.Key(), SensorLocations) > EvictionDistance)
+				{
+					if (Tile.MeshDataIndex != INDEX_NONE)
+						RemoveMeshData(Tile.MeshDataIndex);
+					if (Tile.CPUMesh.IsValid())
+						RemoveMeshFromSensors(Tile.CPUMesh.Get());
+					UE_LOG(SonoTraceUE, Verbose, TEXT("Evicted tile (%d, %d) of landscape '%s'."), TileIterator.Key().X, TileIterator.Key().Y, *Landscape.Label.ToString());
+					TileIterator.RemoveCurrent();
+					NumberOfTiles--;
+					LandscapeChanged = true;
+					continue;
+				}
+				if (Tile.Task.IsValid())
+				{
+					Tile.MeshDataIndex = AllocateMeshDataIndex();
+					SetMeshData(Tile.MeshDataIndex, MoveTemp(Tile.Result));
+					Tile.Task = UE::Tasks::FTask();
+					// Landscapes are not traced as meshes by the CPU raytracing backend, the loaded tiles are its ground
+					if (Tile.CPUMesh.IsValid())
+						AddMeshToSensors(Tile.CPUMesh, Landscape.GetTileTransform(), Landscape.PersistentPrimitiveIndexes[0]);
+					UE_LOG(SonoTraceUE, Verbose, TEXT("Generated tile (%d, %d) of landscape '%s' (%.3f MB)."), TileIterator.Key().X, TileIterator.Key().Y, *Landscape.Label.ToString(),
+					       MeshData[Tile.MeshDataIndex]->GetAllocatedSize() / (1024.0 * 1024.0));
+					LandscapeChanged = true;
+				}
+			}
+			if (LandscapeChanged)
+				PublishHeightfield(Landscape);
+		}
+	}
+
+	// Missing tiles in range of any sensor, closest first
+	struct FTileRequest
+	{
+		int32 LandscapeIndex;
+		FIntPoint Tile;
+		double Distance;
+	};
+	TArray<FTileRequest> TileRequests;
+	for (int32 LandscapeIndex = 0; LandscapeIndex < Landscapes.Num(); LandscapeIndex++)
+	{
+		const FSonoTraceUELandscape& Landscape = Landscapes[LandscapeIndex];
+		const FVector Scale = Landscape.LandscapeTransform.GetScale3D();
+		const double RangeInQuads = Range / FMath::Min(FMath::Abs(Scale.X), FMath::Abs(Scale.Y));
+		const int32 TileSize = Landscape.TileNumberOfQuads;
+		const FIntPoint FirstLandscapeTile = FSonoTraceUEHeightfield::GetTile(FVector2D(Landscape.Extent.Min), TileSize);
+		const FIntPoint LastLandscapeTile = FSonoTraceUEHeightfield::GetTile(FVector2D(Landscape.Extent.Max - FIntPoint(2, 2)), TileSize);
+		TSet<FIntPoint> RequestedTiles;
+		for (const FVector& SensorLocation : SensorLocations)
+		{
+			const FVector2D LocalSensorLocation(Landscape.LandscapeTransform.InverseTransformPosition(SensorLocation));
+			const FIntPoint FirstTile = FSonoTraceUEHeightfield::GetTile(LocalSensorLocation - FVector2D(RangeInQuads), TileSize).ComponentMax(FirstLandscapeTile);
+			const FIntPoint LastTile = FSonoTraceUEHeightfield::GetTile(LocalSensorLocation + FVector2D(RangeInQuads), TileSize).ComponentMin(LastLandscapeTile);
+			for (int32 TileY = FirstTile.Y; TileY <= LastTile.Y; TileY++)
+			{
+				for (int32 TileX = FirstTile.X; TileX <= LastTile.X; TileX++)
+				{
+					const FIntPoint Tile(TileX, TileY);
+					if (Landscape.Tiles.Contains(Tile) || RequestedTiles.Contains(Tile))
+						continue;
+					const double Distance = Landscape.GetTileDistance(Tile, SensorLocations);
+					if (Distance > Range)
+						continue;
+					RequestedTiles.Add(Tile);
+					TileRequests.Add({LandscapeIndex, Tile, Distance});
+				}
+			}
+		}
+	}
+	TileRequests.Sort([](const FTileRequest& A, const FTileRequest& B) { return A.Distance < B.Distance; });
+
+	// The heights are sampled on the game thread within the time budget, the mesh data is generated in background tasks
+	const double StartTime = FPlatformTime::Seconds();
+	const int32 MaximumRunningTasks = FMath::Max(1, FTaskGraphInterface::Get().GetNumWorkerThreads());
+	const bool UseCPUBackend = InputSettings->EnableRaytracing && InputSettings->RaytracingBackend == ESonoTraceUERaytracingBackendEnum::CPU;
+	for (const FTileRequest& TileRequest : TileRequests)
+	{
+		if (RunningTasks >= MaximumRunningTasks || NumberOfTiles >= InputSettings->MaximumLandscapeTiles)
+			break;
+		FSonoTraceUELandscape& Landscape = Landscapes[TileRequest.LandscapeIndex];
+		const ALandscapeProxy* LandscapeProxy = Landscape.Landscape.Get();
+		const int32 TileSize = Landscape.TileNumberOfQuads;
+		const FVector Scale = Landscape.LandscapeTransform.GetScale3D();
+		const FIntPoint FirstVertex = TileRequest.Tile * TileSize;
+		FSonoTraceUEHeightfieldTileSamples Samples;
+		Samples.Init(TileSize, FVector2D(FirstVertex) * FVector2D(Scale.X, Scale.Y), FVector2D(Scale.X, Scale.Y));
+		for (int32 Y = -1; Y <= TileSize + 1; Y++)
+		{
+			for (int32 X = -1; X <= TileSize + 1; X++)
+			{
+				const FIntPoint Vertex = FirstVertex + FIntPoint(X, Y);
+				if (!Landscape.Extent.Contains(Vertex))
+					continue;
+				const FVector WorldVertex = Landscape.LandscapeTransform.TransformPosition(FVector(Vertex.X, Vertex.Y, 0.0));
+				const TOptional<float> Height = LandscapeProxy->GetHeightAtLocation(WorldVertex);
+				if (!Height.IsSet())
+					continue;
+				const int32 SampleIndex = Samples.GetSampleIndex(X, Y);
+				Samples.Heights[SampleIndex] = Landscape.LandscapeTransform.InverseTransformPosition(FVector(WorldVertex.X, WorldVertex.Y, Height.GetValue())).Z * Scale.Z;
+				Samples.Valid[SampleIndex] = 1;
+			}
+		}
+
+		FSonoTraceUELandscapeTile& NewTile = Landscape.Tiles.Add(TileRequest.Tile);
+		TSharedPtr<FSonoTraceUEMeshDataStruct, ESPMode::ThreadSafe> Result = MakeShared<FSonoTraceUEMeshDataStruct, ESPMode::ThreadSafe>();
+		NewTile.Result = Result;
+		if (UseCPUBackend)
+			NewTile.CPUMesh = MakeShared<FSonoTraceCPUMesh, ESPMode::ThreadSafe>();
+		const float CurvatureScale = InputSettings->CurvatureScale;
+		NewTile.Task = UE::Tasks::Launch(UE_SOURCE_LOCATION,
+			[Result, CPUMesh = NewTile.CPUMesh, Samples = MoveTemp(Samples), CurvatureScale, TileObjectSettings = ObjectSettings[Landscape.ObjectTypeIndex]]()
+			{
+				Samples.CalculateMeshData(CurvatureScale, *Result);
+				// All triangles of a landscape have the same size, so all of them can be diffraction points
+				ASonoTraceUEActor::GenerateBRDFAndMaterial(&TileObjectSettings, Result.Get(), TNumericLimits<float>::Max());
+				if (CPUMesh.IsValid())
+				{
+					TArray<FVector3f> Vertices;
+					TArray<FIntVector> Triangles;
+					Samples.GetTriangles(Vertices, Triangles);
+					CPUMesh->Build(Vertices, Triangles);
+				}
+			}, UE::Tasks::ETaskPriority::BackgroundNormal);
+		RunningTasks++;
+		NumberOfTiles++;
+		if ((FPlatformTime::Seconds() - StartTime) * 1000.0 > InputSettings->MeshDataGenerationTimeBudget)
+			break;
+	}
+}
+
+void USonoTraceUEMeshRegistry::PublishHeightfield(FSonoTraceUELandscape& Landscape)
+{
+	// Heightfields are immutable as the parse tasks may hold them, every change of the loaded tiles publishes a new one
+	TSharedPtr<FSonoTraceUEHeightfield, ESPMode::ThreadSafe> Heightfield = MakeShared<FSonoTraceUEHeightfield, ESPMode::ThreadSafe>();
+	Heightfield->LandscapeTransform = Landscape.LandscapeTransform;
+	Heightfield->TileNumberOfQuads = Landscape.TileNumberOfQuads;
+	for (const TPair<FIntPoint, FSonoTraceUELandscapeTile>& Tile : Landscape.Tiles)
+	{
+		if (Tile.Value.MeshDataIndex != INDEX_NONE)
+			Heightfield->TileMeshDataIndexes.Add(Tile.Key, Tile.Value.MeshDataIndex);
+	}
+	Landscape.Heightfield = Heightfield;
+	for (const int32 PersistentPrimitiveIndex : Landscape.PersistentPrimitiveIndexes)
+	{
+		PersistentPrimitiveIndexToHeightfield.Add(PersistentPrimitiveIndex, Landscape.Heightfield);
+		if (const int32* ScenePrimitiveIndex = PersistentPrimitiveIndexToScenePrimitiveIndex.Find(PersistentPrimitiveIndex))
+			SetScenePrimitiveIndex(PersistentPrimitiveIndex, *ScenePrimitiveIndex);
+	}
+}
+
+void USonoTraceUEMeshRegistry::ResolveScenePrimitive(const int32 ScenePrimitiveIndex, const int32 PersistentPrimitiveIndex, const FName Label, const FName ResourceName)
+{
+	if (PersistentPrimitiveIndexToLabelsAndObjectTypes.Contains(PersistentPrimitiveIndex))
+	{
+		UE_LOG(SonoTraceUE, Verbose, TEXT("Moved object with PPI #%d to SPI #%d."), PersistentPrimitiveIndex, ScenePrimitiveIndex);
+	}else
+	{
+		PersistentPrimitiveIndexToLabelsAndObjectTypes.Add(PersistentPrimitiveIndex, TTuple<FName, int32>(Label, 0));
+		UE_LOG(SonoTraceUE, Log, TEXT("Added unknown object with PPI #%d, SPI #%d and label '%s' using resource '%s' and object type 'default (#0)'."),
+		       PersistentPrimitiveIndex, ScenePrimitiveIndex, *Label.ToString(), *ResourceName.ToString());
+	}
+	SetScenePrimitiveIndex(PersistentPrimitiveIndex, ScenePrimitiveIndex);
+}
+
+void USonoTraceUEMeshRegistry::MoveScenePrimitive(const int32 PersistentPrimitiveIndex, const int32 ScenePrimitiveIndex)
+{
+	// The current SPI was looked up on the render thread for an object that was no longer found at its SPI in the lookup
+	const int32* PreviousScenePrimitiveIndex = PersistentPrimitiveIndexToScenePrimitiveIndex.Find(PersistentPrimitiveIndex);
+	if (!PreviousScenePrimitiveIndex || *PreviousScenePrimitiveIndex == ScenePrimitiveIndex)
+		return;
+	UE_LOG(SonoTraceUE, Verbose, TEXT("Resynchronized SPI of object with PPI #%d from SPI #%d to SPI #%d."), PersistentPrimitiveIndex, *PreviousScenePrimitiveIndex, ScenePrimitiveIndex);
+	if (ScenePrimitiveIndex == INDEX_NONE)
+		RemoveScenePrimitiveIndex(PersistentPrimitiveIndex);
+	else
+		SetScenePrimitiveIndex(PersistentPrimitiveIndex, ScenePrimitiveIndex);
+}
+
+void USonoTraceUEMeshRegistry::AddMeshComponentToSensors(UMeshComponent* MeshComponent, const UObject* MeshAsset, const int32 PersistentPrimitiveIndex) const
+{
+	for (const TWeakObjectPtr<ASonoTraceUEActor>& Sensor : Sensors)
+	{
+		if (Sensor.IsValid() && Sensor->SonoTrace.IsUsingCPUBackend())
+			Sensor->SonoTrace.GetCPUBackend()->AddMeshComponent(MeshComponent, MeshAsset, PersistentPrimitiveIndex);
+	}
+}
+
+void USonoTraceUEMeshRegistry::RemoveMeshComponentFromSensors(const UMeshComponent* MeshComponent) const
+{
+	for (const TWeakObjectPtr<ASonoTraceUEActor>& Sensor : Sensors)
+	{
+		if (Sensor.IsValid() && Sensor->SonoTrace.IsUsingCPUBackend())
+			Sensor->SonoTrace.GetCPUBackend()->RemoveMeshComponent(MeshComponent);
+	}
+}
+
+void USonoTraceUEMeshRegistry::AddMeshToSensors(const FSonoTraceCPUMeshPtr& Mesh, const FTransform& Transform, const int32 PersistentPrimitiveIndex) const
+{
+	for (const TWeakObjectPtr<ASonoTraceUEActor>& Sensor : Sensors)
+	{
+		if (Sensor.IsValid() && Sensor->SonoTrace.IsUsingCPUBackend())
+			Sensor->SonoTrace.GetCPUBackend()->AddMesh(Mesh, Transform, PersistentPrimitiveIndex);
+	}
+}
+
+void USonoTraceUEMeshRegistry::RemoveMeshFromSensors(const FSonoTraceCPUMesh* Mesh) const
+{
+	for (const TWeakObjectPtr<ASonoTraceUEActor>& Sensor : Sensors)
+	{
+		if (Sensor.IsValid() && Sensor->SonoTrace.IsUsingCPUBackend())
+			Sensor->SonoTrace.GetCPUBackend()->RemoveMesh(Mesh);
+	}
+}
+
+void USonoTraceUEMeshRegistry::DrawMeshDebug(const UMeshComponent* MeshComponent, const FSonoTraceUEMeshDataStruct& NewMeshData, const FSonoTraceUEObjectSettingsStruct* MeshObjectSettings) const
+{
+	// The mesh data is drawn once, by the first sensor
+	for (const TWeakObjectPtr<ASonoTraceUEActor>& Sensor : Sensors)
+	{
+		if (Sensor.IsValid())
+		{
+			Sensor->DrawMeshDebug(MeshComponent, NewMeshData, MeshObjectSettings);
+			return;
+		}
+	}
+}
+
+void USonoTraceUESubsystem::Deinitialize()
+{
+	for (const TPair<TObjectPtr<USonoTraceUEInputSettingsData>, TObjectPtr<USonoTraceUEMeshRegistry>>& Registry : Registries)
+	{
+		Registry.Value->WaitForReaders();
+		Registry.Value->WaitForPendingMeshData();
+	}
+	Registries.Empty();
+	Super::Deinitialize();
+}
+
+void USonoTraceUESubsystem::Tick(float DeltaTime)
+{
+	for (const TPair<TObjectPtr<USonoTraceUEInputSettingsData>, TObjectPtr<USonoTraceUEMeshRegistry>>& Registry : Registries)
+	{
+		Registry.Value->Tick();
+	}
+}
+
+TStatId USonoTraceUESubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(USonoTraceUESubsystem, STATGROUP_Tickables);
+}
+
+USonoTraceUEMeshRegistry* USonoTraceUESubsystem::RegisterSensor(ASonoTraceUEActor* Sensor, USonoTraceUEInputSettingsData* InputSettings)
+{
+	TObjectPtr<USonoTraceUEMeshRegistry>& MeshRegistry = Registries.FindOrAdd(InputSettings);
+	if (!MeshRegistry)
+	{
+		MeshRegistry = NewObject<USonoTraceUEMeshRegistry>(this);
+		MeshRegistry->Initialize(InputSettings);
+		UE_LOG(SonoTraceUE, Log, TEXT("Created mesh registry for input settings '%s'."), *InputSettings->GetName());
+	}
+	MeshRegistry->Sensors.AddUnique(Sensor);
+	UE_LOG(SonoTraceUE, Log, TEXT("Sensor '%s' uses the mesh registry of input settings '%s' with %d sensors."), *Sensor->GetName(), *InputSettings->GetName(), MeshRegistry->Sensors.Num());
+	return MeshRegistry;
+}
+
+void USonoTraceUESubsystem::UnregisterSensor(ASonoTraceUEActor* Sensor, USonoTraceUEMeshRegistry* MeshRegistry)
+{
+	if (!MeshRegistry)
+		return;
+	MeshRegistry->Sensors.Remove(Sensor);
+	MeshRegistry->Sensors.RemoveAll([](const TWeakObjectPtr<ASonoTraceUEActor>& CurrentSensor) { return !CurrentSensor.IsValid(); });
+	if (MeshRegistry->Sensors.IsEmpty())
+	{
+		MeshRegistry->WaitForPendingMeshData();
+		Registries.Remove(MeshRegistry->InputSettings);
+		UE_LOG(SonoTraceUE, Log, TEXT("Released mesh registry for input settings '%s'."), MeshRegistry->InputSettings ? *MeshRegistry->InputSettings->GetName() : TEXT("None"));
+	}
+}
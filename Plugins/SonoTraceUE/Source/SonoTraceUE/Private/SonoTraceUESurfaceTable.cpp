@@ -0,0 +1,49 @@
+// By Wouter Jansen & Jan Steckel, Cosys-Lab, University of Antwerp. See the LICENSE file for details.
+
+#include "SonoTraceUESurfaceTable.h"
+#include "SonoTraceUEActor.h"
+
+void FSonoTraceUESurfaceTable::Build(const FSonoTraceUEObjectSettingsStruct& ObjectSettings)
+{
+	// A slope of 1 feels "natural" but is too slow in material transition.
+	// It should be 8 or 10 or so.
+	// Therefore, this factor is added.
+	constexpr float SigmoidSlopeMultiplier = 8;
+
+	// A sigmoid is within 1e-4 of its end value at 9.2 / slope from its transition position
+	auto SaturatedCurvature = [](const float TransitionPosition, const float TransitionSlope)
+	{
+		const float Slope = FMath::Abs(SigmoidSlopeMultiplier * TransitionSlope);
+		return Slope > 0.0f ? TransitionPosition + 10.0f / Slope : TransitionPosition;
+	};
+	MaximumCurvatureMagnitude = FMath::Max3(SaturatedCurvature(ObjectSettings.BrdfTransitionPosition, ObjectSettings.BrdfTransitionSlope),
+	                                        SaturatedCurvature(ObjectSettings.MaterialsTransitionPosition, ObjectSettings.MaterialsTransitionSlope), UE_KINDA_SMALL_NUMBER);
+	LevelsPerCurvature = (NumberOfLevels - 1) / MaximumCurvatureMagnitude;
+
+	const int32 NumberOfFrequencies = ObjectSettings.BrdfExponentsDiffraction.Num();
+	BRDF.SetNum(NumberOfLevels);
+	Material.SetNum(NumberOfLevels);
+	for (int32 Level = 0; Level < NumberOfLevels; Level++)
+	{
+		const float CurvatureMagnitude = Level / LevelsPerCurvature;
+		BRDF[Level].SetNumUninitialized(NumberOfFrequencies);
+		Material[Level].SetNumUninitialized(NumberOfFrequencies);
+		for (int32 FrequencyIndex = 0; FrequencyIndex < NumberOfFrequencies; FrequencyIndex++)
+		{
+			BRDF[Level][FrequencyIndex] = ASonoTraceUEActor::SigmoidMix(CurvatureMagnitude, SigmoidSlopeMultiplier * ObjectSettings.BrdfTransitionSlope, ObjectSettings.BrdfTransitionPosition,
+			                                                            ObjectSettings.BrdfExponentsDiffraction[FrequencyIndex], ObjectSettings.BrdfExponentsSpecular[FrequencyIndex]);
+			Material[Level][FrequencyIndex] = ASonoTraceUEActor::SigmoidMix(CurvatureMagnitude, SigmoidSlopeMultiplier * ObjectSettings.MaterialsTransitionSlope, ObjectSettings.MaterialsTransitionPosition,
+			                                                                ObjectSettings.MaterialStrengthsDiffraction[FrequencyIndex], ObjectSettings.MaterialStrengthsSpecular[FrequencyIndex]);
+		}
+	}
+}
+
+SIZE_T FSonoTraceUESurfaceTable::GetAllocatedSize() const
+{
+	SIZE_T Size = BRDF.GetAllocatedSize() + Material.GetAllocatedSize();
+	for (int32 Level = 0; Level < BRDF.Num(); Level++)
+	{
+		Size += BRDF[Level].GetAllocatedSize() + Material[Level].GetAllocatedSize();
+	}
+	return Size;
+}
@@ -0,0 +1,370 @@
+// By Wouter Jansen & Jan Steckel, Cosys-Lab, University of Antwerp. See the LICENSE file for details.
+
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+#include "SonoTraceCPU.h"
+
+namespace SonoTraceCPUTest
+{
+	// Triangle of the scene in world space, traced by the brute force reference
+	struct FReferenceTriangle
+	{
+		FVector V0, V1, V2;
+		FVector Normal;
+		int32 ScenePrimitiveIndex;
+		int32 TriangleIndex;
+	};
+
+	struct FReferenceHit
+	{
+		double HitT = -1.0;
+		// All triangles within the distance tolerance of the closest hit, rays on a shared edge can hit either of them
+		TArray<const FReferenceTriangle*> Triangles;
+	};
+
+	constexpr double DistanceTolerance = 0.05;
+	constexpr double SelfIntersectionEpsilon = 1e-3;
+
+	// Möller-Trumbore in double precision
+	bool IntersectTriangle(const FReferenceTriangle& Triangle, const FVector& Origin, const FVector& Direction, double& OutT)
+	{
+		const FVector E1 = Triangle.V1 - Triangle.V0;
+		const FVector E2 = Triangle.V2 - Triangle.V0;
+		const FVector P = FVector::CrossProduct(Direction, E2);
+		const double Determinant = FVector::DotProduct(E1, P);
+		if (FMath::Abs(Determinant) < 1e-12)
+			return false;
+		const FVector T = Origin - Triangle.V0;
+		const double U = FVector::DotProduct(T, P) / Determinant;
+		if (U < 0.0 || U > 1.0)
+			return false;
+		const FVector Q = FVector::CrossProduct(T, E1);
+		const double V = FVector::DotProduct(Direction, Q) / Determinant;
+		if (V < 0.0 || U + V > 1.0)
+			return false;
+		OutT = FVector::DotProduct(E2, Q) / Determinant;
+		return true;
+	}
+
+	FReferenceHit TraceClosestReference(const TArray<FReferenceTriangle>& Triangles, const FVector& Origin, const FVector& Direction, const double TMin, const double TMax, const bool CullBackFacing)
+	{
+		TArray<TPair<double, const FReferenceTriangle*>> Hits;
+		for (const FReferenceTriangle& Triangle : Triangles)
+		{
+			if (CullBackFacing && FVector::DotProduct(Direction, Triangle.Normal) > 0.0)
+				continue;
+			double T;
+			if (IntersectTriangle(Triangle, Origin, Direction, T) && T > TMin && T < TMax)
+				Hits.Add({T, &Triangle});
+		}
+		FReferenceHit Hit;
+		for (const TPair<double, const FReferenceTriangle*>& CandidateHit : Hits)
+		{
+			if (Hit.HitT < 0 || CandidateHit.Key < Hit.HitT)
+				Hit.HitT = CandidateHit.Key;
+		}
+		for (const TPair<double, const FReferenceTriangle*>& CandidateHit : Hits)
+		{
+			if (CandidateHit.Key - Hit.HitT < DistanceTolerance)
+				Hit.Triangles.Add(CandidateHit.Value);
+		}
+		return Hit;
+	}
+
+	bool TraceAnyReference(const TArray<FReferenceTriangle>& Triangles, const FVector& Origin, const FVector& Direction, const double TMin, const double TMax)
+	{
+		for (const FReferenceTriangle& Triangle : Triangles)
+		{
+			double T;
+			if (IntersectTriangle(Triangle, Origin, Direction, T) && T > TMin && T < TMax)
+				return true;
+		}
+		return false;
+	}
+
+	FVector GetWindingNormal(const FVector& V0, const FVector& V1, const FVector& V2)
+	{
+		return FVector::CrossProduct(V2 - V0, V1 - V0).GetSafeNormal();
+	}
+
+	// Adds a mesh to the CPU backend and its world space triangles to the reference
+	void AddMesh(FSonoTraceCPU& Backend, TArray<FReferenceTriangle>& ReferenceTriangles, const TArray<FVector3f>& Vertices, const TArray<FIntVector>& Triangles,
+				 const FTransform& Transform, const int32 PersistentPrimitiveIndex, const int32 ScenePrimitiveIndex)
+	{
+		const TSharedPtr<FSonoTraceCPUMesh, ESPMode::ThreadSafe> Mesh = MakeShared<FSonoTraceCPUMesh, ESPMode::ThreadSafe>();
+		Mesh->Build(Vertices, Triangles);
+		Backend.AddMesh(Mesh, Transform, PersistentPrimitiveIndex);
+		for (int32 TriangleIndex = 0; TriangleIndex < Triangles.Num(); TriangleIndex++)
+		{
+			FReferenceTriangle& ReferenceTriangle = ReferenceTriangles.AddDefaulted_GetRef();
+			ReferenceTriangle.V0 = Transform.TransformPosition(FVector(Vertices[Triangles[TriangleIndex].X]));
+			ReferenceTriangle.V1 = Transform.TransformPosition(FVector(Vertices[Triangles[TriangleIndex].Y]));
+			ReferenceTriangle.V2 = Transform.TransformPosition(FVector(Vertices[Triangles[TriangleIndex].Z]));
+			ReferenceTriangle.Normal = GetWindingNormal(ReferenceTriangle.V0, ReferenceTriangle.V1, ReferenceTriangle.V2);
+			ReferenceTriangle.ScenePrimitiveIndex = ScenePrimitiveIndex;
+			ReferenceTriangle.TriangleIndex = TriangleIndex;
+		}
+	}
+
+	// Orients every triangle so its winding normal points towards the given position
+	void OrientTowards(const TArray<FVector3f>& Vertices, TArray<FIntVector>& Triangles, const FVector3f& Position)
+	{
+		for (FIntVector& Triangle : Triangles)
+		{
+			const FVector3f Centroid = (Vertices[Triangle.X] + Vertices[Triangle.Y] + Vertices[Triangle.Z]) / 3.0f;
+			if (FVector3f::DotProduct(FSonoTraceCPUMesh::GetWindingNormal(Vertices[Triangle.X], Vertices[Triangle.Y], Vertices[Triangle.Z]), Position - Centroid) < 0.0f)
+				Swap(Triangle.Y, Triangle.Z);
+		}
+	}
+
+	bool MatchesReference(const FReferenceHit& ReferenceHit, const FStructuredOutputBufferElem& Output, const double HitT)
+	{
+		if (FMath::Abs(HitT - ReferenceHit.HitT) > DistanceTolerance)
+			return false;
+		return ReferenceHit.Triangles.ContainsByPredicate([&Output](const FReferenceTriangle* Triangle)
+		{
+			return Triangle->ScenePrimitiveIndex == Output.HitScenePrimitiveIndex && Triangle->TriangleIndex == Output.HitTriangleIndex;
+		});
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(SonoTraceCPU_Tests, "SonoTraceUE.CPUBackend.Test", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::SmokeFilter)
+
+bool SonoTraceCPU_Tests::RunTest(const FString& Parameters)
+{
+	using namespace SonoTraceCPUTest;
+	FRandomStream RandomStream(1234);
+
+	// BVH: every primitive is referenced once and every node contains its children
+	{
+		TArray<FBox3f> PrimitiveBounds;
+		for (int32 PrimitiveIndex = 0; PrimitiveIndex < 500; PrimitiveIndex++)
+		{
+			const FVector3f Center(RandomStream.FRandRange(-100.0f, 100.0f), RandomStream.FRandRange(-100.0f, 100.0f), RandomStream.FRandRange(-100.0f, 100.0f));
+			PrimitiveBounds.Add(FBox3f(Center - FVector3f(RandomStream.FRandRange(0.1f, 5.0f)), Center + FVector3f(RandomStream.FRandRange(0.1f, 5.0f))));
+		}
+		FSonoTraceBVH BVH;
+		BVH.Build(PrimitiveBounds, 4);
+		TArray<int32> SortedOrder = BVH.PrimitiveOrder;
+		SortedOrder.Sort();
+		bool IsPermutation = SortedOrder.Num() == PrimitiveBounds.Num();
+		for (int32 Index = 0; IsPermutation && Index < SortedOrder.Num(); Index++)
+		{
+			IsPermutation = SortedOrder[Index] == Index;
+		}
+		TestTrue(TEXT("check every primitive is in the BVH once"), IsPermutation);
+
+		int32 ContainmentErrors = 0;
+		int32 LeafPrimitives = 0;
+		for (const FSonoTraceBVHNode& Node : BVH.Nodes)
+		{
+			const FBox3f NodeBounds(Node.BoundsMin, Node.BoundsMax);
+			if (Node.Count > 0)
+			{
+				LeafPrimitives += Node.Count;
+				for (int32 OrderIndex = Node.FirstIndex; OrderIndex < Node.FirstIndex + Node.Count; OrderIndex++)
+				{
+					ContainmentErrors += NodeBounds.ExpandBy(1e-3f).IsInside(PrimitiveBounds[BVH.PrimitiveOrder[OrderIndex]]) ? 0 : 1;
+				}
+			}else
+			{
+				for (const int32 ChildIndex : {Node.FirstIndex, Node.FirstIndex + 1})
+				{
+					const FSonoTraceBVHNode& Child = BVH.Nodes[ChildIndex];
+					ContainmentErrors += NodeBounds.ExpandBy(1e-3f).IsInside(FBox3f(Child.BoundsMin, Child.BoundsMax)) ? 0 : 1;
+				}
+			}
+		}
+		TestEqual(TEXT("check the leaves hold every primitive"), LeafPrimitives, PrimitiveBounds.Num());
+		TestEqual(TEXT("check node bounds contain their children"), ContainmentErrors, 0);
+	}
+
+	// Scene: a closed room facing inwards, a mesh of small triangles in random orientations placed twice and a quad facing away from the sensor
+	FSonoTraceCPU Backend;
+	TArray<FReferenceTriangle> ReferenceTriangles;
+	TMap<int32, int32> PersistentPrimitiveIndexToScenePrimitiveIndex;
+	PersistentPrimitiveIndexToScenePrimitiveIndex.Add(10, 3);
+	PersistentPrimitiveIndexToScenePrimitiveIndex.Add(11, 7);
+	PersistentPrimitiveIndexToScenePrimitiveIndex.Add(12, 9);
+	{
+		TArray<FVector3f> Vertices;
+		for (int32 Corner = 0; Corner < 8; Corner++)
+		{
+			Vertices.Add(FVector3f(Corner & 1 ? 500.0f : -500.0f, Corner & 2 ? 500.0f : -500.0f, Corner & 4 ? 500.0f : -500.0f));
+		}
+		TArray<FIntVector> Triangles = {
+			{0, 1, 3}, {0, 3, 2}, {4, 5, 7}, {4, 7, 6}, {0, 1, 5}, {0, 5, 4},
+			{2, 3, 7}, {2, 7, 6}, {0, 2, 6}, {0, 6, 4}, {1, 3, 7}, {1, 7, 5}};
+		OrientTowards(Vertices, Triangles, FVector3f::ZeroVector);
+		AddMesh(Backend, ReferenceTriangles, Vertices, Triangles, FTransform::Identity, 10, 3);
+	}
+	{
+		TArray<FVector3f> Vertices;
+		TArray<FIntVector> Triangles;
+		for (int32 TriangleIndex = 0; TriangleIndex < 200; TriangleIndex++)
+		{
+			FVector3f Center;
+			do
+			{
+				Center = FVector3f(RandomStream.FRandRange(-350.0f, 350.0f), RandomStream.FRandRange(-350.0f, 350.0f), RandomStream.FRandRange(-350.0f, 350.0f));
+			} while (Center.Size() < 80.0f);
+			const int32 FirstVertex = Vertices.Num();
+			for (int32 VertexIndex = 0; VertexIndex < 3; VertexIndex++)
+			{
+				Vertices.Add(Center + FVector3f(RandomStream.VRand()) * RandomStream.FRandRange(10.0f, 40.0f));
+			}
+			Triangles.Add(FIntVector(FirstVertex, FirstVertex + 1, FirstVertex + 2));
+		}
+		AddMesh(Backend, ReferenceTriangles, Vertices, Triangles, FTransform::Identity, 11, 7);
+		// Second instance of the same mesh, rotated and scaled
+		const FTransform Transform(FRotator(30.0f, 45.0f, 10.0f), FVector(20.0f, -30.0f, 10.0f), FVector(0.8f));
+		AddMesh(Backend, ReferenceTriangles, Vertices, Triangles, Transform, 11, 7);
+	}
+	{
+		// Quad straight in front of the sensor, wound so it faces away from it
+		const TArray<FVector3f> Vertices = {{60.0f, -20.0f, -20.0f}, {60.0f, 20.0f, -20.0f}, {60.0f, 20.0f, 20.0f}, {60.0f, -20.0f, 20.0f}};
+		TArray<FIntVector> Triangles = {{0, 1, 2}, {0, 2, 3}};
+		OrientTowards(Vertices, Triangles, FVector3f(100.0f, 0.0f, 0.0f));
+		AddMesh(Backend, ReferenceTriangles, Vertices, Triangles, FTransform::Identity, 12, 9);
+	}
+	TestEqual(TEXT("check the instanced mesh is stored once per instance"), Backend.GetInstanceCount(), 4);
+
+	// Rays in random directions, the first one straight through the back of the quad
+	FSonoTraceParameters TraceParameters;
+	const int32 NumberOfRays = 256;
+	TraceParameters.DistributionAzimuthAngles.Add(0.0f);
+	TraceParameters.DistributionElevationAngles.Add(0.0f);
+	for (int32 RayIndex = 1; RayIndex < NumberOfRays; RayIndex++)
+	{
+		TraceParameters.DistributionAzimuthAngles.Add(RandomStream.FRandRange(-PI, PI));
+		TraceParameters.DistributionElevationAngles.Add(FMath::Asin(RandomStream.FRandRange(-1.0f, 1.0f)));
+	}
+	TraceParameters.NumDistributionRays = NumberOfRays;
+	TraceParameters.SensorPosition = FVector::ZeroVector;
+	TraceParameters.SensorRotation = FRotator::ZeroRotator;
+	TraceParameters.EmitterPositions.Add(FVector(10.0f, 0.0f, 0.0f));
+	TraceParameters.EmitterCount = 1;
+	TraceParameters.MaxTraceDistance = 5000.0f;
+	TraceParameters.MaxBounces = 4;
+	// Direct paths in random directions, inside the closed room they always end on a surface
+	TraceParameters.EnableDirectPath = true;
+	for (int32 DirectPathIndex = 0; DirectPathIndex < 16; DirectPathIndex++)
+	{
+		TraceParameters.DirectPathAzimuthAngles.Add(RandomStream.FRandRange(-PI, PI));
+		TraceParameters.DirectPathElevationAngles.Add(FMath::Asin(RandomStream.FRandRange(-1.0f, 1.0f)));
+	}
+
+	TArray<FStructuredOutputBufferElem> OutputBuffer;
+	Backend.Trace(TraceParameters, PersistentPrimitiveIndexToScenePrimitiveIndex, OutputBuffer);
+	const int32 MaxBounces = TraceParameters.MaxBounces;
+	TestEqual(TEXT("check output size"), OutputBuffer.Num(), (NumberOfRays + TraceParameters.DirectPathAzimuthAngles.Num()) * MaxBounces);
+
+	auto GetRayDirection = [&TraceParameters](const int32 RayIndex)
+	{
+		const bool IsDirectPath = RayIndex >= static_cast<int32>(TraceParameters.NumDistributionRays);
+		const int32 AngleIndex = IsDirectPath ? RayIndex - TraceParameters.NumDistributionRays : RayIndex;
+		const double Azimuth = IsDirectPath ? TraceParameters.DirectPathAzimuthAngles[AngleIndex] : TraceParameters.DistributionAzimuthAngles[AngleIndex];
+		const double Elevation = IsDirectPath ? TraceParameters.DirectPathElevationAngles[AngleIndex] : TraceParameters.DistributionElevationAngles[AngleIndex];
+		return FVector(FMath::Cos(Elevation) * FMath::Cos(Azimuth), FMath::Cos(Elevation) * FMath::Sin(Azimuth), FMath::Sin(Elevation));
+	};
+
+	// Every bounce is compared against the brute force closest hit from where the previous bounce of the backend left off
+	int32 ClosestHitErrors = 0, ReflectionErrors = 0, LineOfSightErrors = 0, TerminationErrors = 0, Hits = 0, LineOfSightBlocked = 0;
+	for (int32 RayIndex = 0; RayIndex < NumberOfRays; RayIndex++)
+	{
+		FVector Origin = TraceParameters.SensorPosition;
+		FVector Direction = GetRayDirection(RayIndex);
+		double TotalDistance = 0.0;
+		for (int32 BounceIndex = 0; BounceIndex < MaxBounces; BounceIndex++)
+		{
+			const FStructuredOutputBufferElem& Output = OutputBuffer[RayIndex * MaxBounces + BounceIndex];
+			const FReferenceHit ReferenceHit = TraceClosestReference(ReferenceTriangles, Origin, Direction, BounceIndex == 0 ? 0.0 : SelfIntersectionEpsilon, TraceParameters.MaxTraceDistance, true);
+			if (ReferenceHit.HitT < 0 || !Output.IsHit)
+			{
+				TerminationErrors += (ReferenceHit.HitT < 0) != !Output.IsHit ? 1 : 0;
+				break;
+			}
+			Hits++;
+			const FVector HitPosition(Output.HitPosX, Output.HitPosY, Output.HitPosZ);
+			const double HitT = Output.RayDistanceTotal - TotalDistance;
+			ClosestHitErrors += MatchesReference(ReferenceHit, Output, HitT) && HitPosition.Equals(Origin + Direction * ReferenceHit.HitT, DistanceTolerance * 2.0) ? 0 : 1;
+
+			const FVector Reflection(Output.HitReflectionX, Output.HitReflectionY, Output.HitReflectionZ);
+			const bool ReflectionMatches = ReferenceHit.Triangles.ContainsByPredicate([&](const FReferenceTriangle* Triangle)
+			{
+				return Reflection.Equals(Direction - 2.0 * FVector::DotProduct(Direction, Triangle->Normal) * Triangle->Normal, 1e-3);
+			});
+			ReflectionErrors += ReflectionMatches ? 0 : 1;
+
+			if (BounceIndex > 0)
+			{
+				const FVector ToSensor = TraceParameters.SensorPosition - HitPosition;
+				const bool ReferenceLineOfSight = !TraceAnyReference(ReferenceTriangles, HitPosition, ToSensor.GetSafeNormal(), SelfIntersectionEpsilon, ToSensor.Size());
+				LineOfSightErrors += ReferenceLineOfSight != Output.HitLineOfSightToSensor ? 1 : 0;
+				LineOfSightBlocked += ReferenceLineOfSight ? 0 : 1;
+			}else
+			{
+				LineOfSightErrors += Output.HitLineOfSightToSensor ? 0 : 1;
+			}
+
+			TotalDistance = Output.RayDistanceTotal;
+			Origin = HitPosition;
+			Direction = Reflection;
+		}
+	}
+	TestTrue(TEXT("check the rays hit the scene"), Hits > NumberOfRays);
+	TestTrue(TEXT("check some reflections are occluded from the sensor"), LineOfSightBlocked > 0);
+	TestEqual(TEXT("check closest hits match the reference"), ClosestHitErrors, 0);
+	TestEqual(TEXT("check reflections match the winding normal of the reference"), ReflectionErrors, 0);
+	TestEqual(TEXT("check line of sight matches the reference"), LineOfSightErrors, 0);
+	TestEqual(TEXT("check rays end where the reference misses"), TerminationErrors, 0);
+
+	// The ray through the back of the quad is culled and continues to the room
+	TestNotEqual(TEXT("check back faces are culled"), OutputBuffer[0].HitScenePrimitiveIndex, 9);
+	TestTrue(TEXT("check the culled ray hits behind the quad"), OutputBuffer[0].HitPosX > 60.0f);
+
+	// Direct paths are not culled and report a hit when nothing is in the way
+	int32 DirectPathErrors = 0;
+	for (int32 DirectPathIndex = 0; DirectPathIndex < TraceParameters.DirectPathAzimuthAngles.Num(); DirectPathIndex++)
+	{
+		const int32 RayIndex = NumberOfRays + DirectPathIndex;
+		const FStructuredOutputBufferElem& Output = OutputBuffer[RayIndex * MaxBounces];
+		const FReferenceHit ReferenceHit = TraceClosestReference(ReferenceTriangles, TraceParameters.SensorPosition, GetRayDirection(RayIndex), 0.0, TraceParameters.MaxTraceDistance, false);
+		DirectPathErrors += Output.DirectPath == 1 ? 0 : 1;
+		DirectPathErrors += Output.IsHit == (ReferenceHit.HitT < 0) ? 0 : 1;
+		if (ReferenceHit.HitT >= 0)
+			DirectPathErrors += FMath::IsNearlyEqual(Output.RayDistanceTotal, ReferenceHit.HitT, DistanceTolerance) ? 0 : 1;
+		for (int32 BounceIndex = 1; BounceIndex < MaxBounces; BounceIndex++)
+		{
+			DirectPathErrors += OutputBuffer[RayIndex * MaxBounces + BounceIndex].IsHit ? 1 : 0;
+		}
+	}
+	TestEqual(TEXT("check direct paths match the reference"), DirectPathErrors, 0);
+
+	// A direct path straight through the back of the quad is blocked
+	FSonoTraceParameters BlockedParameters = TraceParameters;
+	BlockedParameters.DirectPathAzimuthAngles = {0.0f};
+	BlockedParameters.DirectPathElevationAngles = {0.0f};
+	Backend.Trace(BlockedParameters, PersistentPrimitiveIndexToScenePrimitiveIndex, OutputBuffer);
+	TestFalse(TEXT("check back faces block the direct path"), OutputBuffer[NumberOfRays * MaxBounces].IsHit);
+	TestTrue(TEXT("check the direct path stops at the quad"), FMath::IsNearlyEqual(OutputBuffer[NumberOfRays * MaxBounces].RayDistanceTotal, 60.0f, 0.01f));
+
+	// Within a shorter trace distance nothing is in the way
+	FSonoTraceParameters ClearParameters = BlockedParameters;
+	ClearParameters.MaxTraceDistance = 50.0f;
+	Backend.Trace(ClearParameters, PersistentPrimitiveIndexToScenePrimitiveIndex, OutputBuffer);
+	TestTrue(TEXT("check an unobstructed direct path is a hit"), OutputBuffer[NumberOfRays * MaxBounces].IsHit);
+	TestEqual(TEXT("check an unobstructed direct path has no distance"), OutputBuffer[NumberOfRays * MaxBounces].RayDistanceTotal, -1.0f);
+
+	// Objects that are not in the SPI map are traced as unresolved
+	PersistentPrimitiveIndexToScenePrimitiveIndex.Remove(10);
+	Backend.Trace(BlockedParameters, PersistentPrimitiveIndexToScenePrimitiveIndex, OutputBuffer);
+	bool HasUnresolvedHit = false;
+	for (int32 RayIndex = 0; RayIndex < NumberOfRays; RayIndex++)
+	{
+		HasUnresolvedHit |= OutputBuffer[RayIndex * MaxBounces].IsHit && OutputBuffer[RayIndex * MaxBounces].HitScenePrimitiveIndex == -1;
+	}
+	TestTrue(TEXT("check hits on objects without SPI are unresolved"), HasUnresolvedHit);
+
+	return true;
+}
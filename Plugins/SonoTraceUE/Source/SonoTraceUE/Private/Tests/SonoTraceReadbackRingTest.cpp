@@ -0,0 +1,118 @@
+// By Wouter Jansen & Jan Steckel, Cosys-Lab, University of Antwerp. See the LICENSE file for details.
+
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+#include "SonoTrace.h"
+
+namespace SonoTraceReadbackRingTest
+{
+	// Readback that becomes ready when the test says so, every element is tagged with the value it was filled with
+	class FMockReadback : public ISonoTraceReadback
+	{
+	public:
+		virtual bool IsReady() override { return Ready; }
+		virtual uint32 GetSizeBytes() override { return Buffer.Num() * sizeof(FStructuredOutputBufferElem); }
+		virtual bool CopyTo(void* Destination, const uint32 NumBytes) override
+		{
+			FMemory::Memcpy(Destination, Buffer.GetData(), NumBytes);
+			return true;
+		}
+
+		void Fill(const int32 Tag, const int32 NumElements)
+		{
+			Buffer.SetNumZeroed(NumElements);
+			for (FStructuredOutputBufferElem& Element : Buffer)
+			{
+				Element.HitScenePrimitiveIndex = Tag;
+			}
+			Ready = true;
+		}
+
+		bool Ready = false;
+		TArray<FStructuredOutputBufferElem> Buffer;
+	};
+
+	FSonoTraceFrameInfo MakeFrameInfo(const uint64 ExecutionCounter)
+	{
+		FSonoTraceFrameInfo FrameInfo;
+		FrameInfo.ExecutionCounter = ExecutionCounter;
+		FrameInfo.SensorLocation = FVector(ExecutionCounter, 0, 0);
+		FrameInfo.OverrideEmitterSignalIndexes.Add(static_cast<int32>(ExecutionCounter));
+		return FrameInfo;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(SonoTraceReadbackRing_Tests, "SonoTraceUE.ReadbackRing.Test", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::SmokeFilter)
+
+bool SonoTraceReadbackRing_Tests::RunTest(const FString& Parameters)
+{
+	using namespace SonoTraceReadbackRingTest;
+
+	TArray<TUniquePtr<ISonoTraceReadback>> Readbacks;
+	TArray<FMockReadback*> MockReadbacks;
+	for (int32 SlotIndex = 0; SlotIndex < 3; SlotIndex++)
+	{
+		TUniquePtr<FMockReadback> Readback = MakeUnique<FMockReadback>();
+		MockReadbacks.Add(Readback.Get());
+		Readbacks.Add(MoveTemp(Readback));
+	}
+	FSonoTraceReadbackRing ReadbackRing(MoveTemp(Readbacks));
+	TArray<FStructuredOutputBufferElem> Buffer;
+	FSonoTraceFrameInfo FrameInfo;
+
+	{
+		TestEqual(TEXT("check slot count"), ReadbackRing.Num(), 3);
+		TestEqual(TEXT("check nothing in flight"), ReadbackRing.NumInFlight(), 0);
+		TestFalse(TEXT("check empty ring is not ready"), ReadbackRing.IsOldestReady());
+		TestFalse(TEXT("check empty ring delivers nothing"), ReadbackRing.PopReady(Buffer, FrameInfo));
+	}
+
+	{
+		// Fill the ring, a fourth trace has to wait for a free slot
+		TestTrue(TEXT("check trace 1 started"), ReadbackRing.BeginTrace(MakeFrameInfo(1)) == MockReadbacks[0]);
+		TestTrue(TEXT("check trace 2 started"), ReadbackRing.BeginTrace(MakeFrameInfo(2)) == MockReadbacks[1]);
+		TestTrue(TEXT("check trace 3 started"), ReadbackRing.BeginTrace(MakeFrameInfo(3)) == MockReadbacks[2]);
+		TestFalse(TEXT("check ring is full"), ReadbackRing.HasFreeSlot());
+		TestTrue(TEXT("check trace 4 rejected"), ReadbackRing.BeginTrace(MakeFrameInfo(4)) == nullptr);
+		TestEqual(TEXT("check three in flight"), ReadbackRing.NumInFlight(), 3);
+	}
+
+	{
+		// Younger traces finishing first must not overtake the oldest one
+		MockReadbacks[1]->Fill(2, 8);
+		MockReadbacks[2]->Fill(3, 8);
+		TestFalse(TEXT("check oldest trace not ready"), ReadbackRing.IsOldestReady());
+		TestFalse(TEXT("check out of order result is held back"), ReadbackRing.PopReady(Buffer, FrameInfo));
+
+		MockReadbacks[0]->Fill(1, 8);
+		TestTrue(TEXT("check oldest trace ready"), ReadbackRing.IsOldestReady());
+		TestTrue(TEXT("check trace 1 delivered"), ReadbackRing.PopReady(Buffer, FrameInfo));
+		TestEqual(TEXT("check trace 1 counter"), FrameInfo.ExecutionCounter, static_cast<uint64>(1));
+		TestEqual(TEXT("check trace 1 data"), Buffer[0].HitScenePrimitiveIndex, 1);
+		TestEqual(TEXT("check trace 1 buffer size"), Buffer.Num(), 8);
+		TestEqual(TEXT("check trace 1 pose"), FrameInfo.SensorLocation.X, 1.0);
+		TestEqual(TEXT("check trace 1 override"), FrameInfo.OverrideEmitterSignalIndexes[0], 1);
+		TestTrue(TEXT("check slot freed"), ReadbackRing.HasFreeSlot());
+	}
+
+	{
+		// The freed slot is reused after the ones still in flight
+		MockReadbacks[0]->Ready = false;
+		TestTrue(TEXT("check trace 4 started in freed slot"), ReadbackRing.BeginTrace(MakeFrameInfo(4)) == MockReadbacks[0]);
+
+		TestTrue(TEXT("check trace 2 delivered"), ReadbackRing.PopReady(Buffer, FrameInfo));
+		TestEqual(TEXT("check trace 2 counter"), FrameInfo.ExecutionCounter, static_cast<uint64>(2));
+		TestEqual(TEXT("check trace 2 data"), Buffer[0].HitScenePrimitiveIndex, 2);
+		TestTrue(TEXT("check trace 3 delivered"), ReadbackRing.PopReady(Buffer, FrameInfo));
+		TestEqual(TEXT("check trace 3 counter"), FrameInfo.ExecutionCounter, static_cast<uint64>(3));
+		TestFalse(TEXT("check trace 4 not ready"), ReadbackRing.PopReady(Buffer, FrameInfo));
+
+		MockReadbacks[0]->Fill(4, 4);
+		TestTrue(TEXT("check trace 4 delivered"), ReadbackRing.PopReady(Buffer, FrameInfo));
+		TestEqual(TEXT("check trace 4 counter"), FrameInfo.ExecutionCounter, static_cast<uint64>(4));
+		TestEqual(TEXT("check trace 4 buffer size"), Buffer.Num(), 4);
+		TestEqual(TEXT("check nothing in flight after draining"), ReadbackRing.NumInFlight(), 0);
+	}
+
+	return true;
+}
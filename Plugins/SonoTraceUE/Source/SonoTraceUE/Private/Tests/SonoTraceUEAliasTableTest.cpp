@@ -0,0 +1,110 @@
+// By Wouter Jansen & Jan Steckel, Cosys-Lab, University of Antwerp. See the LICENSE file for details.
+
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+#include "SonoTraceUEActor.h"
+#include "SonoTraceUEAliasTable.h"
+#include "Algo/BinarySearch.h"
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(SonoTraceUEAliasTable_Tests, "SonoTraceUE.AliasTable.Test", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::SmokeFilter)
+
+bool SonoTraceUEAliasTable_Tests::RunTest(const FString& Parameters)
+{
+	FRandomStream RandomStream(1234);
+
+	{
+		// The sampled frequencies have to follow the weights, zero weights are never drawn
+		const TArray<float> Weights = {1.0f, 0.0f, 3.0f, 0.5f, 0.0f, 2.5f, 1.0f, 2.0f};
+		float TotalWeight = 0.0f;
+		for (const float Weight : Weights)
+			TotalWeight += Weight;
+
+		FSonoTraceUEAliasTable AliasTable;
+		AliasTable.Build(Weights);
+		TestEqual(TEXT("check table size"), AliasTable.Num(), Weights.Num());
+
+		const int32 NumberOfSamples = 40000;
+		TArray<int32> Counts;
+		Counts.SetNumZeroed(Weights.Num());
+		for (int32 SampleIndex = 0; SampleIndex < NumberOfSamples; SampleIndex++)
+		{
+			Counts[AliasTable.Sample(RandomStream.FRand(), RandomStream.FRand())]++;
+		}
+		for (int32 Index = 0; Index < Weights.Num(); Index++)
+		{
+			const float Expected = Weights[Index] / TotalWeight;
+			const float Measured = static_cast<float>(Counts[Index]) / NumberOfSamples;
+			TestTrue(FString::Printf(TEXT("check frequency of index %d (expected %.4f, got %.4f)"), Index, Expected, Measured), FMath::Abs(Expected - Measured) < 0.015f);
+		}
+		TestEqual(TEXT("check zero weight never drawn"), Counts[1] + Counts[4], 0);
+	}
+
+	{
+		FSonoTraceUEAliasTable AliasTable;
+		AliasTable.Build(TArray<float>({0.0f, 0.0f, 0.0f, 0.0f}));
+		int32 Mismatches = 0;
+		for (int32 Index = 0; Index < AliasTable.Num(); Index++)
+		{
+			if (AliasTable.Probabilities[Index] != 1.0f)
+				Mismatches++;
+		}
+		TestEqual(TEXT("check all zero weights are uniform"), Mismatches, 0);
+		TestEqual(TEXT("check last bin at upper bound"), AliasTable.Sample(1.0f, 0.5f), 3);
+
+		AliasTable.Build(TArray<float>());
+		TestFalse(TEXT("check empty table invalid"), AliasTable.IsValid());
+	}
+
+	return true;
+}
+
+// Sampling a large mesh with the alias table against a CDF searched by bisection, the reference of the old linear scan
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(SonoTraceUEAliasTable_PerfTests, "SonoTraceUE.AliasTable.Perf", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::PerfFilter)
+
+bool SonoTraceUEAliasTable_PerfTests::RunTest(const FString& Parameters)
+{
+	FRandomStream RandomStream(1234);
+
+	{
+		// Diffraction-like sample counts from a large mesh
+		const int32 NumberOfTriangles = 200000;
+		const int32 NumberOfSamples = 50000;
+		TArray<float> Weights;
+		for (int32 Index = 0; Index < NumberOfTriangles; Index++)
+		{
+			Weights.Add(FMath::Pow(RandomStream.FRand(), 4.0f) + 0.000005f);
+		}
+
+		double StartTime = FPlatformTime::Seconds();
+		TArray<float> CDF;
+		float CumulativeSum = 0.0f;
+		for (const float Weight : Weights)
+		{
+			CumulativeSum += Weight;
+			CDF.Add(CumulativeSum);
+		}
+		int32 CDFChecksum = 0;
+		for (int32 SampleIndex = 0; SampleIndex < NumberOfSamples; SampleIndex++)
+		{
+			CDFChecksum += Algo::LowerBound(CDF, RandomStream.FRand() * CumulativeSum) & 1;
+		}
+		const double CDFTime = FPlatformTime::Seconds() - StartTime;
+
+		StartTime = FPlatformTime::Seconds();
+		FSonoTraceUEAliasTable AliasTable;
+		AliasTable.Build(Weights);
+		const double BuildTime = FPlatformTime::Seconds() - StartTime;
+
+		StartTime = FPlatformTime::Seconds();
+		int32 AliasChecksum = 0;
+		for (int32 SampleIndex = 0; SampleIndex < NumberOfSamples; SampleIndex++)
+		{
+			AliasChecksum += AliasTable.Sample(RandomStream.FRand(), RandomStream.FRand()) & 1;
+		}
+		const double AliasTime = FPlatformTime::Seconds() - StartTime;
+		AddInfo(FString::Printf(TEXT("Drew %d samples from %d triangles. CDF per measurement: %.5fs, alias table build: %.5fs, alias sampling: %.5fs (checksums %d, %d)"),
+			NumberOfSamples, NumberOfTriangles, CDFTime, BuildTime, AliasTime, CDFChecksum, AliasChecksum));
+	}
+
+	return true;
+}
@@ -0,0 +1,117 @@
+// By Wouter Jansen & Jan Steckel, Cosys-Lab, University of Antwerp. See the LICENSE file for details.
+
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+#include "SonoTraceUEActor.h"
+#include "SonoTraceUECompaction.h"
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(SonoTraceUECompaction_Tests, "SonoTraceUE.Compaction.Test", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::SmokeFilter)
+
+bool SonoTraceUECompaction_Tests::RunTest(const FString& Parameters)
+{
+	const int32 NumberOfElements = 5000;
+
+	FRandomStream RandomStream(1234);
+	TArray<int32> Elements;
+	TArray<uint8> KeepMask;
+	for (int32 Index = 0; Index < NumberOfElements; Index++)
+	{
+		Elements.Add(Index);
+		KeepMask.Add(RandomStream.FRand() > 0.7f ? 1 : 0);
+	}
+
+	{
+		TArray<int32> ReferenceElements;
+		for (int32 Index = 0; Index < NumberOfElements; Index++)
+		{
+			if (KeepMask[Index])
+				ReferenceElements.Add(Elements[Index]);
+		}
+
+		TArray<int32> CompactedElements = Elements;
+		const int32 NumKept = SonoTraceUECompaction::Compact(CompactedElements, KeepMask);
+		TestEqual(TEXT("check kept count"), NumKept, ReferenceElements.Num());
+		TestTrue(TEXT("check compacted order"), CompactedElements == ReferenceElements);
+	}
+
+	{
+		// Every third point has no strength tensor block, the blocks of removed points have to be dropped and the indexes remapped
+		FSonoTraceUESubOutputStruct SubOutput;
+		SubOutput.StrengthTensor.Reset(2, 3, 4);
+		const int32 NumberOfPoints = 1000;
+		TArray<uint8> PointKeepMask;
+		TArray<float> ReferenceFirstStrengths;
+		for (int32 PointIndex = 0; PointIndex < NumberOfPoints; PointIndex++)
+		{
+			FSonoTraceUEPointStruct Point;
+			Point.Index = PointIndex;
+			if (PointIndex % 3 != 0)
+			{
+				Point.StrengthTensorIndex = SubOutput.StrengthTensor.AddBlocks(1);
+				SubOutput.StrengthTensor.GetStrengths(Point.StrengthTensorIndex, 1, 2)[3] = PointIndex;
+				SubOutput.StrengthTensor.GetTotalDistanceToReceiver(Point.StrengthTensorIndex, 1, 2) = PointIndex;
+			}
+			const bool Keep = PointIndex % 2 == 0;
+			PointKeepMask.Add(Keep ? 1 : 0);
+			if (Keep && Point.StrengthTensorIndex != INDEX_NONE)
+				ReferenceFirstStrengths.Add(PointIndex);
+			SubOutput.ReflectedPoints.Add(Point);
+			SubOutput.ReflectedStrengths.Add(PointIndex);
+		}
+
+		SubOutput.Compact(PointKeepMask);
+		TestEqual(TEXT("check compacted point count"), SubOutput.ReflectedPoints.Num(), NumberOfPoints / 2);
+		TestEqual(TEXT("check compacted strength count"), SubOutput.ReflectedStrengths.Num(), NumberOfPoints / 2);
+		TestEqual(TEXT("check compacted block count"), SubOutput.StrengthTensor.NumBlocks(), ReferenceFirstStrengths.Num());
+
+		int32 Mismatches = 0;
+		for (const FSonoTraceUEPointStruct& Point : SubOutput.ReflectedPoints)
+		{
+			if (Point.Index % 2 != 0 || SubOutput.ReflectedStrengths[Point.Index / 2] != Point.Index)
+				Mismatches++;
+			if (Point.StrengthTensorIndex != INDEX_NONE
+				&& (SubOutput.StrengthTensor.GetStrengths(Point.StrengthTensorIndex, 1, 2)[3] != Point.Index || SubOutput.StrengthTensor.GetTotalDistanceToReceiver(Point.StrengthTensorIndex, 1, 2) != Point.Index))
+				Mismatches++;
+			if ((Point.StrengthTensorIndex == INDEX_NONE) != (Point.Index % 3 == 0))
+				Mismatches++;
+		}
+		TestEqual(TEXT("check compacted points and blocks"), Mismatches, 0);
+	}
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(SonoTraceUECompaction_PerfTests, "SonoTraceUE.Compaction.Perf", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::PerfFilter)
+
+bool SonoTraceUECompaction_PerfTests::RunTest(const FString& Parameters)
+{
+	// Filtering a large point set with RemoveAt in a reverse loop, the old approach, against the compaction
+	const int32 NumberOfElements = 50000;
+
+	FRandomStream RandomStream(1234);
+	TArray<int32> Elements;
+	TArray<uint8> KeepMask;
+	for (int32 Index = 0; Index < NumberOfElements; Index++)
+	{
+		Elements.Add(Index);
+		KeepMask.Add(RandomStream.FRand() > 0.7f ? 1 : 0);
+	}
+
+	double StartTime = FPlatformTime::Seconds();
+	TArray<int32> RemovedElements = Elements;
+	for (int32 Index = NumberOfElements - 1; Index >= 0; --Index)
+	{
+		if (!KeepMask[Index])
+			RemovedElements.RemoveAt(Index);
+	}
+	const double RemoveTime = FPlatformTime::Seconds() - StartTime;
+
+	StartTime = FPlatformTime::Seconds();
+	TArray<int32> CompactedElements = Elements;
+	SonoTraceUECompaction::Compact(CompactedElements, KeepMask);
+	const double CompactTime = FPlatformTime::Seconds() - StartTime;
+	AddInfo(FString::Printf(TEXT("Filtered %d elements. RemoveAt: %.5fs, compaction: %.5fs"), NumberOfElements, RemoveTime, CompactTime));
+	TestTrue(TEXT("check same result as RemoveAt"), CompactedElements == RemovedElements);
+
+	return true;
+}
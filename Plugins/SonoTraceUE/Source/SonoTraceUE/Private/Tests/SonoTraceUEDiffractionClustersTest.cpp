@@ -0,0 +1,124 @@
+// By Wouter Jansen & Jan Steckel, Cosys-Lab, University of Antwerp. See the LICENSE file for details.
+
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+#include "SonoTraceUEDiffractionClusters.h"
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(SonoTraceUEDiffractionClusters_Tests, "SonoTraceUE.DiffractionClusters.Test", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::SmokeFilter)
+
+bool SonoTraceUEDiffractionClusters_Tests::RunTest(const FString& Parameters)
+{
+	// Triangles on a sphere with outward normals, every fifth one too large for diffraction
+	const int32 NumberOfTriangles = 20000;
+	FRandomStream RandomStream(1234);
+	TArray<FVector> Positions;
+	TArray<FVector> Normals;
+	TArray<float> Weights;
+	TArray<uint8> EligibleMask;
+	for (int32 TriangleIndex = 0; TriangleIndex < NumberOfTriangles; TriangleIndex++)
+	{
+		const FVector Normal = RandomStream.GetUnitVector();
+		Positions.Add(Normal * 200.0);
+		Normals.Add(Normal);
+		Weights.Add(RandomStream.FRand() + 0.000005f);
+		EligibleMask.Add(TriangleIndex % 5 != 0 ? 1 : 0);
+	}
+
+	FSonoTraceUEDiffractionClusters Clusters;
+	Clusters.Build(Positions, Normals, Weights, EligibleMask);
+
+	{
+		TArray<int32> Occurrences;
+		Occurrences.SetNumZeroed(NumberOfTriangles);
+		int32 Mismatches = 0;
+		for (const FSonoTraceUEDiffractionClusters::FCluster& Cluster : Clusters.Clusters)
+		{
+			for (int32 Index = Cluster.FirstTriangle; Index < Cluster.FirstTriangle + Cluster.NumTriangles; Index++)
+			{
+				const int32 TriangleIndex = Clusters.Triangles[Index];
+				Occurrences[TriangleIndex]++;
+				if (FVector::Dist(Cluster.Center, Positions[TriangleIndex]) > Cluster.Radius + KINDA_SMALL_NUMBER)
+					Mismatches++;
+				if (FMath::Acos(FMath::Clamp(static_cast<float>(FVector::DotProduct(Cluster.ConeAxis, Normals[TriangleIndex])), -1.0f, 1.0f)) > Cluster.ConeHalfAngle + KINDA_SMALL_NUMBER)
+					Mismatches++;
+			}
+		}
+		int32 WrongOccurrences = 0;
+		for (int32 TriangleIndex = 0; TriangleIndex < NumberOfTriangles; TriangleIndex++)
+		{
+			WrongOccurrences += Occurrences[TriangleIndex] != EligibleMask[TriangleIndex];
+		}
+		TestEqual(TEXT("check every eligible triangle in exactly one cluster"), WrongOccurrences, 0);
+		TestEqual(TEXT("check spheres and cones bound their triangles"), Mismatches, 0);
+	}
+
+	{
+		// Culling is conservative, every triangle that passes the per-point frustum and emitter tests has to be in a visible cluster
+		int32 MissedTriangles = 0;
+		int32 VisibleTriangles = 0;
+		int32 KeptTriangles = 0;
+		for (int32 ViewIndex = 0; ViewIndex < 20; ViewIndex++)
+		{
+			const FTransform Transform(FRotator(RandomStream.FRandRange(-180, 180), RandomStream.FRandRange(-180, 180), 0), RandomStream.GetUnitVector() * 100.0, FVector(RandomStream.FRandRange(0.5, 2.0)));
+			const TArray<FVector> EmitterLocations = {RandomStream.GetUnitVector() * 600.0};
+			FSonoTraceUEDiffractionClusters::FView View;
+			View.SensorLocation = EmitterLocations[0];
+			View.SensorRotation = (-EmitterLocations[0]).Rotation() + FRotator(RandomStream.FRandRange(-30, 30), RandomStream.FRandRange(-30, 30), 0);
+			View.LowerAzimuthLimit = -40.0f;
+			View.UpperAzimuthLimit = 40.0f;
+			View.LowerElevationLimit = -30.0f;
+			View.UpperElevationLimit = 30.0f;
+			View.MaximumDistance = 900.0f;
+			View.EmitterLocations = EmitterLocations;
+
+			TArray<int32> VisibleClusters;
+			TArray<float> VisibleImportances;
+			Clusters.Cull(Transform, View, VisibleClusters, VisibleImportances);
+			TArray<uint8> InVisibleCluster;
+			InVisibleCluster.SetNumZeroed(NumberOfTriangles);
+			for (const int32 ClusterIndex : VisibleClusters)
+			{
+				const FSonoTraceUEDiffractionClusters::FCluster& Cluster = Clusters.Clusters[ClusterIndex];
+				for (int32 Index = Cluster.FirstTriangle; Index < Cluster.FirstTriangle + Cluster.NumTriangles; Index++)
+				{
+					InVisibleCluster[Clusters.Triangles[Index]] = 1;
+					KeptTriangles++;
+				}
+			}
+
+			for (int32 TriangleIndex = 0; TriangleIndex < NumberOfTriangles; TriangleIndex++)
+			{
+				if (!EligibleMask[TriangleIndex])
+					continue;
+				const FVector Position = Transform.TransformPosition(Positions[TriangleIndex]);
+				const FVector Normal = Transform.TransformVectorNoScale(Normals[TriangleIndex]);
+				const FVector DirectionToPoint = Position - View.SensorLocation;
+				if (DirectionToPoint.Size() > View.MaximumDistance)
+					continue;
+				const FVector LocalDirection = View.SensorRotation.UnrotateVector(DirectionToPoint.GetSafeNormal());
+				const float Elevation = FMath::RadiansToDegrees(FMath::Asin(LocalDirection.Z));
+				const float Azimuth = FMath::RadiansToDegrees(FMath::Atan2(LocalDirection.Y, LocalDirection.X));
+				if (Elevation < View.LowerElevationLimit || Elevation > View.UpperElevationLimit || Azimuth < View.LowerAzimuthLimit || Azimuth > View.UpperAzimuthLimit)
+					continue;
+				const float Angle = FMath::RadiansToDegrees(FMath::Acos(FMath::Clamp(static_cast<float>(FVector::DotProduct(Normal, (Position - EmitterLocations[0]).GetSafeNormal())), -1.0f, 1.0f)));
+				if (Angle <= 90)
+					continue;
+				VisibleTriangles++;
+				MissedTriangles += !InVisibleCluster[TriangleIndex];
+			}
+		}
+		AddInfo(FString::Printf(TEXT("%d valid triangles, %d triangles in visible clusters"), VisibleTriangles, KeptTriangles));
+		TestEqual(TEXT("check no valid triangle culled"), MissedTriangles, 0);
+		TestTrue(TEXT("check culling removes clusters"), KeptTriangles < 20 * Clusters.Triangles.Num());
+	}
+
+	{
+		TArray<int32> Counts;
+		FSonoTraceUEDiffractionClusters::SplitBudget(TArray<float>({1.0f, 0.0f, 2.0f, 1.0f}), 1001, Counts);
+		TestEqual(TEXT("check budget spent"), Counts[0] + Counts[1] + Counts[2] + Counts[3], 1001);
+		TestEqual(TEXT("check zero weight gets no samples"), Counts[1], 0);
+		TestTrue(TEXT("check budget proportional"), Counts[2] == 501 && Counts[0] == 250 && Counts[3] == 250);
+	}
+
+	return true;
+}
@@ -0,0 +1,131 @@
+// By Wouter Jansen & Jan Steckel, Cosys-Lab, University of Antwerp. See the LICENSE file for details.
+
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+#include "SonoTraceUEActor.h"
+#include "SonoTraceUEStrengthKernels.h"
+
+namespace SonoTraceUEDiffractionScalingTest
+{
+	constexpr int32 NumberOfObjects = 32;
+	constexpr int32 NumberOfTrianglesPerObject = 20000;
+	constexpr int32 NumberOfSamples = 64000;
+	constexpr int32 NumberOfEmitters = 2;
+	constexpr int32 NumberOfReceivers = 8;
+	constexpr int32 NumberOfFrequencies = 32;
+	constexpr int32 NumberOfRuns = 5;
+}
+
+// Time of the diffraction stage of the simulation (culling, sampling, strength kernel and compaction) on the worker threads of this machine.
+// The stage spreads its work over all workers, so the scaling is measured by running the test with -corelimit=8, -corelimit=16 and -corelimit=32.
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(SonoTraceUEDiffractionScaling_Tests, "SonoTraceUE.DiffractionScaling.Test", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::PerfFilter)
+
+bool SonoTraceUEDiffractionScaling_Tests::RunTest(const FString& Parameters)
+{
+	using namespace SonoTraceUEDiffractionScalingTest;
+
+	// One object type with a diffraction material and a surface table, as the mesh registry would hold it
+	TArray<FSonoTraceUEObjectSettingsStruct> ObjectSettings;
+	FSonoTraceUEObjectSettingsStruct& DefaultObjectSettings = ObjectSettings.AddDefaulted_GetRef();
+	DefaultObjectSettings.BrdfTransitionPosition = 0.4f;
+	DefaultObjectSettings.BrdfTransitionSlope = 2.0f;
+	DefaultObjectSettings.MaterialsTransitionPosition = 0.6f;
+	DefaultObjectSettings.MaterialsTransitionSlope = 1.0f;
+	TArray<float> Frequencies;
+	for (int32 FrequencyIndex = 0; FrequencyIndex < NumberOfFrequencies; FrequencyIndex++)
+	{
+		Frequencies.Add(20000.0f + FrequencyIndex * 1000.0f);
+		DefaultObjectSettings.BrdfExponentsSpecular.Add(0.1f + 0.01f * FrequencyIndex);
+		DefaultObjectSettings.BrdfExponentsDiffraction.Add(2.0f + 0.05f * FrequencyIndex);
+		DefaultObjectSettings.MaterialStrengthsSpecular.Add(1.0f - 0.01f * FrequencyIndex);
+		DefaultObjectSettings.MaterialStrengthsDiffraction.Add(0.2f + 0.01f * FrequencyIndex);
+	}
+	DefaultObjectSettings.SurfaceTable.Build(DefaultObjectSettings);
+
+	// Spheres in front of the sensor with random triangle importances, the half facing the sensor faces the emitters
+	FSonoTraceUESimulationInput Input;
+	FRandomStream RandomStream(1234);
+	for (int32 ObjectIndex = 0; ObjectIndex < NumberOfObjects; ObjectIndex++)
+	{
+		TSharedPtr<FSonoTraceUEMeshDataStruct, ESPMode::ThreadSafe> MeshData = MakeShared<FSonoTraceUEMeshDataStruct, ESPMode::ThreadSafe>();
+		TArray<float> Weights;
+		TArray<uint8> EligibleMask;
+		for (int32 TriangleIndex = 0; TriangleIndex < NumberOfTrianglesPerObject; TriangleIndex++)
+		{
+			const FVector Normal = RandomStream.GetUnitVector();
+			MeshData->TrianglePosition.Add(Normal * 100.0);
+			MeshData->TriangleNormal.Add(Normal);
+			MeshData->TriangleSize.Add(1.0f);
+			MeshData->TriangleCurvatureMagnitude.Add(FFloat16(RandomStream.FRand()));
+			Weights.Add(RandomStream.FRand() < 0.9f ? 0.0f : RandomStream.FRand());
+			EligibleMask.Add(1);
+		}
+		MeshData->DiffractionClusters.Build(MeshData->TrianglePosition, MeshData->TriangleNormal, Weights, EligibleMask);
+
+		Input.HitObjectsPersistentPrimitiveIndexes.Add(ObjectIndex);
+		Input.HitObjectInstanceIndexes.Add(INDEX_NONE);
+		Input.HitObjectKeys.Add(static_cast<uint32>(ObjectIndex));
+		Input.HitObjectTypes.Add(0);
+		Input.HitObjectLabels.Add(FName(FString::Printf(TEXT("Object_%d"), ObjectIndex)));
+		Input.HitObjectTransforms.Add(FTransform(FVector(RandomStream.FRandRange(500.0f, 2000.0f), RandomStream.FRandRange(-1000.0f, 1000.0f), RandomStream.FRandRange(-500.0f, 500.0f))));
+		Input.HitObjectMeshData.Add(MeshData);
+		Input.HitObjectTraceParams.Emplace(FName(TEXT("DiffractionTrace")), true);
+	}
+	for (int32 EmitterIndex = 0; EmitterIndex < NumberOfEmitters; EmitterIndex++)
+	{
+		Input.EmitterPoses.Add(FTransform(FVector(0.0f, EmitterIndex * 5.0f, 0.0f)));
+	}
+	for (int32 ReceiverIndex = 0; ReceiverIndex < NumberOfReceivers; ReceiverIndex++)
+	{
+		Input.ReceiverPoses.Add(FTransform(FVector(0.0f, (ReceiverIndex % 4) * 1.0f, (ReceiverIndex / 4) * 1.0f)));
+	}
+	Input.Index = 1;
+
+	// The line of sight is not traced as there is no world, every other part of the stage runs as in a measurement
+	FSonoTraceUESimulationSettings& Settings = Input.Settings;
+	Settings.NumberOfSimFrequencies = NumberOfFrequencies;
+	Settings.EnableDiffractionComponentCalculation = true;
+	Settings.NumberOfInitialRays = NumberOfSamples;
+	Settings.DiffractionSimDivisionFactor = 1;
+	Settings.SensorLowerAzimuthLimit = -90.0f;
+	Settings.SensorUpperAzimuthLimit = 90.0f;
+	Settings.SensorLowerElevationLimit = -90.0f;
+	Settings.SensorUpperElevationLimit = 90.0f;
+	Settings.MaximumRayDistance = 5000.0f;
+	Settings.DiffractionSampleBudget = NumberOfSamples;
+	Settings.RandomSeed = 1234;
+	Settings.EnableDiffractionLineOfSightRequired = false;
+	Settings.DiffractionMinimumStrength = 1e-12f;
+	FSonoTraceUEStrengthKernels::CalculateLogAbsorptions(Frequencies, Settings.LogAbsorptions);
+	Settings.ObjectSettings = &ObjectSettings;
+
+	// Warm up the worker threads and the allocations
+	FSonoTraceUESubOutputStruct ReferenceSubOutput;
+	const int32 NumberOfCandidates = ASonoTraceUEActor::SimulateDiffraction(Input, nullptr, ReferenceSubOutput);
+	TestTrue(TEXT("check candidates are drawn"), NumberOfCandidates > 0);
+	TestTrue(TEXT("check points are kept"), ReferenceSubOutput.ReflectedPoints.Num() > 0);
+
+	double TotalTime = 0.0;
+	double MinimumTime = TNumericLimits<double>::Max();
+	for (int32 RunIndex = 0; RunIndex < NumberOfRuns; RunIndex++)
+	{
+		FSonoTraceUESubOutputStruct SubOutput;
+		const double StartTime = FPlatformTime::Seconds();
+		ASonoTraceUEActor::SimulateDiffraction(Input, nullptr, SubOutput);
+		const double RunTime = FPlatformTime::Seconds() - StartTime;
+		TotalTime += RunTime;
+		MinimumTime = FMath::Min(MinimumTime, RunTime);
+
+		// The random numbers of a sample do not depend on the scheduling, so every run keeps the same points
+		TestEqual(FString::Printf(TEXT("check run %d keeps the same points"), RunIndex), SubOutput.ReflectedPoints.Num(), ReferenceSubOutput.ReflectedPoints.Num());
+		TestEqual(FString::Printf(TEXT("check run %d has the same summed strength"), RunIndex), SubOutput.SummedStrength, ReferenceSubOutput.SummedStrength);
+	}
+
+	AddInfo(FString::Printf(TEXT("Diffraction stage of %d samples on %d objects with %d paths and %d frequencies, %d cores, %d worker threads"),
+	                        NumberOfSamples, NumberOfObjects, NumberOfEmitters * NumberOfReceivers, NumberOfFrequencies, FPlatformMisc::NumberOfCoresIncludingHyperthreads(),
+	                        FTaskGraphInterface::Get().GetNumWorkerThreads()));
+	AddInfo(FString::Printf(TEXT("%d candidates, %d points: mean %.4fs, minimum %.4fs over %d runs"), NumberOfCandidates, ReferenceSubOutput.ReflectedPoints.Num(),
+	                        TotalTime / NumberOfRuns, MinimumTime, NumberOfRuns));
+
+	return true;
+}
@@ -0,0 +1,137 @@
+// By Wouter Jansen & Jan Steckel, Cosys-Lab, University of Antwerp. See the LICENSE file for details.
+
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+#include "SonoTraceUEActor.h"
+#include "SonoTraceUEHeightfield.h"
+#include "SonoTraceCPU.h"
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(SonoTraceUEHeightfield_Tests, "SonoTraceUE.Heightfield.Test", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::SmokeFilter)
+
+bool SonoTraceUEHeightfield_Tests::RunTest(const FString& Parameters)
+{
+	const int32 NumberOfQuads = 64;
+	const FVector2D QuadSize(100.0, 100.0);
+	auto FillTile = [&](const TFunctionRef<float(double, double)> HeightFunction)
+	{
+		FSonoTraceUEHeightfieldTileSamples Samples;
+		Samples.Init(NumberOfQuads, FVector2D(-NumberOfQuads * QuadSize.X / 2, -NumberOfQuads * QuadSize.Y / 2), QuadSize);
+		for (int32 Y = -1; Y <= NumberOfQuads + 1; Y++)
+		{
+			for (int32 X = -1; X <= NumberOfQuads + 1; X++)
+			{
+				const int32 SampleIndex = Samples.GetSampleIndex(X, Y);
+				Samples.Heights[SampleIndex] = HeightFunction(Samples.Origin.X + X * QuadSize.X, Samples.Origin.Y + Y * QuadSize.Y);
+				Samples.Valid[SampleIndex] = 1;
+			}
+		}
+		return Samples;
+	};
+
+	// A sloped plane has no curvature and the normal of the plane everywhere
+	const FVector PlaneNormal = FVector(-0.2, 0.1, 1.0).GetSafeNormal();
+	const FSonoTraceUEHeightfieldTileSamples Plane = FillTile([](const double X, const double Y) { return static_cast<float>(0.2 * X - 0.1 * Y + 30.0); });
+	FSonoTraceUEMeshDataStruct PlaneMeshData;
+	Plane.CalculateMeshData(1.0f, PlaneMeshData);
+	TestEqual(TEXT("check triangle count"), PlaneMeshData.TriangleCurvatureMagnitude.Num(), 2 * NumberOfQuads * NumberOfQuads);
+	bool PlaneIsFlat = true;
+	for (int32 TriangleIndex = 0; TriangleIndex < PlaneMeshData.TriangleCurvatureMagnitude.Num(); TriangleIndex++)
+	{
+		PlaneIsFlat &= PlaneMeshData.TriangleCurvatureMagnitude[TriangleIndex] < 1e-4f;
+		PlaneIsFlat &= PlaneMeshData.TriangleNormal[TriangleIndex].Equals(PlaneNormal, 1e-4);
+		PlaneIsFlat &= FMath::IsNearlyEqual(PlaneMeshData.TriangleSize[TriangleIndex], QuadSize.X * QuadSize.Y / 2 * (1.0 / PlaneNormal.Z), 1.0);
+	}
+	TestTrue(TEXT("check plane is flat with the plane normal"), PlaneIsFlat);
+
+	// The mean curvature of a dome follows the radius of its sphere
+	const double Radius = 20000.0;
+	const FSonoTraceUEHeightfieldTileSamples Dome = FillTile([Radius](const double X, const double Y) { return static_cast<float>(FMath::Sqrt(Radius * Radius - X * X - Y * Y) - Radius); });
+	bool DomeCurvatureMatches = true;
+	for (int32 Y = 0; Y <= NumberOfQuads; Y += 8)
+	{
+		for (int32 X = 0; X <= NumberOfQuads; X += 8)
+		{
+			DomeCurvatureMatches &= FMath::IsNearlyEqual(Dome.GetMeanCurvature(X, Y), 1.0 / Radius, 0.02 / Radius);
+		}
+	}
+	TestTrue(TEXT("check dome curvature"), DomeCurvatureMatches);
+
+	// A ridge only has curvature next to its crest
+	const FSonoTraceUEHeightfieldTileSamples Ridge = FillTile([](const double X, const double Y) { return static_cast<float>(-0.5 * FMath::Abs(X)); });
+	FSonoTraceUEMeshDataStruct RidgeMeshData;
+	Ridge.CalculateMeshData(1.0f, RidgeMeshData);
+	bool RidgeCurvatureAtCrest = true;
+	for (int32 TriangleIndex = 0; TriangleIndex < RidgeMeshData.TriangleCurvatureMagnitude.Num(); TriangleIndex++)
+	{
+		const bool NearCrest = FMath::Abs(RidgeMeshData.TrianglePosition[TriangleIndex].X) < QuadSize.X;
+		RidgeCurvatureAtCrest &= NearCrest == (RidgeMeshData.TriangleCurvatureMagnitude[TriangleIndex] > 1e-4f);
+	}
+	TestTrue(TEXT("check ridge curvature at crest"), RidgeCurvatureAtCrest);
+
+	// Triangles touching a hole get no curvature, the crest runs through the vertices in the middle of the tile
+	FSonoTraceUEHeightfieldTileSamples Hole = Ridge;
+	Hole.Valid[Hole.GetSampleIndex(NumberOfQuads / 2, 10)] = 0;
+	FSonoTraceUEMeshDataStruct HoleMeshData;
+	Hole.CalculateMeshData(1.0f, HoleMeshData);
+	const int32 HoleTriangleIndex = 2 * (10 * NumberOfQuads + NumberOfQuads / 2);
+	TestTrue(TEXT("check ridge has curvature next to hole"), RidgeMeshData.TriangleCurvatureMagnitude[HoleTriangleIndex] > 1e-4f);
+	TestTrue(TEXT("check hole has no curvature"), HoleMeshData.TriangleCurvatureMagnitude[HoleTriangleIndex] == 0.0f && HoleMeshData.TriangleCurvatureMagnitude[HoleTriangleIndex + 1] == 0.0f);
+
+	// The triangles of the CPU raytracing backend match the mesh data triangles and face up, the six triangles sharing the hole vertex can not be hit
+	TArray<FVector3f> RidgeVertices;
+	TArray<FIntVector> RidgeTriangles;
+	Ridge.GetTriangles(RidgeVertices, RidgeTriangles);
+	TestEqual(TEXT("check CPU triangle count"), RidgeTriangles.Num(), RidgeMeshData.TriangleNormal.Num());
+	bool CPUTrianglesMatch = true;
+	for (int32 TriangleIndex = 0; TriangleIndex < RidgeTriangles.Num(); TriangleIndex++)
+	{
+		const FIntVector& Triangle = RidgeTriangles[TriangleIndex];
+		const FVector3f Centroid = (RidgeVertices[Triangle.X] + RidgeVertices[Triangle.Y] + RidgeVertices[Triangle.Z]) / 3.0f;
+		CPUTrianglesMatch &= Centroid.Equals(FVector3f(RidgeMeshData.TrianglePosition[TriangleIndex]), 1e-2f);
+		CPUTrianglesMatch &= FSonoTraceCPUMesh::GetWindingNormal(RidgeVertices[Triangle.X], RidgeVertices[Triangle.Y], RidgeVertices[Triangle.Z]).Equals(FVector3f(RidgeMeshData.TriangleNormal[TriangleIndex]), 1e-4f);
+	}
+	TestTrue(TEXT("check CPU triangles match the mesh data"), CPUTrianglesMatch);
+	TArray<FVector3f> HoleVertices;
+	TArray<FIntVector> HoleTriangles;
+	Hole.GetTriangles(HoleVertices, HoleTriangles);
+	int32 NumberOfCollapsedTriangles = 0;
+	for (const FIntVector& Triangle : HoleTriangles)
+	{
+		NumberOfCollapsedTriangles += Triangle.X == Triangle.Y && Triangle.Y == Triangle.Z ? 1 : 0;
+	}
+	TestEqual(TEXT("check triangles touching the hole are collapsed"), NumberOfCollapsedTriangles, 6);
+	TestTrue(TEXT("check triangle next to the hole is collapsed"), HoleTriangles[HoleTriangleIndex].X == HoleTriangles[HoleTriangleIndex].Z);
+
+	// Every triangle is found back from a world position on it, on a rotated, scaled and moved landscape
+	FSonoTraceUEHeightfield Heightfield;
+	Heightfield.TileNumberOfQuads = NumberOfQuads;
+	Heightfield.LandscapeTransform = FTransform(FRotator(0.0, 30.0, 0.0), FVector(1000.0, -2000.0, 50.0), FVector(QuadSize.X, QuadSize.Y, 1.0));
+	const FIntPoint Tile(-3, 2);
+	Heightfield.TileMeshDataIndexes.Add(Tile, 7);
+	bool AllTrianglesFound = true;
+	FRandomStream RandomStream(1234);
+	for (int32 QueryIndex = 0; QueryIndex < 1000; QueryIndex++)
+	{
+		const int32 TriangleIndex = RandomStream.RandHelper(2 * NumberOfQuads * NumberOfQuads);
+		const int32 QuadIndex = TriangleIndex / 2;
+		const FVector2D Centroid = FVector2D(QuadIndex % NumberOfQuads, QuadIndex / NumberOfQuads) + (TriangleIndex % 2 == 0 ? FVector2D(2.0 / 3.0, 1.0 / 3.0) : FVector2D(1.0 / 3.0, 2.0 / 3.0));
+		const FVector LocalPosition(FVector2D(Tile * NumberOfQuads) + Centroid, RandomStream.FRandRange(-100.0f, 100.0f));
+		int32 MeshDataIndex = INDEX_NONE;
+		int32 FoundTriangleIndex = INDEX_NONE;
+		AllTrianglesFound &= Heightfield.FindTriangle(Heightfield.LandscapeTransform.TransformPosition(LocalPosition), MeshDataIndex, FoundTriangleIndex);
+		AllTrianglesFound &= MeshDataIndex == 7 && FoundTriangleIndex == TriangleIndex;
+	}
+	TestTrue(TEXT("check triangles are found from their position"), AllTrianglesFound);
+	int32 MeshDataIndex;
+	int32 TriangleIndex;
+	TestFalse(TEXT("check unloaded tile is not found"), Heightfield.FindTriangle(Heightfield.LandscapeTransform.TransformPosition(FVector(0.5, 0.5, 0.0)), MeshDataIndex, TriangleIndex));
+
+	// Memory of a tile compared to the triangle data of a whole 8k landscape
+	FSonoTraceUEMeshDataStruct TileMeshData;
+	Dome.CalculateMeshData(1.0f, TileMeshData);
+	const double BytesPerTriangle = static_cast<double>(TileMeshData.GetAllocatedSize()) / TileMeshData.TriangleCurvatureMagnitude.Num();
+	AddInfo(FString::Printf(TEXT("Tile of %dx%d quads takes %.3f MB. A 8129x8129 landscape as triangles would take %.1f MB."), NumberOfQuads, NumberOfQuads,
+	                        TileMeshData.GetAllocatedSize() / (1024.0 * 1024.0), 2.0 * 8128.0 * 8128.0 * BytesPerTriangle / (1024.0 * 1024.0)));
+
+	return true;
+}
@@ -0,0 +1,156 @@
+// By Wouter Jansen & Jan Steckel, Cosys-Lab, University of Antwerp. See the LICENSE file for details.
+
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+#include "SonoTraceUEInstanceHierarchy.h"
+
+namespace SonoTraceUEInstanceHierarchyTest
+{
+	// Vegetation like scene of small instances scattered over a square with the given half size
+	TArray<FBox3f> MakeInstanceBounds(const int32 NumberOfInstances, const float HalfSize, FRandomStream& RandomStream)
+	{
+		TArray<FBox3f> InstanceBounds;
+		for (int32 InstanceIndex = 0; InstanceIndex < NumberOfInstances; InstanceIndex++)
+		{
+			const FVector3f Center(RandomStream.FRandRange(-HalfSize, HalfSize), RandomStream.FRandRange(-HalfSize, HalfSize), RandomStream.FRandRange(0.0f, 500.0f));
+			const FVector3f Extent(RandomStream.FRandRange(20.0f, 200.0f), RandomStream.FRandRange(20.0f, 200.0f), RandomStream.FRandRange(50.0f, 800.0f));
+			InstanceBounds.Add(FBox3f(Center - Extent, Center + Extent));
+		}
+		return InstanceBounds;
+	}
+
+	// Brute force reference of FSonoTraceUEInstanceHierarchy::FindInstance
+	int32 FindInstanceReference(const TArray<FBox3f>& InstanceBounds, const FVector3f& Position)
+	{
+		int32 ClosestInstance = INDEX_NONE;
+		float ClosestDistanceSquared = TNumericLimits<float>::Max();
+		for (int32 InstanceIndex = 0; InstanceIndex < InstanceBounds.Num(); InstanceIndex++)
+		{
+			if (!InstanceBounds[InstanceIndex].ExpandBy(1.0f).IsInsideOrOn(Position))
+				continue;
+			const float DistanceSquared = FVector3f::DistSquared(InstanceBounds[InstanceIndex].GetCenter(), Position);
+			if (DistanceSquared < ClosestDistanceSquared)
+			{
+				ClosestDistanceSquared = DistanceSquared;
+				ClosestInstance = InstanceIndex;
+			}
+		}
+		return ClosestInstance;
+	}
+
+	// Hits on the surface of an instance and positions in the open
+	TArray<FVector3f> MakeQueryPositions(const TArray<FBox3f>& InstanceBounds, const int32 NumberOfQueries, const float HalfSize, FRandomStream& RandomStream)
+	{
+		TArray<FVector3f> Positions;
+		for (int32 QueryIndex = 0; QueryIndex < NumberOfQueries; QueryIndex++)
+		{
+			if (QueryIndex % 2 == 0)
+			{
+				const FBox3f& HitBounds = InstanceBounds[RandomStream.RandHelper(InstanceBounds.Num())];
+				Positions.Add(FVector3f(RandomStream.FRandRange(HitBounds.Min.X, HitBounds.Max.X), RandomStream.FRandRange(HitBounds.Min.Y, HitBounds.Max.Y), HitBounds.Max.Z));
+			}else
+			{
+				Positions.Add(FVector3f(RandomStream.FRandRange(-HalfSize, HalfSize), RandomStream.FRandRange(-HalfSize, HalfSize), RandomStream.FRandRange(0.0f, 2000.0f)));
+			}
+		}
+		return Positions;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(SonoTraceUEInstanceHierarchy_Tests, "SonoTraceUE.InstanceHierarchy.Test", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::SmokeFilter)
+
+bool SonoTraceUEInstanceHierarchy_Tests::RunTest(const FString& Parameters)
+{
+	using namespace SonoTraceUEInstanceHierarchyTest;
+
+	// Same instance density as a vegetation scene of 100000 instances on a square kilometer
+	const int32 NumberOfInstances = 5000;
+	const int32 NumberOfQueries = 500;
+	const float HalfSize = 11000.0f;
+	FRandomStream RandomStream(1234);
+	const TArray<FBox3f> InstanceBounds = MakeInstanceBounds(NumberOfInstances, HalfSize, RandomStream);
+	FSonoTraceUEInstanceHierarchy Hierarchy;
+	Hierarchy.Build(InstanceBounds);
+	TestEqual(TEXT("check instance count"), Hierarchy.Num(), NumberOfInstances);
+
+	auto OverlapSphereReference = [&](const FVector3f& Center, const float Radius)
+	{
+		TArray<int32> Instances;
+		for (int32 InstanceIndex = 0; InstanceIndex < InstanceBounds.Num(); InstanceIndex++)
+		{
+			if (FMath::SphereAABBIntersection(FVector(Center), FMath::Square(Radius), FBox(InstanceBounds[InstanceIndex])))
+				Instances.Add(InstanceIndex);
+		}
+		return Instances;
+	};
+
+	const TArray<FVector3f> Positions = MakeQueryPositions(InstanceBounds, NumberOfQueries, HalfSize, RandomStream);
+	TArray<int32> ReferenceInstances;
+	TArray<int32> FoundInstances;
+	for (const FVector3f& Position : Positions)
+	{
+		ReferenceInstances.Add(FindInstanceReference(InstanceBounds, Position));
+		FoundInstances.Add(Hierarchy.FindInstance(Position));
+	}
+	TestTrue(TEXT("check resolved instances"), FoundInstances == ReferenceInstances);
+
+	// Instances in range of a sensor
+	bool AllOverlapsEqual = true;
+	int32 NumberOfOverlaps = 0;
+	for (int32 QueryIndex = 0; QueryIndex < 20; QueryIndex++)
+	{
+		const FVector3f Center(RandomStream.FRandRange(-HalfSize, HalfSize), RandomStream.FRandRange(-HalfSize, HalfSize), 100.0f);
+		const float Radius = RandomStream.FRandRange(500.0f, 5000.0f);
+		TArray<int32> Instances;
+		Hierarchy.OverlapSphere(Center, Radius, Instances);
+		Instances.Sort();
+		AllOverlapsEqual &= Instances == OverlapSphereReference(Center, Radius);
+		NumberOfOverlaps += Instances.Num();
+	}
+	TestTrue(TEXT("check instances in range"), AllOverlapsEqual);
+	TestTrue(TEXT("check instances were found in range"), NumberOfOverlaps > 0);
+
+	FSonoTraceUEInstanceHierarchy EmptyHierarchy;
+	EmptyHierarchy.Build({});
+	TestEqual(TEXT("check empty hierarchy"), EmptyHierarchy.FindInstance(FVector3f::ZeroVector), INDEX_NONE);
+
+	return true;
+}
+
+// Building the hierarchy of a full vegetation scene and resolving hits against the brute force search
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(SonoTraceUEInstanceHierarchy_PerfTests, "SonoTraceUE.InstanceHierarchy.Perf", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::PerfFilter)
+
+bool SonoTraceUEInstanceHierarchy_PerfTests::RunTest(const FString& Parameters)
+{
+	using namespace SonoTraceUEInstanceHierarchyTest;
+
+	const int32 NumberOfInstances = 100000;
+	const int32 NumberOfQueries = 2000;
+	const float HalfSize = 50000.0f;
+	FRandomStream RandomStream(1234);
+	const TArray<FBox3f> InstanceBounds = MakeInstanceBounds(NumberOfInstances, HalfSize, RandomStream);
+	double StartTime = FPlatformTime::Seconds();
+	FSonoTraceUEInstanceHierarchy Hierarchy;
+	Hierarchy.Build(InstanceBounds);
+	const double BuildTime = FPlatformTime::Seconds() - StartTime;
+
+	const TArray<FVector3f> Positions = MakeQueryPositions(InstanceBounds, NumberOfQueries, HalfSize, RandomStream);
+	TArray<int32> ReferenceInstances;
+	StartTime = FPlatformTime::Seconds();
+	for (const FVector3f& Position : Positions)
+	{
+		ReferenceInstances.Add(FindInstanceReference(InstanceBounds, Position));
+	}
+	const double ReferenceFindTime = FPlatformTime::Seconds() - StartTime;
+	TArray<int32> FoundInstances;
+	StartTime = FPlatformTime::Seconds();
+	for (const FVector3f& Position : Positions)
+	{
+		FoundInstances.Add(Hierarchy.FindInstance(Position));
+	}
+	const double FindTime = FPlatformTime::Seconds() - StartTime;
+	AddInfo(FString::Printf(TEXT("%d instances built in %.4fs. Resolving %d hits, brute force: %.4fs, hierarchy: %.4fs"), NumberOfInstances, BuildTime, NumberOfQueries, ReferenceFindTime, FindTime));
+	TestTrue(TEXT("check resolved instances"), FoundInstances == ReferenceInstances);
+
+	return true;
+}
@@ -0,0 +1,103 @@
+// By Wouter Jansen & Jan Steckel, Cosys-Lab, University of Antwerp. See the LICENSE file for details.
+
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+#include "HAL/FileManager.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+#include "SonoTraceUEActor.h"
+#include "SonoTraceUEMeshCache.h"
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(SonoTraceUEMeshCache_Tests, "SonoTraceUE.MeshCache.Test", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::SmokeFilter)
+
+bool SonoTraceUEMeshCache_Tests::RunTest(const FString& Parameters)
+{
+	const int32 NumberOfTriangles = 2000;
+	const int32 NumberOfFrequencies = 8;
+
+	FSonoTraceUEObjectSettingsStruct ObjectSettings;
+	ObjectSettings.BrdfTransitionPosition = 0.2f;
+	ObjectSettings.BrdfTransitionSlope = 2.0f;
+	ObjectSettings.MaterialsTransitionPosition = 0.3f;
+	ObjectSettings.MaterialsTransitionSlope = 2.0f;
+	ObjectSettings.BrdfExponentsSpecular.Init(0.1f, NumberOfFrequencies);
+	ObjectSettings.BrdfExponentsDiffraction.Init(5.0f, NumberOfFrequencies);
+	ObjectSettings.MaterialStrengthsSpecular.Init(1.0f, NumberOfFrequencies);
+	ObjectSettings.MaterialStrengthsDiffraction.Init(0.5f, NumberOfFrequencies);
+
+	FRandomStream RandomStream(1234);
+	FSonoTraceUEMeshDataStruct MeshData;
+	TArray<float> Weights;
+	TArray<uint8> EligibleMask;
+	for (int32 TriangleIndex = 0; TriangleIndex < NumberOfTriangles; TriangleIndex++)
+	{
+		const FVector Normal = RandomStream.GetUnitVector();
+		MeshData.TrianglePosition.Add(Normal * 200.0);
+		MeshData.TriangleNormal.Add(Normal);
+		MeshData.TriangleSize.Add(RandomStream.FRandRange(0.0f, 400.0f));
+		MeshData.TriangleCurvatureMagnitude.Add(FFloat16(RandomStream.FRand()));
+		Weights.Add(RandomStream.FRand() + 0.000005f);
+		EligibleMask.Add(MeshData.TriangleSize.Last() < 200.0f ? 1 : 0);
+	}
+	MeshData.DiffractionClusters.Build(MeshData.TrianglePosition, MeshData.TriangleNormal, Weights, EligibleMask);
+
+	auto IsEqual = [](const FSonoTraceUEMeshDataStruct& A, const FSonoTraceUEMeshDataStruct& B)
+	{
+		if (A.DiffractionClusters.Clusters.Num() != B.DiffractionClusters.Clusters.Num())
+			return false;
+		for (int32 ClusterIndex = 0; ClusterIndex < A.DiffractionClusters.Clusters.Num(); ClusterIndex++)
+		{
+			const FSonoTraceUEDiffractionClusters::FCluster& ClusterA = A.DiffractionClusters.Clusters[ClusterIndex];
+			const FSonoTraceUEDiffractionClusters::FCluster& ClusterB = B.DiffractionClusters.Clusters[ClusterIndex];
+			if (ClusterA.Center != ClusterB.Center || ClusterA.Radius != ClusterB.Radius || ClusterA.ConeAxis != ClusterB.ConeAxis || ClusterA.ConeHalfAngle != ClusterB.ConeHalfAngle
+				|| ClusterA.Importance != ClusterB.Importance || ClusterA.FirstTriangle != ClusterB.FirstTriangle || ClusterA.NumTriangles != ClusterB.NumTriangles
+				|| ClusterA.AliasTable.Probabilities != ClusterB.AliasTable.Probabilities || ClusterA.AliasTable.Aliases != ClusterB.AliasTable.Aliases)
+				return false;
+		}
+		return A.TriangleCurvatureMagnitude == B.TriangleCurvatureMagnitude && A.TriangleSize == B.TriangleSize
+			&& A.TriangleNormal == B.TriangleNormal && A.TrianglePosition == B.TrianglePosition
+			&& A.DiffractionClusters.Triangles == B.DiffractionClusters.Triangles && A.DiffractionClusters.MeshImportance == B.DiffractionClusters.MeshImportance;
+	};
+
+	TArray<uint8> EntryData;
+	{
+		FMemoryWriter Writer(EntryData);
+		FSonoTraceUEMeshCache::Write(Writer, MeshData);
+		FSonoTraceUEMeshDataStruct LoadedMeshData;
+		FMemoryReader Reader(EntryData);
+		TestTrue(TEXT("check entry read"), FSonoTraceUEMeshCache::Read(Reader, LoadedMeshData));
+		TestTrue(TEXT("check round trip"), IsEqual(MeshData, LoadedMeshData));
+
+		// Entries of another version or without the header are rejected
+		TArray<uint8> OutdatedData = EntryData;
+		OutdatedData[4] ^= 0xFF;
+		FMemoryReader OutdatedReader(OutdatedData);
+		TestFalse(TEXT("check outdated entry rejected"), FSonoTraceUEMeshCache::Read(OutdatedReader, LoadedMeshData));
+		TArray<uint8> ForeignData = EntryData;
+		ForeignData[0] ^= 0xFF;
+		FMemoryReader ForeignReader(ForeignData);
+		TestFalse(TEXT("check foreign file rejected"), FSonoTraceUEMeshCache::Read(ForeignReader, LoadedMeshData));
+	}
+
+	{
+		USonoTraceUEInputSettingsData* InputSettings = NewObject<USonoTraceUEInputSettingsData>();
+		const FString Key = FSonoTraceUEMeshCache::GetKey(TEXT("SonoTraceUEMeshCacheTest"), ObjectSettings, *InputSettings);
+		TestEqual(TEXT("check key is stable"), FSonoTraceUEMeshCache::GetKey(TEXT("SonoTraceUEMeshCacheTest"), ObjectSettings, *InputSettings), Key);
+		TestNotEqual(TEXT("check key changes with mesh"), FSonoTraceUEMeshCache::GetKey(TEXT("SonoTraceUEMeshCacheTest2"), ObjectSettings, *InputSettings), Key);
+		InputSettings->CurvatureScale *= 2.0f;
+		TestNotEqual(TEXT("check key changes with curvature settings"), FSonoTraceUEMeshCache::GetKey(TEXT("SonoTraceUEMeshCacheTest"), ObjectSettings, *InputSettings), Key);
+		InputSettings->CurvatureScale /= 2.0f;
+		FSonoTraceUEObjectSettingsStruct ChangedObjectSettings = ObjectSettings;
+		ChangedObjectSettings.MaterialStrengthsDiffraction[3] = 0.25f;
+		TestNotEqual(TEXT("check key changes with object settings"), FSonoTraceUEMeshCache::GetKey(TEXT("SonoTraceUEMeshCacheTest"), ChangedObjectSettings, *InputSettings), Key);
+
+		TestTrue(TEXT("check entry saved"), FSonoTraceUEMeshCache::Save(Key, MeshData));
+		FSonoTraceUEMeshDataStruct LoadedMeshData;
+		TestTrue(TEXT("check entry loaded"), FSonoTraceUEMeshCache::Load(Key, LoadedMeshData));
+		TestTrue(TEXT("check loaded entry"), IsEqual(MeshData, LoadedMeshData));
+		IFileManager::Get().Delete(*FSonoTraceUEMeshCache::GetPath(Key));
+		TestFalse(TEXT("check missing entry"), FSonoTraceUEMeshCache::Load(Key, LoadedMeshData));
+	}
+
+	return true;
+}
@@ -0,0 +1,123 @@
+// By Wouter Jansen & Jan Steckel, Cosys-Lab, University of Antwerp. See the LICENSE file for details.
+
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+#include "DynamicMesh/DynamicMesh3.h"
+#include "Generators/SphereGenerator.h"
+#include "MeshCurvature.h"
+#include "SonoTraceUEActor.h"
+
+namespace SonoTraceUEMeshCurvatureTest
+{
+	constexpr float CurvatureScale = 1.0f;
+	constexpr float MinimumEffect = 0.02f;
+	constexpr float MaximumEffect = 2.0f;
+	constexpr float LowerThreshold = 0.5f;
+	constexpr float UpperThreshold = 5.0f;
+	constexpr float DiffractionThreshold = 200.0f;
+
+	// Single pass reference evaluating the curvature of all three vertices of every triangle
+	void CalculateReference(const UE::Geometry::FDynamicMesh3& Mesh, FSonoTraceUEMeshDataStruct& OutMeshData)
+	{
+		for (int32 TriangleIndex : Mesh.TriangleIndicesItr())
+		{
+			const UE::Geometry::FIndex3i TriVertices = Mesh.GetTriangle(TriangleIndex);
+			const FVector3d Vertex1Position = Mesh.GetVertex(TriVertices.A);
+			const FVector3d Vertex2Position = Mesh.GetVertex(TriVertices.B);
+			const FVector3d Vertex3Position = Mesh.GetVertex(TriVertices.C);
+			OutMeshData.TrianglePosition.Add((Vertex1Position + Vertex2Position + Vertex3Position) / 3.0);
+
+			const FVector3f Vertex1Normal = Mesh.GetVertexNormal(TriVertices.A);
+			FVector TriangleNormal = FVector::CrossProduct(FVector(Vertex2Position) - FVector(Vertex1Position), FVector(Vertex3Position) - FVector(Vertex1Position));
+			const float DotNormal = FVector::DotProduct(TriangleNormal, FVector(Vertex1Normal));
+			if (DotNormal < 0.0f)
+				TriangleNormal = -TriangleNormal;
+			OutMeshData.TriangleNormal.Add(TriangleNormal);
+
+			const float TriangleSize = FVector3d::CrossProduct(Vertex2Position - Vertex1Position, Vertex3Position - Vertex1Position).Length() * 0.5;
+			OutMeshData.TriangleSize.Add(TriangleSize);
+
+			const double CurvatureMag1 = UE::MeshCurvature::MeanCurvatureNormal(Mesh, TriVertices.A).Length() / 2;
+			const double CurvatureMag2 = UE::MeshCurvature::MeanCurvatureNormal(Mesh, TriVertices.B).Length() / 2;
+			const double CurvatureMag3 = UE::MeshCurvature::MeanCurvatureNormal(Mesh, TriVertices.C).Length() / 2;
+			double Curvature = FMath::Max3(CurvatureMag1, CurvatureMag2, CurvatureMag3) - FMath::Min3(CurvatureMag1, CurvatureMag2, CurvatureMag3);
+			float ScaledAreaEffect = 0;
+			if (TriangleSize <= LowerThreshold)
+				ScaledAreaEffect = MinimumEffect + (1 - MinimumEffect) / LowerThreshold * TriangleSize;
+			else if (TriangleSize > LowerThreshold && TriangleSize <= UpperThreshold)
+				ScaledAreaEffect = 1 + (MaximumEffect - 1) / (UpperThreshold - LowerThreshold) * (TriangleSize - LowerThreshold);
+			else if (TriangleSize > UpperThreshold && TriangleSize <= DiffractionThreshold)
+				ScaledAreaEffect = MaximumEffect - MaximumEffect / (DiffractionThreshold - UpperThreshold) * (TriangleSize - UpperThreshold);
+			Curvature = Curvature * ScaledAreaEffect;
+			OutMeshData.TriangleCurvatureMagnitude.Add(FFloat16(static_cast<float>(Curvature * CurvatureScale)));
+		}
+	}
+
+	// Noisy sphere with some triangles removed so the triangle IDs have holes
+	UE::Geometry::FDynamicMesh3 MakeNoisySphere(const int32 Resolution)
+	{
+		UE::Geometry::FSphereGenerator SphereGenerator;
+		SphereGenerator.Radius = 500.0f;
+		SphereGenerator.NumPhi = Resolution;
+		SphereGenerator.NumTheta = Resolution;
+		SphereGenerator.Generate();
+		UE::Geometry::FDynamicMesh3 Mesh(&SphereGenerator);
+		FRandomStream RandomStream(1234);
+		for (const int32 VertexID : Mesh.VertexIndicesItr())
+		{
+			Mesh.SetVertex(VertexID, Mesh.GetVertex(VertexID) + FVector3d(RandomStream.VRand()) * RandomStream.FRand());
+		}
+		for (int32 TriangleID = 0; TriangleID < Mesh.MaxTriangleID(); TriangleID += 97)
+		{
+			Mesh.RemoveTriangle(TriangleID);
+		}
+		return Mesh;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(SonoTraceUEMeshCurvature_Tests, "SonoTraceUE.MeshCurvature.Test", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::SmokeFilter)
+
+bool SonoTraceUEMeshCurvature_Tests::RunTest(const FString& Parameters)
+{
+	using namespace SonoTraceUEMeshCurvatureTest;
+
+	for (const int32 Resolution : {16, 40})
+	{
+		const UE::Geometry::FDynamicMesh3 Mesh = MakeNoisySphere(Resolution);
+		FSonoTraceUEMeshDataStruct ReferenceMeshData;
+		CalculateReference(Mesh, ReferenceMeshData);
+		FSonoTraceUEMeshDataStruct MeshData;
+		ASonoTraceUEActor::CalculateMeshCurvature(Mesh, MeshData, CurvatureScale, true, MinimumEffect, MaximumEffect, LowerThreshold, UpperThreshold, DiffractionThreshold);
+
+		TestEqual(TEXT("check triangle count"), MeshData.TriangleCurvatureMagnitude.Num(), Mesh.TriangleCount());
+		TestTrue(TEXT("check identical positions"), MeshData.TrianglePosition == ReferenceMeshData.TrianglePosition);
+		TestTrue(TEXT("check identical normals"), MeshData.TriangleNormal == ReferenceMeshData.TriangleNormal);
+		TestTrue(TEXT("check identical sizes"), MeshData.TriangleSize == ReferenceMeshData.TriangleSize);
+		TestTrue(TEXT("check identical curvatures"), MeshData.TriangleCurvatureMagnitude == ReferenceMeshData.TriangleCurvatureMagnitude);
+	}
+
+	return true;
+}
+
+// Curvature of a sphere of over a million triangles with the single pass reference against the two pass calculation
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(SonoTraceUEMeshCurvature_PerfTests, "SonoTraceUE.MeshCurvature.Perf", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::PerfFilter)
+
+bool SonoTraceUEMeshCurvature_PerfTests::RunTest(const FString& Parameters)
+{
+	using namespace SonoTraceUEMeshCurvatureTest;
+
+	const UE::Geometry::FDynamicMesh3 Mesh = MakeNoisySphere(710);
+	double StartTime = FPlatformTime::Seconds();
+	FSonoTraceUEMeshDataStruct ReferenceMeshData;
+	CalculateReference(Mesh, ReferenceMeshData);
+	const double ReferenceTime = FPlatformTime::Seconds() - StartTime;
+
+	StartTime = FPlatformTime::Seconds();
+	FSonoTraceUEMeshDataStruct MeshData;
+	ASonoTraceUEActor::CalculateMeshCurvature(Mesh, MeshData, CurvatureScale, true, MinimumEffect, MaximumEffect, LowerThreshold, UpperThreshold, DiffractionThreshold);
+	const double TwoPassTime = FPlatformTime::Seconds() - StartTime;
+	AddInfo(FString::Printf(TEXT("Curvature of %d triangles. Single pass: %.4fs, two pass: %.4fs"), Mesh.TriangleCount(), ReferenceTime, TwoPassTime));
+	TestTrue(TEXT("check identical curvatures"), MeshData.TriangleCurvatureMagnitude == ReferenceMeshData.TriangleCurvatureMagnitude);
+
+	return true;
+}
@@ -0,0 +1,201 @@
+// By Wouter Jansen & Jan Steckel, Cosys-Lab, University of Antwerp. See the LICENSE file for details.
+
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+#include "SonoTraceUEActor.h"
+#include "SonoTraceUEParser.h"
+
+namespace SonoTraceUEParserTest
+{
+	// Synthetic readback buffer with a mix of multi-bounce hits, hits without line-of-sight and unknown primitives
+	void GenerateRawOutput(const int32 NumberOfRays, const int32 MaximumBounces, const int32 NumberOfPrimitives, TArray<FStructuredOutputBufferElem>& OutRawOutput)
+	{
+		FRandomStream RandomStream(1234);
+		OutRawOutput.SetNumZeroed(NumberOfRays * MaximumBounces);
+		for (int32 RayIndex = 0; RayIndex < NumberOfRays; RayIndex++)
+		{
+			const int32 NumberOfHits = RandomStream.RandRange(0, MaximumBounces);
+			for (int32 BounceIndex = 0; BounceIndex < NumberOfHits; BounceIndex++)
+			{
+				FStructuredOutputBufferElem& Output = OutRawOutput[RayIndex * MaximumBounces + BounceIndex];
+				Output.IsHit = true;
+				Output.HitPosX = RandomStream.FRandRange(-1000.0f, 1000.0f);
+				Output.HitPosY = RandomStream.FRandRange(-1000.0f, 1000.0f);
+				Output.HitPosZ = RandomStream.FRandRange(0.0f, 500.0f);
+				Output.HitReflectionZ = 1.0f;
+				Output.HitScenePrimitiveIndex = RandomStream.RandRange(0, NumberOfPrimitives + 1);
+				Output.HitTriangleIndex = RandomStream.RandRange(0, 15);
+				Output.RayDistanceTotal = RandomStream.FRandRange(10.0f, 5000.0f);
+				Output.HitLineOfSightToSensor = BounceIndex == 0 || RandomStream.FRand() > 0.3f;
+				Output.DistancesFromEmitterTotal[0] = Output.RayDistanceTotal;
+			}
+		}
+	}
+
+	// Serial reference implementation with the hashed tables the parser replaced
+	void ParseSerial(const FSonoTraceUEParseContext& Context, const TMap<int32, int32>& ScenePrimitiveIndexToPersistentPrimitiveIndex, TArray<FSonoTraceUEPointStruct>& OutPoints, TArray<int32>& OutHitPersistentPrimitiveIndexes)
+	{
+		const FName UnknownObjectName = FName(TEXT("UNKNOWN"));
+		for (int32 RayIndex = 0; RayIndex < Context.NumberOfRays; RayIndex++)
+		{
+			bool CurrentRayIsHitting = false;
+			TArray<float> CachedSourceDirectivities;
+			CachedSourceDirectivities.Init(1.0f, Context.EmitterPoses.Num());
+			for (int32 BounceIndex = 0; BounceIndex < Context.MaximumBounces; BounceIndex++)
+			{
+				const int32 OutputIndex = RayIndex * Context.MaximumBounces + BounceIndex;
+				const FStructuredOutputBufferElem& Output = Context.RawOutput[OutputIndex];
+				if (!Output.IsHit)
+				{
+					if (CurrentRayIsHitting)
+						OutPoints.Last().IsLastHit = true;
+					break;
+				}
+				CurrentRayIsHitting = true;
+				if (!Output.HitLineOfSightToSensor)
+					continue;
+				int32 PersistentPrimitiveIndex = -1;
+				if (const int32* Found = ScenePrimitiveIndexToPersistentPrimitiveIndex.Find(Output.HitScenePrimitiveIndex))
+					PersistentPrimitiveIndex = *Found;
+				OutHitPersistentPrimitiveIndexes.AddUnique(PersistentPrimitiveIndex);
+				const FVector HitLocation(Output.HitPosX, Output.HitPosY, Output.HitPosZ);
+				TArray<float> RayDistancesTotalFromEmitters;
+				RayDistancesTotalFromEmitters.Append(Output.DistancesFromEmitterTotal, Context.EmitterPoses.Num());
+				OutPoints.Emplace(HitLocation, FVector(Output.HitReflectionX, Output.HitReflectionY, Output.HitReflectionZ),
+				                  PersistentPrimitiveIndex == -1 ? UnknownObjectName : FName(*FString::Printf(TEXT("Object_%d"), PersistentPrimitiveIndex)),
+				                  OutputIndex, Output.RayDistanceTotal, RayDistancesTotalFromEmitters, FVector::Distance(HitLocation, Context.SensorLocation),
+				                  0, 0.0f, Context.DefaultTriangleBRDF, Context.DefaultTriangleMaterial, RayIndex, BounceIndex, CachedSourceDirectivities);
+			}
+		}
+	}
+
+	// Parse context over a synthetic readback, the last two scene primitive indexes are left out of the tables to exercise the unknown object path
+	struct FParserFixture
+	{
+		static constexpr int32 MaximumBounces = 3;
+		static constexpr int32 NumberOfPrimitives = 64;
+
+		TArray<FStructuredOutputBufferElem> RawOutput;
+		FSonoTraceUEPrimitiveLookup Lookup;
+		TMap<int32, int32> ScenePrimitiveIndexToPersistentPrimitiveIndex;
+		TArray<float> DefaultTriangleBRDF;
+		TArray<float> DefaultTriangleMaterial;
+		FSonoTraceUEParseContext Context;
+
+		explicit FParserFixture(const int32 NumberOfRays)
+		{
+			GenerateRawOutput(NumberOfRays, MaximumBounces, NumberOfPrimitives, RawOutput);
+			for (int32 ScenePrimitiveIndex = 0; ScenePrimitiveIndex < NumberOfPrimitives; ScenePrimitiveIndex++)
+			{
+				const int32 PersistentPrimitiveIndex = ScenePrimitiveIndex * 3 + 7;
+				Lookup.Add(ScenePrimitiveIndex, PersistentPrimitiveIndex, FName(*FString::Printf(TEXT("Object_%d"), PersistentPrimitiveIndex)), 0, INDEX_NONE);
+				ScenePrimitiveIndexToPersistentPrimitiveIndex.Add(ScenePrimitiveIndex, PersistentPrimitiveIndex);
+			}
+			DefaultTriangleBRDF.Init(1.0f, 8);
+			DefaultTriangleMaterial.Init(1.0f, 8);
+
+			Context.RawOutput = RawOutput.GetData();
+			Context.NumberOfRays = NumberOfRays;
+			Context.MaximumBounces = MaximumBounces;
+			Context.EmitterPoses.Add(FTransform::Identity);
+			Context.EmitterDirectivities.Add(0.0f);
+			Context.PrimitiveLookup = &Lookup;
+			Context.DefaultTriangleBRDF = &DefaultTriangleBRDF;
+			Context.DefaultTriangleMaterial = &DefaultTriangleMaterial;
+		}
+	};
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(SonoTraceUEParser_Tests, "SonoTraceUE.Parser.Test", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::SmokeFilter)
+
+bool SonoTraceUEParser_Tests::RunTest(const FString& Parameters)
+{
+	// Enough rays for several chunks and a partial last chunk
+	const int32 NumberOfRays = 5000;
+	const SonoTraceUEParserTest::FParserFixture Fixture(NumberOfRays);
+	const FSonoTraceUEParseContext& Context = Fixture.Context;
+	const int32 NumberOfPrimitives = SonoTraceUEParserTest::FParserFixture::NumberOfPrimitives;
+
+	{
+		const TArray<int32> UnknownScenePrimitiveIndexes = FSonoTraceUEParser::FindUnknownScenePrimitiveIndexes(Context);
+		TestEqual(TEXT("check unknown primitive count"), UnknownScenePrimitiveIndexes.Num(), 2);
+		if (UnknownScenePrimitiveIndexes.Num() == 2)
+		{
+			TestEqual(TEXT("check unknown primitive 1"), UnknownScenePrimitiveIndexes[0], NumberOfPrimitives);
+			TestEqual(TEXT("check unknown primitive 2"), UnknownScenePrimitiveIndexes[1], NumberOfPrimitives + 1);
+		}
+	}
+
+	{
+		TArray<FSonoTraceUEPointStruct> ReferencePoints;
+		TArray<int32> ReferenceHitPersistentPrimitiveIndexes;
+		SonoTraceUEParserTest::ParseSerial(Context, Fixture.ScenePrimitiveIndexToPersistentPrimitiveIndex, ReferencePoints, ReferenceHitPersistentPrimitiveIndexes);
+		FSonoTraceUESubOutputStruct SubOutput;
+		FSonoTraceUEParser::Parse(Context, SubOutput);
+
+		TestEqual(TEXT("check point count"), SubOutput.ReflectedPoints.Num(), ReferencePoints.Num());
+		if (SubOutput.ReflectedPoints.Num() == ReferencePoints.Num())
+		{
+			int32 Mismatches = 0;
+			float MaximumTotalDistance = 0.0f;
+			for (int32 PointIndex = 0; PointIndex < ReferencePoints.Num(); PointIndex++)
+			{
+				const FSonoTraceUEPointStruct& Point = SubOutput.ReflectedPoints[PointIndex];
+				const FSonoTraceUEPointStruct& ReferencePoint = ReferencePoints[PointIndex];
+				if (Point.Index != ReferencePoint.Index || Point.IsLastHit != ReferencePoint.IsLastHit || Point.Label != ReferencePoint.Label || Point.Location != ReferencePoint.Location)
+					Mismatches++;
+				MaximumTotalDistance = FMath::Max(MaximumTotalDistance, ReferencePoint.TotalDistance);
+			}
+			TestEqual(TEXT("check point order and content"), Mismatches, 0);
+			TestEqual(TEXT("check maximum total distance"), SubOutput.MaximumTotalDistance, MaximumTotalDistance);
+		}
+
+		ReferenceHitPersistentPrimitiveIndexes.Sort();
+		TArray<int32> HitPersistentPrimitiveIndexes = SubOutput.HitPersistentPrimitiveIndexes;
+		HitPersistentPrimitiveIndexes.Sort();
+		TestTrue(TEXT("check hit primitives"), HitPersistentPrimitiveIndexes == ReferenceHitPersistentPrimitiveIndexes);
+	}
+
+	{
+		FSonoTraceUEStagingBufferPool StagingBufferPool;
+		TSharedPtr<TArray<FStructuredOutputBufferElem>, ESPMode::ThreadSafe> HeldBuffer = StagingBufferPool.Acquire(16);
+		const TArray<FStructuredOutputBufferElem>* ReleasedBuffer = &StagingBufferPool.Acquire(32).Get();
+		TestEqual(TEXT("check staging buffer pool size"), StagingBufferPool.Num(), 2);
+		TestTrue(TEXT("check released staging buffer is reused"), &StagingBufferPool.Acquire(8).Get() == ReleasedBuffer);
+		TestEqual(TEXT("check staging buffer pool size after reuse"), StagingBufferPool.Num(), 2);
+		TestEqual(TEXT("check held staging buffer size"), HeldBuffer->Num(), 16);
+	}
+
+	{
+		FSonoTraceUEParseContext EmptyContext;
+		FSonoTraceUESubOutputStruct SubOutput;
+		FSonoTraceUEParser::Parse(EmptyContext, SubOutput);
+		TestEqual(TEXT("check empty parse"), SubOutput.ReflectedPoints.Num(), 0);
+	}
+
+	return true;
+}
+
+// Parsing a full readback with the serial reference against the parallel parser
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(SonoTraceUEParser_PerfTests, "SonoTraceUE.Parser.Perf", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::PerfFilter)
+
+bool SonoTraceUEParser_PerfTests::RunTest(const FString& Parameters)
+{
+	const int32 NumberOfRays = 50000;
+	const SonoTraceUEParserTest::FParserFixture Fixture(NumberOfRays);
+
+	TArray<FSonoTraceUEPointStruct> ReferencePoints;
+	TArray<int32> ReferenceHitPersistentPrimitiveIndexes;
+	double StartTime = FPlatformTime::Seconds();
+	SonoTraceUEParserTest::ParseSerial(Fixture.Context, Fixture.ScenePrimitiveIndexToPersistentPrimitiveIndex, ReferencePoints, ReferenceHitPersistentPrimitiveIndexes);
+	const double SerialTime = FPlatformTime::Seconds() - StartTime;
+
+	FSonoTraceUESubOutputStruct SubOutput;
+	StartTime = FPlatformTime::Seconds();
+	FSonoTraceUEParser::Parse(Fixture.Context, SubOutput);
+	const double ParallelTime = FPlatformTime::Seconds() - StartTime;
+	AddInfo(FString::Printf(TEXT("Parsed %d rays with %d bounces. Serial: %.5fs, parallel: %.5fs"), NumberOfRays, SonoTraceUEParserTest::FParserFixture::MaximumBounces, SerialTime, ParallelTime));
+	TestEqual(TEXT("check point count"), SubOutput.ReflectedPoints.Num(), ReferencePoints.Num());
+
+	return true;
+}
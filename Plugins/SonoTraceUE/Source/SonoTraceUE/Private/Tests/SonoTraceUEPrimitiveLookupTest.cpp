@@ -0,0 +1,153 @@
+// By Wouter Jansen & Jan Steckel, Cosys-Lab, University of Antwerp. See the LICENSE file for details.
+
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+#include "SonoTraceUEParser.h"
+
+namespace SonoTraceUEPrimitiveLookupTest
+{
+	struct FScenarioResult
+	{
+		bool AllEqual = true;
+		bool HeldUnchanged = true;
+		double IncrementalTime = 0.0;
+		double RebuildTime = 0.0;
+		int32 NumPendingChanges = 0;
+	};
+
+	// Spawns and despawns primitives every frame and compares every published lookup against a lookup rebuilt from scratch
+	FScenarioResult RunScenario(const int32 NumberOfPrimitives, const int32 NumberOfFrames, const int32 ChangesPerFrame)
+	{
+		FScenarioResult Result;
+		FSonoTraceUEPrimitiveLookupBuffer LookupBuffer;
+
+		// Reference of PPI to SPI, as kept by the mesh registry
+		TMap<int32, int32> PersistentPrimitiveIndexToScenePrimitiveIndex;
+		auto SetScenePrimitiveIndex = [&](const int32 PersistentPrimitiveIndex, const int32 ScenePrimitiveIndex)
+		{
+			if (const int32* PreviousScenePrimitiveIndex = PersistentPrimitiveIndexToScenePrimitiveIndex.Find(PersistentPrimitiveIndex))
+			{
+				if (*PreviousScenePrimitiveIndex != ScenePrimitiveIndex)
+					LookupBuffer.Remove(*PreviousScenePrimitiveIndex, PersistentPrimitiveIndex);
+			}
+			PersistentPrimitiveIndexToScenePrimitiveIndex.Add(PersistentPrimitiveIndex, ScenePrimitiveIndex);
+			LookupBuffer.Add(ScenePrimitiveIndex, PersistentPrimitiveIndex, FName(TEXT("Object"), PersistentPrimitiveIndex), PersistentPrimitiveIndex % 4, PersistentPrimitiveIndex % 7);
+		};
+		auto BuildReference = [&]()
+		{
+			FSonoTraceUEPrimitiveLookup Lookup;
+			for (const TPair<int32, int32>& PersistentPrimitiveIndexAndScenePrimitiveIndex : PersistentPrimitiveIndexToScenePrimitiveIndex)
+			{
+				const int32 PersistentPrimitiveIndex = PersistentPrimitiveIndexAndScenePrimitiveIndex.Key;
+				Lookup.Add(PersistentPrimitiveIndexAndScenePrimitiveIndex.Value, PersistentPrimitiveIndex, FName(TEXT("Object"), PersistentPrimitiveIndex), PersistentPrimitiveIndex % 4, PersistentPrimitiveIndex % 7);
+			}
+			return Lookup;
+		};
+		auto IsEqual = [](const FSonoTraceUEPrimitiveLookup& Lookup, const FSonoTraceUEPrimitiveLookup& Reference)
+		{
+			for (int32 ScenePrimitiveIndex = 0; ScenePrimitiveIndex < FMath::Max(Lookup.Num(), Reference.Num()); ScenePrimitiveIndex++)
+			{
+				if (Lookup.Contains(ScenePrimitiveIndex) != Reference.Contains(ScenePrimitiveIndex))
+					return false;
+				if (Reference.Contains(ScenePrimitiveIndex) &&
+					(Lookup.PersistentPrimitiveIndexes[ScenePrimitiveIndex] != Reference.PersistentPrimitiveIndexes[ScenePrimitiveIndex] ||
+					 Lookup.Labels[ScenePrimitiveIndex] != Reference.Labels[ScenePrimitiveIndex] ||
+					 Lookup.ObjectTypeIndexes[ScenePrimitiveIndex] != Reference.ObjectTypeIndexes[ScenePrimitiveIndex] ||
+					 Lookup.MeshDataIndexes[ScenePrimitiveIndex] != Reference.MeshDataIndexes[ScenePrimitiveIndex]))
+					return false;
+			}
+			return true;
+		};
+
+		// Scene of which the slots are reused by spawned primitives and compacted by moving the last primitive into a removed slot
+		FRandomStream RandomStream(1234);
+		TArray<int32> ScenePrimitives;
+		int32 NextPersistentPrimitiveIndex = 0;
+		for (int32 PrimitiveIndex = 0; PrimitiveIndex < NumberOfPrimitives; PrimitiveIndex++)
+		{
+			ScenePrimitives.Add(NextPersistentPrimitiveIndex);
+			SetScenePrimitiveIndex(NextPersistentPrimitiveIndex++, PrimitiveIndex);
+		}
+		LookupBuffer.Publish();
+
+		// Tables held by the parse tasks of the sensors together with a copy to check they are never modified
+		TArray<TPair<FSonoTraceUEPrimitiveLookupBuffer::FLookupPtr, FSonoTraceUEPrimitiveLookup>> HeldLookups;
+		for (int32 FrameIndex = 0; FrameIndex < NumberOfFrames; FrameIndex++)
+		{
+			for (int32 ChangeIndex = 0; ChangeIndex < ChangesPerFrame; ChangeIndex++)
+			{
+				const int32 ScenePrimitiveIndex = RandomStream.RandHelper(ScenePrimitives.Num());
+				if (RandomStream.FRand() < 0.5f)
+				{
+					// Despawn and compact
+					PersistentPrimitiveIndexToScenePrimitiveIndex.Remove(ScenePrimitives[ScenePrimitiveIndex]);
+					LookupBuffer.Remove(ScenePrimitiveIndex, ScenePrimitives[ScenePrimitiveIndex]);
+					ScenePrimitives.RemoveAtSwap(ScenePrimitiveIndex);
+					if (ScenePrimitives.IsValidIndex(ScenePrimitiveIndex))
+						SetScenePrimitiveIndex(ScenePrimitives[ScenePrimitiveIndex], ScenePrimitiveIndex);
+				}else
+				{
+					// Spawn
+					ScenePrimitives.Add(NextPersistentPrimitiveIndex);
+					SetScenePrimitiveIndex(NextPersistentPrimitiveIndex++, ScenePrimitives.Num() - 1);
+				}
+			}
+
+			double StartTime = FPlatformTime::Seconds();
+			const FSonoTraceUEPrimitiveLookupBuffer::FLookupPtr Lookup = LookupBuffer.Publish();
+			Result.IncrementalTime += FPlatformTime::Seconds() - StartTime;
+
+			StartTime = FPlatformTime::Seconds();
+			const FSonoTraceUEPrimitiveLookup Reference = BuildReference();
+			Result.RebuildTime += FPlatformTime::Seconds() - StartTime;
+			Result.AllEqual &= IsEqual(*Lookup, Reference);
+
+			for (const TPair<FSonoTraceUEPrimitiveLookupBuffer::FLookupPtr, FSonoTraceUEPrimitiveLookup>& HeldLookup : HeldLookups)
+			{
+				Result.HeldUnchanged &= IsEqual(*HeldLookup.Key, HeldLookup.Value);
+			}
+			// Usually the previous table is released before the next publish, every fourth frame both tables stay held
+			if (FrameIndex % 4 != 0)
+				HeldLookups.Empty();
+			HeldLookups.Emplace(Lookup, *Lookup);
+		}
+		Result.NumPendingChanges = LookupBuffer.NumPendingChanges();
+		return Result;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(SonoTraceUEPrimitiveLookup_Tests, "SonoTraceUE.PrimitiveLookup.Test", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::SmokeFilter)
+
+bool SonoTraceUEPrimitiveLookup_Tests::RunTest(const FString& Parameters)
+{
+	const SonoTraceUEPrimitiveLookupTest::FScenarioResult Result = SonoTraceUEPrimitiveLookupTest::RunScenario(2000, 50, 20);
+	TestTrue(TEXT("check published lookup equals rebuilt lookup"), Result.AllEqual);
+	TestTrue(TEXT("check held lookup is never modified"), Result.HeldUnchanged);
+	TestEqual(TEXT("check no pending changes"), Result.NumPendingChanges, 0);
+
+	// Removing a slot that another primitive was moved into keeps the moved primitive
+	FSonoTraceUEPrimitiveLookupBuffer MoveBuffer;
+	MoveBuffer.Add(0, 10, NAME_None, 0, INDEX_NONE);
+	MoveBuffer.Add(0, 11, NAME_None, 0, INDEX_NONE);
+	MoveBuffer.Remove(0, 10);
+	const FSonoTraceUEPrimitiveLookupBuffer::FLookupPtr MovedLookup = MoveBuffer.Publish();
+	TestTrue(TEXT("check moved primitive is kept"), MovedLookup->Contains(0) && MovedLookup->PersistentPrimitiveIndexes[0] == 11);
+
+	return true;
+}
+
+// Publishing the lookup of a large scene incrementally against rebuilding it every frame
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(SonoTraceUEPrimitiveLookup_PerfTests, "SonoTraceUE.PrimitiveLookup.Perf", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::PerfFilter)
+
+bool SonoTraceUEPrimitiveLookup_PerfTests::RunTest(const FString& Parameters)
+{
+	const int32 NumberOfPrimitives = 20000;
+	const int32 NumberOfFrames = 200;
+	const int32 ChangesPerFrame = 20;
+	const SonoTraceUEPrimitiveLookupTest::FScenarioResult Result = SonoTraceUEPrimitiveLookupTest::RunScenario(NumberOfPrimitives, NumberOfFrames, ChangesPerFrame);
+	AddInfo(FString::Printf(TEXT("Lookup of %d primitives with %d changes per frame. Rebuild: %.6fs, incremental: %.6fs per frame"),
+	                        NumberOfPrimitives, ChangesPerFrame, Result.RebuildTime / NumberOfFrames, Result.IncrementalTime / NumberOfFrames));
+	TestTrue(TEXT("check published lookup equals rebuilt lookup"), Result.AllEqual);
+
+	return true;
+}
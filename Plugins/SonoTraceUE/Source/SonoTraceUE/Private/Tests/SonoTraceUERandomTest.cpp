@@ -0,0 +1,172 @@
+// By Wouter Jansen & Jan Steckel, Cosys-Lab, University of Antwerp. See the LICENSE file for details.
+
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+#include "Async/ParallelFor.h"
+#include "SonoTraceUERandom.h"
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(SonoTraceUERandom_Tests, "SonoTraceUE.Random.Test", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::SmokeFilter)
+
+bool SonoTraceUERandom_Tests::RunTest(const FString& Parameters)
+{
+	{
+		// Known answers of the Random123 reference implementation of Philox4x32-10
+		auto CheckKnownAnswer = [this](const uint32 Key0, const uint32 Key1, const uint32 (&Counter)[4], const uint32 (&Expected)[4])
+		{
+			uint32 Words[4];
+			FSonoTraceUEPhilox(Key0, Key1).Generate(Counter, Words);
+			TestTrue(FString::Printf(TEXT("check known answer %08x %08x %08x %08x"), Expected[0], Expected[1], Expected[2], Expected[3]),
+				Words[0] == Expected[0] && Words[1] == Expected[1] && Words[2] == Expected[2] && Words[3] == Expected[3]);
+		};
+		CheckKnownAnswer(0, 0, {0, 0, 0, 0}, {0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8});
+		CheckKnownAnswer(0xffffffff, 0xffffffff, {0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff}, {0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd});
+		CheckKnownAnswer(0xa4093822, 0x299f31d0, {0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344}, {0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1});
+	}
+
+	{
+		// Drawing in parallel gives the same numbers as drawing serially, the streams differ and the uniforms stay in [0, 1)
+		const int32 NumberOfSamples = 10000;
+		const FSonoTraceUEPhilox Random(1234, FSonoTraceUEPhilox::EStream::Diffraction);
+		const FSonoTraceUEPhilox OtherStreamRandom(1234, FSonoTraceUEPhilox::EStream::DrawSelection);
+		TArray<float> SerialUniforms;
+		SerialUniforms.SetNumUninitialized(NumberOfSamples * 4);
+		for (int32 SampleIndex = 0; SampleIndex < NumberOfSamples; SampleIndex++)
+		{
+			float Uniforms[4];
+			Random.GetUniforms(7, 42, SampleIndex, 0, Uniforms);
+			FMemory::Memcpy(&SerialUniforms[SampleIndex * 4], Uniforms, sizeof(Uniforms));
+		}
+		TArray<float> ParallelUniforms;
+		ParallelUniforms.SetNumUninitialized(NumberOfSamples * 4);
+		ParallelFor(NumberOfSamples, [&](const int32 SampleIndex)
+		{
+			float Uniforms[4];
+			Random.GetUniforms(7, 42, SampleIndex, 0, Uniforms);
+			FMemory::Memcpy(&ParallelUniforms[SampleIndex * 4], Uniforms, sizeof(Uniforms));
+		});
+		TestTrue(TEXT("check parallel draws reproduce serial draws"), SerialUniforms == ParallelUniforms);
+
+		int32 OutOfRange = 0;
+		double Sum = 0.0;
+		for (const float Uniform : SerialUniforms)
+		{
+			OutOfRange += Uniform < 0.0f || Uniform >= 1.0f;
+			Sum += Uniform;
+		}
+		TestEqual(TEXT("check uniforms in [0, 1)"), OutOfRange, 0);
+		TestTrue(TEXT("check uniform mean"), FMath::Abs(Sum / SerialUniforms.Num() - 0.5) < 0.005);
+		TestTrue(TEXT("check largest uniform below one"), FSonoTraceUEPhilox::ToUniform(0xffffffff) < 1.0f);
+
+		float Uniforms[4];
+		float OtherUniforms[4];
+		Random.GetUniforms(7, 42, 0, 0, Uniforms);
+		OtherStreamRandom.GetUniforms(7, 42, 0, 0, OtherUniforms);
+		TestTrue(TEXT("check streams differ"), Uniforms[0] != OtherUniforms[0]);
+		Random.GetUniforms(8, 42, 0, 0, OtherUniforms);
+		TestTrue(TEXT("check measurements differ"), Uniforms[0] != OtherUniforms[0]);
+	}
+
+	{
+		// The unscrambled sequence starts with the van der Corput points in the first dimension
+		const float Expected[8] = {0.0f, 0.5f, 0.25f, 0.75f, 0.125f, 0.625f, 0.375f, 0.875f};
+		int32 Mismatches = 0;
+		for (int32 Index = 0; Index < 8; Index++)
+		{
+			Mismatches += FSonoTraceUEPhilox::ToUniform(FSonoTraceUESobol::Generate(Index, 0)) != Expected[Index];
+		}
+		TestEqual(TEXT("check first Sobol dimension"), Mismatches, 0);
+
+		// Scrambling keeps the stratification, 256 points put one point in every 1/256 interval of every dimension and in every 16 x 16 cell of the first two dimensions
+		int32 BadCells = 0;
+		for (uint32 Seed = 0; Seed < 8; Seed++)
+		{
+			TArray<float> Points;
+			for (int32 Index = 0; Index < 256; Index++)
+			{
+				float Uniforms[FSonoTraceUESobol::NumberOfDimensions];
+				FSonoTraceUESobol::GetUniforms(Index, Seed * 7919u, Uniforms);
+				Points.Append(Uniforms, FSonoTraceUESobol::NumberOfDimensions);
+			}
+			for (int32 Dimension = 0; Dimension < FSonoTraceUESobol::NumberOfDimensions; Dimension++)
+			{
+				TArray<int32> Intervals;
+				Intervals.SetNumZeroed(256);
+				for (int32 Index = 0; Index < 256; Index++)
+				{
+					Intervals[FMath::FloorToInt32(Points[Index * FSonoTraceUESobol::NumberOfDimensions + Dimension] * 256.0f)]++;
+				}
+				for (const int32 Interval : Intervals)
+					BadCells += Interval != 1;
+			}
+			TArray<int32> Cells;
+			Cells.SetNumZeroed(256);
+			for (int32 Index = 0; Index < 256; Index++)
+			{
+				const int32 X = FMath::FloorToInt32(Points[Index * FSonoTraceUESobol::NumberOfDimensions] * 16.0f);
+				const int32 Y = FMath::FloorToInt32(Points[Index * FSonoTraceUESobol::NumberOfDimensions + 1] * 16.0f);
+				Cells[Y * 16 + X]++;
+			}
+			for (const int32 Cell : Cells)
+				BadCells += Cell != 1;
+		}
+		TestEqual(TEXT("check scrambled Sobol stratification"), BadCells, 0);
+
+		// Integrating a smooth function with scrambled Sobol points has a much smaller error than with independent samples
+		const int32 NumberOfPoints = 1024;
+		const int32 NumberOfRuns = 32;
+		double RandomSquaredError = 0.0;
+		double SobolSquaredError = 0.0;
+		const FSonoTraceUEPhilox Random(99, FSonoTraceUEPhilox::EStream::Diffraction);
+		for (int32 Run = 0; Run < NumberOfRuns; Run++)
+		{
+			double RandomSum = 0.0;
+			double SobolSum = 0.0;
+			for (int32 Index = 0; Index < NumberOfPoints; Index++)
+			{
+				float Uniforms[4];
+				Random.GetUniforms(Run, 0, Index, 0, Uniforms);
+				RandomSum += Uniforms[0] * Uniforms[1] + Uniforms[2] * Uniforms[3];
+				FSonoTraceUESobol::GetUniforms(Index, Run * 104729u + 1u, Uniforms);
+				SobolSum += Uniforms[0] * Uniforms[1] + Uniforms[2] * Uniforms[3];
+			}
+			RandomSquaredError += FMath::Square(RandomSum / NumberOfPoints - 0.5);
+			SobolSquaredError += FMath::Square(SobolSum / NumberOfPoints - 0.5);
+		}
+		const double RandomError = FMath::Sqrt(RandomSquaredError / NumberOfRuns);
+		const double SobolError = FMath::Sqrt(SobolSquaredError / NumberOfRuns);
+		AddInfo(FString::Printf(TEXT("RMS integration error with %d points. Random: %.6f, Sobol: %.6f"), NumberOfPoints, RandomError, SobolError));
+		TestTrue(TEXT("check Sobol integrates more accurately"), SobolError < 0.5 * RandomError);
+	}
+
+	return true;
+}
+
+// Drawing counter based uniforms against the sequential FRandomStream
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(SonoTraceUERandom_PerfTests, "SonoTraceUE.Random.Perf", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::PerfFilter)
+
+bool SonoTraceUERandom_PerfTests::RunTest(const FString& Parameters)
+{
+	const int32 NumberOfSamples = 100000;
+	const FSonoTraceUEPhilox Random(1234, FSonoTraceUEPhilox::EStream::Diffraction);
+
+	double StartTime = FPlatformTime::Seconds();
+	FRandomStream RandomStream(1234);
+	float StreamSum = 0.0f;
+	for (int32 Index = 0; Index < NumberOfSamples * 4; Index++)
+	{
+		StreamSum += RandomStream.FRand();
+	}
+	const double StreamTime = FPlatformTime::Seconds() - StartTime;
+	StartTime = FPlatformTime::Seconds();
+	float PhiloxSum = 0.0f;
+	for (int32 SampleIndex = 0; SampleIndex < NumberOfSamples; SampleIndex++)
+	{
+		float Uniforms[4];
+		Random.GetUniforms(7, 42, SampleIndex, 0, Uniforms);
+		PhiloxSum += Uniforms[0] + Uniforms[1] + Uniforms[2] + Uniforms[3];
+	}
+	const double PhiloxTime = FPlatformTime::Seconds() - StartTime;
+	AddInfo(FString::Printf(TEXT("Drew %d uniforms. FRandomStream: %.5fs, Philox: %.5fs (sums %.1f, %.1f)"), NumberOfSamples * 4, StreamTime, PhiloxTime, StreamSum, PhiloxSum));
+
+	return true;
+}
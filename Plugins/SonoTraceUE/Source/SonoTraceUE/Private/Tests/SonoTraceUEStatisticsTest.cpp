@@ -0,0 +1,51 @@
+// By Wouter Jansen & Jan Steckel, Cosys-Lab, University of Antwerp. See the LICENSE file for details.
+
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+#include "SonoTraceUEStatistics.h"
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(SonoTraceUEStatistics_Tests, "SonoTraceUE.Statistics.Test", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::SmokeFilter)
+
+bool SonoTraceUEStatistics_Tests::RunTest(const FString& Parameters)
+{
+	const int32 NumberOfPoints = 10000;
+
+	FRandomStream RandomStream(1234);
+	TArray<FVector3f> Points;
+	Points.SetNumUninitialized(NumberOfPoints);
+	for (FVector3f& Point : Points)
+	{
+		Point = FVector3f(RandomStream.FRandRange(0.0f, 10.0f), RandomStream.FRandRange(0.0f, 2.0f), RandomStream.FRandRange(0.0f, 5000.0f));
+	}
+
+	{
+		// Every second point is skipped to check the hit count
+		FSonoTraceUEPointStatistics ReferenceStatistics;
+		for (int32 PointIndex = 0; PointIndex < NumberOfPoints; PointIndex += 2)
+		{
+			ReferenceStatistics.Add(Points[PointIndex].X, Points[PointIndex].Y, Points[PointIndex].Z);
+		}
+
+		const FSonoTraceUEPointStatistics Statistics = ParallelForWithStatistics(NumberOfPoints, [&](FSonoTraceUEPointStatistics& WorkerStatistics, const int32 PointIndex)
+		{
+			if (PointIndex % 2 == 0)
+				WorkerStatistics.Add(Points[PointIndex].X, Points[PointIndex].Y, Points[PointIndex].Z);
+		});
+
+		TestEqual(TEXT("check hit count"), Statistics.NumberOfHits, ReferenceStatistics.NumberOfHits);
+		TestEqual(TEXT("check maximum strength"), Statistics.MaximumStrength, ReferenceStatistics.MaximumStrength);
+		TestEqual(TEXT("check maximum curvature"), Statistics.MaximumCurvature, ReferenceStatistics.MaximumCurvature);
+		TestEqual(TEXT("check maximum total distance"), Statistics.MaximumTotalDistance, ReferenceStatistics.MaximumTotalDistance);
+	}
+
+	{
+		const FSonoTraceUEPointStatistics Statistics = ParallelForWithStatistics(0, [&](FSonoTraceUEPointStatistics& WorkerStatistics, const int32 PointIndex)
+		{
+			WorkerStatistics.Add(1.0f, 1.0f, 1.0f);
+		});
+		TestEqual(TEXT("check empty hit count"), Statistics.NumberOfHits, 0);
+		TestEqual(TEXT("check empty maximum strength"), Statistics.MaximumStrength, 0.0f);
+	}
+
+	return true;
+}
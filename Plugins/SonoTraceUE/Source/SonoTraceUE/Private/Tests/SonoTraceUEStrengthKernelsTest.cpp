@@ -0,0 +1,282 @@
+// By Wouter Jansen & Jan Steckel, Cosys-Lab, University of Antwerp. See the LICENSE file for details.
+
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+#include "SonoTraceUEStrengthKernels.h"
+
+namespace SonoTraceUEStrengthKernelsTest
+{
+	constexpr int32 NumberOfPoints = 200;
+	constexpr int32 NumberOfEmitters = 2;
+	constexpr int32 NumberOfReceivers = 32;
+	constexpr int32 NumberOfFrequencies = 64;
+	constexpr int32 NumberOfPaths = NumberOfEmitters * NumberOfReceivers;
+
+	// Random but physically plausible inputs for every point
+	struct FPointInput
+	{
+		TArray<float> ReflectionCosines;
+		TArray<float> Scales;
+		TArray<float> Distances; // Meters
+		float AbsorptionDistance = 0.0f; // Meters
+	};
+
+	// Scalar per frequency evaluation as the simulation did before the kernels, used as reference
+	float AlphaAbsorption(const float Frequency)
+	{
+		return 0.038 * (Frequency / 1000) - 0.3;
+	}
+
+	float SpecularReference(TArray<float>& OutStrengths, const FPointInput& Point, const TArray<float>& SurfaceBRDF, const TArray<float>& SurfaceMaterial, const TArray<float>& Frequencies)
+	{
+		float SummedSquaredStrength = 0.0f;
+		for (int32 PathIndex = 0; PathIndex < NumberOfPaths; PathIndex++)
+		{
+			const float AngleReflection = FMath::RadiansToDegrees(FMath::Acos(Point.ReflectionCosines[PathIndex]));
+			for (int32 FrequencyIndex = 0; FrequencyIndex < NumberOfFrequencies; FrequencyIndex++)
+			{
+				const float SurfaceBRDFExponent = -1 / (2 * SurfaceBRDF[FrequencyIndex] * SurfaceBRDF[FrequencyIndex]);
+				const float PathlossAbsorption = FMath::Pow(10.0f, -(AlphaAbsorption(Frequencies[FrequencyIndex]) * Point.AbsorptionDistance) / 20);
+				const float ReflectionStrengthBRDF = exp(SurfaceBRDFExponent * (AngleReflection * AngleReflection));
+				const float Strength = ReflectionStrengthBRDF * Point.Scales[PathIndex] * SurfaceMaterial[FrequencyIndex] * PathlossAbsorption;
+				OutStrengths[PathIndex * NumberOfFrequencies + FrequencyIndex] = Strength;
+				SummedSquaredStrength += Strength * Strength;
+			}
+		}
+		return SummedSquaredStrength;
+	}
+
+	float DiffractionReference(TArray<float>& OutStrengths, const FPointInput& Point, const TArray<float>& MaterialStrengths, const TArray<float>& Frequencies)
+	{
+		float SummedSquaredStrength = 0.0f;
+		for (int32 PathIndex = 0; PathIndex < NumberOfPaths; PathIndex++)
+		{
+			for (int32 FrequencyIndex = 0; FrequencyIndex < NumberOfFrequencies; FrequencyIndex++)
+			{
+				const float PathLossDiff = 1.0f / FMath::Square(Point.Distances[PathIndex]);
+				const float PathLossAbsorption = FMath::Pow(10.0f, -(AlphaAbsorption(Frequencies[FrequencyIndex]) * Point.Distances[PathIndex]) / 20.0f);
+				const float Strength = MaterialStrengths[FrequencyIndex] * PathLossDiff * PathLossAbsorption;
+				OutStrengths[PathIndex * NumberOfFrequencies + FrequencyIndex] = Strength;
+				SummedSquaredStrength += Strength * Strength;
+			}
+		}
+		return SummedSquaredStrength;
+	}
+
+	float DirectPathReference(TArray<float>& OutStrengths, const FPointInput& Point, const float DirectPathStrength, const TArray<float>& Frequencies)
+	{
+		float SummedSquaredStrength = 0.0f;
+		for (int32 PathIndex = 0; PathIndex < NumberOfPaths; PathIndex++)
+		{
+			const float Distance = Point.Distances[PathIndex];
+			for (int32 FrequencyIndex = 0; FrequencyIndex < NumberOfFrequencies; FrequencyIndex++)
+			{
+				float Strength = 0.0f;
+				if (Distance > 0.0f)
+				{
+					const float PathlossAbsorption = FMath::Pow(10.0f, -(AlphaAbsorption(Frequencies[FrequencyIndex]) * Distance) / 20);
+					Strength = DirectPathStrength / FMath::Square(Distance) * PathlossAbsorption;
+				}
+				OutStrengths[PathIndex * NumberOfFrequencies + FrequencyIndex] = Strength;
+				SummedSquaredStrength += Strength * Strength;
+			}
+		}
+		return SummedSquaredStrength;
+	}
+
+	// Counts the values that differ more than the relative tolerance, values far below the maximum are compared absolutely
+	int32 CountMismatches(const TArray<float>& Values, const TArray<float>& ReferenceValues, const float Tolerance)
+	{
+		float MaximumValue = 0.0f;
+		for (const float ReferenceValue : ReferenceValues)
+			MaximumValue = FMath::Max(MaximumValue, FMath::Abs(ReferenceValue));
+		int32 Mismatches = 0;
+		for (int32 Index = 0; Index < Values.Num(); Index++)
+		{
+			const float Difference = FMath::Abs(Values[Index] - ReferenceValues[Index]);
+			if (Difference > Tolerance * FMath::Max(FMath::Abs(ReferenceValues[Index]), MaximumValue * 1e-3f))
+				Mismatches++;
+		}
+		return Mismatches;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(SonoTraceUEStrengthKernels_Tests, "SonoTraceUE.StrengthKernels.Test", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::SmokeFilter)
+
+bool SonoTraceUEStrengthKernels_Tests::RunTest(const FString& Parameters)
+{
+	using namespace SonoTraceUEStrengthKernelsTest;
+	constexpr float Tolerance = 1e-3f;
+
+	FRandomStream RandomStream(1234);
+	TArray<float> Frequencies;
+	TArray<float> SurfaceBRDF;
+	TArray<float> SurfaceMaterial;
+	for (int32 FrequencyIndex = 0; FrequencyIndex < NumberOfFrequencies; FrequencyIndex++)
+	{
+		Frequencies.Add(20000.0f + FrequencyIndex * (80000.0f / (NumberOfFrequencies - 1)));
+		SurfaceBRDF.Add(RandomStream.FRandRange(5.0f, 60.0f));
+		SurfaceMaterial.Add(RandomStream.FRandRange(0.1f, 1.0f));
+	}
+	TArray<float> LogAbsorptions;
+	FSonoTraceUEStrengthKernels::CalculateLogAbsorptions(Frequencies, LogAbsorptions);
+
+	TArray<FPointInput> Points;
+	Points.SetNum(NumberOfPoints);
+	for (FPointInput& Point : Points)
+	{
+		Point.AbsorptionDistance = RandomStream.FRandRange(0.5f, 20.0f);
+		for (int32 PathIndex = 0; PathIndex < NumberOfPaths; PathIndex++)
+		{
+			Point.ReflectionCosines.Add(RandomStream.FRandRange(-1.0f, 1.0f));
+			Point.Scales.Add(RandomStream.FRandRange(0.0f, 2.0f));
+			// Every eighth path has no line-of-sight for the direct path
+			Point.Distances.Add(PathIndex % 8 == 7 ? 0.0f : RandomStream.FRandRange(0.5f, 20.0f));
+		}
+	}
+
+	{
+		const float Frequency = 40000.0f;
+		TArray<float> SingleLogAbsorption;
+		FSonoTraceUEStrengthKernels::CalculateLogAbsorptions(TArray<float>({Frequency}), SingleLogAbsorption);
+		const float ReferenceAbsorption = FMath::Pow(10.0f, -(AlphaAbsorption(Frequency) * 3.0f) / 20.0f);
+		TestTrue(TEXT("check log absorption"), FMath::IsNearlyEqual(FMath::Exp(SingleLogAbsorption[0] * 3.0f), ReferenceAbsorption, ReferenceAbsorption * 1e-5f));
+	}
+
+	// Every model is run over all points with the reference and with the kernel, strengths and summed squared strengths have to match
+	auto RunModel = [&](const TCHAR* ModelName, TFunctionRef<float(TArray<float>&, const FPointInput&)> Reference, TFunctionRef<float(TArray<float>&, const FPointInput&)> Kernel)
+	{
+		TArray<float> ReferenceStrengths;
+		TArray<float> Strengths;
+		ReferenceStrengths.SetNumZeroed(NumberOfPoints * NumberOfPaths * NumberOfFrequencies);
+		Strengths.SetNumZeroed(NumberOfPoints * NumberOfPaths * NumberOfFrequencies);
+		TArray<float> ReferenceSums;
+		TArray<float> Sums;
+		ReferenceSums.SetNumZeroed(NumberOfPoints);
+		Sums.SetNumZeroed(NumberOfPoints);
+
+		TArray<float> PointStrengths;
+		PointStrengths.SetNumZeroed(NumberOfPaths * NumberOfFrequencies);
+		for (int32 PointIndex = 0; PointIndex < NumberOfPoints; PointIndex++)
+		{
+			ReferenceSums[PointIndex] = Reference(PointStrengths, Points[PointIndex]);
+			FMemory::Memcpy(ReferenceStrengths.GetData() + PointIndex * PointStrengths.Num(), PointStrengths.GetData(), PointStrengths.Num() * sizeof(float));
+		}
+
+		for (int32 PointIndex = 0; PointIndex < NumberOfPoints; PointIndex++)
+		{
+			Sums[PointIndex] = Kernel(PointStrengths, Points[PointIndex]);
+			FMemory::Memcpy(Strengths.GetData() + PointIndex * PointStrengths.Num(), PointStrengths.GetData(), PointStrengths.Num() * sizeof(float));
+		}
+
+		TestEqual(FString::Printf(TEXT("check %s strengths"), ModelName), CountMismatches(Strengths, ReferenceStrengths, Tolerance), 0);
+		TestEqual(FString::Printf(TEXT("check %s summed strengths"), ModelName), CountMismatches(Sums, ReferenceSums, Tolerance), 0);
+	};
+
+	RunModel(TEXT("Specular"),
+		[&](TArray<float>& OutStrengths, const FPointInput& Point) { return SpecularReference(OutStrengths, Point, SurfaceBRDF, SurfaceMaterial, Frequencies); },
+		[&](TArray<float>& OutStrengths, const FPointInput& Point) { return FSonoTraceUEStrengthKernels::Specular(OutStrengths, Point.ReflectionCosines, Point.Scales, SurfaceBRDF, SurfaceMaterial, LogAbsorptions, Point.AbsorptionDistance).SummedSquaredStrength; });
+
+	// The diffraction model has no paths without distance
+	for (FPointInput& Point : Points)
+	{
+		for (float& Distance : Point.Distances)
+		{
+			if (Distance <= 0.0f)
+				Distance = 1.0f;
+		}
+	}
+	RunModel(TEXT("Diffraction"),
+		[&](TArray<float>& OutStrengths, const FPointInput& Point) { return DiffractionReference(OutStrengths, Point, SurfaceMaterial, Frequencies); },
+		[&](TArray<float>& OutStrengths, const FPointInput& Point) { return FSonoTraceUEStrengthKernels::Diffraction(OutStrengths, Point.Distances, SurfaceMaterial, LogAbsorptions).SummedSquaredStrength; });
+
+	for (FPointInput& Point : Points)
+	{
+		Point.Distances[0] = 0.0f;
+	}
+	RunModel(TEXT("Direct path"),
+		[&](TArray<float>& OutStrengths, const FPointInput& Point) { return DirectPathReference(OutStrengths, Point, 2.0f, Frequencies); },
+		[&](TArray<float>& OutStrengths, const FPointInput& Point) { return FSonoTraceUEStrengthKernels::DirectPath(OutStrengths, Point.Distances, 2.0f, LogAbsorptions).SummedSquaredStrength; });
+
+	{
+		// Square lattice in the YZ plane, sound arriving along the X axis reaches all virtual receivers in phase
+		TArray<FVector> Offsets;
+		for (int32 Y = -2; Y <= 2; Y++)
+		{
+			for (int32 Z = -2; Z <= 2; Z++)
+			{
+				Offsets.Add(FVector(0.0, Y * 0.5, Z * 0.5));
+			}
+		}
+		FSonoTraceUEArrayGainTable GainTable;
+		GainTable.Build(Offsets, Frequencies, 343.0f);
+		TArray<float> Gains;
+		Gains.SetNumZeroed(NumberOfFrequencies);
+
+		GainTable.GetGains(FVector(1.0, 0.0, 0.0), Gains);
+		int32 Mismatches = 0;
+		for (const float Gain : Gains)
+		{
+			if (!FMath::IsNearlyEqual(Gain, static_cast<float>(Offsets.Num()), 1e-3f))
+				Mismatches++;
+		}
+		TestEqual(TEXT("check broadside array gain"), Mismatches, 0);
+
+		// A direction on the table grid has to match the array factor of the virtual receivers
+		const FVector Direction = FRotator(30.0, 46.0, 0.0).Vector();
+		GainTable.GetGains(Direction, Gains);
+		Mismatches = 0;
+		for (int32 FrequencyIndex = 0; FrequencyIndex < NumberOfFrequencies; FrequencyIndex++)
+		{
+			double Real = 0.0;
+			double Imaginary = 0.0;
+			for (const FVector& Offset : Offsets)
+			{
+				const double Phase = 2.0 * UE_DOUBLE_PI * Frequencies[FrequencyIndex] / 343.0 * FVector::DotProduct(Offset, Direction) / 100.0;
+				Real += FMath::Cos(Phase);
+				Imaginary += FMath::Sin(Phase);
+			}
+			if (!FMath::IsNearlyEqual(Gains[FrequencyIndex], static_cast<float>(FMath::Sqrt(Real * Real + Imaginary * Imaginary)), 1e-2f))
+				Mismatches++;
+		}
+		TestEqual(TEXT("check array gain off axis"), Mismatches, 0);
+
+		// The gains of the receivers repeat for every emitter
+		TArray<float> ReceiverGains;
+		for (int32 ReceiverIndex = 0; ReceiverIndex < NumberOfReceivers; ReceiverIndex++)
+		{
+			ReceiverGains.Append(Gains);
+		}
+		TArray<float> Strengths;
+		TArray<float> GainStrengths;
+		Strengths.SetNumZeroed(NumberOfPaths * NumberOfFrequencies);
+		GainStrengths.SetNumZeroed(NumberOfPaths * NumberOfFrequencies);
+		FSonoTraceUEStrengthKernels::DirectPath(Strengths, Points[0].Distances, 2.0f, LogAbsorptions);
+		FSonoTraceUEStrengthKernels::DirectPath(GainStrengths, Points[0].Distances, 2.0f, LogAbsorptions, ReceiverGains);
+		Mismatches = 0;
+		for (int32 Index = 0; Index < Strengths.Num(); Index++)
+		{
+			if (!FMath::IsNearlyEqual(GainStrengths[Index], Strengths[Index] * Gains[Index % NumberOfFrequencies], 1e-4f * FMath::Max(1.0f, Strengths[Index])))
+				Mismatches++;
+		}
+		TestEqual(TEXT("check kernel receiver gains"), Mismatches, 0);
+	}
+
+	{
+		// The kernels keep a point only above the minimum summed squared strength, a negative minimum keeps every point
+		TArray<float> Strengths;
+		Strengths.SetNumZeroed(NumberOfPaths * NumberOfFrequencies);
+		const FSonoTraceUEStrengthKernelResult Result = FSonoTraceUEStrengthKernels::Diffraction(Strengths, Points[1].Distances, SurfaceMaterial, LogAbsorptions);
+		TestTrue(TEXT("check kernel keeps without minimum"), Result.IsKept);
+		TestTrue(TEXT("check kernel keeps below the summed strength"), FSonoTraceUEStrengthKernels::Diffraction(Strengths, Points[1].Distances, SurfaceMaterial, LogAbsorptions,
+		                                                                                                    TConstArrayView<float>(), Result.SummedSquaredStrength * 0.5f).IsKept);
+		TestFalse(TEXT("check kernel rejects at the summed strength"), FSonoTraceUEStrengthKernels::Diffraction(Strengths, Points[1].Distances, SurfaceMaterial, LogAbsorptions,
+		                                                                                                    TConstArrayView<float>(), Result.SummedSquaredStrength).IsKept);
+		TArray<float> NoDistances;
+		NoDistances.SetNumZeroed(NumberOfPaths);
+		TestTrue(TEXT("check kernel keeps zero strength without minimum"), FSonoTraceUEStrengthKernels::DirectPath(Strengths, NoDistances, 2.0f, LogAbsorptions).IsKept);
+		TestFalse(TEXT("check kernel rejects zero strength"), FSonoTraceUEStrengthKernels::DirectPath(Strengths, NoDistances, 2.0f, LogAbsorptions, TConstArrayView<float>(), 0.0f).IsKept);
+	}
+
+	return true;
+}
@@ -0,0 +1,78 @@
+// By Wouter Jansen & Jan Steckel, Cosys-Lab, University of Antwerp. See the LICENSE file for details.
+
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+#include "SonoTraceUEActor.h"
+#include "SonoTraceUESurfaceTable.h"
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(SonoTraceUESurfaceTable_Tests, "SonoTraceUE.SurfaceTable.Test", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::SmokeFilter)
+
+bool SonoTraceUESurfaceTable_Tests::RunTest(const FString& Parameters)
+{
+	const int32 NumberOfFrequencies = 14;
+	FSonoTraceUEObjectSettingsStruct ObjectSettings;
+	ObjectSettings.BrdfTransitionPosition = 0.4f;
+	ObjectSettings.BrdfTransitionSlope = 2.0f;
+	ObjectSettings.MaterialsTransitionPosition = 0.6f;
+	ObjectSettings.MaterialsTransitionSlope = 1.0f;
+	for (int32 FrequencyIndex = 0; FrequencyIndex < NumberOfFrequencies; FrequencyIndex++)
+	{
+		ObjectSettings.BrdfExponentsSpecular.Add(0.1f + 0.05f * FrequencyIndex);
+		ObjectSettings.BrdfExponentsDiffraction.Add(2.0f + 0.1f * FrequencyIndex);
+		ObjectSettings.MaterialStrengthsSpecular.Add(1.0f - 0.02f * FrequencyIndex);
+		ObjectSettings.MaterialStrengthsDiffraction.Add(0.2f + 0.01f * FrequencyIndex);
+	}
+	FSonoTraceUESurfaceTable SurfaceTable;
+	SurfaceTable.Build(ObjectSettings);
+	TestTrue(TEXT("check table is valid"), SurfaceTable.IsValid());
+
+	// Reference evaluating the sigmoids directly on the full precision curvature
+	auto SigmoidMix = [](const float X, const float Slope, const float Center, const float Value1, const float Value2)
+	{
+		const float Sigmoid = 1.0f / (1.0f + FMath::Exp(-8.0f * Slope * (X - Center)));
+		return Sigmoid * Value1 + (1.0f - Sigmoid) * Value2;
+	};
+
+	// The error of the fp16 curvature and the level rounding stays well below a percent of the transition range
+	FRandomStream RandomStream(1234);
+	float MaximumBRDFError = 0.0f;
+	float MaximumMaterialError = 0.0f;
+	for (int32 SampleIndex = 0; SampleIndex < 10000; SampleIndex++)
+	{
+		const float CurvatureMagnitude = RandomStream.FRandRange(0.0f, 3.0f);
+		const int32 Level = SurfaceTable.GetLevel(FFloat16(CurvatureMagnitude));
+		for (int32 FrequencyIndex = 0; FrequencyIndex < NumberOfFrequencies; FrequencyIndex++)
+		{
+			const float BRDF = SigmoidMix(CurvatureMagnitude, ObjectSettings.BrdfTransitionSlope, ObjectSettings.BrdfTransitionPosition,
+			                              ObjectSettings.BrdfExponentsDiffraction[FrequencyIndex], ObjectSettings.BrdfExponentsSpecular[FrequencyIndex]);
+			const float Material = SigmoidMix(CurvatureMagnitude, ObjectSettings.MaterialsTransitionSlope, ObjectSettings.MaterialsTransitionPosition,
+			                                  ObjectSettings.MaterialStrengthsDiffraction[FrequencyIndex], ObjectSettings.MaterialStrengthsSpecular[FrequencyIndex]);
+			const float BRDFRange = FMath::Abs(ObjectSettings.BrdfExponentsDiffraction[FrequencyIndex] - ObjectSettings.BrdfExponentsSpecular[FrequencyIndex]);
+			const float MaterialRange = FMath::Abs(ObjectSettings.MaterialStrengthsDiffraction[FrequencyIndex] - ObjectSettings.MaterialStrengthsSpecular[FrequencyIndex]);
+			MaximumBRDFError = FMath::Max(MaximumBRDFError, FMath::Abs(SurfaceTable.BRDF[Level][FrequencyIndex] - BRDF) / BRDFRange);
+			MaximumMaterialError = FMath::Max(MaximumMaterialError, FMath::Abs(SurfaceTable.Material[Level][FrequencyIndex] - Material) / MaterialRange);
+		}
+	}
+	AddInfo(FString::Printf(TEXT("Maximum relative error of the surface table, BRDF: %.5f, material: %.5f"), MaximumBRDFError, MaximumMaterialError));
+	TestTrue(TEXT("check BRDF error"), MaximumBRDFError < 0.005f);
+	TestTrue(TEXT("check material error"), MaximumMaterialError < 0.005f);
+
+	TestEqual(TEXT("check zero curvature level"), SurfaceTable.GetLevel(0.0f), 0);
+	TestEqual(TEXT("check negative curvature level"), SurfaceTable.GetLevel(-1.0f), 0);
+	TestEqual(TEXT("check saturated curvature level"), SurfaceTable.GetLevel(TNumericLimits<float>::Max()), FSonoTraceUESurfaceTable::NumberOfLevels - 1);
+	TestEqual(TEXT("check NaN curvature level"), SurfaceTable.GetLevel(FMath::Sqrt(-1.0f)), FSonoTraceUESurfaceTable::NumberOfLevels - 1);
+
+	// Memory of a mesh against the former layout with a BRDF and material array per triangle
+	const int32 NumberOfTriangles = 10000;
+	FSonoTraceUEMeshDataStruct MeshData;
+	MeshData.TriangleCurvatureMagnitude.SetNumZeroed(NumberOfTriangles);
+	MeshData.TriangleSize.SetNumZeroed(NumberOfTriangles);
+	MeshData.TriangleNormal.SetNumZeroed(NumberOfTriangles);
+	MeshData.TrianglePosition.SetNumZeroed(NumberOfTriangles);
+	const SIZE_T PerTriangleTablesSize = 2 * NumberOfTriangles * (sizeof(TArray<float>) + NumberOfFrequencies * sizeof(float)) + NumberOfTriangles * (sizeof(float) - sizeof(FFloat16));
+	AddInfo(FString::Printf(TEXT("Mesh data of %d triangles with %d frequencies: %.3f MB, %.3f MB with per triangle tables. Surface table: %.3f MB"), NumberOfTriangles, NumberOfFrequencies,
+	                        MeshData.GetAllocatedSize() / (1024.0 * 1024.0), (MeshData.GetAllocatedSize() + PerTriangleTablesSize) / (1024.0 * 1024.0), SurfaceTable.GetAllocatedSize() / (1024.0 * 1024.0)));
+	TestTrue(TEXT("check mesh data size"), MeshData.GetAllocatedSize() < PerTriangleTablesSize);
+
+	return true;
+}
@@ -28,11 +28,12 @@ class FRandomIterator
          *     - Amount => Number of numbers to generate
          *     - Min => Minimum number in range to generate
          *     - Max => Maximum number in range to generate
+         *     - Seed => Seed of the generator, so a selection can be repeated
          *
          * The constructor also instantiates the variable gen
-         * with a new random_device.
+         * with the seed.
          */
-        FRandomIterator(const unsigned long long &Amount, const unsigned long long &Min, const unsigned long long &Max): Gen(random_device()())
+        FRandomIterator(const unsigned long long &Amount, const unsigned long long &Min, const unsigned long long &Max, const unsigned long long &Seed): Gen(Seed)
 
         {
             Floor = Min;
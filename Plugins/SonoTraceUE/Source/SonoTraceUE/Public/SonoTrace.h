@@ -6,12 +6,15 @@
 #include "SceneInterface.h"
 #include "RendererInterface.h" 
 #include "RHIGPUReadback.h"
+#include "HAL/CriticalSection.h"
+#include "Tasks/Task.h"
 
 DECLARE_LOG_CATEGORY_EXTERN(SonoTraceUE, Log, All);
 
 inline constexpr UINT32 MaxEmitterCount = 32;
 
 class FSonoTrace;
+class FSonoTraceCPU;
 
 struct FStructuredOutputBufferElem
 {
@@ -30,10 +33,100 @@ struct FStructuredOutputBufferElem
 	float   DistancesFromEmitterTotal[MaxEmitterCount];
 };
 
+// State of the sensor at the moment a trace was started, stored with its readback so results can be used once they arrive
+struct FSonoTraceFrameInfo
+{
+	uint64 ExecutionCounter = 0;
+	double Timestamp = -1;
+	FVector SensorLocation = FVector::ZeroVector;
+	FRotator SensorRotation = FRotator::ZeroRotator;
+	TArray<FTransform> EmitterPoses;
+	TArray<FTransform> ReceiverPoses;
+	TArray<int32> OverrideEmitterSignalIndexes;
+};
+
+// Readback of the output of a single trace.
+// Abstracted so the in-flight pipeline does not depend on the RHI and can be tested without a GPU.
+class ISonoTraceReadback
+{
+public:
+	virtual ~ISonoTraceReadback() = default;
+	virtual bool IsReady() = 0;
+	virtual uint32 GetSizeBytes() = 0;
+	virtual bool CopyTo(void* Destination, const uint32 NumBytes) = 0;
+
+	// Destination of the GPU copy pass, nullptr for readbacks that are filled on the CPU
+	virtual FRHIGPUBufferReadback* GetGPUReadback() { return nullptr; }
+	// Destination of the CPU backend trace, nullptr for GPU readbacks
+	virtual TArray<FStructuredOutputBufferElem>* GetCPUBuffer() { return nullptr; }
+	// Task filling the CPU buffer, the readback is ready once it completes
+	virtual void SetCPUTask(const UE::Tasks::FTask& Task) {}
+};
+
+class SONOTRACEUE_API FSonoTraceGPUReadback : public ISonoTraceReadback
+{
+public:
+	explicit FSonoTraceGPUReadback(const FName& RequestName);
+	virtual bool IsReady() override;
+	virtual uint32 GetSizeBytes() override;
+	virtual bool CopyTo(void* Destination, const uint32 NumBytes) override;
+	virtual FRHIGPUBufferReadback* GetGPUReadback() override { return Readback.Get(); }
+
+private:
+	TUniquePtr<FRHIGPUBufferReadback> Readback;
+};
+
+class SONOTRACEUE_API FSonoTraceCPUReadback : public ISonoTraceReadback
+{
+public:
+	virtual ~FSonoTraceCPUReadback() override;
+	virtual bool IsReady() override { return !Task.IsValid() || Task.IsCompleted(); }
+	virtual uint32 GetSizeBytes() override { return Buffer.Num() * sizeof(FStructuredOutputBufferElem); }
+	virtual bool CopyTo(void* Destination, const uint32 NumBytes) override;
+	virtual TArray<FStructuredOutputBufferElem>* GetCPUBuffer() override { return &Buffer; }
+	virtual void SetCPUTask(const UE::Tasks::FTask& InTask) override { Task = InTask; }
+
+private:
+	TArray<FStructuredOutputBufferElem> Buffer;
+	UE::Tasks::FTask Task;
+};
+
+// Ring of readback slots so multiple traces can be in flight while earlier results are parsed and simulated.
+// Every slot is tagged with the frame info of its trace and results are always delivered in the order the traces were started.
+class SONOTRACEUE_API FSonoTraceReadbackRing
+{
+public:
+	explicit FSonoTraceReadbackRing(TArray<TUniquePtr<ISonoTraceReadback>>&& Readbacks);
+
+	int32 Num() const { return Slots.Num(); }
+	int32 NumInFlight() const;
+	bool HasFreeSlot() const;
+	// True if the oldest trace in flight can be popped, so a parse is only started once there is a result to copy
+	bool IsOldestReady() const;
+
+	// Claims the next slot for a new trace, returns nullptr if all slots are in flight
+	ISonoTraceReadback* BeginTrace(const FSonoTraceFrameInfo& FrameInfo);
+	// Copies the oldest trace into the buffer and frees its slot if its readback is ready.
+	// Younger traces that are already ready keep waiting so the order is preserved.
+	bool PopReady(TArray<FStructuredOutputBufferElem>& OutBuffer, FSonoTraceFrameInfo& OutFrameInfo);
+
+private:
+	struct FSlot
+	{
+		TUniquePtr<ISonoTraceReadback> Readback;
+		FSonoTraceFrameInfo FrameInfo;
+	};
+
+	TArray<FSlot> Slots;
+	int32 OldestSlotIndex = 0;
+	int32 InFlightCount = 0;
+	mutable FCriticalSection CriticalSection;
+};
+
 struct  FSonoTraceParameters
 {
 	FScene* Scene = nullptr;
-	FRHIGPUBufferReadback* GPUReadback = nullptr;
+	FSonoTraceFrameInfo FrameInfo; // Not used by the shader, stored with the readback of every trace
 
 	TArray<float> DistributionAzimuthAngles; // Azimuth angles array for the reflection distribution
 	TArray<float> DistributionElevationAngles; // Elevation angles array for the reflection distribution
@@ -54,13 +147,19 @@ class SONOTRACEUE_API FSonoTrace
 {
 public:
 	FSonoTrace();
-	explicit FSonoTrace(const float SimulationRate, const bool RunOnTriggerOnly):
-		RunRate(SimulationRate),
-		RunOnTriggerOnly(RunOnTriggerOnly) {}
+	explicit FSonoTrace(const float SimulationRate, const bool RunOnTriggerOnly, const bool UseCPUBackend = false, const int32 NumberOfInFlightTraces = 1);
 
 	void BeginRendering();
 	void EndRendering();
 	void UpdateParameters(const FSonoTraceParameters& InputParameters);	
+	// Starts a CPU backend trace in a task, the SPI of the objects are resolved through the map of the mesh registry
+	bool Execute_GameThread(const TMap<int32, int32>& PersistentPrimitiveIndexToScenePrimitiveIndex);
+
+	void ReleaseReadbacks() { ReadbackRing.Reset(); }
+
+	bool IsUsingCPUBackend() const { return CPUBackend.IsValid(); }
+	FSonoTraceCPU* GetCPUBackend() const { return CPUBackend.Get(); }
+	TSharedPtr<FSonoTraceReadbackRing, ESPMode::ThreadSafe> GetReadbackRing() const { return ReadbackRing; }
 	
 	uint64 ExecutionCounter = 0;
 	double CurrentTimestamp = -1;
@@ -68,6 +167,7 @@ public:
 	
 private:
 	void Execute_RenderThread(FPostOpaqueRenderParameters& Parameters);
+	bool ShouldExecute();
 	static void BindSonoTraceCHSBindings(FRHICommandList& RHICmdList, const FViewInfo& View, FRHIRayTracingScene* RHIScene, FRHIUniformBuffer* SceneUniformBuffer, FRayTracingPipelineState* PipelineState);
 	
 	FDelegateHandle SonoTraceRenderDelegate;
@@ -80,4 +180,6 @@ private:
 	double LastExecutionTime = -1;
 	double RunRate = 30;
 	bool RunOnTriggerOnly = true;
+	TSharedPtr<FSonoTraceCPU> CPUBackend;
+	TSharedPtr<FSonoTraceReadbackRing, ESPMode::ThreadSafe> ReadbackRing;
 };
\ No newline at end of file
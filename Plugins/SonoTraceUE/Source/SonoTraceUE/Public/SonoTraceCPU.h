@@ -0,0 +1,135 @@
+// By Wouter Jansen & Jan Steckel, Cosys-Lab, University of Antwerp. See the LICENSE file for details.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "SonoTrace.h"
+#include "UObject/WeakObjectPtrTemplates.h"
+
+class UMeshComponent;
+
+// Flattened BVH node. Inner nodes have Count == 0 and store their two children at FirstIndex and FirstIndex + 1.
+// Leaf nodes store Count primitives starting at FirstIndex in the reordered primitive list.
+struct FSonoTraceBVHNode
+{
+	FVector3f BoundsMin;
+	int32 FirstIndex;
+	FVector3f BoundsMax;
+	int32 Count;
+};
+
+// Bounding volume hierarchy built with a binned surface area heuristic.
+// The same builder is used for the per-mesh triangle hierarchies and for the per-trace instance hierarchy.
+class SONOTRACEUE_API FSonoTraceBVH
+{
+public:
+	void Build(const TArray<FBox3f>& PrimitiveBounds, const int32 MaxLeafSize = 4);
+	void Reset();
+	bool IsEmpty() const { return Nodes.IsEmpty(); }
+
+	TArray<FSonoTraceBVHNode> Nodes;
+	TArray<int32> PrimitiveOrder; // Maps the leaf ordering back to the original primitive index
+};
+
+// Triangle geometry of a single mesh asset in its local space.
+// Triangles are stored in structure-of-arrays form in BVH leaf order so the intersection loop stays contiguous.
+struct SONOTRACEUE_API FSonoTraceCPUMesh
+{
+	// The normal of every triangle follows its winding like GetGeometryNormalFromTriangleBaseAttributes in the shader
+	void Build(const TArray<FVector3f>& Vertices, const TArray<FIntVector>& Triangles);
+	bool IntersectClosest(const FVector3f& Origin, const FVector3f& Direction, const float TMin, const bool CullBackFacing, float& InOutTMax, int32& OutTriangleIndex, FVector3f& OutNormal) const;
+	bool IntersectAny(const FVector3f& Origin, const FVector3f& Direction, const float TMin, const float TMax) const;
+	int32 Num() const { return TriangleIndex.Num(); }
+
+	// Cross product of the second and the first edge, the winding normal of the shader and of FDynamicMesh3::GetTriNormal
+	static FVector3f GetWindingNormal(const FVector3f& Vertex1, const FVector3f& Vertex2, const FVector3f& Vertex3)
+	{
+		return FVector3f::CrossProduct(Vertex3 - Vertex1, Vertex2 - Vertex1).GetSafeNormal();
+	}
+
+	FSonoTraceBVH BVH;
+	TArray<float> V0X, V0Y, V0Z;
+	TArray<float> E1X, E1Y, E1Z;
+	TArray<float> E2X, E2Y, E2Z;
+	TArray<float> NX, NY, NZ; // Winding normal, used for back-face culling and the reflection direction
+	TArray<int32> TriangleIndex; // Original triangle index, identical to the index used in the mesh data
+	FBox3f LocalBounds = FBox3f(ForceInit);
+};
+
+typedef TSharedPtr<const FSonoTraceCPUMesh, ESPMode::ThreadSafe> FSonoTraceCPUMeshPtr;
+
+// Instance of a mesh placed in the world by a primitive component, or with a fixed transform when it has no component
+struct FSonoTraceCPUInstance
+{
+	TWeakObjectPtr<UMeshComponent> MeshComponent;
+	FSonoTraceCPUMeshPtr Mesh;
+	// Instance of an instanced static mesh component, every instance shares the mesh and the SPI of the component
+	int32 InstanceIndex = INDEX_NONE;
+	int32 PersistentPrimitiveIndex = INDEX_NONE;
+	bool HasFixedTransform = false;
+	FTransform FixedTransform = FTransform::Identity;
+};
+
+// Instances and top level BVH of a single trace. Built on the game thread and only read by the trace task,
+// so objects can be added, removed and moved while a trace is running.
+class SONOTRACEUE_API FSonoTraceCPUScene
+{
+public:
+	struct FInstance
+	{
+		FSonoTraceCPUMeshPtr Mesh;
+		FMatrix44f LocalToWorld = FMatrix44f::Identity;
+		FMatrix44f WorldToLocal = FMatrix44f::Identity;
+		int32 ScenePrimitiveIndex = -1;
+	};
+
+	struct FTraceHit
+	{
+		float HitT = -1.0f;
+		int32 ScenePrimitiveIndex = -1;
+		int32 TriangleIndex = -1;
+		FVector3f WorldNormal = FVector3f::ZeroVector;
+	};
+
+	void Build(TArray<FInstance>&& InInstances);
+	// Same rays and output layout as the ray generation shader, safe to call from any thread
+	void Trace(const FSonoTraceParameters& Parameters, TArray<FStructuredOutputBufferElem>& OutputBuffer) const;
+	bool TraceClosest(const FVector3f& Origin, const FVector3f& Direction, const float TMin, const float TMax, const bool CullBackFacing, FTraceHit& OutHit) const;
+	bool TraceAny(const FVector3f& Origin, const FVector3f& Direction, const float TMin, const float TMax) const;
+
+	int32 Num() const { return Instances.Num(); }
+
+private:
+	TArray<FInstance> Instances;
+	FSonoTraceBVH InstanceBVH;
+};
+
+typedef TSharedPtr<const FSonoTraceCPUScene, ESPMode::ThreadSafe> FSonoTraceCPUScenePtr;
+
+// Headless CPU implementation of the SonoTrace ray generation shader (SonoTrace.usf).
+// Produces the same FStructuredOutputBufferElem layout as the GPU path so parsing and simulation are unaffected.
+// Meshes are stored once per asset in a local space BVH, the instances are gathered in a top level BVH at every trace.
+// Skeletal meshes are copied once in their bind pose and only follow the transform of their component, animation and morph targets are not traced.
+class SONOTRACEUE_API FSonoTraceCPU
+{
+public:
+	bool AddMeshComponent(UMeshComponent* MeshComponent, const UObject* MeshAsset, const int32 PersistentPrimitiveIndex);
+	bool RemoveMeshComponent(const UMeshComponent* MeshComponent);
+	// Geometry without a component, such as landscape tiles and generated scenes, keeps the given transform. A mesh is placed once, adding it again is ignored.
+	bool AddMesh(const FSonoTraceCPUMeshPtr& Mesh, const FTransform& Transform, const int32 PersistentPrimitiveIndex);
+	bool RemoveMesh(const FSonoTraceCPUMesh* Mesh);
+
+	// Snapshot of the current instance transforms, game thread only. The SPI of every object is resolved through the PPI to SPI map
+	// of the mesh registry, which is also what the parser resolves the hits with.
+	FSonoTraceCPUScenePtr CreateScene(const TMap<int32, int32>& PersistentPrimitiveIndexToScenePrimitiveIndex) const;
+	void Trace(const FSonoTraceParameters& Parameters, const TMap<int32, int32>& PersistentPrimitiveIndexToScenePrimitiveIndex, TArray<FStructuredOutputBufferElem>& OutputBuffer) const;
+
+	int32 GetInstanceCount() const { return Instances.Num(); }
+	int32 GetMeshCount() const { return Meshes.Num(); }
+
+private:
+	static FSonoTraceCPUMeshPtr CreateMesh(UMeshComponent* MeshComponent);
+
+	TMap<const UObject*, FSonoTraceCPUMeshPtr> Meshes;
+	TArray<FSonoTraceCPUInstance> Instances;
+};
\ No newline at end of file
@@ -4,6 +4,12 @@
 
 #include "CoreMinimal.h"
 #include "SonoTrace.h"
+#include "SonoTraceUEParser.h"
+#include "SonoTraceUECompaction.h"
+#include "SonoTraceUEDiffractionClusters.h"
+#include "SonoTraceUERandom.h"
+#include "SonoTraceUEStrengthKernels.h"
+#include "SonoTraceUESurfaceTable.h"
 #include "ColorMaps.h"
 #include "Engine/SkeletalMesh.h"
 #include "Engine/StaticMesh.h"
@@ -14,41 +20,55 @@
 #include "Engine/DataAsset.h"
 #include "Curves/CurveFloat.h"
 #include "GameFramework/Actor.h"
+#include "Tasks/Task.h"
+#include "Math/Float16.h"
 #pragma warning(disable: 4668)
 #include "ObjectDeliverer/Public/DeliveryBox/Utf8StringDeliveryBox.h"
 #include "ObjectDeliverer/Public/DeliveryBox/ObjectDeliveryBoxUsingJson.h"
 #include "ObjectDeliverer/Public/ObjectDelivererManager.h"
 #include "SonoTraceUEActor.generated.h"
 
-struct FDiffractionImportancePair
-{
-	float Value;    
-	int32 Index;  
-
-	FDiffractionImportancePair(const float InValue, const int32 InIndex)
-		: Value(InValue), Index(InIndex) {}
-
-	bool operator<(const FDiffractionImportancePair& Other) const
-	{
-		return Value < Other.Value;
-	}
-};
+namespace UE::Geometry { class FDynamicMesh3; }
+class USonoTraceUEMeshRegistry;
+class ALandscapeProxy;
 
 USTRUCT()
 struct FSonoTraceUEMeshDataStruct
 {
 	GENERATED_BODY()
 
-	TArray<float> TriangleCurvatureMagnitude;
+	TArray<FFloat16> TriangleCurvatureMagnitude; // BRDF and material follow from the surface table of the object type
 	TArray<float> TriangleSize;
-	TArray<TArray<float>> TriangleBRDF; // Triangle // Frequency
-	TArray<TArray<float>> TriangleMaterial; // Triangle // Frequency
 	TArray<FVector> TriangleNormal;
 	TArray<FVector> TrianglePosition;
-	TArray<float> ImportanceVertexOrderedBRDFValue;
-	TArray<int32> ImportanceVertexOrderedIndex;
+	FSonoTraceUEDiffractionClusters DiffractionClusters; // Triangle sampling proportional to the BRDF based importance
 
 	FSonoTraceUEMeshDataStruct() {}
+
+	SIZE_T GetAllocatedSize() const
+	{
+		return TriangleCurvatureMagnitude.GetAllocatedSize() + TriangleSize.GetAllocatedSize() + TriangleNormal.GetAllocatedSize() + TrianglePosition.GetAllocatedSize()
+		       + DiffractionClusters.GetAllocatedSize();
+	}
+
+	friend FArchive& operator<<(FArchive& Ar, FSonoTraceUEMeshDataStruct& MeshData)
+	{
+		return Ar << MeshData.TriangleCurvatureMagnitude << MeshData.TriangleSize << MeshData.TriangleNormal << MeshData.TrianglePosition << MeshData.DiffractionClusters;
+	}
+};
+
+// Unique mesh whose data is loaded or generated in a background task. Its mesh data slot stays empty until the result is swapped in on the game thread,
+// hits on the mesh use the default BRDF and material of its object type until then.
+struct FSonoTraceUEPendingMeshData
+{
+	TWeakObjectPtr<UMeshComponent> MeshComponent;
+	TWeakObjectPtr<UObject> MeshAsset;
+	int32 MeshDataIndex = INDEX_NONE;
+	int32 ObjectTypeIndex = 0;
+	bool LoadingFromCache = false;
+	bool ForceGeneration = false; // Set when the cache entry could not be read
+	UE::Tasks::FTask Task;
+	TSharedPtr<FSonoTraceUEMeshDataStruct, ESPMode::ThreadSafe> Result;
 };
 
 USTRUCT(BlueprintType)
@@ -80,6 +100,8 @@ struct SONOTRACEUE_API FSonoTraceUEObjectSettingsStruct
 	TArray<float> MaterialStrengthsSpecular;
 	TArray<float> MaterialStrengthsDiffraction;
 	TArray<float> DefaultTriangleMaterial;
+
+	FSonoTraceUESurfaceTable SurfaceTable;
 };
 
 USTRUCT(BlueprintType)
@@ -133,8 +155,8 @@ struct SONOTRACEUE_API FSonoTraceUEObjectSettingsTable : public FTableRowBase
 {
 	GENERATED_BODY()
 
-	// Currently, only StaticMesh and SkeletalMesh are supported
-    UPROPERTY(EditAnywhere, BlueprintReadWrite, meta=(AllowedClasses = "StaticMesh,SkeletalMesh"), Category = "SonoTraceUE")
+	// Currently, only StaticMesh and SkeletalMesh are supported, landscapes are matched on their landscape material
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, meta=(AllowedClasses = "StaticMesh,SkeletalMesh,MaterialInterface"), Category = "SonoTraceUE")
     UObject* Asset = nullptr;
 
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "SonoTraceUE")
@@ -183,6 +205,20 @@ enum class ESonoTraceUEArrayPlaneEnum : uint8
 	XY UMETA(DisplayName = "X-Y Plane (Z = 0)")
 };
 
+UENUM(BlueprintType)
+enum class ESonoTraceUEDiffractionSamplingEnum : uint8
+{
+	Random UMETA(DisplayName = "Random (independent samples)"),
+	Sobol UMETA(DisplayName = "Sobol (scrambled low-discrepancy sequence)"),
+};
+
+UENUM(BlueprintType)
+enum class ESonoTraceUERaytracingBackendEnum : uint8
+{
+	GPU UMETA(DisplayName = "GPU (hardware ray tracing)"),
+	CPU UMETA(DisplayName = "CPU (headless, no ray tracing GPU required)"),
+};
+
 UCLASS(BlueprintType)
 class SONOTRACEUE_API USonoTraceUEInterfaceSettingsData : public UDataAsset
 {
@@ -304,6 +340,10 @@ public:
 	// Set the plane where the generated circular array will exist within (YZ (default)/XZ/XY)
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "SonoTraceUE|Configuration|Receivers|EmitterPattern")
 	ESonoTraceUEArrayPlaneEnum EmitterPatternPlane = ESonoTraceUEArrayPlaneEnum::YZ;
+
+	// Enable to fold the emitter pattern into a far-field array gain per real receiver instead of simulating every virtual receiver
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "SonoTraceUE|Configuration|Receivers|EmitterPattern")
+	bool EnableEmitterPatternAggregation = false;
 	
 	// SIMULATION SETTINGS
 
@@ -377,6 +417,11 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "SonoTraceUE|Configuration|Simulation|General")
 	float DiffractionMinimumStrength = 0;
 
+	// The minimum summed strength value (across all frequencies and receivers)
+	// of an emitter to be saved as a point during simulation of the direct path component
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "SonoTraceUE|Configuration|Simulation|General")
+	float DirectPathMinimumStrength = 0;
+
 	// A cut-off threshold for the size of triangles in centimeters squared.
 	// Triangles have to be larger to be considered for diffraction.
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "SonoTraceUE|Configuration|Simulation|General", meta=(ClampMin=0))
@@ -389,6 +434,19 @@ public:
 	// For each diffraction point, make sure it has LOS to the emitter
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "SonoTraceUE|Configuration|Simulation|General")
 	bool EnableDiffractionLineOfSightRequired = true;
+
+	// Total number of diffraction samples per measurement, split over the diffraction objects in proportion to their projected solid angle and edge importance inside the sensor frustum.
+	// When 0, every object gets the number of initial rays divided by DiffractionSimDivisionFactor.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "SonoTraceUE|Configuration|Simulation|General", meta=(ClampMin=0))
+	int32 DiffractionSampleBudget = 0;
+
+	// How the diffraction samples are drawn from the importance of the triangles. Sobol spreads the samples more evenly, so fewer samples reach the same accuracy.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "SonoTraceUE|Configuration|Simulation|General")
+	ESonoTraceUEDiffractionSamplingEnum DiffractionSampling = ESonoTraceUEDiffractionSamplingEnum::Random;
+
+	// Seed of all random sampling. Together with the measurement index it determines every random number of a measurement, so a measurement can be regenerated exactly.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "SonoTraceUE|Configuration|Simulation|General")
+	int32 RandomSeed = 0;
 	
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "SonoTraceUE|Configuration|Simulation|General")
 	bool EnableDiffractionForDynamicObjects = false;
@@ -448,6 +506,35 @@ public:
 	// Beyond this point, until the variable is set as Diffraction Triangle Size Threshold, it will linearly drop to 0.
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "SonoTraceUE|Configuration|Simulation|Objects", meta=(ClampMin=0, EditCondition="EnableCurvatureTriangleSizeBasedScaler", EditConditionHides))
 	float CurvatureScalerUpperTriangleSizeThreshold = 5;
+
+	// Store the generated curvature, BRDF and material data of every mesh under Saved/SonoTraceUE/MeshCache and reuse it in later sessions.
+	// Entries are invalidated automatically when the mesh or any of the curvature, diffraction triangle size or object settings change.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "SonoTraceUE|Configuration|Simulation|Objects")
+	bool EnableMeshDataCache = true;
+
+	// Load or generate the mesh data in prioritized background tasks, meshes closest to the sensor first, instead of all at once during initialization.
+	// The simulation starts immediately and uses the default BRDF and material of the object type for meshes that are not ready yet.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "SonoTraceUE|Configuration|Simulation|Objects")
+	bool EnableAsyncMeshDataGeneration = true;
+
+	// Game thread time per tick spent on starting background mesh data tasks.
+	// Converting a mesh to a dynamic mesh has to happen on the game thread, at least one mesh is started every tick.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "SonoTraceUE|Configuration|Simulation|Objects", meta=(ClampMin=0, Units="Milliseconds", EditCondition="EnableAsyncMeshDataGeneration", EditConditionHides))
+	float MeshDataGenerationTimeBudget = 4;
+
+	// Generate the curvature, normals and diffraction importance of landscapes from their heightfield in tiles around the sensors.
+	// Tiles are generated in background tasks once they come within the maximum ray distance of a sensor and evicted when they leave it.
+	// Without it landscapes use the default BRDF and material of their object type and are not used for diffraction.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "SonoTraceUE|Configuration|Simulation|Objects")
+	bool EnableLandscapeTiles = true;
+
+	// Size of a landscape tile in landscape quads per side
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "SonoTraceUE|Configuration|Simulation|Objects", meta=(ClampMin=8, ClampMax=256, EditCondition="EnableLandscapeTiles", EditConditionHides))
+	int32 LandscapeTileSize = 64;
+
+	// Maximum number of landscape tiles loaded at once over all landscapes, the tiles closest to the sensors are loaded first
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "SonoTraceUE|Configuration|Simulation|Objects", meta=(ClampMin=1, EditCondition="EnableLandscapeTiles", EditConditionHides))
+	int32 MaximumLandscapeTiles = 256;
 	
 	// In degrees, left-handed coordinate system
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "SonoTraceUE|Configuration|Simulation|Raytracing", meta=(ClampMin=-90, ClampMax=90, Units="Degrees"))
@@ -475,6 +562,14 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "SonoTraceUE|Configuration|Simulation|Raytracing", meta=(ClampMin=1, ClampMax=10))
 	int32 MaximumBounces = 3;
 
+	// Select where the rays are traced. The CPU backend builds its own BVH of the scene meshes and also works without a GPU (ex. -nullrhi)
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "SonoTraceUE|Configuration|Simulation|Raytracing")
+	ESonoTraceUERaytracingBackendEnum RaytracingBackend = ESonoTraceUERaytracingBackendEnum::GPU;
+
+	// Number of traces that can be in flight at the same time when running continuously. With more than one, the next trace is already running while the previous result is parsed and simulated
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "SonoTraceUE|Configuration|Simulation|Raytracing", meta=(ClampMin=1, ClampMax=8))
+	int32 NumberOfInFlightTraces = 2;
+
 	// DRAW SETTINGS
 
 	// Global toggle of debug drawing
@@ -717,6 +812,12 @@ struct FSonoTraceUEGeneratedInputStruct
 	UPROPERTY(BlueprintReadOnly, Category = "SonoTraceUE|Generatedinput")
 	TArray<float> Frequencies;
 
+	// Natural-log absorption per meter of every simulation frequency, the absorption over a path is exp(LogAbsorption * Distance)
+	TArray<float> LogAbsorptions;
+
+	// Array gain of the emitter pattern per direction and frequency, only set when the emitter pattern is aggregated. Shared with the simulation tasks.
+	TSharedPtr<const FSonoTraceUEArrayGainTable, ESPMode::ThreadSafe> EmitterPatternGainTable;
+
 	TArray<TArray<float>> EmitterSignals;
 
 	UPROPERTY(BlueprintReadOnly, Category = "SonoTraceUE|Generatedinput")
@@ -747,6 +848,125 @@ struct FSonoTraceUECoordinateTable : public FTableRowBase
 	}
 };
 
+// Contiguous storage of the strengths and total distances to the receivers of all simulated points of a (sub-)output.
+// Every simulated point owns one block of Emitter x Receiver x Frequency strengths and Emitter x Receiver distances, found at its StrengthTensorIndex.
+struct FSonoTraceUEStrengthTensor
+{
+	// Clears the blocks but keeps the allocation so the tensor can be reused for the next output
+	void Reset(const int32 InNumberOfEmitters, const int32 InNumberOfReceivers, const int32 InNumberOfFrequencies)
+	{
+		NumberOfEmitters = InNumberOfEmitters;
+		NumberOfReceivers = InNumberOfReceivers;
+		NumberOfFrequencies = InNumberOfFrequencies;
+		Strengths.Reset();
+		TotalDistancesToReceivers.Reset();
+	}
+
+	// Adds zeroed blocks and returns the index of the first one
+	int32 AddBlocks(const int32 Count)
+	{
+		const int32 FirstBlockIndex = NumBlocks();
+		Strengths.AddZeroed(Count * GetStrengthBlockSize());
+		TotalDistancesToReceivers.AddZeroed(Count * GetDistanceBlockSize());
+		return FirstBlockIndex;
+	}
+
+	void SetNumBlocks(const int32 Count)
+	{
+		Strengths.SetNum(Count * GetStrengthBlockSize(), EAllowShrinking::No);
+		TotalDistancesToReceivers.SetNum(Count * GetDistanceBlockSize(), EAllowShrinking::No);
+	}
+
+	// Appends all blocks of a tensor with the same dimensions and returns the block index the first one was stored at
+	int32 Append(const FSonoTraceUEStrengthTensor& Other)
+	{
+		if (GetDistanceBlockSize() == 0)
+		{
+			NumberOfEmitters = Other.NumberOfEmitters;
+			NumberOfReceivers = Other.NumberOfReceivers;
+			NumberOfFrequencies = Other.NumberOfFrequencies;
+		}
+		const int32 FirstBlockIndex = NumBlocks();
+		if (Other.NumBlocks() > 0 && ensure(Other.GetStrengthBlockSize() == GetStrengthBlockSize() && Other.GetDistanceBlockSize() == GetDistanceBlockSize()))
+		{
+			Strengths.Append(Other.Strengths);
+			TotalDistancesToReceivers.Append(Other.TotalDistancesToReceivers);
+		}
+		return FirstBlockIndex;
+	}
+
+	// Moves every block to its compacted index, blocks with INDEX_NONE are dropped
+	void CompactBlocks(TConstArrayView<int32> CompactedBlockIndexes, const int32 NumKeptBlocks)
+	{
+		SonoTraceUECompaction::Scatter(Strengths, CompactedBlockIndexes, NumKeptBlocks, GetStrengthBlockSize());
+		SonoTraceUECompaction::Scatter(TotalDistancesToReceivers, CompactedBlockIndexes, NumKeptBlocks, GetDistanceBlockSize());
+	}
+
+	int32 NumBlocks() const { return GetDistanceBlockSize() > 0 ? TotalDistancesToReceivers.Num() / GetDistanceBlockSize() : 0; }
+	int32 GetStrengthBlockSize() const { return NumberOfEmitters * NumberOfReceivers * NumberOfFrequencies; }
+	int32 GetDistanceBlockSize() const { return NumberOfEmitters * NumberOfReceivers; }
+	bool IsValidIndex(const int32 BlockIndex, const int32 EmitterIndex, const int32 ReceiverIndex) const
+	{
+		return BlockIndex >= 0 && BlockIndex < NumBlocks() && EmitterIndex >= 0 && EmitterIndex < NumberOfEmitters && ReceiverIndex >= 0 && ReceiverIndex < NumberOfReceivers;
+	}
+
+	// Strength per frequency of a single emitter and receiver pair, empty when the indexes are not valid
+	TArrayView<float> GetStrengths(const int32 BlockIndex, const int32 EmitterIndex, const int32 ReceiverIndex)
+	{
+		if (!IsValidIndex(BlockIndex, EmitterIndex, ReceiverIndex))
+			return TArrayView<float>();
+		return TArrayView<float>(Strengths.GetData() + (BlockIndex * GetDistanceBlockSize() + EmitterIndex * NumberOfReceivers + ReceiverIndex) * NumberOfFrequencies, NumberOfFrequencies);
+	}
+
+	TArrayView<const float> GetStrengths(const int32 BlockIndex, const int32 EmitterIndex, const int32 ReceiverIndex) const
+	{
+		return const_cast<FSonoTraceUEStrengthTensor*>(this)->GetStrengths(BlockIndex, EmitterIndex, ReceiverIndex);
+	}
+
+	// All strengths of a block, ordered by emitter, receiver and frequency
+	TArrayView<float> GetBlockStrengths(const int32 BlockIndex)
+	{
+		if (BlockIndex < 0 || BlockIndex >= NumBlocks())
+			return TArrayView<float>();
+		return TArrayView<float>(Strengths.GetData() + BlockIndex * GetStrengthBlockSize(), GetStrengthBlockSize());
+	}
+
+	TArrayView<const float> GetBlockStrengths(const int32 BlockIndex) const
+	{
+		return const_cast<FSonoTraceUEStrengthTensor*>(this)->GetBlockStrengths(BlockIndex);
+	}
+
+	// All total distances to the receivers of a block, ordered by emitter and receiver
+	TArrayView<float> GetBlockTotalDistancesToReceivers(const int32 BlockIndex)
+	{
+		if (BlockIndex < 0 || BlockIndex >= NumBlocks())
+			return TArrayView<float>();
+		return TArrayView<float>(TotalDistancesToReceivers.GetData() + BlockIndex * GetDistanceBlockSize(), GetDistanceBlockSize());
+	}
+
+	TArrayView<const float> GetBlockTotalDistancesToReceivers(const int32 BlockIndex) const
+	{
+		return const_cast<FSonoTraceUEStrengthTensor*>(this)->GetBlockTotalDistancesToReceivers(BlockIndex);
+	}
+
+	float& GetTotalDistanceToReceiver(const int32 BlockIndex, const int32 EmitterIndex, const int32 ReceiverIndex)
+	{
+		check(IsValidIndex(BlockIndex, EmitterIndex, ReceiverIndex));
+		return TotalDistancesToReceivers[BlockIndex * GetDistanceBlockSize() + EmitterIndex * NumberOfReceivers + ReceiverIndex];
+	}
+
+	float GetTotalDistanceToReceiver(const int32 BlockIndex, const int32 EmitterIndex, const int32 ReceiverIndex) const
+	{
+		return IsValidIndex(BlockIndex, EmitterIndex, ReceiverIndex) ? TotalDistancesToReceivers[BlockIndex * GetDistanceBlockSize() + EmitterIndex * NumberOfReceivers + ReceiverIndex] : -1.0f;
+	}
+
+	int32 NumberOfEmitters = 0;
+	int32 NumberOfReceivers = 0;
+	int32 NumberOfFrequencies = 0;
+	TArray<float> Strengths; // Block // Emitter // Receiver // Frequency
+	TArray<float> TotalDistancesToReceivers; // Block // Emitter // Receiver
+};
+
 USTRUCT(BlueprintType)
 struct FSonoTraceUEPointStruct
 {
@@ -789,10 +1009,9 @@ struct FSonoTraceUEPointStruct
 	UPROPERTY(BlueprintReadOnly, Category = "SonoTraceUE|Point")
 	float CurvatureMagnitude;
 	
-	TArray<float>* SurfaceBRDF;	
-	TArray<float>* SurfaceMaterial;	
-	TArray<TArray<TArray<float>>> Strengths; // Emitter // Receiver // Frequency
-	TArray<TArray<float>> TotalDistancesToReceivers; // Emitter // Receiver
+	const TArray<float>* SurfaceBRDF;	
+	const TArray<float>* SurfaceMaterial;	
+	int32 StrengthTensorIndex = INDEX_NONE; // Block in the strength tensor of the (sub-)output holding this point, INDEX_NONE if not simulated
 
 	UPROPERTY(BlueprintReadOnly, Category = "SonoTraceUE|Point")
 	bool IsSpecular = true;
@@ -808,6 +1027,10 @@ struct FSonoTraceUEPointStruct
 	
 	UPROPERTY(BlueprintReadOnly, Category = "SonoTraceUE|Point")
 	int BounceIndex = 0;		
+
+	// Instance of an instanced static mesh (ISM, HISM or foliage) the point lies on, -1 for other objects
+	UPROPERTY(BlueprintReadOnly, Category = "SonoTraceUE|Point")
+	int InstanceIndex = INDEX_NONE;
 	
 	UPROPERTY(BlueprintReadOnly, Category = "SonoTraceUE|Point")
 	TArray<float> EmitterDirectivities;	
@@ -815,7 +1038,7 @@ struct FSonoTraceUEPointStruct
 	FSonoTraceUEPointStruct(const FVector& Location, const FVector& ReflectionDirection, const FName Label, const int Index,
 	                        const float TotalDistance, const TArray<float>& TotalDistancesFromEmitters,
 	                        const float DistanceToSensor, const int ObjectTypeIndex, const float CurvatureMagnitude,
-	                        TArray<float>* SurfaceBRDF, TArray<float>* SurfaceMaterial,
+	                        const TArray<float>* SurfaceBRDF, const TArray<float>* SurfaceMaterial,
 	                        const int RayIndex, int BounceIndex, const TArray<float>& EmitterDirectivities):
 		Location(Location),
 	    ReflectionDirection(ReflectionDirection),
@@ -856,8 +1079,7 @@ struct FSonoTraceUEPointStruct
 
 	FSonoTraceUEPointStruct(const FVector& Location, const FVector& ReflectionDirection, const FName Label, const int Index,
 							const float TotalDistance, const float DistanceToSensor, const float SummedStrength,
-							const TArray<TArray<float>>& TotalDistancesToReceivers,
-							const TArray<TArray<TArray<float>>>& Strengths):
+							const int32 StrengthTensorIndex):
 		Location(Location),
 		ReflectionDirection(ReflectionDirection),
 		Label(Label),
@@ -871,8 +1093,7 @@ struct FSonoTraceUEPointStruct
 		CurvatureMagnitude(0),
 		SurfaceBRDF(nullptr),
 		SurfaceMaterial(nullptr),
-		Strengths(Strengths),
-		TotalDistancesToReceivers(TotalDistancesToReceivers),
+		StrengthTensorIndex(StrengthTensorIndex),
 		IsSpecular(false),
 		IsDirectPath(true),
 		RayIndex(0),
@@ -906,6 +1127,47 @@ struct FSonoTraceUESubOutputStruct
 
 	UPROPERTY(BlueprintReadOnly, Category = "SonoTraceUE|SubOutput")
 	float MaximumTotalDistance = 0;
+
+	// Summed strength of all samples and its standard error estimated from independent replicates of the sampling, only set for the diffraction component
+	UPROPERTY(BlueprintReadOnly, Category = "SonoTraceUE|SubOutput")
+	float SummedStrength = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "SonoTraceUE|SubOutput")
+	float SummedStrengthStandardError = 0;
+
+	FSonoTraceUEStrengthTensor StrengthTensor;
+
+	// PPI and instance index of every hit instance of instanced objects
+	TArray<FIntPoint> HitInstances;
+
+	// Removes the points without a set mask in a stable parallel compaction, their reflected strengths and strength tensor blocks are dropped with them
+	void Compact(TConstArrayView<uint8> KeepMask)
+	{
+		check(KeepMask.Num() == ReflectedPoints.Num());
+		TArray<int32> CompactedIndexes;
+		const int32 NumKept = SonoTraceUECompaction::CalculateCompactedIndexes(KeepMask, CompactedIndexes);
+		if (NumKept == ReflectedPoints.Num())
+			return;
+		SonoTraceUECompaction::Scatter(ReflectedPoints, CompactedIndexes, NumKept);
+		if (ReflectedStrengths.Num() == CompactedIndexes.Num())
+			SonoTraceUECompaction::Scatter(ReflectedStrengths, CompactedIndexes, NumKept);
+
+		TArray<uint8> BlockKeepMask;
+		BlockKeepMask.SetNumZeroed(StrengthTensor.NumBlocks());
+		for (const FSonoTraceUEPointStruct& Point : ReflectedPoints)
+		{
+			if (BlockKeepMask.IsValidIndex(Point.StrengthTensorIndex))
+				BlockKeepMask[Point.StrengthTensorIndex] = 1;
+		}
+		TArray<int32> CompactedBlockIndexes;
+		const int32 NumKeptBlocks = SonoTraceUECompaction::CalculateCompactedIndexes(BlockKeepMask, CompactedBlockIndexes);
+		StrengthTensor.CompactBlocks(CompactedBlockIndexes, NumKeptBlocks);
+		for (FSonoTraceUEPointStruct& Point : ReflectedPoints)
+		{
+			if (CompactedBlockIndexes.IsValidIndex(Point.StrengthTensorIndex))
+				Point.StrengthTensorIndex = CompactedBlockIndexes[Point.StrengthTensorIndex];
+		}
+	}
 	
 	FSonoTraceUESubOutputStruct()
 	{
@@ -973,10 +1235,26 @@ struct FSonoTraceUEOutputStruct
 
 	UPROPERTY(BlueprintReadOnly, Category = "SonoTraceUE|Output")
 	int32 Index = -1;	
+
+	// Strengths of all points in ReflectedPoints
+	FSonoTraceUEStrengthTensor StrengthTensor;
 	
 	FSonoTraceUEOutputStruct()		
 	{
 	}
+
+	// Appends the points of a sub-output, their strength blocks are copied into the strength tensor of this output
+	void AppendPoints(const FSonoTraceUESubOutputStruct& SubOutput)
+	{
+		const int32 FirstBlockIndex = StrengthTensor.Append(SubOutput.StrengthTensor);
+		const int32 FirstPointIndex = ReflectedPoints.Num();
+		ReflectedPoints.Append(SubOutput.ReflectedPoints);
+		for (int32 PointIndex = FirstPointIndex; PointIndex < ReflectedPoints.Num(); PointIndex++)
+		{
+			if (ReflectedPoints[PointIndex].StrengthTensorIndex != INDEX_NONE)
+				ReflectedPoints[PointIndex].StrengthTensorIndex += FirstBlockIndex;
+		}
+	}
 };
 
 USTRUCT(NotBlueprintType)
@@ -995,12 +1273,97 @@ struct FSonoTraceUEDataMessage
 	}
 };
 
+// Result of a single raytracing parse, shared between the render thread copy and the parse task
+struct FSonoTraceUEParseResult
+{
+	bool IsValid = false;
+	FSonoTraceFrameInfo FrameInfo;
+	double ParseTime = 0;
+	TSharedPtr<TArray<FStructuredOutputBufferElem>, ESPMode::ThreadSafe> RawOutput;
+	FSonoTraceUESubOutputStruct SubOutput;
+	TArray<TTuple<bool, FVector>> DirectPathReceiverOutput;
+	TArray<int32> UnknownScenePrimitiveIndexes;
+	// SPI and PPI in the lookup of every known primitive that was hit
+	TArray<TPair<int32, int32>> HitScenePrimitives;
+};
+
+// Settings a simulation run reads, copied from the input and generated settings when the simulation task is launched so Blueprint writes to them do not reach a running simulation
+struct FSonoTraceUESimulationSettings
+{
+	int32 NumberOfSimFrequencies = 0;
+	bool EnableSpecularComponentCalculation = false;
+	bool EnableSpecularSimulationOnlyOnLastHits = false;
+	float SpecularMinimumStrength = 0.0f;
+	bool EnableReceiverDirectivity = false;
+	bool EnableEmitterDirectivity = false;
+	bool EnableDiffractionComponentCalculation = false;
+	int32 NumberOfInitialRays = 0;
+	int32 DiffractionSimDivisionFactor = 1;
+	float SensorLowerAzimuthLimit = 0.0f;
+	float SensorUpperAzimuthLimit = 0.0f;
+	float SensorLowerElevationLimit = 0.0f;
+	float SensorUpperElevationLimit = 0.0f;
+	float MaximumRayDistance = 0.0f;
+	int32 DiffractionSampleBudget = 0;
+	int32 RandomSeed = 0;
+	ESonoTraceUEDiffractionSamplingEnum DiffractionSampling = ESonoTraceUEDiffractionSamplingEnum::Random;
+	bool EnableDiffractionLineOfSightRequired = false;
+	float DiffractionMinimumStrength = 0.0f;
+	bool EnableDirectPathComponentCalculation = false;
+	float DirectPathMinimumStrength = 0.0f;
+	float DirectPathStrength = 0.0f;
+	bool EnableSimulationSubOutput = false;
+	bool PointsInSensorFrame = false;
+	bool EnableDebugLogExecutionTimes = false;
+
+	TArray<float> FinalReceiverDirectivities;
+	TArray<float> LogAbsorptions;
+	TSharedPtr<const FSonoTraceUEArrayGainTable, ESPMode::ThreadSafe> EmitterPatternGainTable;
+	// Object settings of the mesh registry, which do not change after its initialization
+	const TArray<FSonoTraceUEObjectSettingsStruct>* ObjectSettings = nullptr;
+};
+
+// Snapshot of the actor state a simulation run needs, taken on the game thread before the simulation task is launched
+struct FSonoTraceUESimulationInput
+{
+	FSonoTraceUESimulationSettings Settings;
+	int32 Index = 0;
+	double StartTime = 0;
+	TArray<int32> EmitterSignalIndexes;
+	FVector SensorLocation = FVector::ZeroVector;
+	FRotator SensorRotation = FRotator::ZeroRotator;
+	FVector SensorToOwnerTranslation = FVector::ZeroVector;
+	FRotator SensorToOwnerRotation = FRotator::ZeroRotator;
+	FVector OwnerLocation = FVector::ZeroVector;
+	FRotator OwnerRotation = FRotator::ZeroRotator;
+	TArray<FTransform> EmitterPoses;
+	TArray<FTransform> ReceiverPoses;
+	FSonoTraceUESubOutputStruct RayTracingSubOutput;
+	TArray<TTuple<bool, FVector>> DirectPathReceiverOutput;
+
+	// Objects used for the diffraction component
+	TArray<int32> HitObjectsPersistentPrimitiveIndexes;
+	TArray<int32> HitObjectInstanceIndexes; // Every instance of an instanced object is its own hit object, -1 for other objects
+	TArray<uint32> HitObjectKeys; // Seeds the random numbers of every hit object
+	TArray<int32> HitObjectTypes;
+	TArray<FName> HitObjectLabels;
+	TArray<FTransform> HitObjectTransforms;
+	TArray<FSonoTraceUEMeshDataPtr> HitObjectMeshData;
+	TArray<FCollisionQueryParams> HitObjectTraceParams;
+};
+
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_FiveParams(FInterfaceDataMessageReceivedEvent, int32, Type, const TArray<int32>&, Order, const TArray<FString>&, Strings, const TArray<int32>&, Integers, const TArray<float>&, Floats);
 
 UCLASS()
 class SONOTRACEUE_API ASonoTraceUEActor : public AActor
 {
 	GENERATED_BODY()
+
+	// Precomputes the mesh data of whole levels with the same pipeline
+	friend class USonoTraceUECommandlet;
+	friend struct FSonoTraceUESurfaceTable;
+	// Shares the mesh data of the world between all sensors using the same input settings
+	friend class USonoTraceUEMeshRegistry;
 	
 public:	
 	ASonoTraceUEActor();
@@ -1090,14 +1453,34 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "SonoTraceUE")
 	int32 GetEmitterSignalCount() const;
 
+	/**
+	* Get the simulated strengths of a point of the current output for a single emitter and receiver pair.
+	* @param PointIndex The index of the point in the reflected points of the current output.
+	* @param EmitterIndex The index of the emitter.
+	* @param ReceiverIndex The index of the receiver.
+	* @return The strength for each simulation frequency, empty if the indexes are not valid or the point was not simulated.
+	*/
+	UFUNCTION(BlueprintCallable, Category = "SonoTraceUE")
+	TArray<float> GetCurrentOutputPointStrengths(const int32 PointIndex, const int32 EmitterIndex, const int32 ReceiverIndex) const;
+
+	/**
+	* Get the total path length of a point of the current output from an emitter to a receiver.
+	* @param PointIndex The index of the point in the reflected points of the current output.
+	* @param EmitterIndex The index of the emitter.
+	* @param ReceiverIndex The index of the receiver.
+	* @return The total distance in centimeters, -1 if the indexes are not valid or the point was not simulated.
+	*/
+	UFUNCTION(BlueprintCallable, Category = "SonoTraceUE")
+	float GetCurrentOutputPointTotalDistanceToReceiver(const int32 PointIndex, const int32 EmitterIndex, const int32 ReceiverIndex) const;
+
 	/**
 	* Add an Actor to the SonoTraceUE mesh analysis system. Individual child components will be automatically parsed.
 	* If this contains any new mesh resource that is the first instance in the scene, it will load and parse this mesh data.
 	* @param Actor The new Actor to add.
 	* @return Returns true if the actor was successfully added.
 	*/
-	UFUNCTION(BlueprintCallable, Category = "SonoTraceUE", meta=(HidePin = "OverrideInitialization, UpdateTable"))
-	bool AddActor(AActor* Actor, const bool OverrideInitialization = false, const bool UpdateTable = true);
+	UFUNCTION(BlueprintCallable, Category = "SonoTraceUE", meta=(HidePin = "OverrideInitialization"))
+	bool AddActor(AActor* Actor, const bool OverrideInitialization = false);
 	
 	/**
 	* Add a StaticMeshComponent to the SonoTraceUE mesh analysis system.
@@ -1106,8 +1489,8 @@ public:
 	* @param ObjectNamePrefix The prefix to add to the label of this mesh. Usually this is the name of the Actor that owns this component.
 	* @return Returns true if the mesh component was successfully added.
 	*/
-	UFUNCTION(BlueprintCallable, Category = "SonoTraceUE", meta=(HidePin = "OverrideInitialization, UpdateTable, OverrideAddingToLoadList, PreviousAttempts"))
-	bool AddStaticMeshComponent(UStaticMeshComponent* MeshComponent, FString ObjectNamePrefix, const bool OverrideInitialization = false, const bool UpdateTable = true, const bool OverrideAddingToLoadList = false, const int32 PreviousAttempts = 0);
+	UFUNCTION(BlueprintCallable, Category = "SonoTraceUE", meta=(HidePin = "OverrideInitialization, OverrideAddingToLoadList, PreviousAttempts"))
+	bool AddStaticMeshComponent(UStaticMeshComponent* MeshComponent, FString ObjectNamePrefix, const bool OverrideInitialization = false, const bool OverrideAddingToLoadList = false, const int32 PreviousAttempts = 0);
 
 	/**
 	* Add a SkeletalMeshComponent to the SonoTraceUE mesh analysis system.
@@ -1116,8 +1499,8 @@ public:
 	* @param ObjectNamePrefix The prefix to add to the label of this mesh. Usually this is the name of the Actor that owns this component.
 	* @return Returns true if the mesh component was successfully added.
 	*/
-	UFUNCTION(BlueprintCallable, Category = "SonoTraceUE", meta=(HidePin = "OverrideInitialization, UpdateTable, OverrideAddingToLoadList, PreviousAttempts"))
-	bool AddSkeletalMeshComponent(USkeletalMeshComponent* MeshComponent, FString ObjectNamePrefix, const bool OverrideInitialization = false, const bool UpdateTable = true, const bool OverrideAddingToLoadList = false, const int32 PreviousAttempts = 0);
+	UFUNCTION(BlueprintCallable, Category = "SonoTraceUE", meta=(HidePin = "OverrideInitialization, OverrideAddingToLoadList, PreviousAttempts"))
+	bool AddSkeletalMeshComponent(USkeletalMeshComponent* MeshComponent, FString ObjectNamePrefix, const bool OverrideInitialization = false, const bool OverrideAddingToLoadList = false, const int32 PreviousAttempts = 0);
 
 	/**
 	* Remove an Actor from the SonoTraceUE mesh analysis system.
@@ -1125,8 +1508,8 @@ public:
 	* @param Actor The Actor to remove.
 	* @return Returns true if the mesh component was successfully removed.
 	*/
-	UFUNCTION(BlueprintCallable, Category = "SonoTraceUE", meta=(HidePin = "UpdateTable"))
-	bool RemoveActor(AActor* Actor, const bool UpdateTable = true);
+	UFUNCTION(BlueprintCallable, Category = "SonoTraceUE")
+	bool RemoveActor(AActor* Actor);
 
 	/**
 	* Remove a StaticMeshComponent of the SonoTraceUE mesh analysis system.
@@ -1134,8 +1517,8 @@ public:
 	* @param MeshComponent The StaticMeshComponent to remove.
 	* @return Returns true if the mesh component was successfully removed.
 	*/
-	UFUNCTION(BlueprintCallable, Category = "SonoTraceUE", meta=(HidePin = "UpdateTable"))
-	bool RemoveStaticMeshComponent(UStaticMeshComponent* MeshComponent, const bool UpdateTable = true);
+	UFUNCTION(BlueprintCallable, Category = "SonoTraceUE")
+	bool RemoveStaticMeshComponent(UStaticMeshComponent* MeshComponent);
 
 	/**
 	* Remove a SkeletalMeshComponent of the SonoTraceUE mesh analysis system.
@@ -1144,7 +1527,39 @@ public:
 	* @return Returns true if the mesh component was successfully removed.
 	*/
 	UFUNCTION(BlueprintCallable, Category = "SonoTraceUE")
-	bool RemoveSkeletalMeshComponent(USkeletalMeshComponent* MeshComponent, const bool UpdateTable = true);
+	bool RemoveSkeletalMeshComponent(USkeletalMeshComponent* MeshComponent);
+
+	/**
+	* Add a landscape to the SonoTraceUE mesh analysis system.
+	* Its mesh data is generated from the heightfield in tiles around the sensors instead of from its triangles.
+	* @param Landscape The new landscape to add.
+	* @param ObjectNamePrefix The prefix of the label of the landscape. Usually this is the name of the landscape.
+	* @return Returns true if the landscape was successfully added.
+	*/
+	UFUNCTION(BlueprintCallable, Category = "SonoTraceUE", meta=(HidePin = "OverrideInitialization"))
+	bool AddLandscape(ALandscapeProxy* Landscape, FString ObjectNamePrefix, const bool OverrideInitialization = false);
+
+	/**
+	* Remove a landscape of the SonoTraceUE mesh analysis system and unload all of its tiles.
+	* @param Landscape The landscape to remove.
+	* @return Returns true if the landscape was successfully removed.
+	*/
+	UFUNCTION(BlueprintCallable, Category = "SonoTraceUE")
+	bool RemoveLandscape(ALandscapeProxy* Landscape);
+
+	/**
+	* Get the number of unique meshes of which the mesh data is still being loaded or generated in the background.
+	* Objects using these meshes are simulated with the default BRDF and material of their object type until their mesh data is ready.
+	* @return The number of pending meshes.
+	*/
+	UFUNCTION(BlueprintCallable, Category = "SonoTraceUE")
+	int32 GetNumberOfPendingMeshData() const;
+
+	/**
+	* Log the memory used by the mesh data of every unique mesh and by the surface tables of the object types.
+	*/
+	UFUNCTION(BlueprintCallable, Category = "SonoTraceUE")
+	void LogMeshDataMemoryReport() const;
 
 	/**
 	* Set a new position coordinate for the emitters of the sensor. 
@@ -1255,12 +1670,21 @@ public:
 
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "SonoTraceUE|Output")
 	FSonoTraceUEOutputStruct CurrentOutput;	
+
+	static bool CopyMeshFromComponent(UMeshComponent* MeshComponent, UE::Geometry::FDynamicMesh3& OutMesh);
+	// Per triangle position, normal, size and curvature magnitude. The curvature of every vertex is computed once in a parallel pass, then all triangles are processed in parallel.
+	// Does not touch any UObject, so meshes can be processed in parallel as well.
+	static void CalculateMeshCurvature(const UE::Geometry::FDynamicMesh3& Mesh, FSonoTraceUEMeshDataStruct& OutMeshData, const float CurvatureScaleFactor = 1, const bool EnableCurvatureTriangleSizeBasedScaler = true,
+	                                   const float CurvatureScalerMinimumEffect = 0.05, const float CurvatureScalerMaximumEffect = 2, const float CurvatureScalerLowerTriangleSizeThreshold = 0.45, const float CurvatureScalerUpperTriangleSizeThreshold = 2, const float DiffractionTriangleSizeThreshold = 4);
+	// Diffraction stage of a simulation run: samples the hit objects of the input, traces the line of sight in the given world and evaluates the strengths in parallel.
+	// The world may be null when the line of sight is not required. Returns the number of candidates that were evaluated.
+	static int32 SimulateDiffraction(const FSonoTraceUESimulationInput& Input, const UWorld* World, FSonoTraceUESubOutputStruct& DiffractionSubOutput);
 	
 protected:
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
 	void GenerateAllInitialMeshData();
-	void UpdateScenePrimitiveIndexToPersistentPrimitiveIndexTable();
 	void UpdateTransformations();
 	void UpdateInterface();
 	void SendInterfaceSettings();
@@ -1269,11 +1693,17 @@ protected:
 	void UpdateShaderParameters();
 	bool ExecuteRayTracingOnce(const TArray<int32> OverrideEmitterSignalIndexes);
 	void ParseRayTracing();	
-	void RunSimulation(const TArray<int32> OverrideEmitterSignalIndexes);
+	bool CompleteParseRayTracing();
+	void AddResolvedScenePrimitives();
+	bool RunSimulation(const TArray<int32> OverrideEmitterSignalIndexes);
+	bool CompleteRunSimulation();
+	void GatherDiffractionObjects(FSonoTraceUESimulationInput& Input);
+	static void SimulateOutput(FSonoTraceUESimulationInput& Input, FSonoTraceUEOutputStruct& Output, const UWorld* World);
+	void WaitForPendingTasks();
 	void PrepareInterfaceMeasurementData(const FSonoTraceUEOutputStruct& Output);
 	void DrawSimulationResult();
 	void DrawSimulationDebug();
-	void DrawMeshDebug(const UMeshComponent* MeshComponent, FSonoTraceUEMeshDataStruct& NewMeshData) const;
+	void DrawMeshDebug(const UMeshComponent* MeshComponent, const FSonoTraceUEMeshDataStruct& NewMeshData, const FSonoTraceUEObjectSettingsStruct* ObjectSettings) const;
 
 	static void MergeEmitterPatternImpulseResponses(const int32 OriginalReceiverCount, const int32 NewReceiverCount, const int NumberOfIRSamples, TArray<TArray<float>>* ImpulseResponses);
 	static TArray<float> Interpolate(const TArray<float>& X, const TArray<float>& Y, const TArray<float>& Xq);
@@ -1281,9 +1711,11 @@ protected:
 	static TArray<float> Convolve(const TArray<float>& Signal1, const TArray<float>& Signal2, bool bSame);
 	static void CircShift(TArray<float>& Signal, int32 Shift);	
 	static float SigmoidMix(const float X, const float Slope, const float Center, const float Value1, const float Value2);
-	static void GenerateBRDFAndMaterial(const FSonoTraceUEObjectSettingsStruct* ObjectSettings, FSonoTraceUEMeshDataStruct* MeshData);
-	static void CalculateMeshCurvature(UMeshComponent* MeshComponent, FSonoTraceUEMeshDataStruct& OutMeshData, const float CurvatureScaleFactor = 1, const bool EnableCurvatureTriangleSizeBasedScaler = true,
-	                                   const float CurvatureScalerMinimumEffect = 0.05, const float CurvatureScalerMaximumEffect = 2, const float CurvatureScalerLowerTriangleSizeThreshold = 0.45, const float CurvatureScalerUpperTriangleSizeThreshold = 2, const float DiffractionTriangleSizeThreshold = 4);
+	static void GenerateBRDFAndMaterial(const FSonoTraceUEObjectSettingsStruct* ObjectSettings, FSonoTraceUEMeshDataStruct* MeshData, const float DiffractionTriangleSizeThreshold);
+	static void GenerateMeshData(UMeshComponent* MeshComponent, const UObject* MeshAsset, const USonoTraceUEInputSettingsData* InputSettings, const FSonoTraceUEObjectSettingsStruct* ObjectSettings, FSonoTraceUEMeshDataStruct& OutMeshData);
+	static void GetMeshDataCacheKeys(const UObject* MeshAsset, const USonoTraceUEInputSettingsData* InputSettings, const FSonoTraceUEObjectSettingsStruct* ObjectSettings, FString& OutCacheKey, FString& OutPackKey);
+	static bool LoadCachedMeshData(const FString& CacheKey, const FString& PackKey, FSonoTraceUEMeshDataStruct& OutMeshData);
+	static void ProcessMeshData(const UE::Geometry::FDynamicMesh3& Mesh, const USonoTraceUEInputSettingsData* InputSettings, const FSonoTraceUEObjectSettingsStruct* ObjectSettings, const FString& CacheKey, FSonoTraceUEMeshDataStruct& OutMeshData);
 	static FSonoTraceUEGeneratedInputStruct GenerateInputSettings(const USonoTraceUEInputSettingsData* InputSettings, TMap<UObject*, int32>* AssetToObjectTypeIndexSettings);
 	static TArray<FSonoTraceUEObjectSettingsStruct> PopulateObjectSettings(const USonoTraceUEInputSettingsData* InputSettings, TMap<UObject*, int32>* AssetToObjectTypeIndexSettings);
 	static TArray<FVector> PopulatePositions(const bool EnableTable, const UDataTable* DataTable, const TArray<FVector>& Positions, const FString LogString, const int32 MaxCount = 0);
@@ -1295,23 +1727,33 @@ protected:
 	static FVector CalculateTriangleNormal(const FVector3f& Vertex1, const FVector3f& Vertex2, const FVector3f& Vertex3);
 	static float CalculateTriangleCurvature(const FVector3f& Vertex1, const FVector3f& Vertex2, const FVector3f& Vertex3, const FVector3f& Normal1, const FVector3f& Normal2, const FVector3f& Normal3);
 	static TArray<uint8> SerializeObjectSettingsStruct(FSonoTraceUEObjectSettingsStruct* ObjectSettingsStruct);
-	static TArray<uint8> SerializePointStruct(FSonoTraceUEPointStruct* PointStruct);
+	static TArray<uint8> SerializePointStruct(FSonoTraceUEPointStruct* PointStruct, const FSonoTraceUEStrengthTensor& StrengthTensor);
 	static void DrawDebugNonSymmetricalFrustum(const UWorld* InWorld, const FTransform& StartTransform, const float LowerAzimuthLimit, const float UpperAzimuthLimit, const float LowerElevationLimit, const float UpperElevationLimit, const float Distance, FColor const& Color, bool bPersistentLines = false, float LifeTime=-1.f, uint8 DepthPriority = 0, float Thickness = 0.f);
 
 	float TranscurredTime = 0;
 	bool Initialized = false;
 	bool AwaitingRayTracingResult = false;
 	TArray<int32> TriggerTemporaryEmitterSignalIndexes;
-	bool ReadyToUseRayTracingResult = false;
-	bool CurrentlyParsingRaytracing = false;
 	TArray<int32> CurrentEmitterSignalIndexes;
 	
 	FSonoTrace SonoTrace;
-	FRandomStream RandomStream;
-	FRHIGPUBufferReadback* GPUReadback = nullptr;
-	FStructuredOutputBufferElem* RayTracingRawOutput = nullptr;
+	const FStructuredOutputBufferElem* RayTracingRawOutput = nullptr;
+	TSharedPtr<TArray<FStructuredOutputBufferElem>, ESPMode::ThreadSafe> RayTracingRawOutputBuffer;
+	FSonoTraceUEStagingBufferPool StagingBufferPool;
+	UE::Tasks::FTask ParseTask;
+	TSharedPtr<FSonoTraceUEParseResult, ESPMode::ThreadSafe> PendingParseResult;
+	// Tuple of SPI, PPI, label and resource name of unknown or moved objects found on the render thread that still need to be updated in the tables
+	TArray<TTuple<int32, int32, FName, FName>> ResolvedScenePrimitives;
+	// Pair of PPI and current SPI of known objects found at another SPI than the one in the lookup, INDEX_NONE when removed from the scene
+	TArray<TPair<int32, int32>> MovedScenePrimitives;
+	FCriticalSection ResolvedScenePrimitivesCriticalSection;
 	TArray<TTuple<bool, FVector>> DirectPathReceiverOutput;
 	FSonoTraceUESubOutputStruct RayTracingSubOutput;
+	FSonoTraceFrameInfo RayTracingFrameInfo;
+	UE::Tasks::FTask SimulationTask;
+	// Written by the simulation task and swapped with CurrentOutput on the game thread when the task completes
+	FSonoTraceUEOutputStruct SimulationBackOutput;
+	double SimulationTime = 0;
 	uint64 SonoTracePreviousIndex = 0;	
 	double RayTracingLastLoggedTime = 0.0;        
 	int32 RayTracingExecutionCount = 0;
@@ -1320,22 +1762,9 @@ protected:
 	TArray<TTuple<FString, UStaticMeshComponent*, int32>> StaticMeshComponentsToLoad;
 	TArray<TTuple<FString, USkeletalMeshComponent*, int32>> SkeletalMeshComponentsToLoad;
 	
+	// Mesh data and primitive tables of the world, shared with the other sensors using the same input settings
 	UPROPERTY()
-	TMap<UObject*, int32> AssetToObjectTypeIndexSettings;
-	TMap<int32, TTuple<FName, int32>> PersistentPrimitiveIndexToLabelsAndObjectTypes;
-	UPROPERTY()
-	TMap<int32, UPrimitiveComponent*> PersistentPrimitiveIndexToPrimitiveComponent;
-	TMap<int32, int32> PersistentPrimitiveIndexToMeshDataIndex;
-	TArray<FSonoTraceUEMeshDataStruct> MeshData;
-	UPROPERTY()
-	TMap<UStaticMesh*, int32> StaticMeshToMeshDataIndex;
-	UPROPERTY()
-	TMap<USkeletalMesh*, int32> SkeletalMeshToMeshDataIndex;
-	UPROPERTY()
-	TMap<UStaticMesh*, int32> StaticMeshCounter;
-	UPROPERTY()
-	TMap<USkeletalMesh*, int32> SkeletalMeshCounter;
-	TMap<int32, int32> ScenePrimitiveIndexToPersistentPrimitiveIndex;
+	USonoTraceUEMeshRegistry* MeshRegistry = nullptr;
 
 	
 	TArray<FTransform> EmitterPoses;
@@ -0,0 +1,32 @@
+// By Wouter Jansen & Jan Steckel, Cosys-Lab, University of Antwerp. See the LICENSE file for details.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+// Walker/Vose alias table to draw indexes proportional to a set of non-negative weights in constant time.
+// Every bin holds the probability of keeping its own index and the alias index it falls back to otherwise.
+struct SONOTRACEUE_API FSonoTraceUEAliasTable
+{
+	// Builds the table in O(N). When all weights are zero every index is equally likely.
+	void Build(TConstArrayView<float> Weights);
+
+	// Draws an index from two uniform random numbers in [0, 1)
+	int32 Sample(const float UniformBin, const float UniformAlias) const
+	{
+		const int32 Bin = FMath::Min(static_cast<int32>(UniformBin * Probabilities.Num()), Probabilities.Num() - 1);
+		return UniformAlias < Probabilities[Bin] ? Bin : Aliases[Bin];
+	}
+
+	int32 Num() const { return Probabilities.Num(); }
+	bool IsValid() const { return Probabilities.Num() > 0; }
+	SIZE_T GetAllocatedSize() const { return Probabilities.GetAllocatedSize() + Aliases.GetAllocatedSize(); }
+
+	friend FArchive& operator<<(FArchive& Ar, FSonoTraceUEAliasTable& Table)
+	{
+		return Ar << Table.Probabilities << Table.Aliases;
+	}
+
+	TArray<float> Probabilities;
+	TArray<int32> Aliases;
+};
@@ -0,0 +1,24 @@
+// By Wouter Jansen & Jan Steckel, Cosys-Lab, University of Antwerp. See the LICENSE file for details.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "SonoTraceUECommandlet.generated.h"
+
+// Precomputes the curvature, BRDF, material and diffraction data of all meshes of one or more maps or a list of mesh assets in parallel.
+// The results are written to the mesh data pack that packaged builds load at startup, and to the mesh data cache of the editor.
+// Usage: UnrealEditor-Cmd <Project>.uproject -run=SonoTraceUE -Settings=<InputSettings asset> [-Maps=<Map>+<Map>] [-Meshes=<Mesh>+<Mesh>] [-Output=<Pack file>]
+UCLASS()
+class SONOTRACEUE_API USonoTraceUECommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	USonoTraceUECommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+
+	// Number of meshes converted and kept in memory at once
+	static constexpr int32 MeshesPerBatch = 64;
+};
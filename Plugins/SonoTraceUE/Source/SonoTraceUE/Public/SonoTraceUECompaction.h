@@ -0,0 +1,88 @@
+// By Wouter Jansen & Jan Steckel, Cosys-Lab, University of Antwerp. See the LICENSE file for details.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Async/ParallelFor.h"
+
+// Stable parallel stream compaction of arrays by a keep mask.
+// The kept elements are counted per chunk, an exclusive prefix sum over the chunk counts gives the write offset of every chunk and the chunks scatter in parallel.
+// Kept elements keep their relative order.
+namespace SonoTraceUECompaction
+{
+	static constexpr int32 ElementsPerChunk = 1024;
+
+	// Fills the index every element ends up at after compaction, INDEX_NONE for removed elements. Returns the number of kept elements.
+	inline int32 CalculateCompactedIndexes(TConstArrayView<uint8> KeepMask, TArray<int32>& OutCompactedIndexes)
+	{
+		const int32 NumChunks = FMath::DivideAndRoundUp(KeepMask.Num(), ElementsPerChunk);
+		TArray<int32> ChunkOffsets;
+		ChunkOffsets.SetNumZeroed(NumChunks);
+		ParallelFor(NumChunks, [&](const int32 ChunkIndex)
+		{
+			const int32 LastIndex = FMath::Min((ChunkIndex + 1) * ElementsPerChunk, KeepMask.Num());
+			int32 NumKept = 0;
+			for (int32 Index = ChunkIndex * ElementsPerChunk; Index < LastIndex; Index++)
+			{
+				NumKept += KeepMask[Index] != 0;
+			}
+			ChunkOffsets[ChunkIndex] = NumKept;
+		});
+
+		int32 TotalKept = 0;
+		for (int32& ChunkOffset : ChunkOffsets)
+		{
+			const int32 NumKept = ChunkOffset;
+			ChunkOffset = TotalKept;
+			TotalKept += NumKept;
+		}
+
+		OutCompactedIndexes.SetNumUninitialized(KeepMask.Num());
+		ParallelFor(NumChunks, [&](const int32 ChunkIndex)
+		{
+			const int32 LastIndex = FMath::Min((ChunkIndex + 1) * ElementsPerChunk, KeepMask.Num());
+			int32 CompactedIndex = ChunkOffsets[ChunkIndex];
+			for (int32 Index = ChunkIndex * ElementsPerChunk; Index < LastIndex; Index++)
+			{
+				OutCompactedIndexes[Index] = KeepMask[Index] != 0 ? CompactedIndex++ : INDEX_NONE;
+			}
+		});
+		return TotalKept;
+	}
+
+	// Moves every kept element to its compacted index. With a stride larger than one every index covers that many consecutive elements.
+	template <typename ElementType>
+	void Scatter(TArray<ElementType>& Elements, TConstArrayView<int32> CompactedIndexes, const int32 NumKept, const int32 Stride = 1)
+	{
+		check(Elements.Num() == CompactedIndexes.Num() * Stride);
+		TArray<ElementType> CompactedElements;
+		CompactedElements.SetNum(NumKept * Stride);
+		const int32 NumChunks = FMath::DivideAndRoundUp(CompactedIndexes.Num(), ElementsPerChunk);
+		ParallelFor(NumChunks, [&](const int32 ChunkIndex)
+		{
+			const int32 LastIndex = FMath::Min((ChunkIndex + 1) * ElementsPerChunk, CompactedIndexes.Num());
+			for (int32 Index = ChunkIndex * ElementsPerChunk; Index < LastIndex; Index++)
+			{
+				if (const int32 CompactedIndex = CompactedIndexes[Index]; CompactedIndex != INDEX_NONE)
+				{
+					for (int32 StrideIndex = 0; StrideIndex < Stride; StrideIndex++)
+					{
+						CompactedElements[CompactedIndex * Stride + StrideIndex] = MoveTemp(Elements[Index * Stride + StrideIndex]);
+					}
+				}
+			}
+		});
+		Elements = MoveTemp(CompactedElements);
+	}
+
+	// Removes all elements without a set mask while keeping the order of the others, returns the number of kept elements
+	template <typename ElementType>
+	int32 Compact(TArray<ElementType>& Elements, TConstArrayView<uint8> KeepMask)
+	{
+		TArray<int32> CompactedIndexes;
+		const int32 NumKept = CalculateCompactedIndexes(KeepMask, CompactedIndexes);
+		if (NumKept != Elements.Num())
+			Scatter(Elements, CompactedIndexes, NumKept);
+		return NumKept;
+	}
+}
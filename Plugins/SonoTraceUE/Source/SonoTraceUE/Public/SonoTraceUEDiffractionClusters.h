@@ -0,0 +1,83 @@
+// By Wouter Jansen & Jan Steckel, Cosys-Lab, University of Antwerp. See the LICENSE file for details.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "SonoTraceUEAliasTable.h"
+
+// The triangles of a mesh that are eligible for diffraction, grouped in spatially coherent clusters along a Morton curve.
+// Every cluster has a bounding sphere and a cone around the normals of its triangles, so clusters outside the sensor frustum or facing away from every emitter are culled as a whole.
+// Every cluster holds an alias table over its own triangles, sampling a visible cluster by its importance and then a triangle within gives the same distribution as sampling the visible triangles directly.
+struct SONOTRACEUE_API FSonoTraceUEDiffractionClusters
+{
+	static constexpr int32 TrianglesPerCluster = 64;
+
+	struct FCluster
+	{
+		FVector Center = FVector::ZeroVector; // Mesh space
+		float Radius = 0.0f;
+		FVector ConeAxis = FVector::ZeroVector; // Mesh space
+		float ConeHalfAngle = PI; // Radians
+		float Importance = 0.0f;
+		int32 FirstTriangle = 0;
+		int32 NumTriangles = 0;
+		FSonoTraceUEAliasTable AliasTable;
+
+		friend FArchive& operator<<(FArchive& Ar, FCluster& Cluster)
+		{
+			return Ar << Cluster.Center << Cluster.Radius << Cluster.ConeAxis << Cluster.ConeHalfAngle << Cluster.Importance
+			          << Cluster.FirstTriangle << Cluster.NumTriangles << Cluster.AliasTable;
+		}
+	};
+
+	// Sensor frustum and emitters of a measurement in world space, angles in degrees and distances in centimeters
+	struct FView
+	{
+		FVector SensorLocation = FVector::ZeroVector;
+		FRotator SensorRotation = FRotator::ZeroRotator;
+		float LowerAzimuthLimit = -180.0f;
+		float UpperAzimuthLimit = 180.0f;
+		float LowerElevationLimit = -90.0f;
+		float UpperElevationLimit = 90.0f;
+		float MaximumDistance = 0.0f;
+		TConstArrayView<FVector> EmitterLocations;
+	};
+
+	// Builds the clusters over the eligible triangles, the weights of all triangles add up to the mesh importance
+	void Build(TConstArrayView<FVector> Positions, TConstArrayView<FVector> Normals, TConstArrayView<float> Weights, TConstArrayView<uint8> EligibleMask);
+
+	// Fills the clusters of the mesh placed with the transform that can hold a diffraction point for the view, and their importance.
+	// Returns the projected solid angle of the visible clusters weighted by their mean importance.
+	float Cull(const FTransform& Transform, const FView& View, TArray<int32>& OutClusters, TArray<float>& OutImportances) const;
+
+	// Draws a triangle of a cluster from two uniform random numbers in [0, 1)
+	int32 SampleTriangle(const int32 ClusterIndex, const float UniformBin, const float UniformAlias) const
+	{
+		const FCluster& Cluster = Clusters[ClusterIndex];
+		return Triangles[Cluster.FirstTriangle + Cluster.AliasTable.Sample(UniformBin, UniformAlias)];
+	}
+
+	bool IsValid() const { return Clusters.Num() > 0; }
+
+	SIZE_T GetAllocatedSize() const
+	{
+		SIZE_T Size = Clusters.GetAllocatedSize() + Triangles.GetAllocatedSize();
+		for (const FCluster& Cluster : Clusters)
+		{
+			Size += Cluster.AliasTable.GetAllocatedSize();
+		}
+		return Size;
+	}
+
+	// Splits a sample budget over objects in proportion to their weights, the largest remainders get the samples that are left after rounding down
+	static void SplitBudget(TConstArrayView<float> Weights, const int32 Budget, TArray<int32>& OutCounts);
+
+	friend FArchive& operator<<(FArchive& Ar, FSonoTraceUEDiffractionClusters& DiffractionClusters)
+	{
+		return Ar << DiffractionClusters.Clusters << DiffractionClusters.Triangles << DiffractionClusters.MeshImportance;
+	}
+
+	TArray<FCluster> Clusters;
+	TArray<int32> Triangles; // Triangle indexes ordered by cluster
+	float MeshImportance = 0.0f; // Summed importance of all triangles, also the ones that are not eligible
+};
@@ -0,0 +1,52 @@
+// By Wouter Jansen & Jan Steckel, Cosys-Lab, University of Antwerp. See the LICENSE file for details.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+struct FSonoTraceUEMeshDataStruct;
+class FSonoTraceUEHeightfield;
+
+typedef TSharedPtr<const FSonoTraceUEHeightfield, ESPMode::ThreadSafe> FSonoTraceUEHeightfieldPtr;
+
+// Heights of a square tile of landscape quads, in the frame of the landscape scaled to centimeters.
+// One extra ring of samples around the tile gives the curvature at the tile border without the neighbouring tiles.
+struct SONOTRACEUE_API FSonoTraceUEHeightfieldTileSamples
+{
+	int32 NumberOfQuads = 0; // Per side
+	FVector2D Origin = FVector2D::ZeroVector; // Position of the first vertex of the tile
+	FVector2D QuadSize = FVector2D(100.0);
+	TArray<float> Heights; // Row by row, starting one sample before the origin
+	TArray<uint8> Valid; // Zero for holes and samples outside the landscape
+
+	void Init(const int32 InNumberOfQuads, const FVector2D& InOrigin, const FVector2D& InQuadSize);
+	int32 GetNumberOfSamplesPerSide() const { return NumberOfQuads + 3; }
+	// X and Y range from -1 to NumberOfQuads + 1
+	int32 GetSampleIndex(const int32 X, const int32 Y) const { return (Y + 1) * GetNumberOfSamplesPerSide() + X + 1; }
+	FVector GetVertex(const int32 X, const int32 Y) const { return FVector(Origin.X + X * QuadSize.X, Origin.Y + Y * QuadSize.Y, Heights[GetSampleIndex(X, Y)]); }
+
+	// Magnitude of the mean curvature at a vertex from the central differences of the heights, missing neighbours take the height of the vertex
+	float GetMeanCurvature(const int32 X, const int32 Y) const;
+	// Two triangles per quad with the same per triangle data as the meshes. The triangle curvature is the range of the curvature of its vertices,
+	// the triangle size based scaler is not applied as all triangles of a landscape have the same size.
+	void CalculateMeshData(const float CurvatureScaleFactor, FSonoTraceUEMeshDataStruct& OutMeshData) const;
+	// Vertices and triangles of the tile in the triangle order of the mesh data, for the CPU raytracing backend. The triangles are wound so their front side faces up
+	// in the shader convention, triangles touching a hole are collapsed to a single vertex so they are never hit.
+	void GetTriangles(TArray<FVector3f>& OutVertices, TArray<FIntVector>& OutTriangles) const;
+	// Triangle of a tile at a position within the tile in quads, the quads are split along the diagonal from their first to their last vertex
+	static int32 GetTriangleIndex(const int32 NumberOfQuads, const FVector2D& TilePosition);
+};
+
+// Loaded tiles of a landscape, published to the parse tasks so hits are resolved to a triangle of the mesh data of their tile from their position.
+// Immutable once published, tiles that are loaded or evicted publish a new one.
+class SONOTRACEUE_API FSonoTraceUEHeightfield
+{
+public:
+	FTransform LandscapeTransform = FTransform::Identity; // Local units are quads
+	int32 TileNumberOfQuads = 64;
+	TMap<FIntPoint, int32> TileMeshDataIndexes;
+
+	static FIntPoint GetTile(const FVector2D& LocalPosition, const int32 TileNumberOfQuads);
+	// Mesh data and triangle of the tile containing the position, false when the tile is not loaded
+	bool FindTriangle(const FVector& WorldPosition, int32& OutMeshDataIndex, int32& OutTriangleIndex) const;
+};
@@ -0,0 +1,44 @@
+// By Wouter Jansen & Jan Steckel, Cosys-Lab, University of Antwerp. See the LICENSE file for details.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "SonoTraceCPU.h"
+
+class UInstancedStaticMeshComponent;
+class FSonoTraceUEInstanceHierarchy;
+
+typedef TSharedPtr<const FSonoTraceUEInstanceHierarchy, ESPMode::ThreadSafe> FSonoTraceUEInstanceHierarchyPtr;
+
+// World space bounds of all instances of an instanced static mesh component (ISM, HISM or foliage) in a BVH.
+// Resolves hits to the instance they landed on and finds the instances in range of the sensor, so large instanced scenes are not handled instance by instance.
+// Only the bounds are kept, the transform of an instance is fetched from the component when it is needed.
+class SONOTRACEUE_API FSonoTraceUEInstanceHierarchy
+{
+public:
+	void Build(const TArray<FBox3f>& InstanceBounds);
+
+	// Builds the hierarchy from the current instances of the component, game thread only
+	static FSonoTraceUEInstanceHierarchyPtr Create(const UInstancedStaticMeshComponent* Component);
+	static uint64 HashInstanceData(const UInstancedStaticMeshComponent* Component);
+	// False when instances were added, removed or moved or the component was moved since the hierarchy was built
+	bool IsUpToDate(const UInstancedStaticMeshComponent* Component) const;
+
+	// Instance of which the bounds contain the position, the one with the closest center if several do. INDEX_NONE if there is none.
+	int32 FindInstance(const FVector3f& Position) const;
+	// Appends all instances of which the bounds overlap the sphere
+	void OverlapSphere(const FVector3f& Center, const float Radius, TArray<int32>& OutInstances) const;
+
+	int32 Num() const { return Bounds.Num(); }
+	SIZE_T GetAllocatedSize() const { return Bounds.GetAllocatedSize() + BVH.Nodes.GetAllocatedSize() + BVH.PrimitiveOrder.GetAllocatedSize(); }
+
+private:
+	template <typename NodeTestType, typename LeafFunctionType>
+	void Traverse(NodeTestType&& NodeTest, LeafFunctionType&& LeafFunction) const;
+
+	TArray<FBox3f> Bounds;
+	FSonoTraceBVH BVH;
+	FTransform ComponentTransform = FTransform::Identity;
+	// Hash of the per instance data of the component, catches instances moved without changing the count
+	uint64 InstanceDataHash = 0;
+};
@@ -0,0 +1,48 @@
+// By Wouter Jansen & Jan Steckel, Cosys-Lab, University of Antwerp. See the LICENSE file for details.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+struct FSonoTraceUEMeshDataStruct;
+struct FSonoTraceUEObjectSettingsStruct;
+class USonoTraceUEInputSettingsData;
+
+// Persistent cache of the per mesh acoustic data under Saved/SonoTraceUE/MeshCache, so the curvature, BRDF and material tables and the diffraction clusters are only generated once per mesh.
+// Every entry is keyed by a hash of the mesh asset and all settings the mesh data depends on, a changed mesh or setting gives a new key and the stale entry is simply never read again.
+class SONOTRACEUE_API FSonoTraceUEMeshCache
+{
+public:
+	// Bump whenever the layout of FSonoTraceUEMeshDataStruct or the mesh data generation changes
+	static constexpr uint32 Version = 2;
+	static constexpr uint32 Magic = 0x434D5453; // "STMC"
+
+	// Key of the mesh data of a static or skeletal mesh asset, empty when the asset is not saved on disk or has unsaved changes and can't be cached
+	static FString GetKey(const UObject* MeshAsset, const FSonoTraceUEObjectSettingsStruct& ObjectSettings, const USonoTraceUEInputSettingsData& InputSettings);
+
+	// Key from an identifier of the mesh geometry and the settings, used by GetKey
+	static FString GetKey(const FString& MeshIdentifier, const FSonoTraceUEObjectSettingsStruct& ObjectSettings, const USonoTraceUEInputSettingsData& InputSettings);
+
+	static FString GetDirectory();
+	static FString GetPath(const FString& Key);
+
+	// Returns false on a missing, outdated or corrupt entry, the mesh data is left empty then
+	static bool Load(const FString& Key, FSonoTraceUEMeshDataStruct& OutMeshData);
+	static bool Save(const FString& Key, const FSonoTraceUEMeshDataStruct& MeshData);
+
+	// The mesh data pack is a single data file with the entries of whole levels, written by the SonoTraceUE commandlet and shipped with packaged builds.
+	// Pack entries are keyed by the asset path instead of the geometry, the commandlet has to be rerun when the meshes change.
+	static constexpr uint32 PackMagic = 0x504D5453; // "STMP"
+	static FString GetPackPath();
+	static FString GetPackKey(const UObject* MeshAsset, const FSonoTraceUEObjectSettingsStruct& ObjectSettings, const USonoTraceUEInputSettingsData& InputSettings);
+	// The pack is memory mapped once on the first lookup when the platform supports it, the entries are deserialized from the mapping
+	static bool LoadFromPack(const FString& Key, FSonoTraceUEMeshDataStruct& OutMeshData);
+	// Whether a cache entry or pack entry exists for either key, empty keys are skipped. Does not validate the entry.
+	static bool Contains(const FString& Key, const FString& PackKey);
+	// Entries hold the serialized data written by Write
+	static bool WritePack(const FString& Path, const TMap<FString, TArray<uint8>>& Entries);
+
+	// Serialization of an entry with its header, shared by the cache entries and the pack
+	static bool Read(FArchive& Ar, FSonoTraceUEMeshDataStruct& OutMeshData);
+	static void Write(FArchive& Ar, const FSonoTraceUEMeshDataStruct& MeshData);
+};
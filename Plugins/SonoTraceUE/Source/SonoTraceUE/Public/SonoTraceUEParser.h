@@ -0,0 +1,130 @@
+// By Wouter Jansen & Jan Steckel, Cosys-Lab, University of Antwerp. See the LICENSE file for details.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "SonoTrace.h"
+#include "SonoTraceUEInstanceHierarchy.h"
+#include "SonoTraceUEHeightfield.h"
+#include "HAL/CriticalSection.h"
+
+struct FSonoTraceUEMeshDataStruct;
+struct FSonoTraceUEObjectSettingsStruct;
+struct FSonoTraceUESubOutputStruct;
+
+// Mesh data in a slot of the mesh registry is never modified, a slot that changes gets new mesh data so tasks holding the previous one keep reading it
+typedef TSharedPtr<const FSonoTraceUEMeshDataStruct, ESPMode::ThreadSafe> FSonoTraceUEMeshDataPtr;
+
+// Dense lookup tables indexed by scene primitive index (SPI) so the parser never has to hash per hit.
+struct SONOTRACEUE_API FSonoTraceUEPrimitiveLookup
+{
+	void Reset();
+	void Add(const int32 ScenePrimitiveIndex, const int32 PersistentPrimitiveIndex, const FName Label, const int32 ObjectTypeIndex, const int32 MeshDataIndex,
+	         const FSonoTraceUEInstanceHierarchyPtr& InstanceHierarchy = nullptr, const FSonoTraceUEHeightfieldPtr& Heightfield = nullptr);
+	// Only clears the entry if it still belongs to the persistent primitive, another primitive may have been moved into its slot
+	void Remove(const int32 ScenePrimitiveIndex, const int32 PersistentPrimitiveIndex);
+	bool Contains(const int32 ScenePrimitiveIndex) const
+	{
+		return PersistentPrimitiveIndexes.IsValidIndex(ScenePrimitiveIndex) && PersistentPrimitiveIndexes[ScenePrimitiveIndex] != INDEX_NONE;
+	}
+	int32 Num() const { return PersistentPrimitiveIndexes.Num(); }
+
+	TArray<int32> PersistentPrimitiveIndexes; // INDEX_NONE for scene primitives that are not known
+	TArray<FName> Labels;
+	TArray<int32> ObjectTypeIndexes;
+	TArray<int32> MeshDataIndexes; // INDEX_NONE if there is no mesh data for the object
+	TArray<FSonoTraceUEInstanceHierarchyPtr> InstanceHierarchies; // Only set for instanced objects
+	TArray<FSonoTraceUEHeightfieldPtr> Heightfields; // Only set for landscapes
+};
+
+// Primitive lookup maintained incrementally with two tables. Changes are logged and replayed on the table no parse task holds,
+// which is then published. Publishing costs the number of changes since that table was last published instead of a full rebuild,
+// and a published table is never modified so the parse tasks can read it without locks.
+class SONOTRACEUE_API FSonoTraceUEPrimitiveLookupBuffer
+{
+public:
+	typedef TSharedPtr<FSonoTraceUEPrimitiveLookup, ESPMode::ThreadSafe> FLookupPtr;
+
+	FSonoTraceUEPrimitiveLookupBuffer();
+	void Add(const int32 ScenePrimitiveIndex, const int32 PersistentPrimitiveIndex, const FName Label, const int32 ObjectTypeIndex, const int32 MeshDataIndex,
+	         const FSonoTraceUEInstanceHierarchyPtr& InstanceHierarchy = nullptr, const FSonoTraceUEHeightfieldPtr& Heightfield = nullptr);
+	void Remove(const int32 ScenePrimitiveIndex, const int32 PersistentPrimitiveIndex);
+	// Game thread only. Returns a table with all changes applied.
+	FLookupPtr Publish();
+	int32 NumPendingChanges() const { return Changes.Num() - AppliedChanges[PublishedTable]; }
+
+private:
+	struct FChange
+	{
+		int32 ScenePrimitiveIndex;
+		int32 PersistentPrimitiveIndex;
+		FName Label;
+		int32 ObjectTypeIndex;
+		int32 MeshDataIndex;
+		FSonoTraceUEInstanceHierarchyPtr InstanceHierarchy;
+		FSonoTraceUEHeightfieldPtr Heightfield;
+		bool Remove;
+	};
+
+	FLookupPtr Tables[2];
+	int32 AppliedChanges[2] = {0, 0};
+	int32 PublishedTable = 0;
+	TArray<FChange> Changes;
+};
+
+// Everything the parser needs from the actor for a single raytracing result
+struct FSonoTraceUEParseContext
+{
+	const FStructuredOutputBufferElem* RawOutput = nullptr;
+	int32 NumberOfRays = 0;
+	int32 MaximumBounces = 0;
+	FVector SensorLocation = FVector::ZeroVector;
+	TArray<FTransform> EmitterPoses;
+	TArray<float> EmitterDirectivities;
+	bool EnableEmitterDirectivity = false;
+	const FSonoTraceUEPrimitiveLookup* PrimitiveLookup = nullptr;
+	const TArray<FSonoTraceUEMeshDataPtr>* MeshData = nullptr;
+	const TArray<float>* DefaultTriangleBRDF = nullptr;
+	const TArray<float>* DefaultTriangleMaterial = nullptr;
+	const TArray<FSonoTraceUEObjectSettingsStruct>* ObjectSettings = nullptr; // Surface tables, and default rows of meshes whose mesh data is not ready yet
+
+	// Direct path rays are stored after the distribution rays, one ray per receiver
+	bool EnableDirectPath = false;
+	int32 NumberOfDirectPathRays = 0;
+	float MaximumRayDistance = 0.0f;
+	TArray<FTransform> ReceiverPoses;
+};
+
+// Pool of CPU staging buffers the raytracing readback is copied into on the render thread.
+// A buffer is handed out again once the pool holds the only reference to it, so results that are still parsed or drawn keep their data.
+class SONOTRACEUE_API FSonoTraceUEStagingBufferPool
+{
+public:
+	typedef TSharedRef<TArray<FStructuredOutputBufferElem>, ESPMode::ThreadSafe> FBufferRef;
+
+	FBufferRef Acquire(const int32 NumElements);
+	int32 Num();
+
+private:
+	FCriticalSection CriticalSection;
+	TArray<FBufferRef> Buffers;
+};
+
+// Parallel parser of the raw raytracing output into reflected points.
+// Rays are split in fixed size chunks that are parsed into their own point arrays, which are merged afterward using a prefix sum over the chunk sizes.
+// The resulting point order is identical to a serial parse.
+class SONOTRACEUE_API FSonoTraceUEParser
+{
+public:
+	// Returns the sorted scene primitive indexes that were hit with line-of-sight but are not in the lookup table
+	static TArray<int32> FindUnknownScenePrimitiveIndexes(const FSonoTraceUEParseContext& Context);
+
+	// Fills ReflectedPoints, HitPersistentPrimitiveIndexes, MaximumCurvature and MaximumTotalDistance of the sub-output.
+	// Optionally returns the scene primitive index of every known hit primitive, in the same order as HitPersistentPrimitiveIndexes.
+	static void Parse(const FSonoTraceUEParseContext& Context, FSonoTraceUESubOutputStruct& OutSubOutput, TArray<int32>* OutHitScenePrimitiveIndexes = nullptr);
+
+	// Returns per receiver if it has line-of-sight to the sensor and the location used for the direct path
+	static void ParseDirectPath(const FSonoTraceUEParseContext& Context, TArray<TTuple<bool, FVector>>& OutDirectPathReceiverOutput);
+
+	static constexpr int32 RaysPerChunk = 512;
+};
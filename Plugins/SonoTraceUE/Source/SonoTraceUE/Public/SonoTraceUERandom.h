@@ -0,0 +1,127 @@
+// By Wouter Jansen & Jan Steckel, Cosys-Lab, University of Antwerp. See the LICENSE file for details.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+// Counter-based Philox4x32-10 generator (Salmon et al., "Parallel Random Numbers: As Easy as 1, 2, 3").
+// The random words are a pure function of the key and a 128 bit counter, so workers draw without shared state and every draw can be regenerated from its counter.
+// The key holds the seed and a stream, the counter holds the measurement, object, sample and draw indexes.
+struct FSonoTraceUEPhilox
+{
+	// Streams keep the users of the generator apart, so they never draw the same numbers for the same counter
+	enum class EStream : uint32
+	{
+		Diffraction = 1,
+		DrawSelection = 2,
+		DiffractionSequence = 3,
+	};
+
+	FSonoTraceUEPhilox(const uint32 Seed, const EStream Stream)
+		: Key0(Seed), Key1(static_cast<uint32>(Stream)) {}
+
+	FSonoTraceUEPhilox(const uint32 InKey0, const uint32 InKey1)
+		: Key0(InKey0), Key1(InKey1) {}
+
+	// Ten Philox rounds on the counter, the Weyl sequence bumps the key between the rounds
+	void Generate(const uint32 (&Counter)[4], uint32 (&OutWords)[4]) const
+	{
+		uint32 C0 = Counter[0], C1 = Counter[1], C2 = Counter[2], C3 = Counter[3];
+		uint32 K0 = Key0, K1 = Key1;
+		for (int32 Round = 0; Round < 10; Round++)
+		{
+			const uint64 Product0 = static_cast<uint64>(0xD2511F53u) * C0;
+			const uint64 Product1 = static_cast<uint64>(0xCD9E8D57u) * C2;
+			C0 = static_cast<uint32>(Product1 >> 32) ^ C1 ^ K0;
+			C1 = static_cast<uint32>(Product1);
+			C2 = static_cast<uint32>(Product0 >> 32) ^ C3 ^ K1;
+			C3 = static_cast<uint32>(Product0);
+			K0 += 0x9E3779B9u;
+			K1 += 0xBB67AE85u;
+		}
+		OutWords[0] = C0;
+		OutWords[1] = C1;
+		OutWords[2] = C2;
+		OutWords[3] = C3;
+	}
+
+	// Four uniform numbers in [0, 1) for a draw of a sample of an object in a measurement
+	void GetUniforms(const uint32 Measurement, const uint32 Object, const uint32 Sample, const uint32 Draw, float (&OutUniforms)[4]) const
+	{
+		uint32 Words[4];
+		Generate({Sample, Draw, Object, Measurement}, Words);
+		for (int32 Index = 0; Index < 4; Index++)
+		{
+			OutUniforms[Index] = ToUniform(Words[Index]);
+		}
+	}
+
+	// A single random word, to seed generators that need one
+	uint32 GetSeed(const uint32 Measurement, const uint32 Object) const
+	{
+		uint32 Words[4];
+		Generate({0, 0, Object, Measurement}, Words);
+		return Words[0];
+	}
+
+	// The upper 24 bits fill the float mantissa, so the result is never rounded up to one
+	static float ToUniform(const uint32 Word)
+	{
+		return static_cast<float>(Word >> 8) * (1.0f / 16777216.0f);
+	}
+
+	uint32 Key0;
+	uint32 Key1;
+};
+
+// Owen-scrambled Sobol sequence in four dimensions, with the hash-based nested uniform scrambling of Burley ("Practical Hash-based Owen Scrambling", 2020).
+// Every seed gives an independent randomization of the sequence that keeps its low discrepancy, so the spread between differently seeded runs estimates the error.
+struct FSonoTraceUESobol
+{
+	static constexpr int32 NumberOfDimensions = 4;
+
+	// Point of the unscrambled sequence as a 32 bit fixed point number
+	static uint32 Generate(uint32 Index, const int32 Dimension)
+	{
+		// Direction numbers of the primitive polynomials x, x + 1, x^2 + x + 1 and x^3 + x + 1 (Joe and Kuo)
+		static constexpr uint32 DirectionNumbers[NumberOfDimensions][32] = {
+			{0x80000000, 0x40000000, 0x20000000, 0x10000000, 0x08000000, 0x04000000, 0x02000000, 0x01000000, 0x00800000, 0x00400000, 0x00200000, 0x00100000, 0x00080000, 0x00040000, 0x00020000, 0x00010000,
+			 0x00008000, 0x00004000, 0x00002000, 0x00001000, 0x00000800, 0x00000400, 0x00000200, 0x00000100, 0x00000080, 0x00000040, 0x00000020, 0x00000010, 0x00000008, 0x00000004, 0x00000002, 0x00000001},
+			{0x80000000, 0xc0000000, 0xa0000000, 0xf0000000, 0x88000000, 0xcc000000, 0xaa000000, 0xff000000, 0x80800000, 0xc0c00000, 0xa0a00000, 0xf0f00000, 0x88880000, 0xcccc0000, 0xaaaa0000, 0xffff0000,
+			 0x80008000, 0xc000c000, 0xa000a000, 0xf000f000, 0x88008800, 0xcc00cc00, 0xaa00aa00, 0xff00ff00, 0x80808080, 0xc0c0c0c0, 0xa0a0a0a0, 0xf0f0f0f0, 0x88888888, 0xcccccccc, 0xaaaaaaaa, 0xffffffff},
+			{0x80000000, 0xc0000000, 0x60000000, 0x90000000, 0xe8000000, 0x5c000000, 0x8e000000, 0xc5000000, 0x68800000, 0x9cc00000, 0xee600000, 0x55900000, 0x80680000, 0xc09c0000, 0x60ee0000, 0x90550000,
+			 0xe8808000, 0x5cc0c000, 0x8e606000, 0xc5909000, 0x6868e800, 0x9c9c5c00, 0xeeee8e00, 0x5555c500, 0x8000e880, 0xc0005cc0, 0x60008e60, 0x9000c590, 0xe8006868, 0x5c009c9c, 0x8e00eeee, 0xc5005555},
+			{0x80000000, 0xc0000000, 0x20000000, 0x50000000, 0xf8000000, 0x74000000, 0xa2000000, 0x93000000, 0xd8800000, 0x25400000, 0x59e00000, 0xe6d00000, 0x78080000, 0xb40c0000, 0x82020000, 0xc3050000,
+			 0x208f8000, 0x51474000, 0xfbea2000, 0x75d93000, 0xa0858800, 0x914e5400, 0xdbe79e00, 0x25db6d00, 0x58800080, 0xe54000c0, 0x79e00020, 0xb6d00050, 0x800800f8, 0xc00c0074, 0x200200a2, 0x50050093}};
+		uint32 Result = 0;
+		for (int32 Bit = 0; Index != 0; Index >>= 1, Bit++)
+		{
+			if (Index & 1)
+				Result ^= DirectionNumbers[Dimension][Bit];
+		}
+		return Result;
+	}
+
+	// Owen scrambling of a 32 bit fixed point number, every bit is flipped depending on a hash of the bits above it
+	static uint32 NestedUniformScramble(uint32 Value, const uint32 Seed)
+	{
+		Value = ReverseBits(Value);
+		Value += Seed;
+		Value ^= Value * 0x6c50b47cu;
+		Value ^= Value * 0xb82f1e52u;
+		Value ^= Value * 0xc7afe638u;
+		Value ^= Value * 0x8d22f6e6u;
+		return ReverseBits(Value);
+	}
+
+	// All dimensions of a point of the sequence randomized by the seed, the index is shuffled as well so prefixes of different seeds are independent
+	static void GetUniforms(const uint32 Index, const uint32 Seed, float (&OutUniforms)[NumberOfDimensions])
+	{
+		const uint32 ShuffledIndex = NestedUniformScramble(Index, HashCombineFast(Seed, 0x5bd1e995u));
+		for (int32 Dimension = 0; Dimension < NumberOfDimensions; Dimension++)
+		{
+			const uint32 Scrambled = NestedUniformScramble(Generate(ShuffledIndex, Dimension), HashCombineFast(Seed, static_cast<uint32>(Dimension)));
+			OutUniforms[Dimension] = FSonoTraceUEPhilox::ToUniform(Scrambled);
+		}
+	}
+};
@@ -0,0 +1,60 @@
+// By Wouter Jansen & Jan Steckel, Cosys-Lab, University of Antwerp. See the LICENSE file for details.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Async/ParallelFor.h"
+
+// Maxima and hit count of the points of a (sub-)output.
+// Partial statistics are gathered separately and merged afterward, so parallel loops never write to shared state.
+struct FSonoTraceUEPointStatistics
+{
+	void Add(const float Strength, const float Curvature, const float TotalDistance)
+	{
+		MaximumStrength = FMath::Max(MaximumStrength, Strength);
+		MaximumCurvature = FMath::Max(MaximumCurvature, Curvature);
+		MaximumTotalDistance = FMath::Max(MaximumTotalDistance, TotalDistance);
+		NumberOfHits++;
+	}
+
+	void Merge(const FSonoTraceUEPointStatistics& Other)
+	{
+		MaximumStrength = FMath::Max(MaximumStrength, Other.MaximumStrength);
+		MaximumCurvature = FMath::Max(MaximumCurvature, Other.MaximumCurvature);
+		MaximumTotalDistance = FMath::Max(MaximumTotalDistance, Other.MaximumTotalDistance);
+		NumberOfHits += Other.NumberOfHits;
+	}
+
+	float MaximumStrength = 0.0f;
+	float MaximumCurvature = 0.0f;
+	float MaximumTotalDistance = 0.0f;
+	int32 NumberOfHits = 0;
+};
+
+namespace SonoTraceUEStatistics
+{
+	// Every worker owns a full cache line so the partials do not contend
+	struct alignas(PLATFORM_CACHE_LINE_SIZE) FWorkerStatistics
+	{
+		FSonoTraceUEPointStatistics Statistics;
+	};
+}
+
+// ParallelFor where the body gathers into the statistics of the worker it runs on, Body(FSonoTraceUEPointStatistics&, int32 Index).
+// Returns the merged statistics of all workers.
+template <typename BodyType>
+FSonoTraceUEPointStatistics ParallelForWithStatistics(const int32 Num, const BodyType& Body, const EParallelForFlags Flags = EParallelForFlags::None)
+{
+	TArray<SonoTraceUEStatistics::FWorkerStatistics> WorkerStatistics;
+	ParallelForWithTaskContext(WorkerStatistics, Num, [&Body](SonoTraceUEStatistics::FWorkerStatistics& Worker, const int32 Index)
+	{
+		Body(Worker.Statistics, Index);
+	}, Flags);
+
+	FSonoTraceUEPointStatistics Statistics;
+	for (const SonoTraceUEStatistics::FWorkerStatistics& Worker : WorkerStatistics)
+	{
+		Statistics.Merge(Worker.Statistics);
+	}
+	return Statistics;
+}
@@ -0,0 +1,64 @@
+// By Wouter Jansen & Jan Steckel, Cosys-Lab, University of Antwerp. See the LICENSE file for details.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+// Strength models of the specular, diffraction and direct path components.
+// Every kernel evaluates all paths of a single point for all simulation frequencies at once, the strengths are written path-major like a strength tensor block.
+// The kernels run in ISPC when the engine is built with it and fall back to flat loops the compiler can vectorize otherwise.
+// All kernels return the sum of the squared strengths they have written and whether that sum is above the given minimum,
+// so the caller can reject a point before it is filled in. A negative minimum keeps every point.
+// Optional per receiver gains (Receiver x Frequency) multiply the strengths, they repeat every Gains.Num() / NumberOfFrequencies paths so they apply to all emitters.
+struct FSonoTraceUEStrengthKernelResult
+{
+	float SummedSquaredStrength = 0.0f;
+	bool IsKept = true;
+};
+
+class SONOTRACEUE_API FSonoTraceUEStrengthKernels
+{
+public:
+	// Natural-log absorption per meter of every frequency (in Hz), so the absorption over a path is exp(LogAbsorption * Distance)
+	static void CalculateLogAbsorptions(TConstArrayView<float> Frequencies, TArray<float>& OutLogAbsorptions);
+
+	// Strength = Scale * SurfaceMaterial * exp(-ReflectionAngle^2 / (2 * SurfaceBRDF^2)) * exp(LogAbsorption * AbsorptionDistance)
+	// ReflectionCosines and Scales hold one value per path, the reflection angle is taken in degrees.
+	static FSonoTraceUEStrengthKernelResult Specular(TArrayView<float> OutStrengths, TConstArrayView<float> ReflectionCosines, TConstArrayView<float> Scales,
+	                                                 TConstArrayView<float> SurfaceBRDF, TConstArrayView<float> SurfaceMaterial, TConstArrayView<float> LogAbsorptions, const float AbsorptionDistance,
+	                                                 TConstArrayView<float> Gains = TConstArrayView<float>(), const float MinimumSummedSquaredStrength = -1.0f);
+
+	// Strength = MaterialStrength / Distance^2 * exp(LogAbsorption * Distance), distances in meters per path
+	static FSonoTraceUEStrengthKernelResult Diffraction(TArrayView<float> OutStrengths, TConstArrayView<float> Distances, TConstArrayView<float> MaterialStrengths, TConstArrayView<float> LogAbsorptions,
+	                                                    TConstArrayView<float> Gains = TConstArrayView<float>(), const float MinimumSummedSquaredStrength = -1.0f);
+
+	// Strength = DirectPathStrength / Distance^2 * exp(LogAbsorption * Distance), distances in meters per path. Paths with a distance of zero or less are left at zero.
+	static FSonoTraceUEStrengthKernelResult DirectPath(TArrayView<float> OutStrengths, TConstArrayView<float> Distances, const float DirectPathStrength, TConstArrayView<float> LogAbsorptions,
+	                                                   TConstArrayView<float> Gains = TConstArrayView<float>(), const float MinimumSummedSquaredStrength = -1.0f);
+
+private:
+	static FSonoTraceUEStrengthKernelResult MakeResult(const float SummedSquaredStrength, const float MinimumSummedSquaredStrength)
+	{
+		return {SummedSquaredStrength, SummedSquaredStrength > MinimumSummedSquaredStrength};
+	}
+};
+
+// Far-field array factor |sum(exp(j * 2pi * f * (Offset . Direction) / c))| of the emitter pattern lattice per direction and frequency.
+// Folds all virtual receivers of a real receiver into a single gain, so the simulation cost scales with the real receivers.
+struct SONOTRACEUE_API FSonoTraceUEArrayGainTable
+{
+	// Offsets in centimeters in the sensor frame, frequencies in Hz and the speed of sound in meters per second
+	void Build(TConstArrayView<FVector> Offsets, TConstArrayView<float> Frequencies, const float SpeedOfSound);
+
+	// Bilinear interpolation of the gain of every frequency for a direction of arrival in the sensor frame
+	void GetGains(const FVector& LocalDirection, TArrayView<float> OutGains) const;
+
+	bool IsValid() const { return Gains.Num() > 0; }
+
+	static constexpr float Resolution = 2.0f; // Degrees
+	static constexpr int32 NumberOfAzimuths = 181;
+	static constexpr int32 NumberOfElevations = 91;
+
+	int32 NumberOfFrequencies = 0;
+	TArray<float> Gains; // Elevation // Azimuth // Frequency
+};
@@ -0,0 +1,143 @@
+// By Wouter Jansen & Jan Steckel, Cosys-Lab, University of Antwerp. See the LICENSE file for details.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "SonoTraceUEActor.h"
+#include "SonoTraceUEHeightfield.h"
+#include "SonoTraceCPU.h"
+#include "SonoTraceUESubsystem.generated.h"
+
+class ALandscapeProxy;
+
+typedef TSharedPtr<const TArray<FSonoTraceUEMeshDataPtr>, ESPMode::ThreadSafe> FSonoTraceUEMeshDataSnapshotPtr;
+
+// Mesh data of a tile of a landscape, generated in a background task from the heights sampled on the game thread
+struct FSonoTraceUELandscapeTile
+{
+	int32 MeshDataIndex = INDEX_NONE; // INDEX_NONE until the first result is swapped in
+	UE::Tasks::FTask Task;
+	TSharedPtr<FSonoTraceUEMeshDataStruct, ESPMode::ThreadSafe> Result;
+	TSharedPtr<FSonoTraceCPUMesh, ESPMode::ThreadSafe> CPUMesh; // Only built when the sensors use the CPU raytracing backend, placed in their scenes once the task finished
+};
+
+// A landscape of which the mesh data is streamed in tiles around the sensors instead of generated from all of its triangles at once
+struct FSonoTraceUELandscape
+{
+	TWeakObjectPtr<ALandscapeProxy> Landscape;
+	FName Label;
+	int32 ObjectTypeIndex = 0;
+	FTransform LandscapeTransform = FTransform::Identity; // Local units are quads
+	FIntRect Extent; // Vertices covered by the landscape components
+	int32 TileNumberOfQuads = 64;
+	TArray<int32> PersistentPrimitiveIndexes;
+	TMap<FIntPoint, FSonoTraceUELandscapeTile> Tiles;
+	FSonoTraceUEHeightfieldPtr Heightfield; // Last published loaded tiles
+
+	// Horizontal distance from the closest sensor to a tile, the height is ignored so tiles are rather loaded too early than too late
+	double GetTileDistance(const FIntPoint& Tile, const TArray<FVector>& SensorLocations) const;
+	// The mesh data of the tiles is in the frame of the landscape without its scale
+	FTransform GetTileTransform() const { return FTransform(LandscapeTransform.GetRotation(), LandscapeTransform.GetTranslation()); }
+};
+
+// Mesh data, primitive index tables and object settings of all objects in the world, shared by every sensor using the same input settings.
+// Only mutated on the game thread. The parse and simulation tasks of its sensors read published snapshots of the mesh data and the primitive lookup,
+// so objects are added and removed without waiting for them. The object settings do not change after initialization.
+UCLASS()
+class SONOTRACEUE_API USonoTraceUEMeshRegistry : public UObject
+{
+	GENERATED_BODY()
+
+	friend class ASonoTraceUEActor;
+	friend class USonoTraceUESubsystem;
+
+public:
+	void Initialize(USonoTraceUEInputSettingsData* NewInputSettings);
+	void Tick();
+	void WaitForReaders() const;
+	FSonoTraceUEMeshDataSnapshotPtr PublishMeshData();
+	int32 GetNumberOfPendingMeshData() const { return PendingMeshData.Num(); }
+	int32 GetNumberOfSensors() const { return Sensors.Num(); }
+	void LogMemoryReport() const;
+
+protected:
+	int32 AddMeshData(UMeshComponent* MeshComponent, UObject* MeshAsset, const int32 ObjectTypeIndex);
+	int32 AllocateMeshDataIndex();
+	void SetMeshData(const int32 MeshDataIndex, FSonoTraceUEMeshDataPtr NewMeshData);
+	void RemoveMeshData(const int32 MeshDataIndex);
+	void UpdatePendingMeshData();
+	void WaitForPendingMeshData();
+	void SetScenePrimitiveIndex(const int32 PersistentPrimitiveIndex, const int32 ScenePrimitiveIndex);
+	void RemoveScenePrimitiveIndex(const int32 PersistentPrimitiveIndex);
+	void ResolveScenePrimitive(const int32 ScenePrimitiveIndex, const int32 PersistentPrimitiveIndex, const FName Label, const FName ResourceName);
+	void MoveScenePrimitive(const int32 PersistentPrimitiveIndex, const int32 ScenePrimitiveIndex);
+	void AddInstanceHierarchy(const int32 PersistentPrimitiveIndex, const UInstancedStaticMeshComponent* MeshComponent);
+	void UpdateInstanceHierarchies();
+	bool AddLandscape(ALandscapeProxy* Landscape, const FString& ObjectNamePrefix);
+	bool RemoveLandscape(const ALandscapeProxy* Landscape);
+	void UpdateLandscapeTiles();
+	void ReleaseLandscape(const int32 LandscapeIndex);
+	void PublishHeightfield(FSonoTraceUELandscape& Landscape);
+	void AddMeshComponentToSensors(UMeshComponent* MeshComponent, const UObject* MeshAsset, const int32 PersistentPrimitiveIndex) const;
+	void RemoveMeshComponentFromSensors(const UMeshComponent* MeshComponent) const;
+	void AddMeshToSensors(const FSonoTraceCPUMeshPtr& Mesh, const FTransform& Transform, const int32 PersistentPrimitiveIndex) const;
+	void RemoveMeshFromSensors(const FSonoTraceCPUMesh* Mesh) const;
+	void DrawMeshDebug(const UMeshComponent* MeshComponent, const FSonoTraceUEMeshDataStruct& NewMeshData, const FSonoTraceUEObjectSettingsStruct* ObjectSettings) const;
+
+	UPROPERTY()
+	USonoTraceUEInputSettingsData* InputSettings = nullptr;
+	TArray<TWeakObjectPtr<ASonoTraceUEActor>> Sensors;
+	bool InitialMeshDataGenerated = false;
+
+	TArray<FSonoTraceUEObjectSettingsStruct> ObjectSettings;
+	UPROPERTY()
+	TMap<UObject*, int32> AssetToObjectTypeIndexSettings;
+	TMap<int32, TTuple<FName, int32>> PersistentPrimitiveIndexToLabelsAndObjectTypes;
+	UPROPERTY()
+	TMap<int32, UPrimitiveComponent*> PersistentPrimitiveIndexToPrimitiveComponent;
+	TMap<int32, int32> PersistentPrimitiveIndexToMeshDataIndex;
+	TArray<FSonoTraceUEMeshDataPtr> MeshData;
+	// Copy of the mesh data slots handed to the parse tasks, only copied again after a slot changed
+	FSonoTraceUEMeshDataSnapshotPtr PublishedMeshData;
+	bool MeshDataChanged = true;
+	// Slots of removed meshes, reused so the mesh data indexes of the other objects stay valid
+	TArray<int32> FreeMeshDataIndexes;
+	TArray<FSonoTraceUEPendingMeshData> PendingMeshData;
+	UPROPERTY()
+	TMap<UStaticMesh*, int32> StaticMeshToMeshDataIndex;
+	UPROPERTY()
+	TMap<USkeletalMesh*, int32> SkeletalMeshToMeshDataIndex;
+	UPROPERTY()
+	TMap<UStaticMesh*, int32> StaticMeshCounter;
+	UPROPERTY()
+	TMap<USkeletalMesh*, int32> SkeletalMeshCounter;
+	// SPI of every object in the primitive lookup, so an object can be moved or removed without searching the lookup
+	TMap<int32, int32> PersistentPrimitiveIndexToScenePrimitiveIndex;
+	FSonoTraceUEPrimitiveLookupBuffer PrimitiveLookup;
+	// Instance bounds of every instanced object, rebuilt when its instances change
+	TMap<int32, FSonoTraceUEInstanceHierarchyPtr> PersistentPrimitiveIndexToInstanceHierarchy;
+	// Landscapes with their loaded tiles, each landscape component resolves its hits through the heightfield of its landscape
+	TArray<FSonoTraceUELandscape> Landscapes;
+	TMap<int32, FSonoTraceUEHeightfieldPtr> PersistentPrimitiveIndexToHeightfield;
+};
+
+// Owns one mesh registry per input settings asset so sensors sharing their settings also share the mesh data of the world.
+// A registry is released when its last sensor ends play.
+UCLASS()
+class SONOTRACEUE_API USonoTraceUESubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	USonoTraceUEMeshRegistry* RegisterSensor(ASonoTraceUEActor* Sensor, USonoTraceUEInputSettingsData* InputSettings);
+	void UnregisterSensor(ASonoTraceUEActor* Sensor, USonoTraceUEMeshRegistry* MeshRegistry);
+
+protected:
+	UPROPERTY()
+	TMap<TObjectPtr<USonoTraceUEInputSettingsData>, TObjectPtr<USonoTraceUEMeshRegistry>> Registries;
+};
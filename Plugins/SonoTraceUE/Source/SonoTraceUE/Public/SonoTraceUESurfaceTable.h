@@ -0,0 +1,32 @@
+// By Wouter Jansen & Jan Steckel, Cosys-Lab, University of Antwerp. See the LICENSE file for details.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+struct FSonoTraceUEObjectSettingsStruct;
+
+// BRDF opening angle and material strength per frequency of one object type against the quantized curvature magnitude of a triangle.
+// Both are sigmoids of the curvature with the transition settings of the object type, so triangles only store their curvature and look up their row when hit.
+struct SONOTRACEUE_API FSonoTraceUESurfaceTable
+{
+	static constexpr int32 NumberOfLevels = 1024;
+
+	// Levels are spread between zero curvature and the curvature at which both sigmoids are saturated
+	void Build(const FSonoTraceUEObjectSettingsStruct& ObjectSettings);
+
+	int32 GetLevel(const float CurvatureMagnitude) const
+	{
+		// Also maps infinite and NaN curvatures to the last level
+		return FMath::Clamp(FMath::RoundToInt32(FMath::Min(CurvatureMagnitude, MaximumCurvatureMagnitude) * LevelsPerCurvature), 0, NumberOfLevels - 1);
+	}
+
+	bool IsValid() const { return BRDF.Num() == NumberOfLevels; }
+
+	SIZE_T GetAllocatedSize() const;
+
+	float MaximumCurvatureMagnitude = 0.0f;
+	float LevelsPerCurvature = 0.0f;
+	TArray<TArray<float>> BRDF; // Level // Frequency
+	TArray<TArray<float>> Material; // Level // Frequency
+};
@@ -37,6 +37,7 @@ public class SonoTraceUE : ModuleRules
 				"GeometryCore",
 				"GeometryFramework",
 				"GeometryScriptingCore",
+				"Landscape",
 				// ... add other public dependencies that you statically link with here ...
 			}
 		);
@@ -60,6 +61,7 @@ public class SonoTraceUE : ModuleRules
 				"GeometryCore",
 				"GeometryFramework",
 				"GeometryScriptingCore",
+				"Landscape",
 				// ... add private dependencies that you statically link with here ...	
 			}
 		);